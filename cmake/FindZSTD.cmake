@@ -0,0 +1,44 @@
+# Tries to find libzstd headers and libraries
+#
+# Usage of this module as follows:
+#
+# find_package(ZSTD)
+#
+# Variables used by this module, they can change the default behaviour and need
+# to be set before calling find_package:
+#
+# ZSTD_ROOT_DIR  Set this variable to the root installation of libzstd if the
+# module has problems finding the proper installation path.
+#
+# Variables defined by this module:
+#
+# ZSTD_FOUND              System has ZSTD libs/headers ZSTD_LIBRARIES The ZSTD
+# libraries ZSTD_INCLUDE_DIR        The location of ZSTD headers
+
+find_path(
+  ZSTD_INCLUDE_DIR
+  NAMES zstd.h zdict.h
+  HINTS ${ZSTD_ROOT_DIR}/include)
+
+find_library(
+  ZSTD_LIBRARIES
+  NAMES zstd
+  HINTS ${ZSTD_ROOT_DIR}/lib)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ZSTD DEFAULT_MSG ZSTD_LIBRARIES
+                                  ZSTD_INCLUDE_DIR)
+
+mark_as_advanced(ZSTD_ROOT_DIR ZSTD_LIBRARIES ZSTD_INCLUDE_DIR)
+
+if (ZSTD_FOUND)
+  message(STATUS "Found libzstd: ${ZSTD_LIBRARIES}")
+endif ()
+
+# create IMPORTED target for libzstd dependency
+if (ZSTD_FOUND AND NOT TARGET zstd::zstd)
+  add_library(zstd::zstd UNKNOWN IMPORTED GLOBAL)
+  set_target_properties(
+    zstd::zstd PROPERTIES IMPORTED_LOCATION "${ZSTD_LIBRARIES}"
+                          INTERFACE_INCLUDE_DIRECTORIES "${ZSTD_INCLUDE_DIR}")
+endif ()
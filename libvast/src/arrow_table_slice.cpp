@@ -14,11 +14,13 @@
 #include "vast/arrow_table_slice.hpp"
 
 #include "vast/arrow_table_slice_builder.hpp"
+#include "vast/chunk.hpp"
 #include "vast/detail/byte_swap.hpp"
 #include "vast/detail/narrow.hpp"
 #include "vast/detail/overload.hpp"
 #include "vast/error.hpp"
 #include "vast/logger.hpp"
+#include "vast/synopsis.hpp"
 #include "vast/value_index.hpp"
 
 #include <caf/binary_deserializer.hpp>
@@ -29,6 +31,9 @@
 #include <arrow/ipc/reader.h>
 #include <arrow/ipc/writer.h>
 
+#include <cstdint>
+#include <cstring>
+
 namespace vast {
 
 arrow_table_slice::arrow_table_slice(table_slice_header header,
@@ -114,6 +119,20 @@ private:
   int64_t position_;
 };
 
+/// An Arrow buffer over the memory of a chunk that keeps the chunk alive.
+class arrow_chunk_buffer : public arrow::Buffer {
+public:
+  explicit arrow_chunk_buffer(chunk_ptr chunk)
+    : arrow::Buffer(reinterpret_cast<const uint8_t*>(chunk->data()),
+                    detail::narrow_cast<int64_t>(chunk->size())),
+      chunk_{std::move(chunk)} {
+    // nop
+  }
+
+private:
+  chunk_ptr chunk_;
+};
+
 } // namespace
 
 caf::error arrow_table_slice::serialize(caf::serializer& sink) const {
@@ -157,6 +176,38 @@ caf::error arrow_table_slice::deserialize(caf::deserializer& source) {
   return caf::none;
 }
 
+caf::error arrow_table_slice::load(chunk_ptr chunk) {
+  VAST_ASSERT(chunk != nullptr);
+  if (rows() == 0) {
+    batch_ = nullptr;
+    return caf::none;
+  }
+  // Reading from a buffer yields slices of that buffer, so the columns of the
+  // record batch point directly into the chunk. Arrow requires the buffers of
+  // a record batch to be 8-byte aligned, but the data of a table slice starts
+  // right after its header. Hence, we copy the data if the chunk is not
+  // suitably aligned.
+  std::shared_ptr<arrow::Buffer> buffer;
+  if (reinterpret_cast<uintptr_t>(chunk->data()) % 8 == 0) {
+    buffer = std::make_shared<arrow_chunk_buffer>(std::move(chunk));
+  } else {
+    auto copy = arrow::AllocateBuffer(
+      detail::narrow_cast<int64_t>(chunk->size()));
+    if (!copy.ok())
+      return ec::unspecified;
+    std::memcpy((*copy)->mutable_data(), chunk->data(), chunk->size());
+    buffer = std::move(*copy);
+  }
+  arrow::io::BufferReader input_stream{std::move(buffer)};
+  auto reader_result = arrow::ipc::RecordBatchStreamReader::Open(&input_stream);
+  if (!reader_result.ok())
+    return ec::unspecified;
+  auto reader = std::move(*reader_result);
+  if (!reader->ReadNext(&batch_).ok())
+    return ec::unspecified;
+  return caf::none;
+}
+
 caf::atom_value arrow_table_slice::implementation_id() const noexcept {
   return class_id;
 }
@@ -654,6 +705,66 @@ private:
   value_index& idx_;
 };
 
+class synopsis_applier {
+public:
+  synopsis_applier(const type& t, synopsis& syn) : type_(t), syn_(syn) {
+    // nop
+  }
+
+  template <class T, class Array, class Getter>
+  void apply_batch(const Array& arr, Getter f) {
+    std::vector<T> xs;
+    xs.reserve(detail::narrow_cast<size_t>(arr.length()));
+    if (arr.null_count() == 0)
+      for (int64_t row = 0; row < arr.length(); ++row)
+        xs.push_back(f(arr, row));
+    else
+      for (int64_t row = 0; row < arr.length(); ++row)
+        if (!arr.IsNull(row))
+          xs.push_back(f(arr, row));
+    syn_.add_batch(span<const T>{xs});
+  }
+
+  template <class T>
+  void operator()(const arrow::NumericArray<T>& arr, const real_type&) {
+    apply_batch<real>(arr, real_at);
+  }
+
+  template <class T>
+  void operator()(const arrow::NumericArray<T>& arr, const integer_type&) {
+    apply_batch<integer>(arr, integer_at);
+  }
+
+  template <class T>
+  void operator()(const arrow::NumericArray<T>& arr, const count_type&) {
+    apply_batch<count>(arr, count_at);
+  }
+
+  void operator()(const arrow::FixedSizeBinaryArray& arr, const address_type&) {
+    apply_batch<address>(arr, address_at);
+  }
+
+  void operator()(const arrow::StringArray& arr, const string_type&) {
+    apply_batch<std::string_view>(arr, string_at);
+  }
+
+  void operator()(const arrow::TimestampArray& arr, const time_type&) {
+    apply_batch<time>(arr, timestamp_at);
+  }
+
+  // All other types go through the generic per-value interface.
+  template <class Array, class Type>
+  void operator()(const Array& arr, const Type&) {
+    for (int64_t row = 0; row < arr.length(); ++row)
+      if (!arr.IsNull(row))
+        syn_.add(value_at(type_, arr, detail::narrow_cast<size_t>(row)));
+  }
+
+private:
+  const type& type_;
+  synopsis& syn_;
+};
+
 } // namespace
 
 // -- remaining implementation of arrow_table_slice ----------------------------
@@ -672,4 +783,12 @@ void arrow_table_slice::append_column_to_index(size_type col,
   decode(layout().fields[col].type, *arr, f);
 }
 
+void arrow_table_slice::append_column_to_synopsis(size_type col,
+                                                  synopsis& syn) const {
+  auto& t = layout().fields[col].type;
+  synopsis_applier f{t, syn};
+  auto arr = batch_->column(detail::narrow_cast<int>(col));
+  decode(t, *arr, f);
+}
+
 } // namespace vast
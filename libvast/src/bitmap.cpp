@@ -46,6 +46,26 @@ void bitmap::flip() {
   caf::visit([](auto& bm) { bm.flip(); }, bitmap_);
 }
 
+bitmap& bitmap::operator&=(const bitmap& other) {
+  auto x = caf::get_if<roaring_bitmap>(&bitmap_);
+  auto y = caf::get_if<roaring_bitmap>(&other.bitmap_);
+  if (x && y)
+    *x &= *y;
+  else
+    *this = binary_and(*this, other);
+  return *this;
+}
+
+bitmap& bitmap::operator|=(const bitmap& other) {
+  auto x = caf::get_if<roaring_bitmap>(&bitmap_);
+  auto y = caf::get_if<roaring_bitmap>(&other.bitmap_);
+  if (x && y)
+    *x |= *y;
+  else
+    *this = binary_or(*this, other);
+  return *this;
+}
+
 bitmap::variant& bitmap::get_data() {
   return bitmap_;
 }
@@ -84,4 +104,36 @@ bitmap_bit_range bit_range(const bitmap& bm) {
   return bitmap_bit_range{bm};
 }
 
+bitmap binary_and(const bitmap& lhs, const bitmap& rhs) {
+  auto& x = lhs.get_data();
+  auto& y = rhs.get_data();
+  if (auto l = caf::get_if<ewah_bitmap>(&x))
+    if (auto r = caf::get_if<ewah_bitmap>(&y))
+      return binary_and(*l, *r);
+  if (auto l = caf::get_if<roaring_bitmap>(&x))
+    if (auto r = caf::get_if<roaring_bitmap>(&y)) {
+      auto result = *l;
+      result &= *r;
+      return result;
+    }
+  auto op = [](auto l, auto r) { return l & r; };
+  return binary_eval<false, false>(lhs, rhs, op);
+}
+
+bitmap binary_or(const bitmap& lhs, const bitmap& rhs) {
+  auto& x = lhs.get_data();
+  auto& y = rhs.get_data();
+  if (auto l = caf::get_if<ewah_bitmap>(&x))
+    if (auto r = caf::get_if<ewah_bitmap>(&y))
+      return binary_or(*l, *r);
+  if (auto l = caf::get_if<roaring_bitmap>(&x))
+    if (auto r = caf::get_if<roaring_bitmap>(&y)) {
+      auto result = *l;
+      result |= *r;
+      return result;
+    }
+  auto op = [](auto l, auto r) { return l | r; };
+  return binary_eval<true, true>(lhs, rhs, op);
+}
+
 } // namespace vast
@@ -13,10 +13,47 @@
 
 #include "vast/bloom_filter_synopsis.hpp"
 
+#include <vast/defaults.hpp>
 #include <vast/detail/assert.hpp>
 
+#include <caf/config_value.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
 namespace vast {
 
+namespace {
+
+/// Rounds down the number of cells of a Bloom filter to a multiple of a
+/// power of two number of blocks, which keeps it within the memory budget.
+/// This costs at most 1/64 of the cells, and allows for folding the Bloom
+/// filter down to less than 8192 cells.
+size_t foldable_size(size_t m) {
+  size_t granularity = 64;
+  while (granularity * 64 <= m)
+    granularity *= 2;
+  auto result = m / granularity * granularity;
+  return result > 0 ? result : m;
+}
+
+} // namespace
+
+size_t shrunk_size(size_t m, size_t k, size_t n, double p) {
+  // An optimal Bloom filter with m bits and k hash functions for n elements
+  // has a false-positive probability of (1 - exp(-kn/m))^k.
+  auto false_positive_probability = [&](size_t size) {
+    auto x = static_cast<double>(k) * static_cast<double>(n)
+             / static_cast<double>(size);
+    return std::pow(1 - std::exp(-x), static_cast<double>(k));
+  };
+  auto result = m;
+  while (result % 128 == 0 && false_positive_probability(result / 2) <= p)
+    result /= 2;
+  return result;
+}
+
 caf::optional<bloom_filter_parameters> parse_parameters(const type& x) {
   auto pred = [](auto& attr) {
     return attr.key == "synopsis" && attr.value != caf::none;
@@ -28,4 +65,41 @@ caf::optional<bloom_filter_parameters> parse_parameters(const type& x) {
   return parse_parameters(*i->value);
 }
 
+caf::optional<bloom_filter_parameters>
+make_parameters(type& x, const caf::settings& opts) {
+  if (auto xs = parse_parameters(x))
+    return xs;
+  // If no explicit Bloom filter parameters were attached to the type, we try
+  // to use the maximum partition size of the index as upper bound for the
+  // expected number of events.
+  using int_type = caf::config_value::integer;
+  auto max_part_size = caf::get_if<int_type>(&opts, "max-partition-size");
+  if (!max_part_size || *max_part_size <= 0)
+    return caf::none;
+  auto n = static_cast<double>(*max_part_size);
+  auto p = 0.01;
+  // An optimal Bloom filter with m bits for n elements has a false-positive
+  // probability of exp(-m/n * ln(2)^2).
+  static const double ln2 = std::log(2.0);
+  auto max_bits = 8.0
+                  * caf::get_or(opts, "max-synopsis-size",
+                                defaults::system::max_synopsis_size);
+  p = std::clamp(std::exp(-max_bits / n * ln2 * ln2), p, 0.5);
+  using namespace std::string_literals;
+  auto v = "bloomfilter("s + std::to_string(*max_part_size) + ','
+           + std::to_string(p) + ')';
+  x = x.attributes({{"synopsis", std::move(v)}});
+  auto xs = parse_parameters(x);
+  if (!xs)
+    return caf::none;
+  auto ys = evaluate(*xs);
+  if (!ys)
+    return caf::none;
+  // The number of cells and the expected number of elements determine the
+  // remaining parameters.
+  xs->m = foldable_size(*ys->m);
+  xs->p = caf::none;
+  return xs;
+}
+
 } // namespace vast
@@ -43,6 +43,15 @@ caf::optional<bool> bool_synopsis::lookup(relational_operator op,
   return caf::none;
 }
 
+bool bool_synopsis::merge(const synopsis& other) {
+  if (typeid(other) != typeid(bool_synopsis))
+    return false;
+  auto& rhs = static_cast<const bool_synopsis&>(other);
+  false_ = false_ || rhs.false_;
+  true_ = true_ || rhs.true_;
+  return true;
+}
+
 bool bool_synopsis::equals(const synopsis& other) const noexcept {
   if (typeid(other) != typeid(bool_synopsis))
     return false;
@@ -13,16 +13,88 @@
 
 #include "vast/column_index.hpp"
 
+#include "vast/chunk.hpp"
+#include "vast/error.hpp"
+#include "vast/ewah_bitmap.hpp"
 #include "vast/expression_visitors.hpp"
+#include "vast/fbs/utils.hpp"
+#include "vast/fbs/value_index.hpp"
+#include "vast/io/save.hpp"
 #include "vast/load.hpp"
 #include "vast/logger.hpp"
-#include "vast/save.hpp"
 #include "vast/table_slice.hpp"
 #include "vast/table_slice_column.hpp"
 #include "vast/value_index_factory.hpp"
 
+#include <caf/stream_deserializer.hpp>
+#include <caf/stream_serializer.hpp>
+#include <caf/streambuf.hpp>
+
 namespace vast {
 
+namespace {
+
+class block_writing_serializer : public caf::stream_serializer<caf::vectorbuf&>,
+                                 public ewah_block_writer {
+public:
+  using super = caf::stream_serializer<caf::vectorbuf&>;
+
+  explicit block_writing_serializer(caf::vectorbuf& buf) : super{nullptr, buf} {
+    // nop
+  }
+};
+
+class block_reading_deserializer
+  : public caf::stream_deserializer<caf::arraybuf<char>&>,
+    public ewah_block_reader {
+public:
+  using super = caf::stream_deserializer<caf::arraybuf<char>&>;
+
+  block_reading_deserializer(caf::arraybuf<char>& buf,
+                             span<const ewah_bitmap::block_type> blocks,
+                             chunk_ptr owner)
+    : super{nullptr, buf}, ewah_block_reader{blocks, std::move(owner)} {
+    // nop
+  }
+};
+
+/// Packs the state of a column index into a ValueIndex flatbuffer. The blocks
+/// of all EWAH bitmaps end up in a single aligned array.
+caf::expected<chunk_ptr>
+pack(value_index::size_type last_flush, const value_index_ptr& idx) {
+  std::vector<char> state;
+  caf::vectorbuf buf{state};
+  block_writing_serializer sink{buf};
+  if (auto err = sink(last_flush, idx))
+    return err;
+  flatbuffers::FlatBufferBuilder builder;
+  auto data = reinterpret_cast<const uint8_t*>(state.data());
+  auto packed_state = builder.CreateVector(data, state.size());
+  auto& blocks = sink.blocks();
+  auto packed_blocks = builder.CreateVector(blocks.data(), blocks.size());
+  auto root = fbs::CreateValueIndex(builder, fbs::Version::v0, packed_state,
+                                    packed_blocks);
+  builder.Finish(root, fbs::file_identifier);
+  return fbs::release(builder);
+}
+
+/// Unpacks the state of a column index from a ValueIndex flatbuffer. All EWAH
+/// bitmaps of the value index reference their blocks in *chunk*.
+caf::error unpack(const fbs::ValueIndex& x, chunk_ptr chunk,
+                  value_index::size_type& last_flush, value_index_ptr& idx) {
+  if (auto err = fbs::check_version(x.version(), fbs::Version::v0))
+    return err;
+  if (!x.state() || !x.blocks())
+    return make_error(ec::format_error, "incomplete value index");
+  auto data = reinterpret_cast<const char*>(x.state()->data());
+  caf::arraybuf<char> buf{const_cast<char*>(data), x.state()->size()};
+  auto blocks = span<const uint64_t>{x.blocks()->data(), x.blocks()->size()};
+  block_reading_deserializer source{buf, blocks, std::move(chunk)};
+  return source(last_flush, idx);
+}
+
+} // namespace
+
 // -- free functions -----------------------------------------------------------
 
 caf::expected<column_index_ptr>
@@ -57,7 +129,7 @@ caf::error column_index::init() {
   VAST_TRACE("");
   // Materialize the index when encountering persistent state.
   if (exists(filename_)) {
-    if (auto err = load(nullptr, filename_, last_flush_, idx_)) {
+    if (auto err = load_from_disk()) {
       VAST_ERROR(this, "failed to load value index from disk", sys_.render(err));
       return err;
     } else {
@@ -84,8 +156,34 @@ caf::error column_index::flush_to_disk() {
   auto offset = idx_->offset();
   VAST_DEBUG(this, "flushes index (", offset - last_flush_, '/', offset,
              "new/total bits)");
+  auto chk = pack(offset, idx_);
+  if (!chk)
+    return chk.error();
+  if (auto dir = filename_.parent(); !exists(dir))
+    if (auto err = mkdir(dir))
+      return err;
+  if (auto err = io::save(filename_, as_bytes(*chk)))
+    return err;
   last_flush_ = offset;
-  return save(nullptr, filename_, last_flush_, idx_);
+  return caf::none;
+}
+
+caf::error column_index::load_from_disk() {
+  auto chk = chunk::mmap(filename_);
+  if (!chk)
+    return make_error(ec::filesystem_error, "failed to mmap", filename_.str());
+  auto bytes = as_bytes(chk);
+  auto data = reinterpret_cast<const uint8_t*>(bytes.data());
+  // Files without an identifier predate the flatbuffer format and hold the
+  // CAF-serialized state of the column index.
+  if (bytes.size() < flatbuffers::kFileIdentifierLength + sizeof(uint32_t)
+      || !flatbuffers::BufferHasIdentifier(data, fbs::file_identifier))
+    return load(nullptr, filename_, last_flush_, idx_);
+  auto x = fbs::as_flatbuffer<fbs::ValueIndex>(bytes);
+  if (!x)
+    return make_error(ec::format_error, "failed to verify value index",
+                      filename_.str());
+  return unpack(*x, std::move(chk), last_flush_, idx_);
 }
 
 // -- properties -------------------------------------------------------------
@@ -107,6 +205,15 @@ caf::expected<bitmap> column_index::lookup(relational_operator op,
   return result;
 }
 
+caf::error column_index::merge(const column_index& other) {
+  VAST_TRACE(VAST_ARG(other.filename_));
+  VAST_ASSERT(idx_ != nullptr);
+  VAST_ASSERT(other.idx_ != nullptr);
+  if (has_skip_attribute_)
+    return caf::none;
+  return idx_->merge(*other.idx_);
+}
+
 bool column_index::dirty() const noexcept {
   VAST_ASSERT(idx_ != nullptr);
   return idx_->offset() != last_flush_;
@@ -0,0 +1,376 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/compiled_expression.hpp"
+
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/detail/assert.hpp"
+#include "vast/detail/overload.hpp"
+#include "vast/die.hpp"
+#include "vast/error.hpp"
+#include "vast/ids.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/view.hpp"
+
+#include <algorithm>
+#include <regex>
+
+namespace vast {
+
+namespace {
+
+/// Evaluates a unary predicate for every cell of a column and packs the
+/// outcomes into a selection bitmap, one block at a time.
+template <class Predicate>
+null_bitmap
+scan_column(const table_slice& slice, size_t column, Predicate pred) {
+  using word_type = null_bitmap::word_type;
+  null_bitmap result;
+  auto block = null_bitmap::block_type{0};
+  auto n = size_t{0};
+  for (size_t row = 0; row < slice.rows(); ++row) {
+    if (pred(slice.at(row, column)))
+      block |= word_type::mask(n);
+    if (++n == word_type::width) {
+      result.append_block(block);
+      block = 0;
+      n = 0;
+    }
+  }
+  if (n > 0)
+    result.append_block(block, n);
+  return result;
+}
+
+/// Creates a scanner for a column whose cells hold values of type `T`, and
+/// an RHS of type `U`. Cells of any other type, e.g., nil, take the generic
+/// path.
+template <class T, class U, class Compare>
+column_scanner make_typed_scanner(size_t column, relational_operator op,
+                                  data rhs, Compare cmp) {
+  auto y = caf::get<U>(rhs);
+  return [=](const table_slice& slice) {
+    return scan_column(slice, column, [&](const data_view& x) {
+      if (auto v = caf::get_if<view<T>>(&x))
+        return cmp(*v, y);
+      return evaluate_view(x, op, make_data_view(rhs));
+    });
+  };
+}
+
+/// Dispatches the comparison operators on values of type `T`.
+/// @returns an empty scanner if no typed fast path exists for *op* and *rhs*.
+template <class T>
+column_scanner make_ordered_scanner(size_t column, relational_operator op,
+                                    const data& rhs) {
+  if (!caf::holds_alternative<T>(rhs))
+    return {};
+  switch (op) {
+    default:
+      return {};
+    case equal:
+      return make_typed_scanner<T, T>(column, op, rhs, std::equal_to<>{});
+    case not_equal:
+      return make_typed_scanner<T, T>(column, op, rhs, std::not_equal_to<>{});
+    case less:
+      return make_typed_scanner<T, T>(column, op, rhs, std::less<>{});
+    case less_equal:
+      return make_typed_scanner<T, T>(column, op, rhs, std::less_equal<>{});
+    case greater:
+      return make_typed_scanner<T, T>(column, op, rhs, std::greater<>{});
+    case greater_equal:
+      return make_typed_scanner<T, T>(column, op, rhs,
+                                      std::greater_equal<>{});
+  }
+}
+
+/// Handles subnet membership tests on address columns.
+column_scanner make_address_scanner(size_t column, relational_operator op,
+                                    const data& rhs) {
+  if (caf::holds_alternative<subnet>(rhs)) {
+    auto contains = [](const address& x, const subnet& y) {
+      return y.contains(x);
+    };
+    auto excludes = [](const address& x, const subnet& y) {
+      return !y.contains(x);
+    };
+    if (op == in)
+      return make_typed_scanner<address, subnet>(column, op, rhs, contains);
+    if (op == not_in)
+      return make_typed_scanner<address, subnet>(column, op, rhs, excludes);
+    return {};
+  }
+  return make_ordered_scanner<address>(column, op, rhs);
+}
+
+/// Handles pattern matching on string columns. Compiling the regular
+/// expression once instead of once per cell dominates the savings.
+column_scanner make_string_scanner(size_t column, relational_operator op,
+                                   const data& rhs) {
+  if (auto pat = caf::get_if<pattern>(&rhs)) {
+    if (op != match && op != not_match)
+      return {};
+    auto rx = std::regex{pat->string()};
+    auto negate = op == not_match;
+    return [=](const table_slice& slice) {
+      return scan_column(slice, column, [&](const data_view& x) {
+        if (auto str = caf::get_if<view<std::string>>(&x))
+          return std::regex_match(str->begin(), str->end(), rx) != negate;
+        return evaluate_view(x, op, make_data_view(rhs));
+      });
+    };
+  }
+  return make_ordered_scanner<std::string>(column, op, rhs);
+}
+
+using opcode = compiled_expression::instruction::opcode;
+
+compiled_expression::instruction make_constant(bool value) {
+  auto result = compiled_expression::instruction{};
+  result.code = opcode::constant;
+  result.value = value;
+  return result;
+}
+
+compiled_expression::instruction make_scan(column_scanner scan) {
+  auto result = compiled_expression::instruction{};
+  result.code = opcode::scan;
+  result.scan = std::move(scan);
+  return result;
+}
+
+/// Translates a tailored expression into a flat program. Constant operands
+/// of connectives get folded away during compilation.
+struct compiler {
+  compiler(std::vector<compiled_expression::instruction>& program,
+           const record_type& layout)
+    : program_{program}, layout_{layout} {
+    // nop
+  }
+
+  caf::error operator()(caf::none_t) {
+    program_.push_back(make_constant(false));
+    return caf::none;
+  }
+
+  caf::error operator()(const conjunction& c) {
+    return connective(c, opcode::conjunction, false);
+  }
+
+  caf::error operator()(const disjunction& d) {
+    return connective(d, opcode::disjunction, true);
+  }
+
+  caf::error operator()(const negation& n) {
+    auto start = program_.size();
+    program_.push_back({});
+    program_[start].code = opcode::negation;
+    if (auto err = caf::visit(*this, n.expr()))
+      return err;
+    auto& child = program_[start + 1];
+    if (child.code == opcode::constant) {
+      auto value = !child.value;
+      program_.resize(start);
+      program_.push_back(make_constant(value));
+      return caf::none;
+    }
+    program_[start].extent = program_.size() - start;
+    return caf::none;
+  }
+
+  caf::error operator()(const predicate& p) {
+    op_ = p.op;
+    return caf::visit(*this, p.lhs, p.rhs);
+  }
+
+  caf::error operator()(const attribute_extractor& e, const data& d) {
+    if (e.attr == atom::type_v) {
+      program_.push_back(make_constant(evaluate(layout_.name(), op_, d)));
+    } else if (e.attr == atom::timestamp_v) {
+      // Locate the timestamp column once instead of once per row.
+      auto pred = [](auto& x) {
+        return caf::holds_alternative<time_type>(x.type)
+               && has_attribute(x.type, "timestamp");
+      };
+      auto& fs = layout_.fields;
+      auto i = std::find_if(fs.begin(), fs.end(), pred);
+      if (i == fs.end())
+        program_.push_back(make_constant(false));
+      else
+        program_.push_back(make_scan(make_column_scanner(
+          i->type, static_cast<size_t>(std::distance(fs.begin(), i)), op_,
+          d)));
+    } else {
+      program_.push_back(make_constant(false));
+    }
+    return caf::none;
+  }
+
+  caf::error operator()(const type_extractor& e, const data&) {
+    return make_error(ec::invalid_query, "unresolved type extractor", e);
+  }
+
+  caf::error operator()(const field_extractor& e, const data&) {
+    return make_error(ec::invalid_query, "unresolved field extractor", e);
+  }
+
+  caf::error operator()(const data_extractor& e, const data& d) {
+    if (e.type != layout_) {
+      program_.push_back(make_constant(false));
+      return caf::none;
+    }
+    VAST_ASSERT(e.offset.size() == 1);
+    auto column = e.offset[0];
+    program_.push_back(
+      make_scan(make_column_scanner(layout_.fields[column].type, column, op_,
+                                    d)));
+    return caf::none;
+  }
+
+  template <class T>
+  caf::error operator()(const data& d, const T& x) {
+    return (*this)(x, d);
+  }
+
+  template <class T, class U>
+  caf::error operator()(const T&, const U&) {
+    program_.push_back(make_constant(false));
+    return caf::none;
+  }
+
+  /// Compiles a conjunction or disjunction. A constant operand equal to
+  /// *dominant* decides the entire connective, whereas the other constant is
+  /// the neutral element and can be dropped.
+  template <class Connective>
+  caf::error connective(const Connective& xs, opcode code, bool dominant) {
+    auto start = program_.size();
+    program_.push_back({});
+    program_[start].code = code;
+    for (auto& x : xs) {
+      auto child = program_.size();
+      if (auto err = caf::visit(*this, x))
+        return err;
+      if (program_[child].code != opcode::constant)
+        continue;
+      if (program_[child].value == dominant) {
+        program_.resize(start);
+        program_.push_back(make_constant(dominant));
+        return caf::none;
+      }
+      program_.resize(child);
+    }
+    if (program_.size() == start + 1) {
+      program_.back() = make_constant(!dominant);
+      return caf::none;
+    }
+    program_[start].extent = program_.size() - start;
+    return caf::none;
+  }
+
+  std::vector<compiled_expression::instruction>& program_;
+  const record_type& layout_;
+  relational_operator op_;
+};
+
+} // namespace
+
+column_scanner
+make_column_scanner(type t, size_t column, relational_operator op, data rhs) {
+  auto fast_path = caf::visit(
+    detail::overload(
+      [&](const count_type&) {
+        return make_ordered_scanner<count>(column, op, rhs);
+      },
+      [&](const integer_type&) {
+        return make_ordered_scanner<integer>(column, op, rhs);
+      },
+      [&](const real_type&) {
+        return make_ordered_scanner<real>(column, op, rhs);
+      },
+      [&](const time_type&) {
+        return make_ordered_scanner<time>(column, op, rhs);
+      },
+      [&](const address_type&) {
+        return make_address_scanner(column, op, rhs);
+      },
+      [&](const string_type&) {
+        return make_string_scanner(column, op, rhs);
+      },
+      [&](const auto&) { return column_scanner{}; }),
+    t);
+  if (fast_path)
+    return fast_path;
+  return [=, t = std::move(t),
+          rhs = std::move(rhs)](const table_slice& slice) {
+    auto y = make_data_view(rhs);
+    return scan_column(slice, column, [&](const data_view& x) {
+      return evaluate_view(to_canonical(t, x), op, y);
+    });
+  };
+}
+
+caf::expected<compiled_expression>
+compiled_expression::make(const expression& expr, const record_type& layout) {
+  compiled_expression result;
+  if (auto err = caf::visit(compiler{result.program_, layout}, expr))
+    return err;
+  return result;
+}
+
+null_bitmap compiled_expression::operator()(const table_slice& slice) const {
+  VAST_ASSERT(!program_.empty());
+  return run(0, slice);
+}
+
+null_bitmap
+compiled_expression::run(size_t pc, const table_slice& slice) const {
+  auto& instr = program_[pc];
+  auto end = pc + instr.extent;
+  switch (instr.code) {
+    case opcode::constant:
+      return null_bitmap(slice.rows(), instr.value);
+    case opcode::scan:
+      return instr.scan(slice);
+    case opcode::conjunction: {
+      auto result = null_bitmap(slice.rows(), true);
+      // Skip the remaining operands once no row can qualify anymore.
+      for (auto i = pc + 1; i < end && !all<0>(result);
+           i += program_[i].extent)
+        result &= run(i, slice);
+      return result;
+    }
+    case opcode::disjunction: {
+      auto result = null_bitmap(slice.rows());
+      // Skip the remaining operands once all rows qualify.
+      for (auto i = pc + 1; i < end && !all<1>(result);
+           i += program_[i].extent)
+        result |= run(i, slice);
+      return result;
+    }
+    case opcode::negation: {
+      auto result = run(pc + 1, slice);
+      result.flip();
+      return result;
+    }
+  }
+  die("unhandled opcode in compiled expression");
+}
+
+ids evaluate(const table_slice& slice, const compiled_expression& expr) {
+  ids result;
+  result.append(false, slice.offset());
+  result.append(expr(slice));
+  return result;
+}
+
+} // namespace vast
@@ -18,6 +18,12 @@
 #include "vast/compression.hpp"
 #include "vast/die.hpp"
 
+#if VAST_HAVE_ZSTD
+#  include <memory>
+#  include <zdict.h>
+#  include <zstd.h>
+#endif
+
 namespace vast {
 namespace lz4 {
 
@@ -35,4 +41,62 @@ size_t uncompress(const char* in, size_t in_size, char* out, size_t out_size) {
 }
 
 } // namespace lz4
+
+#if VAST_HAVE_ZSTD
+
+namespace zstd {
+
+namespace {
+
+// Contexts are expensive to create, so every thread keeps one of each.
+
+ZSTD_CCtx* compression_context() {
+  thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> ctx{
+    ZSTD_createCCtx(), ZSTD_freeCCtx};
+  return ctx.get();
+}
+
+ZSTD_DCtx* decompression_context() {
+  thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> ctx{
+    ZSTD_createDCtx(), ZSTD_freeDCtx};
+  return ctx.get();
+}
+
+} // namespace
+
+size_t compress_bound(size_t size) {
+  return ZSTD_compressBound(size);
+}
+
+size_t compress(const char* in, size_t in_size, char* out, size_t out_size,
+                int level, const char* dict, size_t dict_size) {
+  auto n = ZSTD_compress_usingDict(compression_context(), out, out_size, in,
+                                   in_size, dict, dict_size, level);
+  return ZSTD_isError(n) ? 0 : n;
+}
+
+size_t uncompress(const char* in, size_t in_size, char* out, size_t out_size,
+                  const char* dict, size_t dict_size) {
+  auto n = ZSTD_decompress_usingDict(decompression_context(), out, out_size,
+                                     in, in_size, dict, dict_size);
+  return ZSTD_isError(n) ? 0 : n;
+}
+
+std::vector<char> train_dictionary(const std::vector<char>& samples,
+                                   const std::vector<size_t>& sizes,
+                                   size_t max_size) {
+  std::vector<char> result(max_size);
+  auto n = ZDICT_trainFromBuffer(result.data(), result.size(), samples.data(),
+                                 sizes.data(),
+                                 static_cast<unsigned>(sizes.size()));
+  if (ZDICT_isError(n))
+    return {};
+  result.resize(n);
+  return result;
+}
+
+} // namespace zstd
+
+#endif // VAST_HAVE_ZSTD
+
 } // namespace vast
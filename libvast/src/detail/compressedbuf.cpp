@@ -19,6 +19,7 @@
 #include "vast/detail/byte_swap.hpp"
 #include "vast/detail/compressedbuf.hpp"
 #include "vast/detail/varbyte.hpp"
+#include "vast/die.hpp"
 
 namespace vast {
 
@@ -175,6 +176,16 @@ void compressedbuf::compress() {
                         compressed_.data(), compressed_.size());
       break;
     }
+    case compression::zstd: {
+#if VAST_HAVE_ZSTD
+      compressed_.resize(zstd::compress_bound(uncompressed_.size()));
+      n = zstd::compress(uncompressed_.data(), uncompressed_.size(),
+                         compressed_.data(), compressed_.size());
+#else
+      die("zstd support not available");
+#endif
+      break;
+    }
   }
   compressed_.resize(n);
   uncompressed_.resize(block_size_);
@@ -193,6 +204,15 @@ void compressedbuf::uncompress() {
                           uncompressed_.data(), uncompressed_.size());
       break;
     }
+    case compression::zstd: {
+#if VAST_HAVE_ZSTD
+      n = zstd::uncompress(compressed_.data(), compressed_.size(),
+                           uncompressed_.data(), uncompressed_.size());
+#else
+      die("zstd support not available");
+#endif
+      break;
+    }
   }
   VAST_ASSERT(n > 0);
   uncompressed_.resize(n);
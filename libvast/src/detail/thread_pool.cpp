@@ -0,0 +1,67 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/detail/thread_pool.hpp"
+
+#include "vast/detail/assert.hpp"
+
+namespace vast::detail {
+
+thread_pool::thread_pool(size_t size) {
+  VAST_ASSERT(size > 0);
+  workers_.reserve(size);
+  for (size_t i = 0; i < size; ++i)
+    workers_.emplace_back([this] { run(); });
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    done_ = true;
+  }
+  cond_.notify_all();
+  for (auto& worker : workers_)
+    worker.join();
+}
+
+size_t thread_pool::size() const {
+  return workers_.size();
+}
+
+void thread_pool::enqueue(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    VAST_ASSERT(!done_);
+    jobs_.push_back(std::move(job));
+  }
+  cond_.notify_one();
+}
+
+void thread_pool::run() {
+  for (;;) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      cond_.wait(lock, [this] { return done_ || !jobs_.empty(); });
+      // Drain the queue before shutting down so that no future is left
+      // without a value.
+      if (jobs_.empty())
+        return;
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    job();
+  }
+}
+
+} // namespace vast::detail
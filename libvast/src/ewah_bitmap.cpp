@@ -11,7 +11,16 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <algorithm>
+#include <array>
+#include <limits>
+
 #include "vast/ewah_bitmap.hpp"
+#include "vast/error.hpp"
+#include "vast/null_bitmap.hpp"
+
+#include <caf/deserializer.hpp>
+#include <caf/serializer.hpp>
 
 namespace vast {
 
@@ -19,6 +28,16 @@ ewah_bitmap::ewah_bitmap(size_type n, bool bit) {
   append_bits(bit, n);
 }
 
+ewah_bitmap::ewah_bitmap(span<const block_type> blocks, size_type last_marker,
+                         size_type num_bits, chunk_ptr owner)
+  : frozen_{blocks},
+    owner_{std::move(owner)},
+    last_marker_{last_marker},
+    num_bits_{num_bits} {
+  VAST_ASSERT(owner_ != nullptr);
+  VAST_ASSERT(blocks.empty() || last_marker < blocks.size());
+}
+
 bool ewah_bitmap::empty() const {
   return num_bits_ == 0;
 }
@@ -27,11 +46,18 @@ ewah_bitmap::size_type ewah_bitmap::size() const {
   return num_bits_;
 }
 
-const ewah_bitmap::block_vector& ewah_bitmap::blocks() const {
+span<const ewah_bitmap::block_type> ewah_bitmap::blocks() const {
+  if (frozen())
+    return frozen_;
   return blocks_;
 }
 
+bool ewah_bitmap::frozen() const {
+  return owner_ != nullptr;
+}
+
 void ewah_bitmap::append_bit(bool bit) {
+  thaw();
   auto partial = num_bits_ % word_type::width;
   if (blocks_.empty()) {
     blocks_.push_back(0); // Always begin with an empty marker.
@@ -49,6 +75,7 @@ void ewah_bitmap::append_bit(bool bit) {
 void ewah_bitmap::append_bits(bool bit, size_type n) {
   if (n == 0)
     return;
+  thaw();
   if (blocks_.empty()) {
     blocks_.push_back(0); // Always begin with an empty marker.
   } else {
@@ -123,6 +150,7 @@ void ewah_bitmap::append_bits(bool bit, size_type n) {
 void ewah_bitmap::append_block(block_type value, size_type bits) {
   VAST_ASSERT(bits > 0);
   VAST_ASSERT(bits <= word_type::width);
+  thaw();
   if (blocks_.empty())
     blocks_.push_back(0); // Always begin with an empty marker.
   else if (num_bits_ % word_type::width == 0)
@@ -148,7 +176,31 @@ void ewah_bitmap::append_block(block_type value, size_type bits) {
   }
 }
 
+void ewah_bitmap::append_blocks(const block_type* first,
+                                const block_type* last) {
+  thaw();
+  if (num_bits_ % word_type::width != 0) {
+    for (; first != last; ++first)
+      append_block(*first);
+    return;
+  }
+  while (first != last) {
+    append_block(*first++);
+    if (word_type::all_or_none(blocks_.back()))
+      continue;
+    // The last block is dirty, so integrating it only bumps the dirty count
+    // of the current marker. The same holds for all subsequent dirty blocks,
+    // until we encounter a clean one.
+    for (; first != last && !word_type::all_or_none(*first); ++first) {
+      bump_dirty_count();
+      blocks_.push_back(*first);
+      num_bits_ += word_type::width;
+    }
+  }
+}
+
 void ewah_bitmap::flip() {
+  thaw();
   if (blocks_.empty())
     return;
   VAST_ASSERT(blocks_.size() >= 2);
@@ -172,6 +224,14 @@ void ewah_bitmap::flip() {
     blocks_.back() &= word_type::lsb_mask(partial);
 }
 
+void ewah_bitmap::thaw() {
+  if (!frozen())
+    return;
+  blocks_.assign(frozen_.begin(), frozen_.end());
+  frozen_ = {};
+  owner_ = nullptr;
+}
+
 void ewah_bitmap::integrate_last_block() {
   VAST_ASSERT(blocks_.size() >= 2); // at least one marker plus dirty block
   VAST_ASSERT(last_marker_ < blocks_.size() - 1); // no marker as last block
@@ -237,7 +297,58 @@ void ewah_bitmap::bump_dirty_count() {
 bool operator==(const ewah_bitmap& x, const ewah_bitmap& y) {
   // If the block vector and the number of bits are equal, so must be the
   // marker by construction.
-  return x.blocks_ == y.blocks_ && x.num_bits_ == y.num_bits_;
+  auto xs = x.blocks();
+  auto ys = y.blocks();
+  return x.num_bits_ == y.num_bits_
+         && std::equal(xs.begin(), xs.end(), ys.begin(), ys.end());
+}
+
+caf::error inspect(caf::serializer& sink, ewah_bitmap& bm) {
+  auto writer = dynamic_cast<ewah_block_writer*>(&sink);
+  if (writer == nullptr)
+    return ewah_bitmap::inspect_inline(sink, bm);
+  auto xs = bm.blocks();
+  auto offset = static_cast<uint64_t>(writer->blocks_.size());
+  auto size = static_cast<uint64_t>(xs.size());
+  writer->blocks_.insert(writer->blocks_.end(), xs.begin(), xs.end());
+  return sink(offset, size, bm.last_marker_, bm.num_bits_);
+}
+
+caf::error inspect(caf::deserializer& source, ewah_bitmap& bm) {
+  auto reader = dynamic_cast<ewah_block_reader*>(&source);
+  if (reader == nullptr)
+    return ewah_bitmap::inspect_inline(source, bm);
+  uint64_t offset;
+  uint64_t size;
+  ewah_bitmap::size_type last_marker;
+  ewah_bitmap::size_type num_bits;
+  if (auto err = source(offset, size, last_marker, num_bits))
+    return err;
+  if (offset > reader->blocks_.size()
+      || size > reader->blocks_.size() - offset
+      || (size > 0 && last_marker >= size))
+    return make_error(ec::parse_error, "invalid EWAH block range");
+  auto blocks = reader->blocks_.subspan(offset, size);
+  bm = ewah_bitmap{blocks, last_marker, num_bits, reader->owner_};
+  return caf::none;
+}
+
+ewah_block_writer::~ewah_block_writer() {
+  // nop
+}
+
+const ewah_bitmap::block_vector& ewah_block_writer::blocks() const {
+  return blocks_;
+}
+
+ewah_block_reader::ewah_block_reader(span<const ewah_bitmap::block_type> blocks,
+                                     chunk_ptr owner)
+  : blocks_{blocks}, owner_{std::move(owner)} {
+  VAST_ASSERT(owner_ != nullptr);
+}
+
+ewah_block_reader::~ewah_block_reader() {
+  // nop
 }
 
 ewah_bitmap_range::ewah_bitmap_range(const ewah_bitmap& bm)
@@ -300,4 +411,208 @@ ewah_bitmap_range bit_range(const ewah_bitmap& bm) {
   return ewah_bitmap_range{bm};
 }
 
+namespace {
+
+using word_type = ewah_bitmap::word_type;
+using block_type = ewah_bitmap::block_type;
+using size_type = ewah_bitmap::size_type;
+
+// Walks over the blocks of an EWAH bitmap as a sequence of clean runs and
+// dirty words. Past the end, the sequence continues with 0s indefinitely.
+class ewah_cursor {
+public:
+  explicit ewah_cursor(const ewah_bitmap& bm)
+    : next_{bm.blocks().data()},
+      end_{bm.blocks().data() + bm.blocks().size()} {
+  }
+
+  // Loads the next marker after having consumed the current one.
+  void refill() {
+    while (clean == 0 && dirty == 0) {
+      if (next_ == end_) {
+        fill = false;
+        clean = std::numeric_limits<size_type>::max();
+      } else if (next_ + 1 == end_) {
+        // The last block is always dirty and not accounted for by a marker.
+        literals = next_++;
+        dirty = 1;
+      } else {
+        auto marker = *next_++;
+        fill = word_type::marker_type(marker);
+        clean = word_type::marker_num_clean(marker);
+        dirty = word_type::marker_num_dirty(marker);
+        literals = next_;
+        next_ += dirty;
+      }
+    }
+  }
+
+  size_type clean = 0;
+  bool fill = false;
+  size_type dirty = 0;
+  const block_type* literals = nullptr;
+
+private:
+  const block_type* next_;
+  const block_type* end_;
+};
+
+// Walks over the blocks of an uncompressed bitmap with the same interface as
+// ewah_cursor, i.e., as one long sequence of dirty words.
+class null_cursor {
+public:
+  explicit null_cursor(const null_bitmap& bm) {
+    auto partial = bm.size() % word_type::width;
+    literals = bm.blocks().data();
+    dirty = bm.size() / word_type::width;
+    if (partial > 0) {
+      // Unlike EWAH, the bitvector does not guarantee that the unused bits of
+      // its last block are 0.
+      tail_ = bm.blocks()[dirty] & word_type::lsb_mask(partial);
+      has_tail_ = true;
+    }
+  }
+
+  void refill() {
+    if (clean > 0 || dirty > 0)
+      return;
+    if (has_tail_) {
+      has_tail_ = false;
+      literals = &tail_;
+      dirty = 1;
+    } else {
+      fill = false;
+      clean = std::numeric_limits<size_type>::max();
+    }
+  }
+
+  size_type clean = 0;
+  bool fill = false;
+  size_type dirty = 0;
+  const block_type* literals = nullptr;
+
+private:
+  block_type tail_ = 0;
+  bool has_tail_ = false;
+};
+
+template <class Cursor>
+block_type fill_word(const Cursor& cursor) {
+  return cursor.fill ? word_type::all : word_type::none;
+}
+
+// Merges two word sequences under a commutative bitwise operation. Pairs of
+// clean runs produce a run in constant time. A clean run that determines the
+// result by itself, i.e., 0s for AND and 1s for OR, skips over the dirty
+// words on the other side. All remaining stretches of dirty words go through
+// a tight loop over a fixed-size buffer, which the compiler can vectorize.
+template <class LHS, class RHS, class Operation>
+ewah_bitmap merge_words(LHS& lhs, RHS& rhs, size_type size, Operation op) {
+  ewah_bitmap result;
+  if (size == 0)
+    return result;
+  auto num_words = (size + word_type::width - 1) / word_type::width;
+  auto complete = num_words - 1;
+  std::array<block_type, 64> buffer;
+  auto evaluate = [&](size_type n, auto f) {
+    for (size_type i = 0; i < n; i += buffer.size()) {
+      auto k = std::min(n - i, size_type{buffer.size()});
+      for (size_type j = 0; j < k; ++j)
+        buffer[j] = f(i + j);
+      result.append_blocks(buffer.data(), buffer.data() + k);
+    }
+  };
+  auto merge_mixed = [&](auto& run, auto& literal, size_type n) {
+    n = std::min({n, run.clean, literal.dirty});
+    auto x = fill_word(run);
+    auto y = op(x, word_type::none);
+    if (y == op(x, word_type::all)) {
+      result.append_bits(y != 0, n * word_type::width);
+    } else {
+      auto literals = literal.literals;
+      evaluate(n, [&](size_type j) { return op(x, literals[j]); });
+    }
+    run.clean -= n;
+    literal.dirty -= n;
+    literal.literals += n;
+    return n;
+  };
+  // Process all complete words.
+  auto i = size_type{0};
+  while (i < complete) {
+    lhs.refill();
+    rhs.refill();
+    auto n = complete - i;
+    if (lhs.clean > 0 && rhs.clean > 0) {
+      n = std::min({n, lhs.clean, rhs.clean});
+      auto x = op(fill_word(lhs), fill_word(rhs));
+      result.append_bits(x != 0, n * word_type::width);
+      lhs.clean -= n;
+      rhs.clean -= n;
+    } else if (lhs.clean > 0) {
+      n = merge_mixed(lhs, rhs, n);
+    } else if (rhs.clean > 0) {
+      n = merge_mixed(rhs, lhs, n);
+    } else {
+      n = std::min({n, lhs.dirty, rhs.dirty});
+      auto l = lhs.literals;
+      auto r = rhs.literals;
+      evaluate(n, [&](size_type j) { return op(l[j], r[j]); });
+      lhs.dirty -= n;
+      lhs.literals += n;
+      rhs.dirty -= n;
+      rhs.literals += n;
+    }
+    i += n;
+  }
+  // Process the last, possibly partial, word. Since both sequences continue
+  // with 0s, the unused bits are 0 after AND and OR.
+  lhs.refill();
+  rhs.refill();
+  auto next_word = [](const auto& cursor) {
+    return cursor.clean > 0 ? fill_word(cursor) : *cursor.literals;
+  };
+  result.append_block(op(next_word(lhs), next_word(rhs)),
+                      size - complete * word_type::width);
+  return result;
+}
+
+auto and_op = [](auto x, auto y) { return x & y; };
+
+auto or_op = [](auto x, auto y) { return x | y; };
+
+} // namespace <anonymous>
+
+ewah_bitmap binary_and(const ewah_bitmap& lhs, const ewah_bitmap& rhs) {
+  ewah_cursor x{lhs};
+  ewah_cursor y{rhs};
+  return merge_words(x, y, std::max(lhs.size(), rhs.size()), and_op);
+}
+
+ewah_bitmap binary_or(const ewah_bitmap& lhs, const ewah_bitmap& rhs) {
+  ewah_cursor x{lhs};
+  ewah_cursor y{rhs};
+  return merge_words(x, y, std::max(lhs.size(), rhs.size()), or_op);
+}
+
+ewah_bitmap binary_and(const ewah_bitmap& lhs, const null_bitmap& rhs) {
+  ewah_cursor x{lhs};
+  null_cursor y{rhs};
+  return merge_words(x, y, std::max(lhs.size(), rhs.size()), and_op);
+}
+
+ewah_bitmap binary_and(const null_bitmap& lhs, const ewah_bitmap& rhs) {
+  return binary_and(rhs, lhs);
+}
+
+ewah_bitmap binary_or(const ewah_bitmap& lhs, const null_bitmap& rhs) {
+  ewah_cursor x{lhs};
+  null_cursor y{rhs};
+  return merge_words(x, y, std::max(lhs.size(), rhs.size()), or_op);
+}
+
+ewah_bitmap binary_or(const null_bitmap& lhs, const ewah_bitmap& rhs) {
+  return binary_or(rhs, lhs);
+}
+
 } // namespace vast
@@ -13,6 +13,7 @@
 
 #include "vast/expression_visitors.hpp"
 
+#include "vast/compiled_expression.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/data.hpp"
 #include "vast/concept/parseable/vast/type.hpp"
@@ -27,6 +28,7 @@
 #include "vast/fwd.hpp"
 #include "vast/ids.hpp"
 #include "vast/logger.hpp"
+#include "vast/synopsis.hpp"
 #include "vast/table_slice.hpp"
 #include "vast/type.hpp"
 #include "vast/view.hpp"
@@ -629,14 +631,179 @@ bool evaluate_at(const table_slice& slice, size_t row, const expression& expr) {
   return caf::visit(table_slice_row_evaluator{slice, row}, expr);
 }
 
+table_slice_column_evaluator::table_slice_column_evaluator(
+  const table_slice& slice)
+  : slice_(slice) {
+  // nop
+}
+
+null_bitmap table_slice_column_evaluator::operator()(caf::none_t) {
+  return null_bitmap(slice_.rows());
+}
+
+null_bitmap table_slice_column_evaluator::operator()(const conjunction& c) {
+  auto result = null_bitmap(slice_.rows(), true);
+  for (auto& op : c) {
+    // Skip the remaining operands once no row can qualify anymore.
+    if (all<0>(result))
+      break;
+    result &= caf::visit(*this, op);
+  }
+  return result;
+}
+
+null_bitmap table_slice_column_evaluator::operator()(const disjunction& d) {
+  auto result = null_bitmap(slice_.rows());
+  for (auto& op : d) {
+    // Skip the remaining operands once all rows qualify.
+    if (all<1>(result))
+      break;
+    result |= caf::visit(*this, op);
+  }
+  return result;
+}
+
+null_bitmap table_slice_column_evaluator::operator()(const negation& n) {
+  auto result = caf::visit(*this, n.expr());
+  result.flip();
+  return result;
+}
+
+null_bitmap table_slice_column_evaluator::operator()(const predicate& p) {
+  op_ = p.op;
+  return caf::visit(*this, p.lhs, p.rhs);
+}
+
+null_bitmap
+table_slice_column_evaluator::operator()(const attribute_extractor& e,
+                                         const data& d) {
+  if (e.attr == atom::type_v)
+    return null_bitmap(slice_.rows(),
+                       evaluate(slice_.layout().name(), op_, d));
+  if (e.attr == atom::timestamp_v) {
+    auto pred = [](auto& x) {
+      return caf::holds_alternative<time_type>(x.type)
+             && has_attribute(x.type, "timestamp");
+    };
+    auto& fs = slice_.layout().fields;
+    auto i = std::find_if(fs.begin(), fs.end(), pred);
+    if (i == fs.end())
+      return null_bitmap(slice_.rows());
+    return scan(static_cast<size_t>(std::distance(fs.begin(), i)), d);
+  }
+  return null_bitmap(slice_.rows());
+}
+
+null_bitmap
+table_slice_column_evaluator::operator()(const type_extractor&, const data&) {
+  die("type extractor should have been resolved at this point");
+}
+
+null_bitmap
+table_slice_column_evaluator::operator()(const field_extractor&, const data&) {
+  die("field extractor should have been resolved at this point");
+}
+
+null_bitmap
+table_slice_column_evaluator::operator()(const data_extractor& e,
+                                         const data& d) {
+  if (e.type != slice_.layout())
+    return null_bitmap(slice_.rows());
+  VAST_ASSERT(e.offset.size() == 1);
+  return scan(e.offset[0], d);
+}
+
+null_bitmap
+table_slice_column_evaluator::scan(size_t column, const data& d) const {
+  auto& t = slice_.layout().fields[column].type;
+  return make_column_scanner(t, column, op_, d)(slice_);
+}
+
 ids evaluate(const table_slice& slice, const expression& expr) {
   ids result;
   result.append(false, slice.offset());
-  for (size_t row = 0; row != slice.rows(); ++row)
-    result.append_bit(evaluate_at(slice, row, expr));
+  result.append(caf::visit(table_slice_column_evaluator{slice}, expr));
   return result;
 }
 
+statistics_evaluator::statistics_evaluator(
+  const record_type& layout, const std::vector<synopsis_ptr>& statistics)
+  : layout_{layout}, statistics_{statistics} {
+  // nop
+}
+
+bool statistics_evaluator::operator()(caf::none_t) {
+  return false;
+}
+
+bool statistics_evaluator::operator()(const conjunction& c) {
+  for (auto& op : c)
+    if (!caf::visit(*this, op))
+      return false;
+  return true;
+}
+
+bool statistics_evaluator::operator()(const disjunction& d) {
+  for (auto& op : d)
+    if (caf::visit(*this, op))
+      return true;
+  return false;
+}
+
+bool statistics_evaluator::operator()(const negation&) {
+  // Statistics cannot tell whether all rows match the negated expression.
+  return true;
+}
+
+bool statistics_evaluator::operator()(const predicate& p) {
+  op_ = p.op;
+  return caf::visit(*this, p.lhs, p.rhs);
+}
+
+bool statistics_evaluator::operator()(const attribute_extractor& e,
+                                      const data& d) {
+  if (e.attr == atom::type_v)
+    return evaluate(layout_.name(), op_, d);
+  if (e.attr == atom::timestamp_v) {
+    auto pred = [](auto& x) {
+      return caf::holds_alternative<time_type>(x.type)
+             && has_attribute(x.type, "timestamp");
+    };
+    auto& fs = layout_.fields;
+    auto i = std::find_if(fs.begin(), fs.end(), pred);
+    if (i == fs.end())
+      return false;
+    return lookup(static_cast<size_t>(std::distance(fs.begin(), i)), d);
+  }
+  return true;
+}
+
+bool statistics_evaluator::operator()(const type_extractor&, const data&) {
+  die("type extractor should have been resolved at this point");
+}
+
+bool statistics_evaluator::operator()(const field_extractor&, const data&) {
+  die("field extractor should have been resolved at this point");
+}
+
+bool statistics_evaluator::operator()(const data_extractor& e,
+                                      const data& d) {
+  if (e.type != layout_)
+    return false;
+  VAST_ASSERT(e.offset.size() == 1);
+  return lookup(e.offset[0], d);
+}
+
+bool statistics_evaluator::lookup(size_t column, const data& d) const {
+  if (column >= statistics_.size() || statistics_[column] == nullptr)
+    return true;
+  // The statistics skip nil cells, which satisfy negated comparisons.
+  if (op_ == not_equal || op_ == not_in)
+    return true;
+  auto result = statistics_[column]->lookup(op_, make_data_view(d));
+  return !result || *result;
+}
+
 matcher::matcher(const type& t) : type_{t} {
   // nop
 }
@@ -13,11 +13,21 @@
 
 #include "vast/meta_index.hpp"
 
+#include "vast/address.hpp"
+#include "vast/bloom_filter.hpp"
+#include "vast/bloom_filter_synopsis.hpp"
+#include "vast/chunk.hpp"
+#include "vast/concept/hashable/xxhash.hpp"
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/type.hpp"
+#include "vast/concept/printable/vast/uuid.hpp"
 #include "vast/data.hpp"
 #include "vast/detail/overload.hpp"
 #include "vast/detail/set_operations.hpp"
 #include "vast/detail/string.hpp"
+#include "vast/error.hpp"
 #include "vast/expression.hpp"
+#include "vast/fbs/utils.hpp"
 #include "vast/fwd.hpp"
 #include "vast/logger.hpp"
 #include "vast/synopsis_factory.hpp"
@@ -27,36 +37,406 @@
 #include <caf/binary_deserializer.hpp>
 #include <caf/binary_serializer.hpp>
 
+#include <algorithm>
+#include <future>
+
 namespace vast {
 
+namespace {
+
+/// Inserts a value into a sorted vector unless it exists already.
+/// @returns the position of the value and whether the insertion took place.
+std::pair<size_t, bool> insert_sorted(std::vector<size_t>& xs, size_t x) {
+  // Partitions receive ascending indexes, so we almost always append.
+  if (xs.empty() || xs.back() < x) {
+    xs.push_back(x);
+    return {xs.size() - 1, true};
+  }
+  auto i = std::lower_bound(xs.begin(), xs.end(), x);
+  auto pos = static_cast<size_t>(std::distance(xs.begin(), i));
+  if (*i == x)
+    return {pos, false};
+  xs.insert(i, x);
+  return {pos, true};
+}
+
+/// A Bloom filter synopsis that performs lookups directly on the bits of a
+/// packed meta index, e.g., in a memory-mapped file. The synopsis copies the
+/// bits only when it receives new data.
+template <class T>
+class frozen_bloom_filter_synopsis final : public synopsis {
+public:
+  using frozen_type = frozen_bloom_filter<xxhash64>;
+  using bloom_filter_type = frozen_type::bloom_filter_type;
+
+  frozen_bloom_filter_synopsis(vast::type x, frozen_type bf, chunk_ptr chunk)
+    : synopsis{std::move(x)},
+      frozen_{std::move(bf)},
+      chunk_{std::move(chunk)} {
+    // nop
+  }
+
+  void add(data_view x) override {
+    thaw();
+    thawed_->add(caf::get<view<T>>(x));
+  }
+
+  using synopsis::add_batch;
+
+  void add_batch(span<const view<T>> xs) override {
+    thaw();
+    for (auto x : xs)
+      thawed_->add(x);
+  }
+
+  caf::optional<bool>
+  lookup(relational_operator op, data_view rhs) const override {
+    if (thawed_)
+      return bloom_filter_lookup<T>(*thawed_, op, rhs);
+    return bloom_filter_lookup<T>(frozen_, op, rhs);
+  }
+
+  bool equals(const synopsis& other) const noexcept override {
+    if (typeid(other) != typeid(frozen_bloom_filter_synopsis))
+      return false;
+    auto& rhs = static_cast<const frozen_bloom_filter_synopsis&>(other);
+    return this->type() == rhs.type() && filter() == rhs.filter();
+  }
+
+  // Uses the same format as `bloom_filter_synopsis`, so that deserializing
+  // yields a regular Bloom filter synopsis.
+  caf::error serialize(caf::serializer& sink) const override {
+    auto bf = filter();
+    return sink(bf);
+  }
+
+  caf::error deserialize(caf::deserializer& source) override {
+    bloom_filter_type bf;
+    if (auto err = source(bf))
+      return err;
+    thawed_ = std::move(bf);
+    chunk_ = nullptr;
+    return caf::none;
+  }
+
+  /// Copies the bits of the Bloom filter, such that the synopsis no longer
+  /// refers to the packed meta index.
+  void thaw() {
+    if (!thawed_) {
+      thawed_ = frozen_.thaw();
+      chunk_ = nullptr;
+    }
+  }
+
+  /// @returns The Bloom filter with copied bits, if the synopsis has thawed.
+  const bloom_filter_type* thawed() const {
+    return thawed_ ? &*thawed_ : nullptr;
+  }
+
+  /// @returns The Bloom filter that refers to the packed meta index.
+  /// @pre `thawed() == nullptr`
+  const frozen_type& frozen() const {
+    VAST_ASSERT(!thawed_);
+    return frozen_;
+  }
+
+private:
+  bloom_filter_type filter() const {
+    return thawed_ ? *thawed_ : frozen_.thaw();
+  }
+
+  frozen_type frozen_;
+  caf::optional<bloom_filter_type> thawed_;
+  chunk_ptr chunk_;
+};
+
+/// Serializes state in CAF binary format into a flatbuffer byte vector.
+template <class Serialize>
+caf::expected<flatbuffers::Offset<flatbuffers::Vector<uint8_t>>>
+pack_state(flatbuffers::FlatBufferBuilder& builder, Serialize serialize) {
+  std::vector<char> buffer;
+  caf::binary_serializer sink{nullptr, buffer};
+  if (auto err = serialize(sink))
+    return err;
+  auto data = reinterpret_cast<const uint8_t*>(buffer.data());
+  return builder.CreateVector(data, buffer.size());
+}
+
+/// Deserializes state in CAF binary format from a flatbuffer byte vector.
+template <class Deserialize>
+caf::error unpack_state(const flatbuffers::Vector<uint8_t>* xs,
+                        Deserialize deserialize) {
+  if (!xs)
+    return make_error(ec::format_error, "missing state in meta index");
+  auto data = reinterpret_cast<const char*>(xs->data());
+  caf::binary_deserializer source{nullptr, data, xs->size()};
+  return deserialize(source);
+}
+
+/// Copies a synopsis via its serialized state, which yields a mutable
+/// synopsis that no longer refers to a packed meta index.
+caf::expected<synopsis_ptr> copy_synopsis(synopsis_ptr x) {
+  std::vector<char> buffer;
+  caf::binary_serializer sink{nullptr, buffer};
+  if (auto err = sink(x))
+    return err;
+  caf::binary_deserializer source{nullptr, buffer};
+  synopsis_ptr result;
+  if (auto err = source(result))
+    return err;
+  return result;
+}
+
+template <class Hasher>
+caf::expected<flatbuffers::Offset<fbs::BloomFilter>>
+pack_bloom_filter(flatbuffers::FlatBufferBuilder& builder, const Hasher& hasher,
+                  size_t size, span<const uint64_t> blocks) {
+  auto packed_hasher = pack_state(
+    builder, [&](caf::serializer& sink) { return sink(hasher); });
+  if (!packed_hasher)
+    return packed_hasher.error();
+  auto packed_blocks = builder.CreateVector(blocks.data(), blocks.size());
+  return fbs::CreateBloomFilter(builder, *packed_hasher, size, packed_blocks);
+}
+
+/// Packs the Bloom filter of a synopsis for elements of type `T`.
+/// @returns The packed Bloom filter, or a null offset if *x* is no Bloom
+///          filter synopsis for `T`.
+template <class T>
+caf::expected<flatbuffers::Offset<fbs::BloomFilter>>
+pack_bloom_filter(flatbuffers::FlatBufferBuilder& builder, const synopsis& x) {
+  if (auto syn = dynamic_cast<const bloom_filter_synopsis<T, xxhash64>*>(&x)) {
+    auto& bf = syn->filter();
+    return pack_bloom_filter(builder, bf.hasher(), bf.size(),
+                             bf.data().blocks());
+  }
+  if (auto syn = dynamic_cast<const frozen_bloom_filter_synopsis<T>*>(&x)) {
+    if (auto bf = syn->thawed())
+      return pack_bloom_filter(builder, bf->hasher(), bf->size(),
+                               bf->data().blocks());
+    auto& bf = syn->frozen();
+    return pack_bloom_filter(builder, bf.hasher(), bf.size(), bf.blocks());
+  }
+  return flatbuffers::Offset<fbs::BloomFilter>{};
+}
+
+template <class T>
+caf::expected<synopsis_ptr>
+unpack_bloom_filter(const fbs::BloomFilter& x, type t, chunk_ptr chunk) {
+  using synopsis_type = frozen_bloom_filter_synopsis<T>;
+  using frozen_type = typename synopsis_type::frozen_type;
+  if (!x.blocks() || x.blocks()->size() * 64 < x.size())
+    return make_error(ec::format_error, "invalid Bloom filter in meta index");
+  typename frozen_type::hasher_type hasher;
+  auto deserialize_hasher
+    = [&](caf::deserializer& source) { return source(hasher); };
+  if (auto err = unpack_state(x.hasher(), deserialize_hasher))
+    return err;
+  auto blocks = span<const uint64_t>{x.blocks()->data(), x.blocks()->size()};
+  auto bf = frozen_type{std::move(hasher), x.size(), blocks};
+  auto owned = chunk == nullptr;
+  auto result = caf::make_counted<synopsis_type>(std::move(t), std::move(bf),
+                                                 std::move(chunk));
+  if (owned)
+    result->thaw();
+  return synopsis_ptr{std::move(result)};
+}
+
+caf::expected<synopsis_ptr>
+unpack_bloom_filter(const fbs::BloomFilter& x, type t, chunk_ptr chunk) {
+  if (caf::holds_alternative<address_type>(t))
+    return unpack_bloom_filter<address>(x, std::move(t), std::move(chunk));
+  if (caf::holds_alternative<string_type>(t))
+    return unpack_bloom_filter<std::string>(x, std::move(t), std::move(chunk));
+  return make_error(ec::invalid_synopsis_type,
+                    "no Bloom filter synopsis for type", to_string(t));
+}
+
+} // namespace
+
+size_t meta_index::partition_index(const uuid& partition) {
+  auto [i, inserted]
+    = partition_indexes_.emplace(partition, partitions_.size());
+  if (inserted)
+    partitions_.push_back(partition);
+  return i->second;
+}
+
+size_t meta_index::field_index(qualified_record_field field) {
+  auto i = field_indexes_.find(field);
+  if (i != field_indexes_.end())
+    return i->second;
+  auto result = fields_.size();
+  field_indexes_.emplace(field, result);
+  fields_.push_back(std::move(field));
+  columns_.emplace_back();
+  return result;
+}
+
+template <class MakeSynopsis>
+synopsis_ptr&
+meta_index::slot(field_synopses& column, size_t partition, MakeSynopsis make) {
+  auto [pos, inserted] = insert_sorted(column.partitions, partition);
+  if (inserted)
+    column.synopses.insert(column.synopses.begin() + pos, make());
+  return column.synopses[pos];
+}
+
+void meta_index::merge(const uuid& partition, partition_synopsis synopses) {
+  auto part = partition_index(partition);
+  for (auto& [field, syn] : synopses) {
+    insert_sorted(layouts_[field.layout_name], part);
+    auto& column = columns_[field_index(field)];
+    if (syn)
+      column.has_synopsis = true;
+    slot(column, part, [] { return synopsis_ptr{}; }) = std::move(syn);
+  }
+}
+
+std::unordered_map<uuid, meta_index::partition_synopsis>
+meta_index::partition_synopses() const {
+  std::unordered_map<uuid, partition_synopsis> result;
+  for (auto& partition : partitions_)
+    result[partition];
+  for (size_t i = 0; i < fields_.size(); ++i) {
+    auto& column = columns_[i];
+    for (size_t k = 0; k < column.partitions.size(); ++k)
+      result[partitions_[column.partitions[k]]].emplace(fields_[i],
+                                                        column.synopses[k]);
+  }
+  return result;
+}
+
+void meta_index::clear() {
+  partitions_.clear();
+  partition_indexes_.clear();
+  fields_.clear();
+  field_indexes_.clear();
+  layouts_.clear();
+  columns_.clear();
+}
+
 void meta_index::add(const uuid& partition, const table_slice& slice) {
   auto make_synopsis = [&](const record_field& field) -> synopsis_ptr {
     return has_skip_attribute(field.type)
              ? nullptr
              : factory<synopsis>::make(field.type, synopsis_options_);
   };
-  auto& part_syn = synopses_[partition];
+  auto part = partition_index(partition);
+  auto& layout = slice.layout();
+  insert_sorted(layouts_[layout.name()], part);
   for (size_t col = 0; col < slice.columns(); ++col) {
-    // Locate the relevant synopsis.
-    auto& field = slice.layout().fields[col];
-    auto key = qualified_record_field{slice.layout().name(), field};
-    auto it = part_syn.find(key);
-    if (it == part_syn.end())
-      // Attempt to create a synopsis if we have never seen this key before.
-      it = part_syn.emplace(std::move(key), make_synopsis(field)).first;
+    // Locate the relevant synopsis, and attempt to create one if we have
+    // never seen this field in this partition before.
+    auto& field = layout.fields[col];
+    auto& column = columns_[field_index({layout.name(), field})];
+    auto& syn = slot(column, part, [&] { return make_synopsis(field); });
     // If there exists a synopsis for a field, add the entire column.
-    if (auto& syn = it->second) {
-      for (size_t row = 0; row < slice.rows(); ++row) {
-        auto view = slice.at(row, col);
-        if (!caf::holds_alternative<caf::none_t>(view))
-          syn->add(std::move(view));
-      }
+    if (syn) {
+      column.has_synopsis = true;
+      slice.append_column_to_synopsis(col, *syn);
     }
   }
 }
 
+void meta_index::shrink(const uuid& partition, size_t events) {
+  auto i = partition_indexes_.find(partition);
+  if (i == partition_indexes_.end())
+    return;
+  auto part = i->second;
+  for (auto& column : columns_) {
+    auto j = std::lower_bound(column.partitions.begin(),
+                              column.partitions.end(), part);
+    if (j == column.partitions.end() || *j != part)
+      continue;
+    if (auto& syn = column.synopses[j - column.partitions.begin()])
+      syn->shrink(events);
+  }
+}
+
+caf::error
+meta_index::replace(const std::vector<uuid>& sources, const uuid& target) {
+  VAST_ASSERT(!sources.empty());
+  auto synopses = partition_synopses();
+  partition_synopsis merged;
+  for (auto& source : sources) {
+    auto i = synopses.find(source);
+    if (i == synopses.end())
+      return make_error(ec::lookup_error, "unknown partition",
+                        to_string(source));
+    for (auto& [field, syn] : i->second) {
+      auto [j, inserted] = merged.emplace(field, synopsis_ptr{});
+      if (!j->second && !syn)
+        continue;
+      // Either all or none of the sources have a synopsis for a field.
+      if (!syn || (!inserted && !j->second))
+        return make_error(ec::unspecified, "inconsistent synopses for",
+                          field.fqn());
+      // Frozen synopses cannot merge, so we always work on copies. This also
+      // leaves the synopses of the sources untouched upon failure.
+      auto copy = copy_synopsis(syn);
+      if (!copy)
+        return copy.error();
+      if (inserted)
+        j->second = std::move(*copy);
+      else if (!j->second->merge(**copy))
+        return make_error(ec::unspecified, "failed to merge synopses for",
+                          field.fqn());
+    }
+  }
+  auto is_source = [&](const uuid& x) {
+    return std::find(sources.begin(), sources.end(), x) != sources.end();
+  };
+  auto order = partitions_;
+  clear();
+  auto replaced = false;
+  for (auto& partition : order) {
+    if (!is_source(partition))
+      merge(partition, std::move(synopses[partition]));
+    else if (!replaced) {
+      merge(target, std::move(merged));
+      replaced = true;
+    }
+  }
+  return caf::none;
+}
+
+void meta_index::erase(const std::vector<uuid>& partitions) {
+  auto synopses = partition_synopses();
+  auto order = partitions_;
+  clear();
+  for (auto& partition : order)
+    if (std::find(partitions.begin(), partitions.end(), partition)
+        == partitions.end())
+      merge(partition, std::move(synopses[partition]));
+}
+
 std::vector<uuid> meta_index::lookup(const expression& expr) const {
   VAST_ASSERT(!caf::holds_alternative<caf::none_t>(expr));
+  auto num_partitions = partitions_.size();
+  auto num_shards
+    = pool_ ? std::min(pool_->size() + 1, num_partitions / min_shard_size) : 1;
+  if (num_shards <= 1)
+    return lookup(expr, 0, num_partitions);
+  // Every shard covers a contiguous range of partition indexes. The calling
+  // thread evaluates the first shard while the pool takes care of the rest.
+  auto shard_size = (num_partitions + num_shards - 1) / num_shards;
+  std::vector<std::future<std::vector<uuid>>> shards;
+  for (auto first = shard_size; first < num_partitions; first += shard_size) {
+    auto last = std::min(first + shard_size, num_partitions);
+    shards.push_back(
+      pool_->submit([&, first, last] { return lookup(expr, first, last); }));
+  }
+  auto result = lookup(expr, 0, shard_size);
+  for (auto& shard : shards)
+    detail::inplace_unify(result, shard.get());
+  VAST_ASSERT(std::is_sorted(result.begin(), result.end()));
+  return result;
+}
+
+std::vector<uuid> meta_index::lookup(const expression& expr, size_t first,
+                                     size_t last) const {
+  VAST_ASSERT(first <= last && last <= partitions_.size());
   // TODO: we could consider a flat_set<uuid> here, which would then have
   // overloads for inplace intersection/union and simplify the implementation
   // of this function a bit. This would also simplify the maintainance of a
@@ -69,23 +449,31 @@ std::vector<uuid> meta_index::lookup(const expression& expr) const {
   using result_type = std::vector<uuid>;
   result_type memoized_partitions;
   auto all_partitions = [&] {
-    if (!memoized_partitions.empty() || synopses_.empty())
+    if (!memoized_partitions.empty() || first == last)
       return memoized_partitions;
-    memoized_partitions.reserve(synopses_.size());
-    std::transform(synopses_.begin(), synopses_.end(),
-                   std::back_inserter(memoized_partitions),
-                   [](auto& x) { return x.first; });
+    memoized_partitions.assign(partitions_.begin() + first,
+                               partitions_.begin() + last);
     std::sort(memoized_partitions.begin(), memoized_partitions.end());
     return memoized_partitions;
   };
+  // Translates a selection of partition indexes, relative to `first`, into
+  // sorted partition IDs.
+  auto to_partition_ids = [&](const std::vector<bool>& selected) {
+    result_type result;
+    for (size_t i = 0; i < selected.size(); ++i)
+      if (selected[i])
+        result.push_back(partitions_[first + i]);
+    std::sort(result.begin(), result.end());
+    return result;
+  };
   auto f = detail::overload(
     [&](const conjunction& x) -> result_type {
       VAST_ASSERT(!x.empty());
       auto i = x.begin();
-      auto result = lookup(*i);
+      auto result = lookup(*i, first, last);
       if (!result.empty())
         for (++i; i != x.end(); ++i) {
-          auto xs = lookup(*i);
+          auto xs = lookup(*i, first, last);
           if (xs.empty())
             return xs; // short-circuit
           detail::inplace_intersect(result, xs);
@@ -96,9 +484,9 @@ std::vector<uuid> meta_index::lookup(const expression& expr) const {
     [&](const disjunction& x) -> result_type {
       result_type result;
       for (auto& op : x) {
-        auto xs = lookup(op);
+        auto xs = lookup(op, first, last);
         VAST_ASSERT(std::is_sorted(xs.begin(), xs.end()));
-        if (xs.size() == synopses_.size())
+        if (xs.size() == last - first)
           return xs; // short-circuit
         detail::inplace_unify(result, xs);
         VAST_ASSERT(std::is_sorted(result.begin(), result.end()));
@@ -114,30 +502,45 @@ std::vector<uuid> meta_index::lookup(const expression& expr) const {
     [&](const predicate& x) -> result_type {
       // Performs a lookup on all *matching* synopses with operator and
       // data from the predicate of the expression. The match function
-      // uses a qualified_record_field to determine whether the synopsis should
-      // be queried.
+      // uses a qualified_record_field to determine whether the synopses of a
+      // field should be queried. We resolve the predicate against the field
+      // dictionary once and then only probe the synopses of matching fields.
       auto search = [&](auto match) {
         VAST_ASSERT(caf::holds_alternative<data>(x.rhs));
-        auto& rhs = caf::get<data>(x.rhs);
-        result_type result;
+        auto rhs = make_view(caf::get<data>(x.rhs));
+        auto selected = std::vector<bool>(last - first);
         auto found_matching_synopsis = false;
-        for (auto& [part_id, part_syn] : synopses_) {
-          VAST_DEBUG(this, "checks", part_id, "for predicate", x);
-          for (auto& [field, syn] : part_syn) {
-            if (syn && match(field)) {
-              found_matching_synopsis = true;
-              auto opt = syn->lookup(x.op, make_view(rhs));
-              if (!opt || *opt) {
-                VAST_DEBUG(this, "selects", part_id, "at predicate", x);
-                result.push_back(part_id);
-                break;
-              }
+        for (size_t i = 0; i < fields_.size(); ++i) {
+          if (!match(fields_[i]))
+            continue;
+          VAST_DEBUG(this, "checks", fields_[i].fqn(), "for predicate", x);
+          auto& column = columns_[i];
+          auto begin = std::lower_bound(column.partitions.begin(),
+                                        column.partitions.end(), first);
+          for (auto k = static_cast<size_t>(begin - column.partitions.begin());
+               k < column.partitions.size() && column.partitions[k] < last;
+               ++k) {
+            auto part = column.partitions[k];
+            if (selected[part - first])
+              continue;
+            // A partition that contains the field but has no synopsis for it,
+            // e.g., because an older version of VAST built it, stays a
+            // candidate.
+            auto& syn = column.synopses[k];
+            auto opt = syn ? syn->lookup(x.op, rhs) : caf::optional<bool>{};
+            if (!opt || *opt) {
+              VAST_DEBUG(this, "selects", partitions_[part], "at predicate",
+                         x);
+              selected[part - first] = true;
             }
           }
+          // Whether we fall back to all partitions must not depend on the
+          // range we look at, so that sharded lookups yield the same result
+          // as a single one. Hence we consider the synopses of all partitions.
+          found_matching_synopsis |= column.has_synopsis;
         }
-        // Re-establish potentially violated invariant.
-        std::sort(result.begin(), result.end());
-        return found_matching_synopsis ? result : all_partitions();
+        return found_matching_synopsis ? to_partition_ids(selected)
+                                       : all_partitions();
       };
       auto extract_expr = detail::overload(
         [&](const attribute_extractor& lhs, const data& d) -> result_type {
@@ -149,23 +552,19 @@ std::vector<uuid> meta_index::lookup(const expression& expr) const {
           } else if (lhs.attr == atom::type_v) {
             // We don't have to look into the synopses for type queries, just
             // at the layout names.
-            result_type result;
-            for (auto& [part_id, part_syn] : synopses_) {
-              for (auto& pair : part_syn) {
-                // TODO: provide an overload for view of evaluate() so that
-                // we can use string_view here. Fortunately type names are
-                // short, so we're probably not hitting the allocator due to
-                // SSO.
-                auto type_name = data{pair.first.layout_name};
-                if (evaluate(type_name, x.op, d)) {
-                  result.push_back(part_id);
-                  break;
-                }
-              }
+            auto selected = std::vector<bool>(last - first);
+            for (auto& [name, parts] : layouts_) {
+              // TODO: provide an overload for view of evaluate() so that
+              // we can use string_view here. Fortunately type names are
+              // short, so we're probably not hitting the allocator due to
+              // SSO.
+              if (evaluate(data{name}, x.op, d))
+                for (auto i = std::lower_bound(parts.begin(), parts.end(),
+                                               first);
+                     i != parts.end() && *i < last; ++i)
+                  selected[*i - first] = true;
             }
-            // Re-establish potentially violated invariant.
-            std::sort(result.begin(), result.end());
-            return result;
+            return to_partition_ids(selected);
           }
           VAST_WARNING(this, "cannot process attribute extractor:", lhs.attr);
           return all_partitions();
@@ -194,27 +593,224 @@ std::vector<uuid> meta_index::lookup(const expression& expr) const {
   return caf::visit(f, expr);
 }
 
+void meta_index::parallelism(size_t num_threads) {
+  if (num_threads > 1)
+    pool_ = std::make_shared<detail::thread_pool>(num_threads - 1);
+  else
+    pool_.reset();
+}
+
 caf::settings& meta_index::factory_options() {
   return synopsis_options_;
 }
 
+size_t meta_index::num_partitions() const {
+  return partitions_.size();
+}
+
+const std::vector<uuid>& meta_index::partitions() const {
+  return partitions_;
+}
+
+caf::expected<flatbuffers::Offset<fbs::MetaIndex>>
+pack(flatbuffers::FlatBufferBuilder& builder, const meta_index& x,
+     size_t first) {
+  VAST_ASSERT(first <= x.partitions_.size());
+  // Synopses of the same field usually share their type, so we store every
+  // distinct type only once.
+  std::vector<flatbuffers::Offset<fbs::SerializedType>> types;
+  std::unordered_map<type, size_t> type_indexes;
+  auto type_index = [&](const type& t) -> caf::expected<size_t> {
+    if (auto i = type_indexes.find(t); i != type_indexes.end())
+      return i->second;
+    auto data
+      = pack_state(builder, [&](caf::serializer& sink) { return sink(t); });
+    if (!data)
+      return data.error();
+    auto result = types.size();
+    types.push_back(fbs::CreateSerializedType(builder, *data));
+    type_indexes.emplace(t, result);
+    return result;
+  };
+  // Partition indexes in the flatbuffer are relative to *first*.
+  std::vector<uint8_t> partitions;
+  partitions.reserve((x.partitions_.size() - first) * uuid::num_bytes);
+  for (auto i = first; i < x.partitions_.size(); ++i) {
+    auto bytes = as_bytes(x.partitions_[i]);
+    auto data = reinterpret_cast<const uint8_t*>(bytes.data());
+    partitions.insert(partitions.end(), data, data + bytes.size());
+  }
+  std::vector<flatbuffers::Offset<fbs::LayoutPartitions>> layouts;
+  for (auto& [name, parts] : x.layouts_) {
+    std::vector<uint64_t> packed_parts;
+    for (auto i = std::lower_bound(parts.begin(), parts.end(), first);
+         i != parts.end(); ++i)
+      packed_parts.push_back(*i - first);
+    if (!packed_parts.empty())
+      layouts.push_back(fbs::CreateLayoutPartitionsDirect(
+        builder, name.c_str(), &packed_parts));
+  }
+  std::vector<flatbuffers::Offset<fbs::Field>> fields;
+  for (size_t i = 0; i < x.fields_.size(); ++i) {
+    auto& column = x.columns_[i];
+    std::vector<flatbuffers::Offset<fbs::Synopsis>> synopses;
+    std::vector<uint64_t> bare_partitions;
+    auto begin = std::lower_bound(column.partitions.begin(),
+                                  column.partitions.end(), first);
+    for (auto k = static_cast<size_t>(begin - column.partitions.begin());
+         k < column.partitions.size(); ++k) {
+      // We record partitions without a synopsis for the field separately,
+      // because lookups must still select them.
+      auto& syn = column.synopses[k];
+      if (!syn) {
+        bare_partitions.push_back(column.partitions[k] - first);
+        continue;
+      }
+      auto syn_type = type_index(syn->type());
+      if (!syn_type)
+        return syn_type.error();
+      auto bf = pack_bloom_filter<address>(builder, *syn);
+      if (bf && bf->IsNull())
+        bf = pack_bloom_filter<std::string>(builder, *syn);
+      if (!bf)
+        return bf.error();
+      auto state = flatbuffers::Offset<flatbuffers::Vector<uint8_t>>{};
+      if (bf->IsNull()) {
+        auto serialize = [&](caf::serializer& sink) {
+          return syn->serialize(sink);
+        };
+        auto packed_state = pack_state(builder, serialize);
+        if (!packed_state)
+          return packed_state.error();
+        state = *packed_state;
+      }
+      synopses.push_back(fbs::CreateSynopsis(
+        builder, column.partitions[k] - first, *syn_type, state, *bf));
+    }
+    if (synopses.empty() && bare_partitions.empty())
+      continue;
+    auto& field = x.fields_[i];
+    auto field_type = type_index(field.type);
+    if (!field_type)
+      return field_type.error();
+    fields.push_back(fbs::CreateFieldDirect(
+      builder, field.layout_name.c_str(), field.field_name.c_str(),
+      *field_type, &synopses, &bare_partitions));
+  }
+  auto options = pack_state(builder, [&](caf::serializer& sink) {
+    return sink(x.synopsis_options_);
+  });
+  if (!options)
+    return options.error();
+  auto packed_partitions = builder.CreateVector(partitions);
+  auto packed_types = builder.CreateVector(types);
+  auto packed_layouts = builder.CreateVector(layouts);
+  auto packed_fields = builder.CreateVector(fields);
+  return fbs::CreateMetaIndex(builder, 0, *options, packed_partitions,
+                              packed_types, packed_layouts, packed_fields);
+}
+
 caf::expected<flatbuffers::Offset<fbs::MetaIndex>>
 pack(flatbuffers::FlatBufferBuilder& builder, const meta_index& x) {
-  std::vector<char> buffer;
-  caf::binary_serializer sink{nullptr, buffer};
-  if (auto error = sink(x))
-    return error;
-  auto data_ptr = reinterpret_cast<const uint8_t*>(buffer.data());
-  auto data = builder.CreateVector(data_ptr, buffer.size());
-  fbs::MetaIndexBuilder meta_index_builder{builder};
-  meta_index_builder.add_state(data);
-  return meta_index_builder.Finish();
+  return pack(builder, x, 0);
+}
+
+caf::error unpack(const fbs::MetaIndex& x, meta_index& y, chunk_ptr chunk) {
+  // Meta index files of older versions of VAST only contain the meta index
+  // state in CAF binary format.
+  if (auto state = x.state()) {
+    meta_index legacy;
+    auto deserialize = [&](caf::deserializer& source) {
+      return source(legacy);
+    };
+    if (auto err = unpack_state(state, deserialize))
+      return err;
+    y.synopsis_options_ = std::move(legacy.synopsis_options_);
+    for (auto& [partition, synopses] : legacy.partition_synopses())
+      y.merge(partition, std::move(synopses));
+    return caf::none;
+  }
+  auto invalid = [](const char* what) {
+    return make_error(ec::format_error, "invalid meta index:", what);
+  };
+  if (!x.partitions() || !x.types() || !x.layouts() || !x.fields())
+    return invalid("missing tables");
+  if (x.partitions()->size() % uuid::num_bytes != 0)
+    return invalid("truncated partition ID");
+  auto deserialize_options = [&](caf::deserializer& source) {
+    return source(y.synopsis_options_);
+  };
+  if (auto err = unpack_state(x.options(), deserialize_options))
+    return err;
+  std::vector<size_t> partitions;
+  for (size_t i = 0; i < x.partitions()->size(); i += uuid::num_bytes) {
+    auto data = reinterpret_cast<const byte*>(x.partitions()->data() + i);
+    auto bytes = span<const byte, uuid::num_bytes>{data, uuid::num_bytes};
+    partitions.push_back(y.partition_index(uuid{bytes}));
+  }
+  std::vector<type> types;
+  for (auto packed_type : *x.types()) {
+    auto& t = types.emplace_back();
+    auto deserialize = [&](caf::deserializer& source) { return source(t); };
+    if (auto err = unpack_state(packed_type->data(), deserialize))
+      return err;
+  }
+  for (auto layout : *x.layouts()) {
+    if (!layout->name() || !layout->partitions())
+      return invalid("incomplete layout");
+    auto& parts = y.layouts_[layout->name()->str()];
+    for (auto part : *layout->partitions()) {
+      if (part >= partitions.size())
+        return invalid("partition out of range");
+      insert_sorted(parts, partitions[part]);
+    }
+  }
+  for (auto field : *x.fields()) {
+    if (!field->layout() || !field->name() || !field->synopses()
+        || field->type() >= types.size())
+      return invalid("incomplete field");
+    auto qualified_field = qualified_record_field{
+      field->layout()->str(),
+      record_field{field->name()->str(), types[field->type()]}};
+    auto& column = y.columns_[y.field_index(std::move(qualified_field))];
+    for (auto packed_syn : *field->synopses()) {
+      if (packed_syn->partition() >= partitions.size()
+          || packed_syn->type() >= types.size())
+        return invalid("synopsis out of range");
+      auto& syn_type = types[packed_syn->type()];
+      synopsis_ptr syn;
+      if (auto bf = packed_syn->bloom_filter()) {
+        auto result = unpack_bloom_filter(*bf, syn_type, chunk);
+        if (!result)
+          return result.error();
+        syn = std::move(*result);
+      } else {
+        syn = factory<synopsis>::make(syn_type, caf::settings{});
+        if (!syn)
+          return ec::invalid_synopsis_type;
+        auto deserialize = [&](caf::deserializer& source) {
+          return syn->deserialize(source);
+        };
+        if (auto err = unpack_state(packed_syn->state(), deserialize))
+          return err;
+      }
+      auto part = partitions[packed_syn->partition()];
+      column.has_synopsis = true;
+      y.slot(column, part, [] { return synopsis_ptr{}; }) = std::move(syn);
+    }
+    if (auto bare_partitions = field->bare_partitions()) {
+      for (auto part : *bare_partitions) {
+        if (part >= partitions.size())
+          return invalid("partition out of range");
+        y.slot(column, partitions[part], [] { return synopsis_ptr{}; });
+      }
+    }
+  }
+  return caf::none;
 }
 
 caf::error unpack(const fbs::MetaIndex& x, meta_index& y) {
-  auto ptr = reinterpret_cast<const char*>(x.state()->Data());
-  caf::binary_deserializer source{nullptr, ptr, x.state()->size()};
-  return source(y);
+  return unpack(x, y, nullptr);
 }
 
 } // namespace vast
@@ -27,6 +27,10 @@ null_bitmap::size_type null_bitmap::size() const {
   return bitvector_.size();
 }
 
+const null_bitmap::bitvector_type::block_vector& null_bitmap::blocks() const {
+  return bitvector_.blocks();
+}
+
 void null_bitmap::append_bit(bool bit) {
   bitvector_.push_back(bit);
 }
@@ -43,6 +47,16 @@ void null_bitmap::flip() {
   bitvector_.flip();
 }
 
+null_bitmap& null_bitmap::operator&=(const null_bitmap& other) {
+  bitvector_ &= other.bitvector_;
+  return *this;
+}
+
+null_bitmap& null_bitmap::operator|=(const null_bitmap& other) {
+  bitvector_ |= other.bitvector_;
+  return *this;
+}
+
 bool operator==(const null_bitmap& x, const null_bitmap& y) {
   return x.bitvector_ == y.bitvector_;
 }
@@ -0,0 +1,71 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/port_synopsis.hpp"
+
+#include "vast/data.hpp"
+#include "vast/detail/assert.hpp"
+#include "vast/port.hpp"
+#include "vast/view.hpp"
+
+#include <limits>
+
+namespace vast {
+
+port_synopsis::port_synopsis(vast::type x)
+  : super{std::move(x), std::numeric_limits<count>::max(),
+          std::numeric_limits<count>::min()} {
+  // nop
+}
+
+void port_synopsis::add(data_view x) {
+  auto p = caf::get_if<view<port>>(&x);
+  VAST_ASSERT(p != nullptr);
+  super::add(count{p->number()});
+}
+
+caf::optional<bool>
+port_synopsis::lookup(relational_operator op, data_view rhs) const {
+  switch (op) {
+    default:
+      break;
+    case not_equal:
+    case not_in:
+      // Equal port numbers with different port types are not equal, but we
+      // only know about the numbers.
+      return caf::none;
+  }
+  if (auto x = caf::get_if<view<port>>(&rhs))
+    return super::lookup(op, count{x->number()});
+  if (auto xs = caf::get_if<view<list>>(&rhs)) {
+    list numbers;
+    for (auto x : **xs) {
+      auto y = caf::get_if<view<port>>(&x);
+      if (!y)
+        return caf::none;
+      numbers.emplace_back(count{y->number()});
+    }
+    auto ys = data{std::move(numbers)};
+    return super::lookup(op, make_view(ys));
+  }
+  return caf::none;
+}
+
+bool port_synopsis::equals(const synopsis& other) const noexcept {
+  if (typeid(other) != typeid(port_synopsis))
+    return false;
+  auto& dref = static_cast<const port_synopsis&>(other);
+  return type() == dref.type() && min() == dref.min() && max() == dref.max();
+}
+
+} // namespace vast
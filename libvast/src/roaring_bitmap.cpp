@@ -0,0 +1,637 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/roaring_bitmap.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <tuple>
+
+namespace vast {
+
+namespace {
+
+using container = roaring_bitmap::container;
+using block_type = roaring_bitmap::block_type;
+using word_type = roaring_bitmap::word_type;
+using kind = container::kind;
+
+constexpr auto chunk_size = static_cast<uint32_t>(roaring_bitmap::container_bits);
+
+constexpr auto width = static_cast<uint32_t>(word_type::width);
+
+// Returns the index of the first run whose last position is at least i.
+size_t find_run(const std::vector<uint16_t>& runs, uint32_t i) {
+  size_t first = 0;
+  size_t last = runs.size() / 2;
+  while (first < last) {
+    auto mid = first + (last - first) / 2;
+    if (runs[2 * mid + 1] < i)
+      first = mid + 1;
+    else
+      last = mid;
+  }
+  return first;
+}
+
+// Sets the bits in [first, last) of an uncompressed bitset.
+void set_range(std::vector<block_type>& blocks, uint32_t first, uint32_t last) {
+  while (first < last) {
+    auto offset = first % width;
+    auto n = std::min(last - first, width - offset);
+    blocks[first / width] |= word_type::lsb_fill(n) << offset;
+    first += n;
+  }
+}
+
+// Counts the number of runs of 1s in an uncompressed bitset.
+size_t count_runs(const std::vector<block_type>& blocks) {
+  size_t result = 0;
+  block_type carry = 0;
+  for (auto x : blocks) {
+    // A run begins at every 1-bit whose predecessor is a 0-bit.
+    result += word_type::popcount(x & ~((x << 1) | carry));
+    carry = x >> (width - 1);
+  }
+  return result;
+}
+
+// Appends the interval [first, last] to a list of runs, coalescing it with the
+// last run if the two overlap or touch.
+void append_run(std::vector<uint16_t>& runs, uint16_t first, uint16_t last) {
+  if (!runs.empty() && first <= runs.back() + 1u)
+    runs.back() = std::max(runs.back(), last);
+  else {
+    runs.push_back(first);
+    runs.push_back(last);
+  }
+}
+
+bool is_empty(const container& x) {
+  return x.values.empty() && x.blocks.empty();
+}
+
+container intersect(const container& x, const container& y) {
+  container result;
+  result.key = x.key;
+  if (x.type == kind::array || y.type == kind::array) {
+    // Probing the sparse side keeps the result sorted and small.
+    auto [sparse, other] = x.type == kind::array ? std::tie(x, y)
+                                                 : std::tie(y, x);
+    for (auto i : sparse.values)
+      if (other.test(i))
+        result.values.push_back(i);
+    return result;
+  }
+  if (x.type == kind::run && y.type == kind::run) {
+    result.type = kind::run;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < x.values.size() && j < y.values.size()) {
+      auto first = std::max(x.values[i], y.values[j]);
+      auto last = std::min(x.values[i + 1], y.values[j + 1]);
+      if (first <= last)
+        append_run(result.values, first, last);
+      if (x.values[i + 1] < y.values[j + 1])
+        i += 2;
+      else
+        j += 2;
+    }
+  } else {
+    auto xs = x.to_bitset();
+    auto ys = y.to_bitset();
+    for (size_t i = 0; i < xs.size(); ++i)
+      xs[i] &= ys[i];
+    result.assign(std::move(xs), kind::bitset);
+  }
+  result.optimize();
+  return result;
+}
+
+container unite(const container& x, const container& y) {
+  container result;
+  result.key = x.key;
+  if (x.type == kind::array && y.type == kind::array) {
+    std::set_union(x.values.begin(), x.values.end(), y.values.begin(),
+                   y.values.end(), std::back_inserter(result.values));
+  } else if (x.type == kind::run && y.type == kind::run) {
+    result.type = kind::run;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < x.values.size() || j < y.values.size()) {
+      if (j == y.values.size()
+          || (i < x.values.size() && x.values[i] <= y.values[j])) {
+        append_run(result.values, x.values[i], x.values[i + 1]);
+        i += 2;
+      } else {
+        append_run(result.values, y.values[j], y.values[j + 1]);
+        j += 2;
+      }
+    }
+  } else {
+    auto xs = x.to_bitset();
+    auto ys = y.to_bitset();
+    for (size_t i = 0; i < xs.size(); ++i)
+      xs[i] |= ys[i];
+    result.assign(std::move(xs), kind::bitset);
+  }
+  result.optimize();
+  return result;
+}
+
+// Computes the complement of a container whose chunk has n valid bits.
+container complement(const container& x, uint32_t n) {
+  container result;
+  result.key = x.key;
+  if (x.type == kind::run) {
+    result.type = kind::run;
+    uint32_t i = 0;
+    for (size_t r = 0; r < x.values.size(); r += 2) {
+      if (x.values[r] > i)
+        append_run(result.values, i, x.values[r] - 1);
+      i = x.values[r + 1] + 1u;
+    }
+    if (i < n)
+      append_run(result.values, i, n - 1);
+  } else {
+    auto xs = x.to_bitset();
+    for (auto& block : xs)
+      block = ~block;
+    if (n < chunk_size) {
+      if (n % width != 0)
+        xs[n / width] &= word_type::lsb_mask(n % width);
+      std::fill(xs.begin() + (n + width - 1) / width, xs.end(), block_type{0});
+    }
+    result.assign(std::move(xs), kind::bitset);
+  }
+  result.optimize();
+  return result;
+}
+
+} // namespace
+
+// -- container ----------------------------------------------------------------
+
+size_t container::cardinality() const {
+  size_t result = 0;
+  switch (type) {
+    case kind::array:
+      result = values.size();
+      break;
+    case kind::bitset:
+      for (auto x : blocks)
+        result += word_type::popcount(x);
+      break;
+    case kind::run:
+      for (size_t i = 0; i < values.size(); i += 2)
+        result += values[i + 1] - values[i] + 1u;
+      break;
+  }
+  return result;
+}
+
+bool container::test(uint32_t i) const {
+  VAST_ASSERT(i < chunk_size);
+  switch (type) {
+    case kind::array:
+      return std::binary_search(values.begin(), values.end(), i);
+    case kind::bitset:
+      return word_type::test(blocks[i / width], i % width);
+    case kind::run: {
+      auto r = find_run(values, i);
+      return r < values.size() / 2 && values[2 * r] <= i;
+    }
+  }
+  return false;
+}
+
+uint32_t container::find(bool bit, uint32_t i) const {
+  VAST_ASSERT(i < chunk_size);
+  switch (type) {
+    case kind::array: {
+      auto x = std::lower_bound(values.begin(), values.end(), i);
+      if (bit)
+        return x == values.end() ? chunk_size : *x;
+      for (; x != values.end() && *x == i; ++x)
+        ++i;
+      return i;
+    }
+    case kind::bitset: {
+      auto b = i / width;
+      auto x = (bit ? blocks[b] : ~blocks[b]) & (word_type::all << (i % width));
+      while (x == 0) {
+        if (++b == bitset_blocks)
+          return chunk_size;
+        x = bit ? blocks[b] : ~blocks[b];
+      }
+      return b * width + word_type::count_trailing_zeros(x);
+    }
+    case kind::run: {
+      auto r = find_run(values, i);
+      auto inside = r < values.size() / 2 && values[2 * r] <= i;
+      if (!bit)
+        return inside ? values[2 * r + 1] + 1u : i;
+      if (inside)
+        return i;
+      return r < values.size() / 2 ? values[2 * r] : chunk_size;
+    }
+  }
+  return chunk_size;
+}
+
+block_type container::extract(uint32_t i, uint32_t n) const {
+  VAST_ASSERT(n <= width && i + n <= chunk_size);
+  block_type result = 0;
+  switch (type) {
+    case kind::array: {
+      auto x = std::lower_bound(values.begin(), values.end(), i);
+      for (; x != values.end() && *x < i + n; ++x)
+        result |= word_type::mask(*x - i);
+      break;
+    }
+    case kind::bitset: {
+      auto b = i / width;
+      auto offset = i % width;
+      result = blocks[b] >> offset;
+      if (offset > 0 && b + 1 < bitset_blocks)
+        result |= blocks[b + 1] << (width - offset);
+      break;
+    }
+    case kind::run: {
+      for (auto r = find_run(values, i);
+           r < values.size() / 2 && values[2 * r] < i + n; ++r) {
+        auto first = std::max<uint32_t>(values[2 * r], i);
+        auto last = std::min<uint32_t>(values[2 * r + 1] + 1u, i + n);
+        result |= word_type::lsb_fill(last - first) << (first - i);
+      }
+      break;
+    }
+  }
+  return n < width ? result & word_type::lsb_mask(n) : result;
+}
+
+void container::add(uint32_t i) {
+  VAST_ASSERT(i < chunk_size);
+  switch (type) {
+    case kind::array:
+      values.push_back(i);
+      if (values.size() > max_array_size)
+        assign(to_bitset(), kind::bitset);
+      break;
+    case kind::bitset:
+      blocks[i / width] |= word_type::mask(i % width);
+      break;
+    case kind::run:
+      append_run(values, i, i);
+      if (values.size() > max_array_size)
+        assign(to_bitset(), kind::bitset);
+      break;
+  }
+}
+
+void container::add_range(uint32_t first, uint32_t last) {
+  VAST_ASSERT(first < last && last <= chunk_size);
+  if (type == kind::array) {
+    if (last - first <= 2) {
+      for (; first < last; ++first)
+        add(first);
+      return;
+    }
+    // Switch to runs, which represent an interval in constant space.
+    std::vector<uint16_t> runs;
+    for (auto i : values)
+      append_run(runs, i, i);
+    values = std::move(runs);
+    type = kind::run;
+  }
+  if (type == kind::bitset) {
+    set_range(blocks, first, last);
+    return;
+  }
+  append_run(values, first, last - 1);
+  // A run takes 4 bytes, and we never want more than a bitset.
+  if (values.size() > max_array_size)
+    assign(to_bitset(), kind::bitset);
+}
+
+std::vector<block_type> container::to_bitset() const {
+  if (type == kind::bitset)
+    return blocks;
+  std::vector<block_type> result(bitset_blocks, 0);
+  if (type == kind::array)
+    for (auto i : values)
+      result[i / width] |= word_type::mask(i % width);
+  else
+    for (size_t i = 0; i < values.size(); i += 2)
+      set_range(result, values[i], values[i + 1] + 1u);
+  return result;
+}
+
+void container::assign(std::vector<block_type> xs, kind k) {
+  VAST_ASSERT(xs.size() == bitset_blocks);
+  values.clear();
+  blocks.clear();
+  type = k;
+  switch (k) {
+    case kind::array:
+      for (uint32_t b = 0; b < xs.size(); ++b)
+        for (auto x = xs[b]; x != 0; x &= x - 1)
+          values.push_back(b * width + word_type::count_trailing_zeros(x));
+      break;
+    case kind::bitset:
+      blocks = std::move(xs);
+      break;
+    case kind::run: {
+      container tmp;
+      tmp.type = kind::bitset;
+      tmp.blocks = std::move(xs);
+      auto i = tmp.find(true, 0);
+      while (i < chunk_size) {
+        auto j = tmp.find(false, i);
+        append_run(values, i, j - 1);
+        i = j < chunk_size ? tmp.find(true, j) : chunk_size;
+      }
+      break;
+    }
+  }
+}
+
+void container::optimize() {
+  size_t card = 0;
+  size_t runs = 0;
+  switch (type) {
+    case kind::array:
+      card = values.size();
+      for (size_t i = 0; i < values.size(); ++i)
+        if (i == 0 || values[i] != values[i - 1] + 1u)
+          ++runs;
+      break;
+    case kind::bitset:
+      card = cardinality();
+      runs = count_runs(blocks);
+      break;
+    case kind::run:
+      card = cardinality();
+      runs = values.size() / 2;
+      break;
+  }
+  // Pick the representation with the smallest footprint.
+  auto array_bytes = card <= max_array_size ? card * sizeof(uint16_t)
+                                            : std::numeric_limits<size_t>::max();
+  auto bitset_bytes = bitset_blocks * sizeof(block_type);
+  auto run_bytes = runs * 2 * sizeof(uint16_t);
+  auto k = kind::bitset;
+  if (run_bytes < std::min(array_bytes, bitset_bytes))
+    k = kind::run;
+  else if (array_bytes <= bitset_bytes)
+    k = kind::array;
+  if (k != type)
+    assign(to_bitset(), k);
+}
+
+bool operator==(const container& x, const container& y) {
+  if (x.key != y.key)
+    return false;
+  if (x.type == y.type)
+    return x.values == y.values && x.blocks == y.blocks;
+  return x.to_bitset() == y.to_bitset();
+}
+
+// -- roaring_bitmap -----------------------------------------------------------
+
+roaring_bitmap::roaring_bitmap(size_type n, bool bit) {
+  append_bits(bit, n);
+}
+
+bool roaring_bitmap::empty() const {
+  return num_bits_ == 0;
+}
+
+roaring_bitmap::size_type roaring_bitmap::size() const {
+  return num_bits_;
+}
+
+const roaring_bitmap::container_vector& roaring_bitmap::containers() const {
+  return containers_;
+}
+
+void roaring_bitmap::append_bit(bool bit) {
+  VAST_ASSERT(num_bits_ < max_size);
+  if (bit)
+    back(num_bits_ / container_bits)
+      .add(static_cast<uint32_t>(num_bits_ % container_bits));
+  ++num_bits_;
+}
+
+void roaring_bitmap::append_bits(bool bit, size_type n) {
+  VAST_ASSERT(max_size - num_bits_ >= n);
+  if (bit)
+    fill(num_bits_, n);
+  num_bits_ += n;
+}
+
+void roaring_bitmap::append_block(block_type bits, size_type n) {
+  VAST_ASSERT(n <= word_type::width);
+  VAST_ASSERT(max_size - num_bits_ >= n);
+  if (n < word_type::width)
+    bits &= word_type::lsb_mask(n);
+  // Process the block one run of 1s at a time.
+  while (bits != 0) {
+    auto first = word_type::count_trailing_zeros(bits);
+    auto rest = bits >> first;
+    auto ones = rest == word_type::all ? word_type::width - first
+                                       : word_type::count_trailing_ones(rest);
+    fill(num_bits_ + first, ones);
+    bits &= first + ones < word_type::width
+              ? word_type::all << (first + ones)
+              : word_type::none;
+  }
+  num_bits_ += n;
+}
+
+void roaring_bitmap::flip() {
+  container_vector result;
+  auto x = containers_.begin();
+  auto chunks = (num_bits_ + container_bits - 1) / container_bits;
+  for (size_type key = 0; key < chunks; ++key) {
+    auto n = static_cast<uint32_t>(
+      std::min(num_bits_ - key * container_bits, container_bits));
+    if (x != containers_.end() && x->key == key) {
+      auto c = complement(*x++, n);
+      if (!is_empty(c))
+        result.push_back(std::move(c));
+    } else {
+      // A missing container turns into a single run.
+      result.emplace_back();
+      result.back().key = key;
+      result.back().type = container::kind::run;
+      result.back().values = {0, static_cast<uint16_t>(n - 1)};
+    }
+  }
+  containers_ = std::move(result);
+}
+
+void roaring_bitmap::optimize() {
+  for (auto& x : containers_)
+    x.optimize();
+}
+
+bool roaring_bitmap::operator[](size_type i) const {
+  VAST_ASSERT(i < num_bits_);
+  auto key = i / container_bits;
+  auto pred = [](const container& x, size_type k) { return x.key < k; };
+  auto x = std::lower_bound(containers_.begin(), containers_.end(), key, pred);
+  return x != containers_.end() && x->key == key
+         && x->test(static_cast<uint32_t>(i % container_bits));
+}
+
+roaring_bitmap& roaring_bitmap::operator&=(const roaring_bitmap& other) {
+  container_vector result;
+  auto x = containers_.begin();
+  auto y = other.containers_.begin();
+  while (x != containers_.end() && y != other.containers_.end()) {
+    if (x->key < y->key) {
+      ++x;
+    } else if (y->key < x->key) {
+      ++y;
+    } else {
+      auto c = intersect(*x++, *y++);
+      if (!is_empty(c))
+        result.push_back(std::move(c));
+    }
+  }
+  containers_ = std::move(result);
+  num_bits_ = std::max(num_bits_, other.num_bits_);
+  return *this;
+}
+
+roaring_bitmap& roaring_bitmap::operator|=(const roaring_bitmap& other) {
+  container_vector result;
+  auto x = containers_.begin();
+  auto y = other.containers_.begin();
+  while (x != containers_.end() || y != other.containers_.end()) {
+    if (y == other.containers_.end()
+        || (x != containers_.end() && x->key < y->key))
+      result.push_back(std::move(*x++));
+    else if (x == containers_.end() || y->key < x->key)
+      result.push_back(*y++);
+    else
+      result.push_back(unite(*x++, *y++));
+  }
+  containers_ = std::move(result);
+  num_bits_ = std::max(num_bits_, other.num_bits_);
+  return *this;
+}
+
+bool operator==(const roaring_bitmap& x, const roaring_bitmap& y) {
+  return x.num_bits_ == y.num_bits_ && x.containers_ == y.containers_;
+}
+
+roaring_bitmap_range bit_range(const roaring_bitmap& bm) {
+  return roaring_bitmap_range{bm};
+}
+
+void roaring_bitmap::fill(size_type first, size_type n) {
+  while (n > 0) {
+    auto offset = first % container_bits;
+    auto k = std::min(n, container_bits - offset);
+    auto i = static_cast<uint32_t>(offset);
+    back(first / container_bits).add_range(i, i + static_cast<uint32_t>(k));
+    first += k;
+    n -= k;
+  }
+}
+
+roaring_bitmap::container& roaring_bitmap::back(size_type key) {
+  VAST_ASSERT(containers_.empty() || containers_.back().key <= key);
+  if (containers_.empty() || containers_.back().key != key) {
+    if (!containers_.empty())
+      containers_.back().optimize();
+    containers_.emplace_back();
+    containers_.back().key = key;
+  }
+  return containers_.back();
+}
+
+// -- roaring_bitmap_range -----------------------------------------------------
+
+roaring_bitmap_range::roaring_bitmap_range(const roaring_bitmap& bm)
+  : bm_{&bm} {
+  if (!done())
+    scan();
+}
+
+void roaring_bitmap_range::next() {
+  position_ += bits_.size();
+  if (!done())
+    scan();
+}
+
+bool roaring_bitmap_range::done() const {
+  return bm_ == nullptr || position_ >= bm_->num_bits_;
+}
+
+void roaring_bitmap_range::scan() {
+  constexpr auto container_bits = roaring_bitmap::container_bits;
+  auto& xs = bm_->containers_;
+  auto num_bits = bm_->num_bits_;
+  auto key = position_ / container_bits;
+  while (container_ < xs.size() && xs[container_].key < key)
+    ++container_;
+  const roaring_bitmap::container* x = nullptr;
+  auto bit = false;
+  auto next = position_; // One past the end of the homogeneous sequence.
+  auto extend = true;    // Whether the sequence reaches a chunk boundary.
+  auto i = uint32_t{0};
+  auto end = uint32_t{0};
+  if (container_ == xs.size() || xs[container_].key > key) {
+    // Everything up to the next container is 0.
+    next = container_ == xs.size() ? num_bits
+                                   : xs[container_].key * container_bits;
+  } else {
+    x = &xs[container_];
+    auto base = x->key * container_bits;
+    i = static_cast<uint32_t>(position_ - base);
+    end = static_cast<uint32_t>(std::min(num_bits - base, container_bits));
+    bit = x->test(i);
+    auto last = std::min(x->find(!bit, i), end);
+    next = base + last;
+    extend = last == end;
+  }
+  // Let sequences that reach the end of a chunk continue into the following
+  // containers and gaps, so that a long run maps to a single sequence.
+  auto c = x == nullptr ? container_ : container_ + 1;
+  while (extend && next < num_bits) {
+    if (c < xs.size() && xs[c].key * container_bits == next) {
+      auto n = static_cast<uint32_t>(std::min(num_bits - next, container_bits));
+      auto last = std::min(xs[c++].find(!bit, 0), n);
+      next += last;
+      extend = last == n;
+    } else if (!bit) {
+      next = c < xs.size() ? xs[c].key * container_bits : num_bits;
+    } else {
+      extend = false;
+    }
+  }
+  auto n = next - position_;
+  if (x == nullptr || n > word_type::width) {
+    bits_ = {bit ? word_type::all : word_type::none, n};
+  } else {
+    // Short sequences become a literal block from the current container.
+    auto k = std::min(end - i, width);
+    bits_ = {x->extract(i, k), k};
+  }
+}
+
+} // namespace vast
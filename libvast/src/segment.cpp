@@ -15,16 +15,22 @@
 
 #include "vast/bitmap.hpp"
 #include "vast/bitmap_algorithms.hpp"
+#include "vast/compression.hpp"
+#include "vast/defaults.hpp"
 #include "vast/detail/assert.hpp"
 #include "vast/detail/byte_swap.hpp"
 #include "vast/detail/narrow.hpp"
 #include "vast/error.hpp"
+#include "vast/expression.hpp"
+#include "vast/expression_visitors.hpp"
 #include "vast/fbs/segment.hpp"
 #include "vast/fbs/utils.hpp"
 #include "vast/ids.hpp"
 #include "vast/logger.hpp"
 #include "vast/si_literals.hpp"
+#include "vast/synopsis.hpp"
 #include "vast/table_slice.hpp"
+#include "vast/type.hpp"
 
 #include <caf/binary_deserializer.hpp>
 #include <caf/binary_serializer.hpp>
@@ -33,15 +39,95 @@ namespace vast {
 
 using namespace binary_byte_literals;
 
+namespace {
+
+/// @returns The half-open ID interval of a table slice in a segment.
+std::pair<id, id> id_range(const fbs::TableSliceBuffer& x) {
+  // Older segments record the ID range only for compressed table slices.
+  if (x.rows() == 0 && x.compression() == fbs::Compression::None) {
+    auto slice = x.data_nested_root();
+    return {slice->offset(), slice->offset() + slice->rows()};
+  }
+  return {x.offset(), x.offset() + x.rows()};
+}
+
+/// Deserializes CAF binary from a flatbuffer byte vector.
+template <class T>
+caf::error unpack_bytes(const flatbuffers::Vector<uint8_t>& xs, T& x) {
+  auto data = reinterpret_cast<const char*>(xs.data());
+  caf::binary_deserializer source{nullptr, data, xs.size()};
+  return source(x);
+}
+
+/// Decompresses a table slice of a segment into a new chunk.
+/// @param max_size The maximum size of the uncompressed table slice.
+caf::expected<chunk_ptr>
+uncompress([[maybe_unused]] const fbs::Segment& segment,
+           const fbs::TableSliceBuffer& x, size_t max_size) {
+  if (x.compressed_data() == nullptr)
+    return make_error(ec::format_error, "missing compressed table slice");
+  // The size comes straight from disk, so we bound it before allocating.
+  if (x.uncompressed_size() > max_size)
+    return make_error(ec::format_error,
+                      "uncompressed table slice exceeds segment size",
+                      x.uncompressed_size());
+  auto in = reinterpret_cast<const char*>(x.compressed_data()->data());
+  auto in_size = x.compressed_data()->size();
+  std::vector<char> out(x.uncompressed_size());
+  size_t n = 0;
+  switch (x.compression()) {
+    case fbs::Compression::None:
+      return make_error(ec::logic_error, "table slice is not compressed");
+    case fbs::Compression::LZ4:
+      n = lz4::uncompress(in, in_size, out.data(), out.size());
+      break;
+    case fbs::Compression::Zstd: {
+#if VAST_HAVE_ZSTD
+      const char* dict = nullptr;
+      size_t dict_size = 0;
+      if (x.dictionary() >= 0) {
+        auto dictionaries = segment.dictionaries();
+        auto index = static_cast<uint32_t>(x.dictionary());
+        if (dictionaries == nullptr || index >= dictionaries->size())
+          return make_error(ec::format_error, "missing compression dictionary");
+        auto data = dictionaries->Get(index)->data();
+        dict = reinterpret_cast<const char*>(data->data());
+        dict_size = data->size();
+      }
+      n = zstd::uncompress(in, in_size, out.data(), out.size(), dict,
+                           dict_size);
+      break;
+#else
+      return make_error(ec::unimplemented, "zstd support not available");
+#endif
+    }
+    default:
+      return make_error(ec::format_error, "unknown table slice compression");
+  }
+  if (n != out.size())
+    return make_error(ec::format_error, "failed to uncompress table slice");
+  return chunk::make(std::move(out));
+}
+
+} // namespace
+
 caf::expected<segment> segment::make(chunk_ptr chunk) {
+  return make(std::move(chunk), defaults::system::max_segment_size * 1_MiB);
+}
+
+caf::expected<segment> segment::make(chunk_ptr chunk, size_t max_size) {
   VAST_ASSERT(chunk != nullptr);
   auto ptr = fbs::as_flatbuffer<fbs::Segment>(as_bytes(chunk));
   if (ptr == nullptr)
     return make_error(ec::format_error, "segment integrity check failed");
-  // Perform version check.
-  if (auto err = fbs::check_version(ptr->version(), fbs::Version::v0))
-    return err;
-  return segment{std::move(chunk)};
+  // Perform version check. Version 1 only adds optional fields, so we read
+  // both versions alike.
+  if (ptr->version() != fbs::Version::v1)
+    if (auto err = fbs::check_version(ptr->version(), fbs::Version::v0))
+      return err;
+  auto result = segment{std::move(chunk)};
+  result.max_size_ = max_size;
+  return result;
 }
 
 uuid segment::id() const {
@@ -54,9 +140,9 @@ vast::ids segment::ids() const {
   vast::ids result;
   auto ptr = fbs::GetSegment(chunk_->data());
   for (auto buffer : *ptr->slices()) {
-    auto slice = buffer->data_nested_root();
-    result.append_bits(false, slice->offset() - result.size());
-    result.append_bits(true, slice->rows());
+    auto [first, last] = id_range(*buffer);
+    result.append_bits(false, first - result.size());
+    result.append_bits(true, last - first);
   }
   return result;
 }
@@ -71,22 +157,85 @@ chunk_ptr segment::chunk() const {
 
 caf::expected<std::vector<table_slice_ptr>>
 segment::lookup(const vast::ids& xs) const {
+  return lookup(xs, expression{});
+}
+
+caf::expected<std::vector<table_slice_ptr>>
+segment::lookup(const vast::ids& xs, const expression& expr) const {
   std::vector<table_slice_ptr> result;
+  auto ptr = fbs::GetSegment(chunk_->data());
+  auto prune = !caf::holds_alternative<caf::none_t>(expr)
+               && ptr->layouts() != nullptr;
+  // We tailor the query to every layout of the segment at most once. The
+  // tailored query remains empty if it does not fit the layout, in which case
+  // we leave reporting the error to the caller.
+  struct tailored_layout {
+    record_type layout;
+    caf::optional<expression> expr;
+  };
+  std::vector<caf::optional<tailored_layout>> layouts;
+  if (prune)
+    layouts.resize(ptr->layouts()->size());
+  auto may_match
+    = [&](const fbs::TableSliceBuffer& buffer) -> caf::expected<bool> {
+    if (!prune || buffer.layout() < 0 || buffer.statistics() == nullptr)
+      return true;
+    auto index = static_cast<size_t>(buffer.layout());
+    if (index >= layouts.size())
+      return make_error(ec::format_error, "invalid table slice layout");
+    auto& entry = layouts[index];
+    if (!entry) {
+      entry = tailored_layout{};
+      auto data = ptr->layouts()->Get(index)->data();
+      if (data == nullptr)
+        return make_error(ec::format_error, "missing segment layout");
+      if (auto err = unpack_bytes(*data, entry->layout))
+        return err;
+      if (auto x = tailor(expr, entry->layout))
+        entry->expr = std::move(*x);
+    }
+    if (!entry->expr)
+      return true;
+    std::vector<synopsis_ptr> statistics;
+    if (auto err = unpack_bytes(*buffer.statistics(), statistics))
+      return err;
+    if (statistics.size() != entry->layout.fields.size())
+      return make_error(ec::format_error, "invalid table slice statistics");
+    return caf::visit(statistics_evaluator{entry->layout, statistics},
+                      *entry->expr);
+  };
   auto f = [](auto buffer) {
-    auto slice = buffer->data_nested_root();
-    return std::pair{slice->offset(), slice->offset() + slice->rows()};
+    return id_range(*buffer);
   };
   auto g = [&](auto buffer) -> caf::error {
-    // TODO: bind the lifetime of the table slice to the segment chunk. This
-    // requires that table slices will be constructable from a chunk. Until
-    // then, we stupidly deserialize the data into a new table slice.
+    auto candidate = may_match(*buffer);
+    if (!candidate)
+      return candidate.error();
+    if (!*candidate)
+      return caf::none;
     table_slice_ptr slice;
-    if (auto err = unpack(*buffer->data_nested_root(), slice))
-      return err;
+    if (buffer->compression() == fbs::Compression::None) {
+      // The table slice references the segment chunk where its encoding
+      // allows for it, which keeps the segment alive.
+      if (auto err = unpack(*buffer->data_nested_root(), slice, chunk_))
+        return err;
+    } else {
+      // A compressed table slice references its own uncompressed chunk.
+      auto chk = uncompress(*ptr, *buffer, max_size_);
+      if (!chk)
+        return chk.error();
+      // Unlike the nested root of an uncompressed table slice, the
+      // uncompressed bytes did not take part in verifying the segment.
+      auto flat_slice = fbs::as_flatbuffer<fbs::TableSlice>(as_bytes(*chk));
+      if (flat_slice == nullptr)
+        return make_error(ec::format_error,
+                          "compressed table slice integrity check failed");
+      if (auto err = unpack(*flat_slice, slice, *chk))
+        return err;
+    }
     result.push_back(std::move(slice));
     return caf::none;
   };
-  auto ptr = fbs::GetSegment(chunk_->data());
   auto begin = ptr->slices()->begin();
   auto end = ptr->slices()->end();
   if (auto error = select_with(xs, begin, end, f, g))
@@ -94,7 +243,9 @@ segment::lookup(const vast::ids& xs) const {
   return result;
 }
 
-segment::segment(chunk_ptr chk) : chunk_{std::move(chk)} {
+segment::segment(chunk_ptr chk)
+  : chunk_{std::move(chk)},
+    max_size_{defaults::system::max_segment_size * 1_MiB} {
 }
 
 } // namespace vast
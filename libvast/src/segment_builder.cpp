@@ -13,31 +13,153 @@
 
 #include "vast/segment_builder.hpp"
 
+#include "vast/chunk.hpp"
 #include "vast/detail/assert.hpp"
 #include "vast/detail/byte_swap.hpp"
 #include "vast/detail/narrow.hpp"
+#include "vast/detail/type_traits.hpp"
 #include "vast/error.hpp"
 #include "vast/fbs/utils.hpp"
 #include "vast/ids.hpp"
 #include "vast/logger.hpp"
 #include "vast/segment.hpp"
+#include "vast/si_literals.hpp"
+#include "vast/synopsis.hpp"
+#include "vast/synopsis_factory.hpp"
 #include "vast/table_slice.hpp"
+#include "vast/type.hpp"
 
 #include <caf/binary_serializer.hpp>
 
+#include <algorithm>
+#include <map>
+#include <string>
+
 namespace vast {
 
-segment_builder::segment_builder() {
+using namespace binary_byte_literals;
+
+namespace {
+
+#if VAST_HAVE_ZSTD
+
+/// The maximum size of a trained dictionary, which zstd recommends to be about
+/// 100 times smaller than the samples it learns from.
+constexpr size_t max_dictionary_size = 64_KiB;
+
+#endif // VAST_HAVE_ZSTD
+
+/// Compresses a serialized table slice.
+/// @returns The compressed bytes, or an empty vector on failure.
+std::vector<char> compress(const segment_compression& config, const chunk& x,
+                           [[maybe_unused]] const std::vector<char>* dict) {
+  std::vector<char> result;
+  size_t n = 0;
+  switch (config.method) {
+    case compression::null:
+      break;
+    case compression::lz4:
+      result.resize(lz4::compress_bound(x.size()));
+      n = lz4::compress(x.data(), x.size(), result.data(), result.size());
+      break;
+    case compression::zstd:
+#if VAST_HAVE_ZSTD
+      result.resize(zstd::compress_bound(x.size()));
+      n = zstd::compress(x.data(), x.size(), result.data(), result.size(),
+                         config.level, dict ? dict->data() : nullptr,
+                         dict ? dict->size() : 0);
+#endif
+      break;
+  }
+  result.resize(n);
+  return result;
+}
+
+/// Checks whether a column of the given type gets statistics. We restrict
+/// statistics to types with a synopsis of constant size, such that they add
+/// only a few bytes per column to every table slice.
+bool has_statistics(const type& t) {
+  auto f = [](const auto& x) {
+    using concrete_type = std::decay_t<decltype(x)>;
+    if constexpr (std::is_same_v<concrete_type, alias_type>)
+      return has_statistics(x.value_type);
+    else
+      return detail::is_any_v<concrete_type, bool_type, integer_type,
+                              count_type, real_type, time_type>;
+  };
+  return !has_skip_attribute(t) && caf::visit(f, t);
+}
+
+/// Computes the per-column statistics of a table slice.
+/// @returns The serialized statistics, or an empty buffer if no column has
+///          statistics.
+caf::expected<std::vector<char>> make_statistics(const table_slice& x) {
+  std::vector<char> result;
+  std::vector<synopsis_ptr> statistics(x.columns());
+  auto& fields = x.layout().fields;
+  auto empty = true;
+  for (size_t col = 0; col < x.columns(); ++col) {
+    if (!has_statistics(fields[col].type))
+      continue;
+    auto& syn = statistics[col];
+    syn = factory<synopsis>::make(fields[col].type, caf::settings{});
+    if (syn == nullptr)
+      continue;
+    x.append_column_to_synopsis(col, *syn);
+    empty = false;
+  }
+  if (empty)
+    return result;
+  caf::binary_serializer sink{nullptr, result};
+  if (auto err = sink(statistics))
+    return err;
+  return result;
+}
+
+fbs::Compression to_flatbuffer(compression x) {
+  switch (x) {
+    case compression::null:
+      return fbs::Compression::None;
+    case compression::lz4:
+      return fbs::Compression::LZ4;
+    case compression::zstd:
+      return fbs::Compression::Zstd;
+  }
+  return fbs::Compression::None;
+}
+
+} // namespace
+
+segment_builder::segment_builder(segment_compression compression)
+  : compression_{compression} {
   reset();
 }
 
 caf::error segment_builder::add(table_slice_ptr x) {
   if (x->offset() < min_table_slice_offset_)
     return make_error(ec::unspecified, "slice offsets not increasing");
-  auto slice = pack(builder_, x);
+  auto slice = pack(x);
   if (!slice)
     return slice.error();
-  flat_slices_.push_back(*slice);
+  auto layout = layout_index(x->layout());
+  if (!layout)
+    return layout.error();
+  auto statistics = make_statistics(*x);
+  if (!statistics)
+    return statistics.error();
+  flatbuffers::Offset<flatbuffers::Vector<uint8_t>> statistics_offset;
+  if (!statistics->empty()) {
+    statistics_offset = builder_.CreateVector(
+      reinterpret_cast<const uint8_t*>(statistics->data()),
+      statistics->size());
+    requires_v1_ = true;
+  }
+  if (compresses_on_finish()) {
+    pending_bytes_ += (*slice)->size();
+    pending_.push_back({std::move(*slice), *layout, statistics_offset});
+  } else {
+    add_buffer(**slice, *x, *layout, statistics_offset, -1, nullptr);
+  }
   // This works only with monotonically increasing IDs.
   if (!intervals_.empty() && intervals_.back().end() == x->offset())
     intervals_.back()
@@ -50,15 +172,21 @@ caf::error segment_builder::add(table_slice_ptr x) {
 }
 
 segment segment_builder::finish() {
+  auto dictionaries = compress_pending();
   auto table_slices_offset = builder_.CreateVector(flat_slices_);
   auto uuid_offset = fbs::pack_bytes(builder_, id_);
   auto ids_offset = builder_.CreateVectorOfStructs(intervals_);
+  auto dictionaries_offset = builder_.CreateVector(dictionaries);
+  auto layouts_offset = builder_.CreateVector(flat_layouts_);
   fbs::SegmentBuilder segment_builder{builder_};
-  segment_builder.add_version(fbs::Version::v0);
+  segment_builder.add_version(requires_v1_ ? fbs::Version::v1
+                                           : fbs::Version::v0);
   segment_builder.add_slices(table_slices_offset);
   segment_builder.add_uuid(uuid_offset);
   segment_builder.add_ids(ids_offset);
   segment_builder.add_events(num_events_);
+  segment_builder.add_dictionaries(dictionaries_offset);
+  segment_builder.add_layouts(layouts_offset);
   auto segment_offset = segment_builder.Finish();
   fbs::FinishSegmentBuffer(builder_, segment_offset);
   auto chk = fbs::release(builder_);
@@ -94,8 +222,12 @@ vast::ids segment_builder::ids() const {
   return result;
 }
 
+bool segment_builder::compresses_on_finish() const {
+  return compression_.method == compression::zstd && compression_.dictionaries;
+}
+
 size_t segment_builder::table_slice_bytes() const {
-  return builder_.GetSize();
+  return builder_.GetSize() + pending_bytes_;
 }
 
 const std::vector<table_slice_ptr>& segment_builder::table_slices() const {
@@ -110,6 +242,105 @@ void segment_builder::reset() {
   flat_slices_.clear();
   intervals_.clear();
   slices_.clear();
+  pending_.clear();
+  pending_bytes_ = 0;
+  layouts_.clear();
+  flat_layouts_.clear();
+  requires_v1_ = false;
+}
+
+caf::expected<int> segment_builder::layout_index(const record_type& layout) {
+  auto i = std::find(layouts_.begin(), layouts_.end(), layout);
+  if (i != layouts_.end())
+    return detail::narrow_cast<int>(std::distance(layouts_.begin(), i));
+  std::vector<char> buffer;
+  caf::binary_serializer sink{nullptr, buffer};
+  if (auto err = sink(layout))
+    return err;
+  auto data_offset = builder_.CreateVector(
+    reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+  flat_layouts_.push_back(fbs::CreateSegmentLayout(builder_, data_offset));
+  layouts_.push_back(layout);
+  return detail::narrow_cast<int>(layouts_.size() - 1);
+}
+
+void segment_builder::add_buffer(
+  const chunk& x, const table_slice& slice, int layout,
+  flatbuffers::Offset<flatbuffers::Vector<uint8_t>> statistics,
+  int dictionary_index, const std::vector<char>* dictionary) {
+  auto compressed = compress(compression_, x, dictionary);
+  // Keep table slices that do not compress as they are.
+  if (compressed.empty() || compressed.size() >= x.size()) {
+    auto data_offset = builder_.CreateVector(
+      reinterpret_cast<const uint8_t*>(x.data()), x.size());
+    fbs::TableSliceBufferBuilder buffer_builder{builder_};
+    buffer_builder.add_data(data_offset);
+    buffer_builder.add_offset(slice.offset());
+    buffer_builder.add_rows(slice.rows());
+    buffer_builder.add_layout(layout);
+    buffer_builder.add_statistics(statistics);
+    flat_slices_.push_back(buffer_builder.Finish());
+    return;
+  }
+  auto data_offset = builder_.CreateVector(
+    reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size());
+  requires_v1_ = true;
+  fbs::TableSliceBufferBuilder buffer_builder{builder_};
+  buffer_builder.add_compression(to_flatbuffer(compression_.method));
+  buffer_builder.add_compressed_data(data_offset);
+  buffer_builder.add_uncompressed_size(x.size());
+  buffer_builder.add_dictionary(dictionary_index);
+  buffer_builder.add_offset(slice.offset());
+  buffer_builder.add_rows(slice.rows());
+  buffer_builder.add_layout(layout);
+  buffer_builder.add_statistics(statistics);
+  flat_slices_.push_back(buffer_builder.Finish());
+}
+
+std::vector<flatbuffers::Offset<fbs::CompressionDictionary>>
+segment_builder::compress_pending() {
+  VAST_ASSERT(pending_.empty() || pending_.size() == slices_.size());
+  std::vector<flatbuffers::Offset<fbs::CompressionDictionary>> result;
+  // Maps every pending table slice to the index of its dictionary.
+  std::vector<int> dictionary_indexes(pending_.size(), -1);
+  std::vector<std::vector<char>> dictionaries;
+#if VAST_HAVE_ZSTD
+  if (compression_.method == compression::zstd && compression_.dictionaries) {
+    std::map<std::string, std::vector<size_t>> layouts;
+    for (size_t i = 0; i < slices_.size(); ++i)
+      layouts[slices_[i]->layout().name()].push_back(i);
+    for (auto& [name, indexes] : layouts) {
+      std::vector<char> samples;
+      std::vector<size_t> sizes;
+      for (auto i : indexes) {
+        auto& x = *pending_[i].chunk;
+        samples.insert(samples.end(), x.begin(), x.end());
+        sizes.push_back(x.size());
+      }
+      auto dictionary
+        = zstd::train_dictionary(samples, sizes, max_dictionary_size);
+      // Training fails for layouts with too few table slices, which we then
+      // compress without a dictionary.
+      if (dictionary.empty())
+        continue;
+      for (auto i : indexes)
+        dictionary_indexes[i] = detail::narrow_cast<int>(dictionaries.size());
+      auto name_offset = builder_.CreateString(name);
+      auto data_offset = builder_.CreateVector(
+        reinterpret_cast<const uint8_t*>(dictionary.data()), dictionary.size());
+      result.push_back(
+        fbs::CreateCompressionDictionary(builder_, name_offset, data_offset));
+      dictionaries.push_back(std::move(dictionary));
+    }
+  }
+#endif
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    auto index = dictionary_indexes[i];
+    add_buffer(*pending_[i].chunk, *slices_[i], pending_[i].layout,
+               pending_[i].statistics, index,
+               index < 0 ? nullptr : &dictionaries[index]);
+  }
+  return result;
 }
 
 } // namespace vast
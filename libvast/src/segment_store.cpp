@@ -14,50 +14,114 @@
 #include "vast/segment_store.hpp"
 
 #include "vast/bitmap_algorithms.hpp"
+#include "vast/chunk.hpp"
 #include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/compression.hpp"
 #include "vast/concept/printable/vast/error.hpp"
 #include "vast/concept/printable/vast/filesystem.hpp"
 #include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/defaults.hpp"
 #include "vast/directory.hpp"
 #include "vast/error.hpp"
 #include "vast/event.hpp"
+#include "vast/expression.hpp"
 #include "vast/fbs/segment.hpp"
 #include "vast/fbs/utils.hpp"
 #include "vast/ids.hpp"
 #include "vast/logger.hpp"
+#include "vast/si_literals.hpp"
 #include "vast/status.hpp"
 #include "vast/table_slice.hpp"
 #include "vast/to_events.hpp"
 
 #include <caf/config_value.hpp>
 #include <caf/dictionary.hpp>
+#include <caf/optional.hpp>
 #include <caf/settings.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+
 namespace vast {
 
+using namespace binary_byte_literals;
+
+namespace {
+
+/// Selects the table slices that contain any of the IDs in `xs`.
+/// @pre `slices` is ordered by offset.
+caf::expected<std::vector<table_slice_ptr>>
+select_slices(const std::vector<table_slice_ptr>& slices, const ids& xs) {
+  std::vector<table_slice_ptr> result;
+  auto f = [](auto& slice) {
+    return std::pair{slice->offset(), slice->offset() + slice->rows()};
+  };
+  auto g = [&](auto& slice) {
+    result.push_back(slice);
+    return caf::none;
+  };
+  if (auto error = select_with(xs, slices.begin(), slices.end(), f, g))
+    return error;
+  return result;
+}
+
+/// @returns The number of bytes of all table slices in `x` after
+///          decompression.
+size_t uncompressed_size(const segment& x) {
+  size_t result = 0;
+  for (auto buffer : *fbs::GetSegment(x.chunk()->data())->slices())
+    result += buffer->compression() == fbs::Compression::None
+                ? buffer->data()->size()
+                : buffer->uncompressed_size();
+  return result;
+}
+
+} // namespace
+
 // TODO: return expected<segment_store_ptr> for better error propagation.
-segment_store_ptr segment_store::make(path dir, size_t max_segment_size,
-                                      size_t in_memory_segments) {
+segment_store_ptr
+segment_store::make(path dir, size_t max_segment_size,
+                    size_t in_memory_segments, size_t segment_cache_size,
+                    size_t slice_cache_size, segment_compression compression,
+                    detail::thread_pool* pool) {
   VAST_TRACE(VAST_ARG(dir), VAST_ARG(max_segment_size),
-             VAST_ARG(in_memory_segments));
+             VAST_ARG(in_memory_segments), VAST_ARG(segment_cache_size),
+             VAST_ARG(slice_cache_size));
   VAST_ASSERT(max_segment_size > 0);
-  auto result = segment_store_ptr{
-    new segment_store{std::move(dir), max_segment_size, in_memory_segments}};
+  auto result = segment_store_ptr{new segment_store{
+    std::move(dir), max_segment_size, in_memory_segments, segment_cache_size,
+    slice_cache_size, compression, pool}};
   if (auto err = result->register_segments())
     return nullptr;
   return result;
 }
 
 segment_store::segment_store(path dir, uint64_t max_segment_size,
-                             size_t in_memory_segments)
+                             size_t in_memory_segments,
+                             size_t segment_cache_size, size_t slice_cache_size,
+                             segment_compression compression,
+                             detail::thread_pool* pool)
   : dir_{std::move(dir)},
     max_segment_size_{max_segment_size},
-    cache_{in_memory_segments} {
+    segment_cache_{segment_cache_size, in_memory_segments},
+    slice_cache_{slice_cache_size, std::numeric_limits<size_t>::max()},
+    compression_{compression},
+    pool_{pool},
+    builder_{compression} {
   // nop
 }
 
+size_t segment_store::segment_weigher::operator()(const segment& x) const {
+  return x.chunk()->size();
+}
+
 segment_store::~segment_store() {
-  // nop
+  // The pool must not write segments of a store that no longer exists. The
+  // errors end up in the log.
+  reap(true);
 }
 
 caf::error segment_store::put(table_slice_ptr xs) {
@@ -69,21 +133,37 @@ caf::error segment_store::put(table_slice_ptr xs) {
     return make_error(ec::unspecified, "failed to update range_map");
   num_events_ += xs->rows();
   if (builder_.table_slice_bytes() < max_segment_size_)
-    return caf::none;
+    return reap(false);
   // We have exceeded our maximum segment size and now finish.
-  return flush();
+  return seal();
 }
 
 std::unique_ptr<store::lookup> segment_store::extract(const ids& xs) const {
+  return extract(xs, expression{});
+}
+
+std::unique_ptr<store::lookup>
+segment_store::extract(const ids& xs, const expression& expr) const {
   class lookup : public store::lookup {
   public:
     using uuid_iterator = std::vector<uuid>::iterator;
 
-    lookup(const segment_store& store, ids xs, std::vector<uuid>&& candidates)
-      : store_{store}, xs_{std::move(xs)}, candidates_{std::move(candidates)} {
+    lookup(const segment_store& store, ids xs, expression expr,
+           std::vector<uuid>&& candidates,
+           std::unordered_map<uuid, std::vector<table_slice_ptr>>&& unwritten)
+      : store_{store},
+        generation_{store.begin_session()},
+        xs_{std::move(xs)},
+        expr_{std::move(expr)},
+        candidates_{std::move(candidates)},
+        unwritten_{std::move(unwritten)} {
       // nop
     }
 
+    ~lookup() override {
+      store_.end_session(generation_);
+    }
+
     caf::expected<table_slice_ptr> next() override {
       // Update the buffer if it has been consumed or the previous
       // refresh return an error.
@@ -102,27 +182,22 @@ std::unique_ptr<store::lookup> segment_store::extract(const ids& xs) const {
       if (first_ == candidates_.end())
         return caf::no_error;
       auto& cand = *first_++;
-      if (cand == store_.builder_.id()) {
-        VAST_DEBUG(this, "looks into the active segement", cand);
-        return store_.builder_.lookup(xs_);
+      if (auto i = unwritten_.find(cand); i != unwritten_.end()) {
+        VAST_DEBUG(this, "looks into the unwritten segment", cand);
+        return std::move(i->second);
       }
-      auto i = store_.cache_.find(cand);
-      if (i != store_.cache_.end()) {
-        VAST_DEBUG(this, "got cache hit for segment", cand);
-        return i->second.lookup(xs_);
-      }
-      VAST_DEBUG(this, "got cache miss for segment", cand);
-      auto s = store_.load_segment(cand);
-      if (!s)
-        return s.error();
-      store_.cache_.emplace(cand, *s);
-      return s->lookup(xs_);
+      return store_.lookup_segment(cand, xs_, expr_);
     }
 
     const segment_store& store_;
+    uint64_t generation_;
     ids xs_;
+    expression expr_;
     std::vector<uuid> candidates_;
     uuid_iterator first_ = candidates_.begin();
+    /// The selected table slices of the segments that were not on disk when
+    /// the session started.
+    std::unordered_map<uuid, std::vector<table_slice_ptr>> unwritten_;
     caf::expected<std::vector<table_slice_ptr>> buffer_{caf::no_error};
     std::vector<table_slice_ptr>::iterator it_;
   };
@@ -136,14 +211,34 @@ std::unique_ptr<store::lookup> segment_store::extract(const ids& xs) const {
     return nullptr;
   }
   VAST_DEBUG(this, "processes", candidates.size(), "candidates");
-  std::partition(candidates.begin(), candidates.end(), [&](const auto& id) {
-    return id == builder_.id() || cache_.find(id) != cache_.end();
-  });
-  return std::make_unique<lookup>(*this, std::move(xs), std::move(candidates));
+  partition_cached(candidates);
+  // The active segment keeps changing while the session runs, and segments
+  // that the pool finishes are not on disk yet, so we take their slices up
+  // front.
+  std::unordered_map<uuid, std::vector<table_slice_ptr>> unwritten;
+  for (auto& id : candidates) {
+    caf::expected<std::vector<table_slice_ptr>> slices{caf::no_error};
+    if (id == builder_.id())
+      slices = builder_.lookup(xs);
+    else if (auto i = sealing_.find(id); i != sealing_.end())
+      slices = select_slices(i->second.slices, xs);
+    else
+      continue;
+    if (!slices) {
+      VAST_WARNING(this, "failed to look into the unwritten segment", id);
+      return nullptr;
+    }
+    unwritten.emplace(id, std::move(*slices));
+  }
+  return std::make_unique<lookup>(*this, xs, expr, std::move(candidates),
+                                  std::move(unwritten));
 }
 
 caf::error segment_store::erase(const ids& xs) {
   VAST_TRACE(VAST_ARG(xs));
+  // Erasing from a segment requires it on disk.
+  if (auto err = reap(true))
+    return err;
   // Get affected segments.
   std::vector<uuid> candidates;
   if (auto err = select_segments(xs, candidates))
@@ -214,7 +309,7 @@ caf::error segment_store::erase(const ids& xs) {
     // Remove stale state.
     segments_.erase_value(segment_id);
     // Create a new segment from the remaining slices.
-    segment_builder tmp_builder;
+    segment_builder tmp_builder{compression_};
     segment_builder* builder = &tmp_builder;
     if constexpr (std::is_same_v<decltype(seg), segment_builder&>) {
       // If `update` got called with a builder then we simply use that by
@@ -245,12 +340,26 @@ caf::error segment_store::erase(const ids& xs) {
     // else: nothing to do, since we can continue filling the active segment.
   };
   // Iterate affected segments.
+  {
+    std::lock_guard<std::mutex> lock{cache_mutex_};
+    ++erase_generation_;
+  }
   for (auto& candidate : candidates) {
-    auto j = cache_.find(candidate);
-    if (j != cache_.end()) {
+    caf::optional<segment> cached_segment;
+    {
+      std::lock_guard<std::mutex> lock{cache_mutex_};
+      // A persisted segment never comes back under the same ID.
+      if (candidate != builder_.id() && !session_generations_.empty())
+        erased_segments_.emplace(candidate, erase_generation_);
+      slice_cache_.erase(candidate);
+      if (auto x = segment_cache_.find(candidate)) {
+        cached_segment = std::move(*x);
+        segment_cache_.erase(candidate);
+      }
+    }
+    if (cached_segment) {
       VAST_DEBUG(this, "erases from the cached segement", candidate);
-      impl(j->second);
-      cache_.erase(j);
+      impl(*cached_segment);
     } else if (candidate == builder_.id()) {
       VAST_DEBUG(this, "erases from the active segement", candidate);
       impl(builder_);
@@ -274,31 +383,19 @@ caf::expected<std::vector<table_slice_ptr>> segment_store::get(const ids& xs) {
   std::vector<uuid> candidates;
   if (auto err = select_segments(xs, candidates))
     return err;
-  // Process candidates in reverse order for maximum LRU cache hits.
   std::vector<table_slice_ptr> result;
   VAST_DEBUG(this, "processes", candidates.size(), "candidates");
-  std::partition(candidates.begin(), candidates.end(), [&](const auto& id) {
-    return id == builder_.id() || cache_.find(id) != cache_.end();
-  });
-  for (auto cand = candidates.begin(); cand != candidates.end(); ++cand) {
-    auto& id = *cand;
+  partition_cached(candidates);
+  for (auto& id : candidates) {
     caf::expected<std::vector<table_slice_ptr>> slices{caf::no_error};
     if (id == builder_.id()) {
       VAST_DEBUG(this, "looks into the active segement", id);
       slices = builder_.lookup(xs);
+    } else if (auto i = sealing_.find(id); i != sealing_.end()) {
+      VAST_DEBUG(this, "looks into the unwritten segment", id);
+      slices = select_slices(i->second.slices, xs);
     } else {
-      auto i = cache_.find(id);
-      if (i == cache_.end()) {
-        VAST_DEBUG(this, "got cache miss for segment", id);
-        auto x = load_segment(id);
-        if (!x)
-          return x.error();
-        i = cache_.emplace(id, std::move(*x)).first;
-      } else {
-        VAST_DEBUG(this, "got cache hit for segment", id);
-      }
-      VAST_DEBUG(this, "looks into segment", id);
-      slices = i->second.lookup(xs);
+      slices = lookup_segment(id, xs, expression{});
     }
     if (!slices)
       return slices.error();
@@ -309,36 +406,105 @@ caf::expected<std::vector<table_slice_ptr>> segment_store::get(const ids& xs) {
 }
 
 caf::error segment_store::flush() {
-  if (!dirty())
-    return caf::none;
+  auto result = reap(true);
+  if (builder_.table_slice_bytes() == 0)
+    return result;
+  VAST_DEBUG(this, "finishes current builder");
+  auto slices = builder_.table_slices();
+  if (auto err = persist(builder_.finish(), std::move(slices)); err && !result)
+    result = std::move(err);
+  return result;
+}
+
+caf::error segment_store::seal() {
   VAST_DEBUG(this, "finishes current builder");
-  auto seg = builder_.finish();
+  auto slices = builder_.table_slices();
+  if (pool_ == nullptr || !builder_.compresses_on_finish())
+    return persist(builder_.finish(), std::move(slices));
+  // Training dictionaries takes long enough to stall ingestion, so a thread
+  // of the pool finishes the segment while we continue with a new one.
+  auto id = builder_.id();
+  auto builder = std::make_shared<segment_builder>(std::move(builder_));
+  builder_.reset();
+  auto done = pool_->submit([this, builder, slices] {
+    return persist(builder->finish(), slices);
+  });
+  sealing_.emplace(id, sealing_segment{std::move(slices), std::move(done)});
+  return reap(false);
+}
+
+caf::error
+segment_store::persist(segment seg, std::vector<table_slice_ptr> slices) {
   auto filename = segment_path() / to_string(seg.id());
   if (auto err = write(filename, seg.chunk()))
     return err;
-  // Keep new segment in the cache.
-  cache_.emplace(seg.id(), seg);
+  // Keep new segment in the cache. Queries tend to ask for recent events, so
+  // we also keep its table slices around, which we have at hand anyway.
+  auto size = uncompressed_size(seg);
+  std::lock_guard<std::mutex> lock{cache_mutex_};
+  segment_cache_.add(seg.id(), seg);
+  slice_cache_.add(seg.id(), unpacked_segment{std::move(slices), size});
   VAST_DEBUG(this, "wrote new segment to", filename.trim(-3));
   return caf::none;
 }
 
+caf::error segment_store::reap(bool wait) {
+  caf::error result;
+  for (auto i = sealing_.begin(); i != sealing_.end();) {
+    auto& done = i->second.done;
+    auto ready = [&] {
+      return done.wait_for(std::chrono::seconds{0})
+             == std::future_status::ready;
+    };
+    if (!wait && !ready()) {
+      ++i;
+      continue;
+    }
+    if (auto err = done.get()) {
+      VAST_ERROR(this, "failed to write segment", i->first, ':',
+                 to_string(err));
+      if (!result)
+        result = std::move(err);
+    }
+    i = sealing_.erase(i);
+  }
+  return result;
+}
+
 void segment_store::inspect_status(caf::settings& xs, status_verbosity v) {
   using caf::put;
+  std::lock_guard<std::mutex> lock{cache_mutex_};
   if (v >= status_verbosity::info) {
     put(xs, "events", num_events_);
-    auto mem = builder_.table_slice_bytes();
-    for (auto& segment : cache_)
-      mem += segment.second.chunk()->size();
+    auto mem = builder_.table_slice_bytes() + segment_cache_.weight();
     put(xs, "memory-usage", mem);
   }
   if (v >= status_verbosity::detailed) {
     auto& segments = put_dictionary(xs, "segments");
     auto& cached = put_list(segments, "cached");
-    for (auto& kvp : cache_)
-      cached.emplace_back(to_string(kvp.first));
+    for (auto tier : {&segment_cache_.recent(), &segment_cache_.frequent()})
+      for (auto& x : *tier)
+        cached.emplace_back(to_string(x.key));
     auto& current = put_dictionary(segments, "current");
     put(current, "uuid", to_string(builder_.id()));
     put(current, "size", builder_.table_slice_bytes());
+    put(segments, "unwritten", sealing_.size());
+    put(segments, "compression", to_string(compression_.method));
+    auto& caches = put_dictionary(xs, "cache");
+    auto put_tier = [&](const char* name, const auto& cache,
+                        const cache_statistics& stats) {
+      auto& tier = put_dictionary(caches, name);
+      put(tier, "segments", cache.size());
+      put(tier, "memory-usage", cache.weight());
+      put(tier, "memory-budget", cache.capacity());
+      put(tier, "hits", stats.hits);
+      put(tier, "misses", stats.misses);
+      if (auto lookups = stats.hits + stats.misses; lookups > 0)
+        put(tier, "hit-rate", static_cast<double>(stats.hits) / lookups);
+      put(tier, "evictions", cache.stats().evictions);
+    };
+    put_tier("segments", segment_cache_, segment_cache_stats_);
+    put_tier("slices", slice_cache_, slice_cache_stats_);
   }
 }
 
@@ -371,7 +537,96 @@ caf::expected<segment> segment_store::load_segment(uuid id) const {
   auto chk = chunk::mmap(filename);
   if (!chk)
     return make_error(ec::filesystem_error, "failed to mmap chunk", filename);
-  return segment::make(std::move(chk));
+  // A segment fills up to its maximum size with table slices of any size, so
+  // we bound single table slices by no less than the default segment size.
+  auto max_size = std::max<uint64_t>(max_segment_size_,
+                                     defaults::system::max_segment_size
+                                       * 1_MiB);
+  return segment::make(std::move(chk), max_size);
+}
+
+caf::expected<std::vector<table_slice_ptr>>
+segment_store::lookup_segment(const uuid& id, const ids& xs,
+                              const expression& expr) const {
+  caf::optional<segment> seg;
+  {
+    std::lock_guard<std::mutex> lock{cache_mutex_};
+    if (auto x = slice_cache_.find(id)) {
+      VAST_DEBUG(this, "got slice cache hit for segment", id);
+      ++slice_cache_stats_.hits;
+      return select_slices(x->slices, xs);
+    }
+    ++slice_cache_stats_.misses;
+    if (auto x = segment_cache_.find(id)) {
+      ++segment_cache_stats_.hits;
+      seg = *x;
+    } else {
+      ++segment_cache_stats_.misses;
+    }
+  }
+  if (seg) {
+    // Only segments that we access repeatedly get here, so a bulk export that
+    // touches every segment once does not flood the slice cache.
+    VAST_DEBUG(this, "got segment cache hit for segment", id);
+    auto slices = seg->lookup(seg->ids());
+    if (!slices)
+      return slices.error();
+    auto result = select_slices(*slices, xs);
+    std::lock_guard<std::mutex> lock{cache_mutex_};
+    if (!slice_cache_.contains(id) && erased_segments_.count(id) == 0) {
+      auto size = uncompressed_size(*seg);
+      slice_cache_.add(id, unpacked_segment{std::move(*slices), size});
+    }
+    return result;
+  }
+  VAST_DEBUG(this, "got cache miss for segment", id);
+  auto loaded = load_segment(id);
+  if (!loaded)
+    return loaded.error();
+  {
+    std::lock_guard<std::mutex> lock{cache_mutex_};
+    if (!segment_cache_.contains(id) && erased_segments_.count(id) == 0)
+      segment_cache_.add(id, *loaded);
+  }
+  // Only this path skips table slices by their statistics, because the others
+  // have unpacked all table slices of the segment already.
+  return loaded->lookup(xs, expr);
+}
+
+uint64_t segment_store::begin_session() const {
+  std::lock_guard<std::mutex> lock{cache_mutex_};
+  session_generations_.insert(erase_generation_);
+  return erase_generation_;
+}
+
+void segment_store::end_session(uint64_t generation) const {
+  std::lock_guard<std::mutex> lock{cache_mutex_};
+  auto i = session_generations_.find(generation);
+  VAST_ASSERT(i != session_generations_.end());
+  session_generations_.erase(i);
+  prune_erased_segments();
+}
+
+void segment_store::prune_erased_segments() const {
+  // A session can only reference segments that an erase of a later
+  // generation evicted.
+  auto oldest = session_generations_.empty()
+                  ? erase_generation_
+                  : *session_generations_.begin();
+  for (auto i = erased_segments_.begin(); i != erased_segments_.end();) {
+    if (i->second <= oldest)
+      i = erased_segments_.erase(i);
+    else
+      ++i;
+  }
+}
+
+void segment_store::partition_cached(std::vector<uuid>& candidates) const {
+  std::lock_guard<std::mutex> lock{cache_mutex_};
+  std::partition(candidates.begin(), candidates.end(), [&](const auto& id) {
+    return id == builder_.id() || sealing_.count(id) > 0
+           || segment_cache_.contains(id) || slice_cache_.contains(id);
+  });
 }
 
 caf::error segment_store::select_segments(const ids& selection,
@@ -390,14 +645,8 @@ caf::error segment_store::select_segments(const ids& selection,
 }
 
 uint64_t segment_store::drop(segment& x) {
-  uint64_t erased_events = 0;
   auto segment_id = x.id();
-  // TODO: discuss whether we want to allow accessing a segment through the
-  // flatbuffers API. The (heavy-weight) altnerative here would be to create a
-  // custom iterator so that a segment can be iterated as a list of table_slice
-  // instances.
-  for (auto buffer : *fbs::GetSegment(x.chunk()->data())->slices())
-    erased_events += buffer->data_nested_root()->rows();
+  uint64_t erased_events = fbs::GetSegment(x.chunk()->data())->events();
   VAST_INFO(this, "erases entire segment", segment_id);
   // Schedule deletion of the segment file when releasing the chunk.
   auto filename = segment_path() / to_string(segment_id);
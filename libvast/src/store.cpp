@@ -23,4 +23,9 @@ store::lookup::~lookup() {
   // nop
 }
 
+std::unique_ptr<store::lookup>
+store::extract(const ids& xs, const expression&) const {
+  return extract(xs);
+}
+
 } // namespace vast
@@ -41,6 +41,44 @@ const vast::type& synopsis::type() const {
   return type_;
 }
 
+void synopsis::add_batch(span<const integer> xs) {
+  for (auto x : xs)
+    add(x);
+}
+
+void synopsis::add_batch(span<const count> xs) {
+  for (auto x : xs)
+    add(x);
+}
+
+void synopsis::add_batch(span<const real> xs) {
+  for (auto x : xs)
+    add(x);
+}
+
+void synopsis::add_batch(span<const time> xs) {
+  for (auto x : xs)
+    add(x);
+}
+
+void synopsis::add_batch(span<const address> xs) {
+  for (auto x : xs)
+    add(x);
+}
+
+void synopsis::add_batch(span<const std::string_view> xs) {
+  for (auto x : xs)
+    add(x);
+}
+
+bool synopsis::merge(const synopsis&) {
+  return false;
+}
+
+void synopsis::shrink(size_t) {
+  // nop
+}
+
 caf::error inspect(caf::serializer& sink, synopsis_ptr& ptr) {
   if (!ptr) {
     static type dummy;
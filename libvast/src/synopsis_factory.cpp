@@ -16,6 +16,9 @@
 #include "vast/address_synopsis.hpp"
 #include "vast/bool_synopsis.hpp"
 #include "vast/concept/hashable/xxhash.hpp"
+#include "vast/min_max_synopsis.hpp"
+#include "vast/port_synopsis.hpp"
+#include "vast/string_synopsis.hpp"
 #include "vast/time_synopsis.hpp"
 
 namespace vast {
@@ -23,6 +26,11 @@ namespace vast {
 void factory_traits<synopsis>::initialize() {
   factory<synopsis>::add(address_type{}, make_address_synopsis<xxhash64>);
   factory<synopsis>::add<bool_type, bool_synopsis>();
+  factory<synopsis>::add(integer_type{}, make_min_max_synopsis<integer>);
+  factory<synopsis>::add(count_type{}, make_min_max_synopsis<count>);
+  factory<synopsis>::add(real_type{}, make_min_max_synopsis<real>);
+  factory<synopsis>::add<port_type, port_synopsis>();
+  factory<synopsis>::add(string_type{}, make_string_synopsis<xxhash64>);
   factory<synopsis>::add<time_type, time_synopsis>();
 }
 
@@ -60,11 +60,39 @@ command::opts_builder add_index_opts(command::opts_builder ob) {
   return std::move(ob)
     .add<size_t>("max-partition-size", "maximum number of events in a "
                                        "partition")
+    .add<std::string>("compaction-interval", "time between two attempts to "
+                                             "merge small partitions (0 = "
+                                             "off)")
+    .add<size_t>("compaction-rate", "maximum number of bytes per second "
+                                    "for reading partitions to merge")
     .add<size_t>("max-resident-partitions", "maximum number of in-memory "
                                             "partitions")
+    .add<size_t>("max-resident-partition-bytes", "maximum number of bytes "
+                                                 "for in-memory partitions")
     .add<size_t>("max-taste-partitions", "maximum number of immediately "
                                          "scheduled partitions")
-    .add<size_t>("max-queries,q", "maximum number of concurrent queries");
+    .add<size_t>("max-predicate-cache-bytes", "maximum number of bytes for "
+                                              "cached lookup results (0 = "
+                                              "off)")
+    .add<size_t>("prefetch-partitions", "number of partitions to load in the "
+                                        "background (0 = off)")
+    .add<size_t>("max-queries,q", "number of workers that evaluate the "
+                                  "partitions of all queries")
+    .add<size_t>("meta-index-threads", "number of threads for meta index "
+                                       "lookups (0 = hardware threads)")
+    .add<size_t>("indexing-threads", "number of threads for indexing all "
+                                     "columns of a partition together (0 = "
+                                     "one actor per column)")
+    .add<size_t>("flush-threads", "number of threads for writing the "
+                                  "columns of a full partition when "
+                                  "indexing in place (0 = none)")
+    .add<caf::atom_value>("index-bitmap", "bitmap representation of new "
+                                          "indexes (ewah or roaring)")
+    .add<size_t>("max-synopsis-size", "maximum size of a Bloom filter "
+                                      "synopsis in the meta index in bytes")
+    .add<std::string>("query-batch-window", "time to collect concurrent "
+                                            "queries for evaluating them "
+                                            "together (0 = off)");
 }
 
 auto make_root_command(std::string_view path) {
@@ -333,7 +361,23 @@ auto make_spawn_command() {
     "archive", "creates a new archive", "",
     opts()
       .add<size_t>("segments,s", "number of cached segments")
-      .add<size_t>("max-segment-size,m", "maximum segment size in MB"),
+      .add<size_t>("max-segment-size,m", "maximum segment size in MB")
+      .add<size_t>("segment-cache-size", "maximum size of cached segments in "
+                                          "MB")
+      .add<size_t>("slice-cache-size", "maximum size of segments with cached "
+                                        "table slices in MB")
+      .add<caf::atom_value>("compression", "compression of table slices in "
+                                            "new segments (null, lz4, zstd)")
+      .add<int>("compression-level", "zstd compression level")
+      .add<bool>("compression-dictionaries", "train a zstd dictionary for "
+                                             "each layout in a segment")
+      .add<size_t>("extraction-threads", "number of threads that decode "
+                                          "segments for exports")
+      .add<size_t>("max-extraction-sessions", "maximum number of exports "
+                                               "that run at the same time")
+      .add<size_t>("extraction-batch-size", "maximum number of table slices "
+                                             "to extract in one turn of an "
+                                             "export"),
     false);
   spawn->add_subcommand(
     "explorer", "creates a new explorer", "",
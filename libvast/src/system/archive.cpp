@@ -30,44 +30,95 @@
 
 #include <caf/config_value.hpp>
 #include <caf/expected.hpp>
+#include <caf/send.hpp>
 #include <caf/settings.hpp>
 
 #include <algorithm>
+#include <memory>
+#include <utility>
 
 using namespace caf;
 
 namespace vast::system {
 
-void archive_state::next_session() {
-  // No requester means no work to do.
-  if (requesters.empty()) {
-    VAST_TRACE(self, "has no requesters");
-    session = nullptr;
-    return;
+namespace {
+
+/// Extracts the next table slices of a session.
+/// @returns The slices restricted to *xs*, and an error that is not `none`
+///          iff *lookup* is exhausted.
+std::pair<std::vector<table_slice_ptr>, caf::error>
+extract_batch(store::lookup& lookup, const ids& xs, size_t max_slices) {
+  std::vector<table_slice_ptr> result;
+  for (size_t i = 0; i < max_slices; ++i) {
+    auto slice = lookup.next();
+    if (!slice) {
+      auto err
+        = slice.error() ? std::move(slice.error()) : make_error(ec::no_error);
+      return {std::move(result), std::move(err)};
+    }
+    // The slice may contain entries that are not selected by xs.
+    for (auto& sub_slice : select(*slice, xs))
+      result.push_back(std::move(sub_slice));
   }
-  // Find the work queue for our current requester.
-  const auto& current_requester = requesters.front();
-  auto it = unhandled_ids.find(current_requester->address());
-  // There is no ids queue for our current requester. Let's dismiss the
-  // requester and try again.
-  if (it == unhandled_ids.end()) {
-    VAST_TRACE(self, "could not find an ids queue for the current requester");
-    requesters.pop();
-    return next_session();
+  return {std::move(result), caf::none};
+}
+
+} // namespace
+
+void archive_state::next_session() {
+  while (sessions.size() < max_sessions
+         && !requesters.empty()) {
+    auto requester = std::move(requesters.front());
+    requesters.pop_front();
+    // Find the work queue for our current requester.
+    auto it = unhandled_ids.find(requester->address());
+    // The requester has shut down since it lined up.
+    if (it == unhandled_ids.end()) {
+      VAST_TRACE(self, "could not find an ids queue for the current requester");
+      continue;
+    }
+    auto xs = std::move(it->second.front());
+    it->second.pop();
+    if (it->second.empty())
+      unhandled_ids.erase(it);
+    // Extraction skips table slices that cannot match the exporter's query.
+    auto exporter = active_exporters.find(requester->address());
+    auto lookup = std::shared_ptr<vast::store::lookup>{
+      exporter != active_exporters.end() ? store->extract(xs, exporter->second)
+                                         : store->extract(xs)};
+    if (!lookup) {
+      self->send(requester, atom::done_v,
+                 make_error(ec::lookup_error, "failed to start extraction"));
+      if (unhandled_ids.count(requester->address()) > 0)
+        requesters.push_back(std::move(requester));
+      continue;
+    }
+    auto id = ++session_id;
+    VAST_DEBUG(self, "starts session", id, "for", rank(xs), "events");
+    sessions.emplace(id, archive_session{std::move(requester), std::move(xs),
+                                         std::move(lookup)});
+    extract(id);
   }
-  // There is a work queue for our current requester, but it is empty. Let's
-  // clean house, dismiss the requester and try again.
-  if (it->second.empty()) {
-    VAST_TRACE(self, "found an empty ids queue for the current requester");
-    unhandled_ids.erase(it);
-    requesters.pop();
-    return next_session();
+}
+
+void archive_state::extract(uint64_t id) {
+  auto i = sessions.find(id);
+  VAST_ASSERT(i != sessions.end());
+  auto& session = i->second;
+  if (!extraction_pool) {
+    auto [slices, err] = extract_batch(*session.lookup, session.xs, batch_size);
+    self->send(self, atom::extract_v, id, std::move(slices), std::move(err));
+    return;
   }
-  // Start working on the next ids for the next requester.
-  auto& next_ids = it->second.front();
-  session = store->extract(next_ids);
-  self->send(self, next_ids, current_requester, ++session_id);
-  it->second.pop();
+  // The job shares the lookup with the session, because the session may go
+  // away while the job runs.
+  extraction_pool->submit([handle = caf::actor_cast<archive_type>(self), id,
+                           lookup = session.lookup, xs = session.xs,
+                           batch_size = batch_size] {
+    auto [slices, err] = extract_batch(*lookup, xs, batch_size);
+    caf::anon_send(handle, atom::extract_v, id, std::move(slices),
+                   std::move(err));
+  });
 }
 
 void archive_state::send_report() {
@@ -91,26 +142,56 @@ void archive_state::send_report() {
 
 archive_type::behavior_type
 archive(archive_type::stateful_pointer<archive_state> self, path dir,
-        size_t capacity, size_t max_segment_size) {
+        size_t capacity, size_t max_segment_size, size_t segment_cache_size,
+        size_t slice_cache_size, segment_compression compression,
+        size_t extraction_threads, size_t max_sessions, size_t batch_size) {
   // TODO: make the choice of store configurable. For most flexibility, it
   // probably makes sense to pass a unique_ptr<stor> directory to the spawn
   // arguments of the actor. This way, users can provide their own store
   // implementation conveniently.
-  VAST_DEBUG(self, "spawned:", VAST_ARG(capacity), VAST_ARG(max_segment_size));
+  VAST_DEBUG(self, "spawned:", VAST_ARG(capacity), VAST_ARG(max_segment_size),
+             VAST_ARG(segment_cache_size), VAST_ARG(slice_cache_size),
+             VAST_ARG(extraction_threads), VAST_ARG(max_sessions),
+             VAST_ARG(batch_size));
+  VAST_ASSERT(max_sessions > 0);
+  VAST_ASSERT(batch_size > 0);
   self->state.self = self;
-  self->state.store = segment_store::make(dir, max_segment_size, capacity);
+  self->state.max_sessions = max_sessions;
+  self->state.batch_size = batch_size;
+  if (extraction_threads > 0)
+    self->state.extraction_pool
+      = std::make_unique<detail::thread_pool>(extraction_threads);
+  // The store finishes segments that train compression dictionaries on the
+  // extraction pool.
+  self->state.store = segment_store::make(
+    dir, max_segment_size, capacity, segment_cache_size, slice_cache_size,
+    compression, self->state.extraction_pool.get());
   VAST_ASSERT(self->state.store != nullptr);
   self->set_exit_handler([=](const exit_msg& msg) {
     VAST_DEBUG(self, "got EXIT from", msg.source);
     self->state.send_report();
+    // Flushing waits for the segments that the pool finishes.
     if (auto err = self->state.store->flush())
       VAST_ERROR(self, "failed to flush archive", to_string(err));
+    // Lookup sessions must not outlive the store.
+    self->state.extraction_pool.reset();
+    self->state.sessions.clear();
     self->state.store.reset();
     self->quit(msg.reason);
   });
   self->set_down_handler([=](const down_msg& msg) {
     VAST_DEBUG(self, "received DOWN from", msg.source);
-    self->state.active_exporters.erase(msg.source);
+    auto& st = self->state;
+    st.active_exporters.erase(msg.source);
+    // Abandon all pending and running work for the exporter.
+    st.unhandled_ids.erase(msg.source);
+    for (auto i = st.sessions.begin(); i != st.sessions.end();) {
+      if (i->second.requester->address() == msg.source)
+        i = st.sessions.erase(i);
+      else
+        ++i;
+    }
+    st.next_session();
   });
   return {
     [=](const ids& xs) {
@@ -125,45 +206,47 @@ archive(archive_type::stateful_pointer<archive_state> self, path dir,
     },
     [=](const ids& xs, receiver_type requester) {
       auto& st = self->state;
-      if (st.active_exporters.count(requester->address()) == 0) {
+      auto addr = requester->address();
+      if (st.active_exporters.count(addr) == 0) {
         VAST_DEBUG(self, "dismisses query for inactive sender");
         return;
       }
-      st.requesters.push(requester);
-      st.unhandled_ids[requester->address()].push(xs);
-      if (!st.session)
-        st.next_session();
+      st.unhandled_ids[addr].push(xs);
+      // A requester with a running session lines up again once it finishes.
+      auto is_requester = [&](const receiver_type& x) {
+        return x->address() == addr;
+      };
+      auto running = std::any_of(
+        st.sessions.begin(), st.sessions.end(),
+        [&](const auto& kvp) { return is_requester(kvp.second.requester); });
+      if (!running
+          && std::none_of(st.requesters.begin(), st.requesters.end(),
+                          is_requester))
+        st.requesters.push_back(std::move(requester));
+      st.next_session();
     },
-    [=](const ids& xs, receiver_type requester, uint64_t session_id) {
+    [=](atom::extract, uint64_t id, std::vector<table_slice_ptr> slices,
+        caf::error err) {
       auto& st = self->state;
-      // If the export has since shut down, we need to invalidate the session.
-      if (st.active_exporters.count(requester->address()) == 0) {
-        VAST_DEBUG(self, "invalidates running query session for", requester);
-        st.next_session();
+      auto i = st.sessions.find(id);
+      // The requester may have shut down while the batch was in flight.
+      if (i == st.sessions.end()) {
+        VAST_DEBUG(self, "drops results of invalidated session", id);
         return;
       }
-      if (!st.session || st.session_id != session_id) {
-        VAST_DEBUG(self, "considers extraction finished for invalidated "
-                         "session");
-        self->send(requester, atom::done_v, make_error(ec::no_error));
-        st.next_session();
+      auto& session = i->second;
+      for (auto& slice : slices)
+        self->send(session.requester, std::move(slice));
+      if (!err) {
+        st.extract(id);
         return;
       }
-      // Extract the next slice.
-      auto slice = st.session->next();
-      if (!slice) {
-        auto err
-          = slice.error() ? std::move(slice.error()) : make_error(ec::no_error);
-        VAST_DEBUG(self, "finished extraction from the current session:", err);
-        self->send(requester, atom::done_v, std::move(err));
-        st.next_session();
-        return;
-      }
-      // The slice may contain entries that are not selected by xs.
-      for (auto& sub_slice : select(*slice, xs))
-        self->send(requester, sub_slice);
-      // Continue working on the current session.
-      self->send(self, xs, requester, session_id);
+      VAST_DEBUG(self, "finished extraction from session", id, ':', err);
+      self->send(session.requester, atom::done_v, std::move(err));
+      if (st.unhandled_ids.count(session.requester->address()) > 0)
+        st.requesters.push_back(std::move(session.requester));
+      st.sessions.erase(i);
+      st.next_session();
     },
     [=](stream<table_slice_ptr> in) {
       self->make_sink(
@@ -198,12 +281,20 @@ archive(archive_type::stateful_pointer<archive_state> self, path dir,
     },
     [=](atom::exporter, const actor& exporter) {
       auto sender_addr = self->current_sender()->address();
-      self->state.active_exporters.insert(sender_addr);
+      self->state.active_exporters.emplace(sender_addr, expression{});
+      self->monitor<caf::message_priority::high>(exporter);
+    },
+    [=](atom::exporter, const actor& exporter, expression expr) {
+      auto sender_addr = self->current_sender()->address();
+      self->state.active_exporters.insert_or_assign(sender_addr,
+                                                    std::move(expr));
       self->monitor<caf::message_priority::high>(exporter);
     },
     [=](atom::status, status_verbosity v) {
       auto result = caf::settings{};
       auto& archive_status = put_dictionary(result, "archive");
+      if (v >= status_verbosity::detailed)
+        caf::put(archive_status, "sessions", self->state.sessions.size());
       if (v >= status_verbosity::debug)
         detail::fill_status_map(archive_status, self);
       self->state.store->inspect_status(archive_status, v);
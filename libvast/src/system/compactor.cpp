@@ -0,0 +1,281 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/system/compactor.hpp"
+
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/column_index.hpp"
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/error.hpp"
+#include "vast/fwd.hpp"
+#include "vast/ids.hpp"
+#include "vast/load.hpp"
+#include "vast/logger.hpp"
+#include "vast/save.hpp"
+
+#include <caf/event_based_actor.hpp>
+#include <caf/settings.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+namespace vast::system {
+
+namespace {
+
+/// Reads the meta data of the persisted partition in *base_dir*.
+caf::expected<partition::meta_data> load_meta_data(const path& base_dir) {
+  partition::meta_data result;
+  record_type combined_type;
+  if (auto err
+      = load(nullptr, partition_meta_file(base_dir), result, combined_type))
+    return err;
+  return result;
+}
+
+compaction_candidate
+summarize(const uuid& id, const partition::meta_data& meta) {
+  auto result = compaction_candidate{id, std::numeric_limits<vast::id>::max(),
+                                     0};
+  for (auto& [name, xs] : meta.type_ids) {
+    result.first = std::min(result.first, select(xs, 1));
+    result.events += rank(xs);
+  }
+  return result;
+}
+
+/// Merges a column of all sources of a job into the target.
+/// @returns The number of bytes read from disk.
+caf::expected<uint64_t>
+merge_column(caf::actor_system& sys, const compactor_state& st,
+             const compactor_state::job& job,
+             const qualified_record_field& field) {
+  // The INDEX creates the indexes of all partitions with these options.
+  caf::settings index_opts;
+  index_opts["cardinality"] = st.max_partition_size;
+  index_opts["bitmap"] = caf::to_string(st.bitmap);
+  auto target = make_column_index(
+    sys, partition_column_file(st.dir / to_string(job.target), field),
+    field.type, index_opts);
+  if (!target)
+    return target.error();
+  auto result = uint64_t{0};
+  for (auto& source : job.sources) {
+    auto filename = partition_column_file(st.dir / to_string(source), field);
+    // Not every source has every column.
+    if (!exists(filename))
+      continue;
+    if (auto size = file_size(filename))
+      result += *size;
+    auto column = make_column_index(sys, filename, field.type, index_opts);
+    if (!column)
+      return column.error();
+    if (auto err = (*target)->merge(**column))
+      return err;
+  }
+  if (auto err = (*target)->flush_to_disk())
+    return err;
+  return result;
+}
+
+} // namespace
+
+std::vector<uuid>
+plan_compaction(const std::vector<compaction_candidate>& candidates,
+                size_t max_partition_size,
+                const std::set<std::vector<uuid>>& failed) {
+  using iterator = std::vector<compaction_candidate>::const_iterator;
+  auto qualifies = [&](const compaction_candidate& x) {
+    return x.events * 2 <= max_partition_size;
+  };
+  // Finds the first run at or after *first*, and returns it together with the
+  // position of its first partition.
+  auto next_run
+    = [&](iterator first) -> std::pair<std::vector<uuid>, iterator> {
+    std::vector<uuid> result;
+    size_t events = 0;
+    auto begin = first;
+    for (auto i = first; i != candidates.end(); ++i) {
+      if (qualifies(*i) && events + i->events <= max_partition_size) {
+        if (result.empty())
+          begin = i;
+        result.push_back(i->id);
+        events += i->events;
+        continue;
+      }
+      if (result.size() > 1)
+        return {std::move(result), begin};
+      result.clear();
+      events = 0;
+      if (qualifies(*i)) {
+        result.push_back(i->id);
+        events = i->events;
+        begin = i;
+      }
+    }
+    if (result.size() > 1)
+      return {std::move(result), begin};
+    return {};
+  };
+  // A run that failed before fails again, so we look for the next one that
+  // starts after its first partition.
+  for (auto first = candidates.begin(); first != candidates.end();) {
+    auto [run, begin] = next_run(first);
+    if (run.empty() || failed.count(run) == 0)
+      return std::move(run);
+    first = std::next(begin);
+  }
+  return {};
+}
+
+caf::behavior compactor(caf::stateful_actor<compactor_state>* self, path dir,
+                        size_t max_partition_size, size_t rate,
+                        caf::atom_value bitmap) {
+  VAST_TRACE(VAST_ARG(dir), VAST_ARG(max_partition_size), VAST_ARG(rate),
+             VAST_ARG(bitmap));
+  self->state.dir = std::move(dir);
+  self->state.max_partition_size = max_partition_size;
+  self->state.rate = rate;
+  self->state.bitmap = bitmap;
+  // Discards the partially written target of the current job.
+  auto fail = [=](caf::error err) {
+    auto& st = self->state;
+    VAST_ASSERT(st.current);
+    VAST_WARNING(self, "failed to compact partitions:",
+                 self->system().render(err));
+    auto target_dir = st.dir / to_string(st.current->target);
+    if (exists(target_dir) && !rm(target_dir))
+      VAST_WARNING(self, "failed to remove", target_dir);
+    st.failed.insert(st.current->sources);
+    st.current->promise.deliver(std::move(err));
+    st.current = caf::none;
+  };
+  return {
+    [=](atom::compact, const std::vector<uuid>& partitions)
+      -> caf::result<uuid, std::vector<uuid>> {
+      auto& st = self->state;
+      if (st.current)
+        return make_error(ec::unspecified, "compaction in progress");
+      // Summarize partitions we have not seen before, and forget about the
+      // ones that no longer exist.
+      decltype(st.candidates) candidates;
+      for (auto& id : partitions) {
+        if (auto i = st.candidates.find(id); i != st.candidates.end()) {
+          candidates.emplace(id, i->second);
+          continue;
+        }
+        auto meta = load_meta_data(st.dir / to_string(id));
+        if (!meta) {
+          VAST_DEBUG(self, "skips partition", id, "without meta data");
+          continue;
+        }
+        candidates.emplace(id, summarize(id, *meta));
+      }
+      st.candidates = std::move(candidates);
+      for (auto i = st.failed.begin(); i != st.failed.end();) {
+        auto gone = [&](const uuid& id) {
+          return st.candidates.count(id) == 0;
+        };
+        if (std::any_of(i->begin(), i->end(), gone))
+          i = st.failed.erase(i);
+        else
+          ++i;
+      }
+      std::vector<compaction_candidate> xs;
+      xs.reserve(st.candidates.size());
+      for (auto& kvp : st.candidates)
+        xs.push_back(kvp.second);
+      std::sort(xs.begin(), xs.end(), [](auto& x, auto& y) {
+        return x.first < y.first;
+      });
+      auto sources = plan_compaction(xs, st.max_partition_size, st.failed);
+      if (sources.empty())
+        return {uuid::nil(), std::vector<uuid>{}};
+      // Combine the meta data of all sources.
+      compactor_state::job job;
+      for (auto& source : sources) {
+        auto meta = load_meta_data(st.dir / to_string(source));
+        if (!meta) {
+          st.failed.insert(sources);
+          return meta.error();
+        }
+        for (auto& layout : meta->layouts) {
+          if (!job.meta.layouts.insert(layout).second)
+            continue;
+          for (auto& field : layout.fields) {
+            auto fqf = qualified_record_field{layout.name(), field};
+            if (std::find(job.columns.begin(), job.columns.end(), fqf)
+                == job.columns.end())
+              job.columns.push_back(std::move(fqf));
+          }
+        }
+        for (auto& [name, xs] : meta->type_ids)
+          job.meta.type_ids[name] |= xs;
+      }
+      job.sources = std::move(sources);
+      job.target = uuid::random();
+      job.promise = self->make_response_promise<uuid, std::vector<uuid>>();
+      VAST_VERBOSE(self, "merges", job.sources.size(), "partitions into",
+                   job.target);
+      st.current = std::move(job);
+      self->send(self, atom::run_v);
+      return st.current->promise;
+    },
+    [=](atom::run) {
+      auto& st = self->state;
+      if (!st.current)
+        return;
+      auto& job = *st.current;
+      // The target becomes a valid partition only once its meta data exists,
+      // so we write it after all columns.
+      if (job.merged_columns == job.columns.size()) {
+        record_type combined_type;
+        for (auto& field : job.columns)
+          combined_type.fields.push_back(as_record_field(field));
+        auto target_dir = st.dir / to_string(job.target);
+        if (!exists(target_dir))
+          if (auto err = mkdir(target_dir))
+            return fail(std::move(err));
+        if (auto err = save(nullptr, partition_meta_file(target_dir), job.meta,
+                            combined_type))
+          return fail(std::move(err));
+        ++st.compactions;
+        job.promise.deliver(job.target, std::move(job.sources));
+        st.current = caf::none;
+        return;
+      }
+      auto bytes = merge_column(self->system(), st, job,
+                                job.columns[job.merged_columns]);
+      if (!bytes)
+        return fail(std::move(bytes.error()));
+      ++job.merged_columns;
+      st.bytes_read += *bytes;
+      // Pause after each column for as long as reading it should have taken
+      // at the configured rate, so that compaction leaves most of the I/O
+      // bandwidth to ingestion and queries.
+      if (st.rate == 0) {
+        self->send(self, atom::run_v);
+        return;
+      }
+      auto delay = std::chrono::duration_cast<caf::timespan>(
+        std::chrono::duration<double>{static_cast<double>(*bytes) / st.rate});
+      self->delayed_send(self, delay, atom::run_v);
+    },
+  };
+}
+
+} // namespace vast::system
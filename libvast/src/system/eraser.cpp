@@ -51,7 +51,7 @@ void eraser_state::init(caf::timespan interval, std::string query,
       VAST_ERROR(self_, "failed to normalize and validate", query_);
       return;
     }
-    self_->send(index_, std::move(*expr));
+    self_->send(index_, atom::background_v, std::move(*expr));
     transition_to(await_query_id);
   });
   // Trigger the delayed send message.
@@ -85,10 +85,12 @@ void eraser_state::process_end_of_hits() {
     request_more_hits(n);
     return;
   }
-  // Tell the ARCHIVE to erase all hits.
+  // Tell the INDEX to drop cached results that refer to the hits and the
+  // ARCHIVE to erase all hits.
   using std::swap;
   ids all_hits;
   swap(all_hits, hits_);
+  self_->send(index_, atom::erase_v, all_hits);
   self_->send(archive_, atom::erase_v, std::move(all_hits));
   transition_to(idle);
 }
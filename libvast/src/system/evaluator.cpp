@@ -13,6 +13,7 @@
 
 #include "vast/system/evaluator.hpp"
 
+#include "vast/bitmap_algorithms.hpp"
 #include "vast/expression_visitors.hpp"
 #include "vast/fwd.hpp"
 #include "vast/logger.hpp"
@@ -23,6 +24,8 @@
 #include <caf/event_based_actor.hpp>
 #include <caf/stateful_actor.hpp>
 
+#include <algorithm>
+
 namespace vast::system {
 
 namespace {
@@ -31,8 +34,10 @@ namespace {
 /// conjunctions, disjunctions, and negations.
 class ids_evaluator {
 public:
-  ids_evaluator(const evaluator_state::predicate_hits_map& xs) : hits_(xs) {
-    push();
+  ids_evaluator(const evaluator_state::predicate_hits_map& xs,
+                offset position = {0})
+    : hits_(xs), position_(std::move(position)) {
+    // nop
   }
 
   ids operator()(caf::none_t) {
@@ -88,6 +93,148 @@ private:
   offset position_;
 };
 
+/// Estimates the fraction of rows satisfying an expression from the
+/// estimates for its predicates, assuming independent predicates.
+class selectivity_estimator {
+public:
+  selectivity_estimator(const selectivity_estimates& xs, offset position)
+    : estimates_(xs), position_(std::move(position)) {
+    // nop
+  }
+
+  double operator()(caf::none_t) {
+    return 1.0;
+  }
+
+  double operator()(const conjunction& xs) {
+    auto result = 1.0;
+    position_.emplace_back(0);
+    for (size_t i = 0; i < xs.size(); ++i) {
+      position_.back() = i;
+      result *= caf::visit(*this, xs[i]);
+    }
+    position_.pop_back();
+    return result;
+  }
+
+  double operator()(const disjunction& xs) {
+    auto result = 0.0;
+    position_.emplace_back(0);
+    for (size_t i = 0; i < xs.size(); ++i) {
+      position_.back() = i;
+      result += caf::visit(*this, xs[i]);
+    }
+    position_.pop_back();
+    return std::min(result, 1.0);
+  }
+
+  double operator()(const negation& n) {
+    position_.emplace_back(0);
+    auto result = caf::visit(*this, n.expr());
+    position_.pop_back();
+    return 1.0 - result;
+  }
+
+  double operator()(const predicate& pred) {
+    auto i = estimates_.find(position_);
+    return i != estimates_.end() ? i->second : default_selectivity(pred.op);
+  }
+
+private:
+  const selectivity_estimates& estimates_;
+  offset position_;
+};
+
+/// Walks the expression tree and collects the predicates to look up in the
+/// next stage. Visits the operands of a conjunction in order of estimated
+/// selectivity and only descends into the next operand after the previous
+/// one completed, dropping all remaining operands once the running
+/// intersection is empty. Each call operator returns whether the visited
+/// subtree is fully evaluated.
+class stage_planner {
+public:
+  stage_planner(evaluator_state& st) : st_(st), position_{0} {
+    // nop
+  }
+
+  bool operator()(caf::none_t) {
+    return true;
+  }
+
+  bool operator()(const conjunction& xs) {
+    position_.emplace_back(0);
+    std::vector<std::pair<double, size_t>> order;
+    order.reserve(xs.size());
+    for (size_t i = 0; i < xs.size(); ++i) {
+      position_.back() = i;
+      selectivity_estimator estimator{st_.estimates, position_};
+      order.emplace_back(caf::visit(estimator, xs[i]), i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](auto& x, auto& y) { return x.first < y.first; });
+    auto done = true;
+    ids intersection;
+    for (size_t i = 0; i < order.size(); ++i) {
+      position_.back() = order[i].second;
+      auto& operand = xs[order[i].second];
+      if (!caf::visit(*this, operand)) {
+        done = false;
+        break;
+      }
+      auto operand_hits
+        = caf::visit(ids_evaluator{st_.predicate_hits, position_}, operand);
+      if (i == 0)
+        intersection = std::move(operand_hits);
+      else
+        intersection &= operand_hits;
+      if (!any<1>(intersection)) {
+        for (auto j = i + 1; j < order.size(); ++j) {
+          position_.back() = order[j].second;
+          st_.skip(position_);
+        }
+        break;
+      }
+    }
+    position_.pop_back();
+    return done;
+  }
+
+  bool operator()(const disjunction& xs) {
+    position_.emplace_back(0);
+    auto done = true;
+    for (size_t i = 0; i < xs.size(); ++i) {
+      position_.back() = i;
+      if (!caf::visit(*this, xs[i]))
+        done = false;
+    }
+    position_.pop_back();
+    return done;
+  }
+
+  bool operator()(const negation& n) {
+    position_.emplace_back(0);
+    auto done = caf::visit(*this, n.expr());
+    position_.pop_back();
+    return done;
+  }
+
+  bool operator()(const predicate&) {
+    if (auto ptr = st_.hits_for(position_))
+      return ptr->first == 0;
+    if (st_.deferred.count(position_) == 0)
+      return true; // Nothing to look up for this predicate.
+    stage.push_back(position_);
+    return false;
+  }
+
+  /// The positions of the predicates to look up next.
+  std::vector<offset> stage;
+
+private:
+  evaluator_state& st_;
+  offset position_;
+};
+
 } // namespace
 
 evaluator_state::evaluator_state(caf::event_based_actor* self) : self(self) {
@@ -95,10 +242,13 @@ evaluator_state::evaluator_state(caf::event_based_actor* self) : self(self) {
 }
 
 void evaluator_state::init(caf::actor client, expression expr,
+                           selectivity_estimates estimates,
                            caf::response_promise promise) {
-  VAST_TRACE(VAST_ARG(client), VAST_ARG(expr), VAST_ARG(promise));
+  VAST_TRACE(VAST_ARG(client), VAST_ARG(expr), VAST_ARG(estimates),
+             VAST_ARG(promise));
   this->client = std::move(client);
   this->expr = std::move(expr);
+  this->estimates = std::move(estimates);
   this->promise = std::move(promise);
 }
 
@@ -109,10 +259,8 @@ void evaluator_state::handle_result(const offset& position, const ids& result) {
   VAST_ASSERT(ptr != nullptr);
   auto& [missing, accumulated_hits] = *ptr;
   accumulated_hits |= result;
-  if (--missing == 0) {
+  if (--missing == 0)
     VAST_DEBUG(self, "collected all INDEXER results at position", position);
-    evaluate();
-  }
   decrement_pending();
 }
 
@@ -123,17 +271,65 @@ void evaluator_state::handle_missing_result(const offset& position,
                "instead of a result for predicate at position", position);
   auto ptr = hits_for(position);
   VAST_ASSERT(ptr != nullptr);
-  if (--ptr->first == 0) {
+  if (--ptr->first == 0)
     VAST_DEBUG(self, "collected all INDEXER results at position", position);
-    evaluate();
-  }
   decrement_pending();
 }
 
+void evaluator_state::proceed() {
+  if (schedule() > 0)
+    return;
+  VAST_ASSERT(deferred.empty());
+  evaluate();
+  VAST_DEBUG(self, "completed expression evaluation in", stages.size(),
+             "stages", stages, "and skipped", skipped, "lookups");
+  promise.deliver(atom::done_v);
+}
+
+size_t evaluator_state::schedule() {
+  stage_planner planner{*this};
+  caf::visit(planner, expr);
+  size_t result = 0;
+  for (auto& position : planner.stage) {
+    auto [first, last] = deferred.equal_range(position);
+    for (auto i = first; i != last; ++i) {
+      auto& [pred, indexer] = i->second;
+      ++predicate_hits[position].first;
+      ++pending_responses;
+      ++result;
+      self->request(indexer, caf::infinite, pred)
+        .then(
+          [this, pos = position](const ids& hits) { handle_result(pos, hits); },
+          [this, pos = position](const caf::error& err) {
+            handle_missing_result(pos, err);
+          });
+    }
+    deferred.erase(first, last);
+  }
+  if (result > 0) {
+    VAST_DEBUG(self, "looks up predicates at positions", planner.stage,
+               "in stage", stages.size());
+    stages.push_back(std::move(planner.stage));
+  }
+  return result;
+}
+
+void evaluator_state::skip(const offset& position) {
+  auto below = [&](const offset& x) {
+    return x.size() >= position.size()
+           && std::equal(position.begin(), position.end(), x.begin());
+  };
+  for (auto i = deferred.lower_bound(position);
+       i != deferred.end() && below(i->first);) {
+    VAST_DEBUG(self, "skips lookup for predicate at position", i->first);
+    i = deferred.erase(i);
+    ++skipped;
+  }
+}
+
 void evaluator_state::evaluate() {
-  VAST_DEBUG(self, "got predicate_hits:", predicate_hits,
-             "expr_hits:", caf::visit(ids_evaluator{predicate_hits}, expr));
   auto delta = caf::visit(ids_evaluator{predicate_hits}, expr) - hits;
+  VAST_DEBUG(self, "got predicate_hits:", predicate_hits, "delta:", delta);
   if (any<1>(delta)) {
     hits |= delta;
     self->send(client, std::move(delta));
@@ -141,11 +337,9 @@ void evaluator_state::evaluate() {
 }
 
 void evaluator_state::decrement_pending() {
-  // We're done evaluating if all INDEXER actors have reported their hits.
-  if (--pending_responses == 0) {
-    VAST_DEBUG(self, "completed expression evaluation");
-    promise.deliver(atom::done_v);
-  }
+  // A stage is complete once all INDEXER actors have reported their hits.
+  if (--pending_responses == 0)
+    proceed();
 }
 
 evaluator_state::predicate_hits_map::mapped_type*
@@ -155,32 +349,18 @@ evaluator_state::hits_for(const offset& position) {
 }
 
 caf::behavior evaluator(caf::stateful_actor<evaluator_state>* self,
-                        expression expr, evaluation_triples eval) {
-  VAST_TRACE(VAST_ARG(expr), VAST_ARG(eval));
+                        expression expr, evaluation_triples eval,
+                        selectivity_estimates estimates) {
+  VAST_TRACE(VAST_ARG(expr), VAST_ARG(eval), VAST_ARG(estimates));
   VAST_ASSERT(!eval.empty());
-  using std::get;
   using std::move;
-  return {[=, expr{move(expr)}, eval{move(eval)}](caf::actor client) {
+  return {[=, expr{move(expr)}, eval{move(eval)},
+           estimates{move(estimates)}](caf::actor client) {
     auto& st = self->state;
-    st.init(client, move(expr), self->make_response_promise());
-    st.pending_responses += eval.size();
-    for (auto& triple : eval) {
-      // No strucutured bindings available due to subsequent lambda. :-/
-      // TODO: C++20
-      auto& pos = get<0>(triple);
-      auto& curried_pred = get<1>(triple);
-      auto& indexer = get<2>(triple);
-      ++st.predicate_hits[pos].first;
-      self->request(indexer, caf::infinite, curried_pred)
-        .then([=](const ids& hits) { self->state.handle_result(pos, hits); },
-              [=](const caf::error& err) {
-                self->state.handle_missing_result(pos, err);
-              });
-    }
-    if (st.pending_responses == 0) {
-      VAST_DEBUG(self, "has nothing to evaluate for expression");
-      st.promise.deliver(atom::done_v);
-    }
+    st.init(client, move(expr), move(estimates), self->make_response_promise());
+    for (auto& [pos, curried_pred, indexer] : eval)
+      st.deferred.emplace(pos, std::make_pair(curried_pred, indexer));
+    st.proceed();
     // We can only deal with exactly one expression/client at the moment.
     self->unbecome();
   }};
@@ -223,8 +223,16 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
         return;
       }
       VAST_DEBUG(self, "tailored AST to", t, ':', x);
+      auto checker = compiled_expression::make(*x, slice->layout());
+      if (!checker) {
+        VAST_ERROR(self, "failed to compile expression:",
+                   self->system().render(checker.error()));
+        ship_results(self);
+        shutdown(self);
+        return;
+      }
       std::tie(it, std::ignore)
-        = st.checkers.emplace(type{slice->layout()}, std::move(*x));
+        = st.checkers.emplace(type{slice->layout()}, std::move(*checker));
     }
     auto& checker = it->second;
     // Perform candidate check, splitting the slice into subsets if needed.
@@ -363,9 +371,10 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
       self->state.archive = archive;
       if (has_continuous_option(self->state.options))
         self->monitor(archive);
-      // Register self at the archive
+      // Register self at the archive, which uses the query to skip table
+      // slices that cannot contain results.
       if (has_historical_option(self->state.options))
-        self->send(archive, atom::exporter_v, self);
+        self->send(archive, atom::exporter_v, self, self->state.expr);
     },
     [=](atom::index, const actor& index) {
       VAST_DEBUG(self, "registers index", index);
@@ -26,21 +26,26 @@
 #include "vast/detail/fill_status_map.hpp"
 #include "vast/detail/narrow.hpp"
 #include "vast/detail/notifying_stream_manager.hpp"
+#include "vast/error.hpp"
 #include "vast/expression_visitors.hpp"
 #include "vast/fbs/meta_index.hpp"
 #include "vast/fbs/utils.hpp"
+#include "vast/file.hpp"
 #include "vast/ids.hpp"
-#include "vast/io/read.hpp"
 #include "vast/io/save.hpp"
 #include "vast/json.hpp"
 #include "vast/load.hpp"
 #include "vast/logger.hpp"
 #include "vast/save.hpp"
 #include "vast/system/accountant.hpp"
+#include "vast/system/compactor.hpp"
 #include "vast/system/evaluator.hpp"
 #include "vast/system/index_common.hpp"
 #include "vast/system/partition.hpp"
+#include "vast/system/posix_filesystem.hpp"
 #include "vast/system/query_supervisor.hpp"
+#include "vast/system/report.hpp"
+#include "vast/system/shared_lookup.hpp"
 #include "vast/system/spawn_indexer.hpp"
 #include "vast/table_slice.hpp"
 
@@ -49,6 +54,10 @@
 
 #include <chrono>
 #include <deque>
+#include <functional>
+#include <map>
+#include <thread>
+#include <tuple>
 #include <unordered_set>
 
 using namespace std::chrono;
@@ -80,16 +89,31 @@ partition_ptr index_state::partition_factory::operator()(const uuid& id) const {
   return result;
 }
 
+size_t
+index_state::partition_weigher::operator()(const partition_ptr& part) const {
+  auto result = size_t{0};
+  auto add = [&](const path& filename) {
+    if (auto size = file_size(filename))
+      result += *size;
+  };
+  add(part->meta_file());
+  for (auto& kvp : part->indexers_)
+    add(part->column_file(kvp.first));
+  return result;
+}
+
 index_state::index_state(caf::stateful_actor<index_state>* self)
   : self(self),
     factory(spawn_indexer),
-    lru_partitions(10, partition_lookup{}, partition_factory{this}) {
+    cached_partitions(defaults::system::max_resident_partition_bytes,
+                      defaults::system::max_in_mem_partitions,
+                      partition_factory{this}) {
   // nop
 }
 
 index_state::~index_state() {
   VAST_VERBOSE(self, "tearing down");
-  if (active != nullptr) {
+  if (active != nullptr && indexing_threads == 0) {
     [[maybe_unused]] auto unregistered = stage->out().unregister(active.get());
     VAST_ASSERT(unregistered);
   }
@@ -99,15 +123,18 @@ index_state::~index_state() {
 
 caf::error
 index_state::init(const path& dir, size_t max_partition_size,
-                  uint32_t in_mem_partitions, uint32_t taste_partitions) {
+                  uint32_t in_mem_partitions, size_t max_resident_bytes,
+                  uint32_t taste_partitions) {
   VAST_TRACE(VAST_ARG(dir), VAST_ARG(max_partition_size),
-             VAST_ARG(in_mem_partitions), VAST_ARG(taste_partitions));
+             VAST_ARG(in_mem_partitions), VAST_ARG(max_resident_bytes),
+             VAST_ARG(taste_partitions));
   // This option must be kept in sync with vast/address_synopsis.hpp.
   put(meta_idx.factory_options(), "max-partition-size", max_partition_size);
   // Set members.
   this->dir = dir;
   this->max_partition_size = max_partition_size;
-  this->lru_partitions.size(in_mem_partitions);
+  this->cached_partitions.max_size(in_mem_partitions);
+  this->cached_partitions.capacity(max_resident_bytes);
   this->taste_partitions = taste_partitions;
   this->flush_on_destruction = false;
   // Read persistent state.
@@ -138,26 +165,117 @@ caf::error index_state::load_from_disk() {
   }
   if (auto fname = meta_index_filename(); exists(fname)) {
     VAST_VERBOSE(self, "loads meta index from", fname);
-    auto buffer = io::read(fname);
-    if (!buffer) {
-      VAST_ERROR(self, "failed to read meta index file:",
-                 self->system().render(buffer.error()));
-      return buffer.error();
+    // We map the meta index into memory and let its Bloom filter synopses
+    // perform lookups directly on the mapped bits.
+    auto chunk = chunk::mmap(fname);
+    if (!chunk) {
+      VAST_ERROR(self, "failed to map meta index file", fname);
+      return make_error(ec::filesystem_error, "failed to mmap", fname.str());
     }
-    auto bytes = span<const byte>{*buffer};
-    if (auto err = fbs::unwrap<fbs::MetaIndex>(bytes, meta_idx))
+    auto flatbuf = fbs::as_flatbuffer<fbs::MetaIndex>(as_bytes(chunk));
+    if (!flatbuf)
+      return make_error(ec::format_error, "flatbuffer verification failed");
+    if (auto err = unpack(*flatbuf, meta_idx, chunk))
       return err;
-    VAST_DEBUG(self, "loaded meta index");
+    meta_index_compacted = meta_idx.num_partitions();
+    // The delta file contains a sequence of size-prefixed meta index
+    // flatbuffers with the partitions that arrived after writing the meta
+    // index file.
+    auto delta_fname = meta_index_delta_filename();
+    if (auto delta = chunk::mmap(delta_fname)) {
+      auto bytes = as_bytes(delta);
+      while (!bytes.empty()) {
+        auto data = reinterpret_cast<const uint8_t*>(bytes.data());
+        auto size = size_t{0};
+        auto verify = [&] {
+          auto prefix_size = sizeof(flatbuffers::uoffset_t);
+          if (bytes.size() < prefix_size)
+            return false;
+          size = flatbuffers::GetPrefixedSize(data) + prefix_size;
+          if (size > bytes.size())
+            return false;
+          auto verifier = fbs::make_verifier(bytes.subspan(0, size));
+          return verifier.VerifySizePrefixedBuffer<fbs::MetaIndex>(
+            fbs::file_identifier);
+        };
+        if (!verify()) {
+          // A crash while appending may leave a truncated record behind. We
+          // drop it and write a fresh meta index file on the next flush.
+          VAST_WARNING(self, "ignores truncated meta index delta in",
+                       delta_fname);
+          meta_index_compacted = 0;
+          break;
+        }
+        auto root = flatbuffers::GetSizePrefixedRoot<fbs::MetaIndex>(data);
+        if (auto err = unpack(*root, meta_idx, delta))
+          return err;
+        bytes = bytes.subspan(size);
+      }
+    }
+    meta_index_appended = meta_idx.num_partitions();
+    VAST_DEBUG(self, "loaded meta index with", meta_index_appended,
+               "partitions");
+    // A crash while flushing a partition leaves it without its meta file,
+    // which we write only after all columns. We cannot query such partitions,
+    // so we drop them and rewrite the meta index on the next flush.
+    std::vector<uuid> incomplete;
+    for (auto& id : meta_idx.partitions())
+      if (!exists(partition_meta_file(dir / to_string(id))))
+        incomplete.push_back(id);
+    if (!incomplete.empty()) {
+      VAST_WARNING(self, "discards", incomplete.size(),
+                   "partitions that were not completely written to disk");
+      meta_idx.erase(incomplete);
+      meta_index_compacted = 0;
+      meta_index_appended = 0;
+      for (auto& id : incomplete)
+        if (auto part_dir = dir / to_string(id);
+            exists(part_dir) && !rm(part_dir))
+          VAST_WARNING(self, "failed to remove", part_dir);
+    }
   }
   return caf::none;
 }
 
 caf::error index_state::flush_meta_index() {
-  VAST_VERBOSE(self, "writes meta index to", meta_index_filename());
-  auto flatbuf = fbs::wrap(meta_idx, fbs::file_identifier);
-  if (!flatbuf)
-    return flatbuf.error();
-  return io::save(meta_index_filename(), as_bytes(*flatbuf));
+  auto num_partitions = meta_idx.num_partitions();
+  // We rewrite the entire meta index when the delta file holds more than an
+  // eighth of all partitions, and append the new partitions to the delta file
+  // otherwise. Appending keeps the cost of a flush proportional to the number
+  // of new partitions.
+  auto fname = meta_index_filename();
+  auto delta_fname = meta_index_delta_filename();
+  if (!exists(fname)
+      || (num_partitions - meta_index_compacted) * 8 > num_partitions) {
+    VAST_VERBOSE(self, "writes meta index to", fname);
+    auto flatbuf = fbs::wrap(meta_idx, fbs::file_identifier);
+    if (!flatbuf)
+      return flatbuf.error();
+    if (auto err = io::save(fname, as_bytes(*flatbuf)))
+      return err;
+    if (exists(delta_fname) && !rm(delta_fname))
+      return make_error(ec::filesystem_error, "failed to remove",
+                        delta_fname.str());
+    meta_index_compacted = num_partitions;
+    meta_index_appended = num_partitions;
+    return caf::none;
+  }
+  if (meta_index_appended == num_partitions)
+    return caf::none;
+  VAST_VERBOSE(self, "appends", num_partitions - meta_index_appended,
+               "partitions to", delta_fname);
+  flatbuffers::FlatBufferBuilder builder;
+  auto root = pack(builder, meta_idx, meta_index_appended);
+  if (!root)
+    return root.error();
+  builder.FinishSizePrefixed(*root, fbs::file_identifier);
+  file delta{delta_fname};
+  if (auto opened = delta.open(file::write_only, true); !opened)
+    return opened.error();
+  if (auto err = delta.write(builder.GetBufferPointer(), builder.GetSize()))
+    return err;
+  meta_index_appended = num_partitions;
+  return caf::none;
 }
 
 caf::error index_state::flush_statistics() {
@@ -168,6 +286,10 @@ caf::error index_state::flush_statistics() {
 caf::error index_state::flush_to_disk() {
   VAST_TRACE("");
   auto flush_all = [this]() -> caf::error {
+    // We only flush on shutdown, after which the active partition receives
+    // no more events.
+    if (active != nullptr)
+      meta_idx.shrink(active->id(), max_partition_size - active->capacity());
     // Flush meta index to disk.
     if (auto err = flush_meta_index())
       return err;
@@ -201,14 +323,8 @@ path index_state::meta_index_filename() const {
   return dir / "meta";
 }
 
-bool index_state::worker_available() {
-  return !idle_workers.empty();
-}
-
-caf::actor index_state::next_worker() {
-  auto result = std::move(idle_workers.back());
-  idle_workers.pop_back();
-  return result;
+path index_state::meta_index_delta_filename() const {
+  return dir / "meta.delta";
 }
 
 caf::dictionary<caf::config_value>
@@ -220,6 +336,58 @@ index_state::status(status_verbosity v) const {
   auto& index_status = put_dictionary(result, "index");
   // Misc parameters.
   if (v >= status_verbosity::info) {
+    auto& cache_status = put_dictionary(index_status, "partition-cache");
+    put(cache_status, "partitions", cached_partitions.size());
+    put(cache_status, "memory-usage", cached_partitions.weight());
+    put(cache_status, "memory-budget", cached_partitions.capacity());
+    auto& cache_stats = cached_partitions.stats();
+    put(cache_status, "hits", cache_stats.hits);
+    put(cache_status, "misses", cache_stats.misses);
+    put(cache_status, "evictions", cache_stats.evictions);
+    auto& indexing_status = put_dictionary(index_status, "indexing");
+    auto engine = indexing_threads > 0 ? "partition" : "actor";
+    put(indexing_status, "engine", std::string{engine});
+    if (indexing_threads > 0) {
+      put(indexing_status, "threads", indexing_threads);
+      put(indexing_status, "events", indexing_measurement.events);
+      put(indexing_status, "rate", indexing_measurement.rate_per_sec());
+    }
+    auto& queries_status = put_dictionary(index_status, "queries");
+    put(queries_status, "batch-window", query_batch_window);
+    put(queries_status, "shared-lookups", shared_lookups);
+    put(queries_status, "pending", scheduler.jobs());
+    auto& workers_status = put_dictionary(queries_status, "workers");
+    put(workers_status, "idle", scheduler.idle_workers());
+    put(workers_status, "busy", scheduler.busy_workers());
+    auto& queue_status = put_dictionary(queries_status, "queue-depth");
+    for (auto priority :
+         {query_priority::interactive, query_priority::background})
+      put(queue_status, to_string(priority), scheduler.queue_depth(priority));
+    auto& task_stats = scheduler.stats();
+    auto& tasks_status = put_dictionary(queries_status, "tasks");
+    put(tasks_status, "completed", task_stats.completed);
+    if (task_stats.completed > 0) {
+      put(tasks_status, "mean-wait-time",
+          duration{task_stats.wait_time / task_stats.completed});
+      put(tasks_status, "mean-run-time",
+          duration{task_stats.run_time / task_stats.completed});
+    }
+    auto& predicate_cache_status = put_dictionary(index_status,
+                                                  "predicate-cache");
+    put(predicate_cache_status, "results", cached_predicates.size());
+    put(predicate_cache_status, "memory-usage", cached_predicates.weight());
+    put(predicate_cache_status, "memory-budget", cached_predicates.capacity());
+    auto& predicate_stats = cached_predicates.stats();
+    put(predicate_cache_status, "hits", predicate_stats.hits);
+    put(predicate_cache_status, "misses", predicate_stats.misses);
+    put(predicate_cache_status, "evictions", predicate_stats.evictions);
+    put(predicate_cache_status, "invalidations",
+        predicate_stats.invalidations);
+    if (compactor) {
+      auto& compaction_status = put_dictionary(index_status, "compaction");
+      put(compaction_status, "interval", compaction_interval);
+      put(compaction_status, "merged-partitions", compacted_partitions);
+    }
   }
   if (v >= status_verbosity::detailed) {
     auto& stats_object = put_dictionary(index_status, "statistics");
@@ -240,11 +408,16 @@ index_state::status(status_verbosity v) const {
     if (active != nullptr)
       partitions.emplace("active", to_string(active->id()));
     auto& cached = put_list(partitions, "cached");
-    for (auto& part : lru_partitions.elements())
-      cached.emplace_back(to_string(part->id()));
+    for (auto& x : cached_partitions.frequent())
+      cached.emplace_back(to_string(x.key));
+    for (auto& x : cached_partitions.recent())
+      cached.emplace_back(to_string(x.key));
     auto& unpersisted = put_list(partitions, "unpersisted");
     for (auto& kvp : this->unpersisted)
       unpersisted.emplace_back(to_string(kvp.first->id()));
+    auto& prefetched = put_list(partitions, "prefetched");
+    for (auto& part : this->prefetched)
+      prefetched.emplace_back(to_string(part->id()));
     // General state such as open streams.
     detail::fill_status_map(index_status, self);
   }
@@ -255,14 +428,30 @@ void index_state::reset_active_partition() {
   // Persist meta data and the state of all INDEXER actors when the active
   // partition gets replaced becomes full.
   if (active != nullptr) {
-    [[maybe_unused]] auto unregistered = stage->out().unregister(active.get());
-    VAST_ASSERT(unregistered);
-    if (auto err = active->flush_to_disk())
-      VAST_ERROR(self, "failed to persist active partition:", err);
-    // Store this partition as unpersisted to make sure we're not attempting
-    // to load it from disk until it is safe to do so.
-    if (active_partition_indexers > 0)
-      unpersisted.emplace_back(std::move(active), active_partition_indexers);
+    // The synopses of a full partition only need to fit its events.
+    meta_idx.shrink(active->id(), max_partition_size - active->capacity());
+    if (indexing_threads > 0) {
+      active->index_inbound();
+    } else {
+      [[maybe_unused]] auto unregistered
+        = stage->out().unregister(active.get());
+      VAST_ASSERT(unregistered);
+    }
+    // The meta file is the manifest of a partition, so we write it only once
+    // all columns are on disk. The columns come from the INDEXER actors or
+    // from the flush pool, which report back with 'done' messages. Without
+    // either, we write the in-place column indexes here.
+    auto pending = active_partition_indexers;
+    if (flush_pool != nullptr)
+      pending += active->flush_columns(*flush_pool);
+    if (pending == 0) {
+      if (auto err = active->flush_to_disk())
+        VAST_ERROR(self, "failed to persist active partition:", err);
+    } else {
+      // Store this partition as unpersisted to make sure we're not attempting
+      // to load it from disk until it is safe to do so.
+      unpersisted.emplace_back(std::move(active), pending);
+    }
   }
   // Persist the current version of the meta_index and statistics to preserve
   // the state and be partially robust against crashes.
@@ -271,7 +460,8 @@ void index_state::reset_active_partition() {
   if (auto err = flush_statistics())
     VAST_ERROR(self, "failed to persist the statistics:", err);
   active = make_partition();
-  stage->out().register_partition(active.get());
+  if (indexing_threads == 0)
+    stage->out().register_partition(active.get());
   active_partition_indexers = 0;
 }
 
@@ -290,14 +480,19 @@ partition_ptr index_state::make_partition(uuid id) {
   return std::make_unique<partition>(this, std::move(id), max_partition_size);
 }
 
+caf::settings index_state::value_index_options() const {
+  caf::settings result;
+  result["cardinality"] = max_partition_size;
+  result["bitmap"] = caf::to_string(bitmap);
+  return result;
+}
+
 caf::actor index_state::make_indexer(path filename, type column_type,
                                      uuid partition_id, std::string fqn) {
   VAST_TRACE(VAST_ARG(dir), VAST_ARG(column_type), VAST_ARG(index),
              VAST_ARG(partition_id));
-  caf::settings index_opts;
-  index_opts["cardinality"] = max_partition_size;
   return factory(self, self->state.accountant, std::move(filename),
-                 std::move(column_type), std::move(index_opts), self,
+                 std::move(column_type), value_index_options(), self,
                  partition_id, std::move(fqn));
 }
 
@@ -313,6 +508,11 @@ void index_state::decrement_indexer_count(uuid partition_id) {
       VAST_ERROR(self,
                  "received done from unknown indexer:", self->current_sender());
     if (--i->second == 0) {
+      if (auto err = i->first->flush_to_disk()) {
+        VAST_ERROR(self, "failed to persist partition", partition_id, ":",
+                   self->system().render(err));
+        return;
+      }
       VAST_DEBUG(self, "successfully persisted", partition_id);
       unpersisted.erase(i);
     }
@@ -325,62 +525,361 @@ partition* index_state::find_unpersisted(const uuid& id) {
   return i != unpersisted.end() ? i->first.get() : nullptr;
 }
 
+bool index_state::is_resident(const uuid& id) const {
+  auto has_id = [&](auto& part) { return part->id() == id; };
+  return (active != nullptr && active->id() == id)
+         || std::any_of(unpersisted.begin(), unpersisted.end(),
+                        [&](auto& kvp) { return has_id(kvp.first); })
+         || cached_partitions.contains(id)
+         || std::any_of(prefetched.begin(), prefetched.end(), has_id);
+}
+
+partition_ptr index_state::take_prefetched(const uuid& id) {
+  auto i = std::find_if(prefetched.begin(), prefetched.end(),
+                        [&](auto& part) { return part->id() == id; });
+  if (i == prefetched.end())
+    return nullptr;
+  auto result = std::move(*i);
+  prefetched.erase(i);
+  return result;
+}
+
+void index_state::prefetch(const lookup_state& lookup) {
+  if (prefetch_partitions == 0 || !filesystem)
+    return;
+  auto n = size_t{0};
+  for (auto& id : lookup.partitions) {
+    if (n == prefetch_partitions)
+      break;
+    if (is_resident(id))
+      continue;
+    ++n;
+    if (!prefetching.insert(id).second)
+      continue;
+    VAST_DEBUG(self, "prefetches partition", id);
+    // The filesystem actor reads the meta file on another thread. Once we
+    // have the partition, we let it spawn the INDEXER actors for the query,
+    // which in turn load their state concurrently.
+    auto filename = path{to_string(id)} / "meta";
+    self->request(filesystem, caf::infinite, atom::read_v, filename)
+      .then(
+        [=, expr = lookup.expr](chunk_ptr& chk) {
+          prefetching.erase(id);
+          if (is_resident(id))
+            return;
+          auto part = std::make_unique<partition>(this, id, max_partition_size);
+          if (auto err = part->init(std::move(chk))) {
+            VAST_WARNING(self, "failed to prefetch partition", id, ":",
+                         self->system().render(err));
+            return;
+          }
+          part->eval(expr);
+          // Bound the number of partitions that wait for their lookups.
+          auto max_prefetched
+            = prefetch_partitions * std::max(pending.size(), size_t{1});
+          if (prefetched.size() >= max_prefetched)
+            prefetched.erase(prefetched.begin());
+          prefetched.push_back(std::move(part));
+        },
+        [=](caf::error& err) {
+          prefetching.erase(id);
+          VAST_WARNING(self, "failed to prefetch partition", id, ":",
+                       self->system().render(err));
+        });
+  }
+}
+
 index_state::pending_query_map
 index_state::build_query_map(lookup_state& lookup, uint32_t num_partitions) {
   VAST_TRACE(VAST_ARG(lookup), VAST_ARG(num_partitions));
-  if (num_partitions == 0 || lookup.partitions.empty())
-    return {};
+  return std::move(build_query_maps({&lookup}, num_partitions).front());
+}
+
+std::vector<index_state::pending_query_map>
+index_state::build_query_maps(const std::vector<lookup_state*>& lookups,
+                              uint32_t num_partitions) {
+  VAST_TRACE(VAST_ARG(num_partitions));
+  // Maps partition IDs to the EVALUATOR actors we are going to spawn, for
+  // each lookup.
+  std::vector<pending_query_map> result(lookups.size());
+  if (num_partitions == 0)
+    return result;
   // Prefer partitions that are already available in RAM.
-  std::partition(lookup.partitions.begin(), lookup.partitions.end(),
-                 [&](const uuid& candidate) {
-                   return (active != nullptr && active->id() == candidate)
-                          || find_unpersisted(candidate) != nullptr
-                          || lru_partitions.contains(candidate);
-                 });
-  // Maps partition IDs to the EVALUATOR actors we are going to spawn.
-  pending_query_map result;
-  // Helper function to spin up EVALUATOR actors for a single partition.
-  auto spin_up = [&](const uuid& partition_id) {
+  for (auto lookup : lookups)
+    std::stable_partition(
+      lookup->partitions.begin(), lookup->partitions.end(),
+      [&](const uuid& candidate) { return is_resident(candidate); });
+  // Helper function to get a partition into memory.
+  auto load = [&](const uuid& partition_id) -> partition* {
     // We need to first check whether the ID is the active partition or one
-    // of our unpersistet ones. Only then can we dispatch to our LRU cache.
-    partition* part;
+    // of our unpersistet ones. Only then can we dispatch to our cache.
     if (active != nullptr && active->id() == partition_id)
-      part = active.get();
-    else if (auto ptr = find_unpersisted(partition_id); ptr != nullptr)
-      part = ptr;
-    else
-      part = lru_partitions.get_or_add(partition_id).get();
-    auto eval = part->eval(lookup.expr);
-    if (eval.empty()) {
-      VAST_DEBUG(self, "identified partition", partition_id,
-                 "as candidate in the meta index, but it didn't produce an "
-                 "evaluation map");
-      return;
-    }
-    result.emplace(partition_id, std::move(eval));
+      return active.get();
+    if (auto ptr = find_unpersisted(partition_id); ptr != nullptr)
+      return ptr;
+    if (auto ptr = take_prefetched(partition_id); ptr != nullptr)
+      return cached_partitions.add(partition_id, std::move(ptr)).get();
+    return cached_partitions.get_or_add(partition_id).get();
+  };
+  auto wants_more = [&](size_t i) {
+    return result[i].size() < num_partitions
+           && !lookups[i]->partitions.empty();
   };
-  // Loop over the candidate set until we either successfully scheduled
-  // num_partitions partitions or run out of candidates.
-  {
-    auto i = lookup.partitions.begin();
-    auto last = lookup.partitions.end();
-    for (; i != last && result.size() < num_partitions; ++i)
-      spin_up(*i);
-    lookup.partitions.erase(lookup.partitions.begin(), i);
+  // Loop over the candidate sets until each lookup either successfully
+  // scheduled num_partitions partitions or ran out of candidates. Whenever we
+  // load a partition for one lookup, we also evaluate all other lookups of
+  // the batch that have it among their candidates.
+  for (auto done = false; !done;) {
+    done = true;
+    for (size_t i = 0; i < lookups.size(); ++i) {
+      if (!wants_more(i))
+        continue;
+      done = false;
+      auto partition_id = lookups[i]->partitions.front();
+      auto part = load(partition_id);
+      for (size_t j = 0; j < lookups.size(); ++j) {
+        if (!wants_more(j))
+          continue;
+        auto& candidates = lookups[j]->partitions;
+        auto k = std::find(candidates.begin(), candidates.end(), partition_id);
+        if (k == candidates.end())
+          continue;
+        candidates.erase(k);
+        auto& expr = lookups[j]->expr;
+        auto eval = part->eval(expr);
+        if (eval.empty()) {
+          VAST_DEBUG(self, "identified partition", partition_id,
+                     "as candidate in the meta index, but it didn't produce "
+                     "an evaluation map");
+          continue;
+        }
+        result[j].emplace(partition_id,
+                          std::make_pair(std::move(eval),
+                                         part->estimate_selectivity(expr)));
+      }
+    }
   }
   return result;
 }
 
+void index_state::share_lookups(std::vector<pending_query_map>& pqms) {
+  using key_type = std::tuple<caf::actor, relational_operator, data>;
+  auto key = [](const evaluation_triple& triple) {
+    auto& pred = std::get<1>(triple);
+    return key_type{std::get<2>(triple), pred.op, pred.rhs};
+  };
+  std::map<key_type, size_t> occurrences;
+  for (auto& pqm : pqms)
+    for (auto& [id, eval] : pqm)
+      for (auto& triple : eval.first)
+        ++occurrences[key(triple)];
+  std::map<key_type, caf::actor> proxies;
+  for (auto& pqm : pqms) {
+    for (auto& [id, eval] : pqm) {
+      for (auto& triple : eval.first) {
+        auto k = key(triple);
+        auto n = occurrences[k];
+        if (n < 2)
+          continue;
+        auto& proxy = proxies[k];
+        if (!proxy) {
+          proxy = self->spawn(shared_lookup, std::get<2>(triple),
+                              std::get<1>(triple),
+                              std::function<void(const caf::expected<ids>&)>{});
+          shared_lookups += n - 1;
+        }
+        std::get<2>(triple) = proxy;
+      }
+    }
+  }
+  if (!proxies.empty())
+    VAST_DEBUG(self, "shares", proxies.size(), "lookups across", pqms.size(),
+               "queries");
+}
+
+void index_state::enqueue_query(query_request request) {
+  query_batch.push_back(std::move(request));
+  if (query_batch_window == duration::zero())
+    run_batch();
+  else if (query_batch.size() == 1)
+    self->delayed_send(self, query_batch_window, atom::batch_v);
+}
+
+void index_state::run_batch() {
+  auto batch = std::exchange(query_batch, {});
+  if (batch.empty())
+    return;
+  VAST_DEBUG(self, "evaluates a batch of", batch.size(), "queries");
+  std::vector<lookup_state*> lookups;
+  lookups.reserve(batch.size());
+  for (auto& request : batch)
+    lookups.push_back(&request.lookup);
+  auto pqms = build_query_maps(lookups, taste_partitions);
+  share_lookups(pqms);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    auto& [lookup, client, promise] = batch[i];
+    auto& pqm = pqms[i];
+    if (pqm.empty()) {
+      VAST_ASSERT(lookup.partitions.empty());
+      VAST_DEBUG(self, "returns without result: no partitions qualify");
+      promise.deliver(uuid::nil(), uint32_t{0}, uint32_t{0});
+      self->send(client, atom::done_v);
+      continue;
+    }
+    auto hits = pqm.size() + lookup.partitions.size();
+    auto scheduling = std::min(size_t{taste_partitions}, hits);
+    // Allows the client to query further results after initial taste, unless
+    // we don't have more hits.
+    auto query_id = scheduling == hits ? uuid::nil() : uuid::random();
+    promise.deliver(query_id, detail::narrow<uint32_t>(hits),
+                    detail::narrow<uint32_t>(scheduling));
+    auto qm = launch_evaluators(std::move(pqm), lookup.expr);
+    VAST_DEBUG(self, "scheduled", qm.size(), "/", hits,
+               "partitions for query", lookup.expr);
+    prefetch(lookup);
+    // Queue one task per partition for the query supervisors.
+    scheduler.add(query_id, lookup.priority, lookup.expr, client,
+                  std::move(qm));
+    if (!lookup.partitions.empty()) {
+      [[maybe_unused]] auto result
+        = pending.emplace(query_id, std::move(lookup));
+      VAST_ASSERT(result.second);
+    }
+  }
+  dispatch_tasks();
+}
+
+void index_state::dispatch_tasks() {
+  scheduler.dispatch([&](const caf::actor& worker, const expression& expr,
+                         query_map qm, const caf::actor& client) {
+    self->send(worker, expr, std::move(qm), client);
+  });
+}
+
 query_map
 index_state::launch_evaluators(pending_query_map pqm, expression expr) {
   query_map result;
   for (auto& [id, eval] : pqm) {
-    std::vector<caf::actor> xs{self->spawn(evaluator, expr, std::move(eval))};
+    auto& [triples, estimates] = eval;
+    std::vector<caf::actor> xs{self->spawn(evaluator, expr, std::move(triples),
+                                           std::move(estimates))};
     result.emplace(id, std::move(xs));
   }
   return result;
 }
 
+void index_state::send_report() {
+  if (!accountant)
+    return;
+  // Report the counters since the last report.
+  report r;
+  auto& stats = cached_predicates.stats();
+  auto hits = stats.hits - reported_predicate_stats.hits;
+  auto misses = stats.misses - reported_predicate_stats.misses;
+  reported_predicate_stats = stats;
+  if (hits + misses > 0) {
+    auto hit_rate = static_cast<double>(hits) / (hits + misses);
+    r.push_back({"index.predicate-cache.hits", hits});
+    r.push_back({"index.predicate-cache.misses", misses});
+    r.push_back({"index.predicate-cache.hit-rate", hit_rate});
+  }
+  auto& task_stats = scheduler.stats();
+  auto completed = task_stats.completed - reported_scheduler_stats.completed;
+  if (completed > 0) {
+    auto wait_time = task_stats.wait_time - reported_scheduler_stats.wait_time;
+    auto run_time = task_stats.run_time - reported_scheduler_stats.run_time;
+    r.push_back({"index.queries.tasks", completed});
+    r.push_back({"index.queries.mean-wait-time",
+                 duration{wait_time / completed}});
+    r.push_back({"index.queries.mean-run-time",
+                 duration{run_time / completed}});
+  }
+  reported_scheduler_stats = task_stats;
+  auto depth = scheduler.queue_depth();
+  if (!r.empty() || depth > 0)
+    r.push_back({"index.queries.queue-depth", uint64_t{depth}});
+  if (!r.empty())
+    self->send(accountant, std::move(r));
+}
+
+bool index_state::is_referenced(const uuid& id) const {
+  auto has_id = [&](const lookup_state& lookup) {
+    return std::find(lookup.partitions.begin(), lookup.partitions.end(), id)
+           != lookup.partitions.end();
+  };
+  return prefetching.count(id) > 0 || scheduler.uses(id)
+         || std::any_of(pending.begin(), pending.end(),
+                        [&](auto& kvp) { return has_id(kvp.second); })
+         || std::any_of(query_batch.begin(), query_batch.end(),
+                        [&](auto& request) { return has_id(request.lookup); });
+}
+
+void index_state::compact() {
+  if (compacting)
+    return;
+  if (compacted) {
+    swap_compacted();
+    return;
+  }
+  // Only partitions with a complete state on disk qualify.
+  std::vector<uuid> persisted;
+  for (auto& id : meta_idx.partitions())
+    if ((active == nullptr || active->id() != id) && !find_unpersisted(id))
+      persisted.push_back(id);
+  if (persisted.size() < 2)
+    return;
+  compacting = true;
+  self
+    ->request(compactor, caf::infinite, atom::compact_v, std::move(persisted))
+    .then(
+      [=](uuid& target, std::vector<uuid>& sources) {
+        compacting = false;
+        if (sources.empty())
+          return;
+        VAST_VERBOSE(self, "merged", sources.size(), "partitions into",
+                     target);
+        compacted = std::make_pair(std::move(target), std::move(sources));
+        swap_compacted();
+      },
+      [=](caf::error& err) {
+        compacting = false;
+        VAST_WARNING(self, "failed to compact partitions:",
+                     self->system().render(err));
+      });
+}
+
+void index_state::swap_compacted() {
+  VAST_ASSERT(compacted);
+  auto& [target, sources] = *compacted;
+  // Queries that selected the sources before the swap keep reading them, so
+  // we retry on the next tick.
+  if (std::any_of(sources.begin(), sources.end(),
+                  [&](auto& id) { return is_referenced(id); })) {
+    VAST_DEBUG(self, "defers replacing compacted partitions");
+    return;
+  }
+  if (auto err = meta_idx.replace(sources, target)) {
+    VAST_WARNING(self, "failed to replace compacted partitions:",
+                 self->system().render(err));
+    rm(dir / to_string(target));
+    compacted = caf::none;
+    return;
+  }
+  // The delta file can only add partitions, so we rewrite the meta index.
+  meta_index_compacted = 0;
+  if (auto err = flush_meta_index())
+    VAST_ERROR(self, "failed to persist the meta index:",
+               self->system().render(err));
+  for (auto& id : sources) {
+    cached_partitions.erase(id);
+    take_prefetched(id);
+    if (!rm(dir / to_string(id)))
+      VAST_WARNING(self, "failed to remove compacted partition", id);
+  }
+  compacted_partitions += sources.size();
+  compacted = caf::none;
+}
+
 void index_state::add_flush_listener(caf::actor listener) {
   VAST_DEBUG(self, "adds a new 'flush' subscriber:", listener);
   flush_listeners.emplace_back(std::move(listener));
@@ -396,89 +895,100 @@ void index_state::notify_flush_listeners() {
 }
 
 caf::behavior index(caf::stateful_actor<index_state>* self, const path& dir,
-                    size_t max_partition_size, size_t in_mem_partitions,
-                    size_t taste_partitions, size_t num_workers) {
-  VAST_TRACE(VAST_ARG(dir), VAST_ARG(max_partition_size),
-             VAST_ARG(in_mem_partitions), VAST_ARG(taste_partitions),
-             VAST_ARG(num_workers));
-  VAST_ASSERT(max_partition_size > 0);
-  VAST_ASSERT(in_mem_partitions > 0);
-  VAST_DEBUG(self, "spawned:", VAST_ARG(max_partition_size),
-             VAST_ARG(in_mem_partitions), VAST_ARG(taste_partitions));
-  if (auto err = self->state.init(dir, max_partition_size, in_mem_partitions,
-                                  taste_partitions)) {
+                    index_options opts) {
+  VAST_TRACE(VAST_ARG(dir),
+             VAST_ARG("max_partition_size", opts.max_partition_size),
+             VAST_ARG("in_mem_partitions", opts.in_mem_partitions));
+  VAST_ASSERT(opts.max_partition_size > 0);
+  VAST_ASSERT(opts.in_mem_partitions > 0);
+  VAST_DEBUG(self, "spawned:",
+             VAST_ARG("max_partition_size", opts.max_partition_size),
+             VAST_ARG("in_mem_partitions", opts.in_mem_partitions),
+             VAST_ARG("max_resident_bytes", opts.max_resident_bytes),
+             VAST_ARG("taste_partitions", opts.taste_partitions));
+  // The indexing engine must be known before the first partition exists.
+  self->state.indexing_threads = opts.indexing_threads;
+  self->state.bitmap = opts.bitmap;
+  if (opts.indexing_threads > 1)
+    self->state.indexing_pool
+      = std::make_unique<detail::thread_pool>(opts.indexing_threads - 1);
+  if (opts.indexing_threads > 0 && opts.flush_threads > 0)
+    self->state.flush_pool
+      = std::make_unique<detail::thread_pool>(opts.flush_threads);
+  if (auto err = self->state.init(dir, opts.max_partition_size,
+                                  opts.in_mem_partitions,
+                                  opts.max_resident_bytes,
+                                  opts.taste_partitions)) {
     self->quit(std::move(err));
     return {};
   }
+  // Set after loading the meta index, which restores the persisted options.
+  put(self->state.meta_idx.factory_options(), "max-synopsis-size",
+      opts.max_synopsis_size);
+  if (opts.meta_index_threads == 0)
+    opts.meta_index_threads = std::thread::hardware_concurrency();
+  self->state.meta_idx.parallelism(opts.meta_index_threads);
+  self->state.prefetch_partitions = opts.prefetch_partitions;
+  if (opts.prefetch_partitions > 0)
+    self->state.filesystem = self->spawn<caf::linked>(posix_filesystem, dir);
+  self->state.query_batch_window = opts.query_batch_window;
+  self->state.cached_predicates
+    = predicate_cache{opts.max_predicate_cache_bytes};
+  // Merging partitions reads and writes whole columns, which would block the
+  // INDEX for too long.
+  self->state.compaction_interval = opts.compaction_interval;
+  if (opts.compaction_interval > duration::zero()) {
+    self->state.compactor = self->spawn<caf::linked + caf::detached>(
+      compactor, dir, opts.max_partition_size, opts.compaction_rate,
+      opts.bitmap);
+    self->delayed_send(self, opts.compaction_interval, atom::compact_v);
+  }
   self->set_exit_handler([=](const caf::exit_msg& msg) {
     VAST_DEBUG(self, "got EXIT from", msg.source);
     self->quit(msg.reason);
   });
-  // Launch workers for resolving queries.
-  for (size_t i = 0; i < num_workers; ++i)
+  // Launch workers for resolving queries. The workers register themselves at
+  // the scheduler once they start.
+  for (size_t i = 0; i < opts.num_workers; ++i)
     self->spawn(query_supervisor, self);
-  // We switch between has_worker behavior and the default behavior (which
-  // simply waits for a worker).
-  self->set_default_handler(caf::skip);
-  self->state.has_worker.assign(
+  auto handle_query = [=](expression& expr, query_priority priority) {
+    auto respond = [&](auto&&... xs) {
+      auto mid = self->current_message_id();
+      unsafe_response(self, self->current_sender(), {}, mid.response_id(),
+                      std::forward<decltype(xs)>(xs)...);
+    };
+    // Sanity check.
+    if (self->current_sender() == nullptr) {
+      VAST_ERROR(self, "got an anonymous query (ignored)");
+      respond(caf::sec::invalid_argument);
+      return;
+    }
+    auto& st = self->state;
+    auto client = caf::actor_cast<caf::actor>(self->current_sender());
+    // Convenience function for dropping out without producing hits. Makes
+    // sure that clients always receive a 'done' message.
+    auto no_result = [&] {
+      respond(uuid::nil(), uint32_t{0}, uint32_t{0});
+      self->send(client, atom::done_v);
+    };
+    // Get all potentially matching partitions.
+    auto candidates = st.meta_idx.lookup(expr);
+    // Report no result if no candidates are found.
+    if (candidates.empty()) {
+      VAST_DEBUG(self, "returns without result: no partitions qualify");
+      no_result();
+      return;
+    }
+    st.enqueue_query({index_state::lookup_state{expr, std::move(candidates),
+                                                priority},
+                      client, self->make_response_promise()});
+  };
+  return {
     [=](expression& expr) {
-      auto respond = [&](auto&&... xs) {
-        auto mid = self->current_message_id();
-        unsafe_response(self, self->current_sender(), {}, mid.response_id(),
-                        std::forward<decltype(xs)>(xs)...);
-      };
-      // Sanity check.
-      if (self->current_sender() == nullptr) {
-        VAST_ERROR(self, "got an anonymous query (ignored)");
-        respond(caf::sec::invalid_argument);
-        return;
-      }
-      auto& st = self->state;
-      auto client = caf::actor_cast<caf::actor>(self->current_sender());
-      // Convenience function for dropping out without producing hits. Makes
-      // sure that clients always receive a 'done' message.
-      auto no_result = [&] {
-        respond(uuid::nil(), uint32_t{0}, uint32_t{0});
-        self->send(client, atom::done_v);
-      };
-      // Get all potentially matching partitions.
-      auto candidates = st.meta_idx.lookup(expr);
-      // Report no result if no candidates are found.
-      if (candidates.empty()) {
-        VAST_DEBUG(self, "returns without result: no partitions qualify");
-        no_result();
-        return;
-      }
-      // Allows the client to query further results after initial taste.
-      auto query_id = uuid::random();
-      auto lookup = index_state::lookup_state{expr, std::move(candidates)};
-      auto pqm = st.build_query_map(lookup, st.taste_partitions);
-      if (pqm.empty()) {
-        VAST_ASSERT(lookup.partitions.empty());
-        VAST_DEBUG(self, "returns without result: no partitions qualify");
-        no_result();
-        return;
-      }
-      auto hits = pqm.size() + lookup.partitions.size();
-      auto scheduling = std::min(taste_partitions, hits);
-      // Notify the client that we don't have more hits.
-      if (scheduling == hits)
-        query_id = uuid::nil();
-      respond(query_id, detail::narrow<uint32_t>(hits),
-              detail::narrow<uint32_t>(scheduling));
-      auto qm = st.launch_evaluators(pqm, expr);
-      VAST_DEBUG(self, "scheduled", qm.size(), "/", hits,
-                 "partitions for query", expr);
-      if (!lookup.partitions.empty()) {
-        [[maybe_unused]] auto result
-          = st.pending.emplace(query_id, std::move(lookup));
-        VAST_ASSERT(result.second);
-      }
-      // Delegate to query supervisor (uses up this worker) and report
-      // query ID + some stats to the client.
-      self->send(st.next_worker(), std::move(expr), std::move(qm), client);
-      if (!st.worker_available())
-        self->unbecome();
+      handle_query(expr, query_priority::interactive);
+    },
+    [=](atom::background, expression& expr) {
+      handle_query(expr, query_priority::background);
     },
     [=](const uuid& query_id, uint32_t num_partitions) {
       auto& st = self->state;
@@ -486,6 +996,7 @@ caf::behavior index(caf::stateful_actor<index_state>* self, const path& dir,
       if (num_partitions == 0) {
         VAST_DEBUG(self, "dropped remaining results for query ID", query_id);
         st.pending.erase(query_id);
+        st.scheduler.cancel(query_id);
         return;
       }
       // Sanity checks.
@@ -509,18 +1020,49 @@ caf::behavior index(caf::stateful_actor<index_state>* self, const path& dir,
         return;
       }
       auto qm = st.launch_evaluators(pqm, iter->second.expr);
-      // Delegate to query supervisor (uses up this worker) and report
-      // query ID + some stats to the client.
+      st.prefetch(iter->second);
       VAST_DEBUG(self, "schedules", qm.size(), "more partition(s) for query",
                  iter->first, "with", iter->second.partitions.size(),
                  "remaining");
-      self->send(st.next_worker(), iter->second.expr, std::move(qm), client);
+      st.scheduler.add(query_id, iter->second.priority, iter->second.expr,
+                       client, std::move(qm));
+      st.dispatch_tasks();
       // Cleanup if we exhausted all candidates.
       if (iter->second.partitions.empty())
         st.pending.erase(iter);
     },
     [=](atom::worker, caf::actor& worker) {
-      self->state.idle_workers.emplace_back(std::move(worker));
+      auto& st = self->state;
+      // Tell the client once the worker completed the last partition of its
+      // query.
+      if (auto client = st.scheduler.release(std::move(worker)))
+        self->send(client, atom::done_v);
+      st.dispatch_tasks();
+    },
+    [=](atom::batch) { self->state.run_batch(); },
+    [=](atom::compact) {
+      self->state.compact();
+      self->delayed_send(self, self->state.compaction_interval,
+                         atom::compact_v);
+    },
+    [=](atom::store, const uuid& partition_id, std::string& column,
+        curried_predicate& pred, ids& hits) {
+      self->state.cached_predicates.add(
+        {partition_id, std::move(column), std::move(pred)}, std::move(hits));
+    },
+    [=](atom::store, const uuid& partition_id, std::string& column,
+        curried_predicate& pred, const caf::error& err) {
+      VAST_DEBUG(self, "got failed lookup for", column, ':', err);
+      self->state.cached_predicates.abort(
+        {partition_id, std::move(column), std::move(pred)});
+    },
+    [=](atom::erase, const ids& xs) {
+      self->state.cached_predicates.invalidate(xs);
+    },
+    [=](atom::telemetry) {
+      self->state.send_report();
+      self->delayed_send(self, defaults::system::telemetry_rate,
+                         atom::telemetry_v);
     },
     [=](atom::done, uuid partition_id) {
       self->state.decrement_indexer_count(partition_id);
@@ -529,35 +1071,18 @@ caf::behavior index(caf::stateful_actor<index_state>* self, const path& dir,
       VAST_DEBUG(self, "got a new source");
       return self->state.stage->add_inbound_path(in);
     },
+    [=](accountant_type accountant) {
+      namespace defs = defaults::system;
+      self->state.accountant = std::move(accountant);
+      self->send(self->state.accountant, atom::announce_v, "index");
+      self->delayed_send(self, defs::telemetry_rate, atom::telemetry_v);
+    },
     [=](atom::status, status_verbosity v) -> caf::config_value::dictionary {
       return self->state.status(v);
     },
     [=](atom::subscribe, atom::flush, caf::actor& listener) {
       self->state.add_flush_listener(std::move(listener));
-    });
-  return {[=](atom::worker, caf::actor& worker) {
-            auto& st = self->state;
-            st.idle_workers.emplace_back(std::move(worker));
-            self->become(caf::keep_behavior, st.has_worker);
-          },
-          [=](atom::done, uuid partition_id) {
-            self->state.decrement_indexer_count(partition_id);
-          },
-          [=](caf::stream<table_slice_ptr> in) {
-            VAST_DEBUG(self, "got a new source");
-            return self->state.stage->add_inbound_path(in);
-          },
-          [=](accountant_type accountant) {
-            namespace defs = defaults::system;
-            self->state.accountant = std::move(accountant);
-            self->send(self->state.accountant, atom::announce_v, "index");
-            self->delayed_send(self, defs::telemetry_rate, atom::telemetry_v);
-          },
-          [=](atom::status, status_verbosity v)
-            -> caf::config_value::dictionary { return self->state.status(v); },
-          [=](atom::subscribe, atom::flush, caf::actor& listener) {
-            self->state.add_flush_listener(std::move(listener));
-          }};
+    }};
 }
 
 } // namespace vast::system
@@ -50,6 +50,10 @@ void indexer_stage_driver::process(downstream_type&, batch_type& slices) {
     st.meta_idx.add(part->id(), *slice);
     part->add(std::move(slice));
   }
+  // Without INDEXER actors, there is no downstream manager that picks up the
+  // slices from the partition.
+  if (st.indexing_threads > 0)
+    st.active->index_inbound();
 }
 
 } // namespace vast::system
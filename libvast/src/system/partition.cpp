@@ -14,11 +14,14 @@
 #include "vast/system/partition.hpp"
 
 #include "vast/aliases.hpp"
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/chunk.hpp"
 #include "vast/concept/hashable/xxhash.hpp"
 #include "vast/concept/printable/to_string.hpp"
 #include "vast/concept/printable/vast/expression.hpp"
 #include "vast/concept/printable/vast/uuid.hpp"
 #include "vast/detail/assert.hpp"
+#include "vast/error.hpp"
 #include "vast/event.hpp"
 #include "vast/expression_visitors.hpp"
 #include "vast/fwd.hpp"
@@ -30,16 +33,28 @@
 #include "vast/system/index.hpp"
 #include "vast/system/index_common.hpp"
 #include "vast/system/indexer_stage_driver.hpp"
+#include "vast/system/predicate_cache.hpp"
+#include "vast/system/shared_lookup.hpp"
 #include "vast/system/spawn_indexer.hpp"
 #include "vast/table_slice_column.hpp"
 #include "vast/time.hpp"
 #include "vast/type.hpp"
+#include "vast/view.hpp"
 
 #include <caf/event_based_actor.hpp>
 #include <caf/local_actor.hpp>
 #include <caf/make_counted.hpp>
+#include <caf/optional.hpp>
+#include <caf/send.hpp>
+#include <caf/streambuf.hpp>
 #include <caf/stateful_actor.hpp>
 
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <string_view>
+#include <unordered_map>
+
 using namespace std::chrono;
 using namespace caf;
 
@@ -69,8 +84,19 @@ caf::error partition::init() {
   auto file_path = meta_file();
   if (!exists(file_path))
     return ec::no_such_file;
+  auto chk = chunk::mmap(file_path);
+  if (!chk)
+    return make_error(ec::filesystem_error, "failed to mmap", file_path.str());
+  return init(std::move(chk));
+}
+
+caf::error partition::init(chunk_ptr meta) {
+  VAST_TRACE("");
+  VAST_ASSERT(meta != nullptr);
+  // The stream buffer only reads from the chunk.
+  caf::arraybuf<char> buf{const_cast<char*>(meta->data()), meta->size()};
   auto partition_type = record_type{};
-  if (auto err = load(nullptr, file_path, meta_data_, partition_type))
+  if (auto err = load(nullptr, buf, meta_data_, partition_type))
     return err;
   VAST_DEBUG(state_->self, "loaded partition", id_, "from disk with",
              meta_data_.layouts.size(), "layouts and",
@@ -84,6 +110,15 @@ caf::error partition::init() {
 }
 
 caf::error partition::flush_to_disk() {
+  // In-place column indexes have no INDEXER that persists them for us.
+  for (auto& kvp : indexers_) {
+    auto& ip = kvp.second;
+    if (!ip.column)
+      continue;
+    std::lock_guard<std::mutex> guard{*ip.column_mutex};
+    if (auto err = ip.column->flush_to_disk())
+      return err;
+  }
   if (meta_data_.dirty) {
     // Write all layouts to disk.
     if (auto err = save(nullptr, meta_file(), meta_data_, combined_type()))
@@ -93,6 +128,33 @@ caf::error partition::flush_to_disk() {
   return caf::none;
 }
 
+size_t partition::flush_columns(detail::thread_pool& pool) {
+  auto index_actor = caf::actor_cast<caf::actor>(state_->self);
+  size_t result = 0;
+  for (auto& kvp : indexers_) {
+    auto& ip = kvp.second;
+    if (!ip.column)
+      continue;
+    // The partition stays among the unpersisted partitions of the INDEX
+    // until the last column reports back, so the pointers remain valid.
+    pool.submit([index_actor, id = id_, col = ip.column.get(),
+                 mtx = ip.column_mutex.get()] {
+      std::unique_lock<std::mutex> guard{*mtx};
+      if (auto err = col->flush_to_disk()) {
+        // Without 'done' the partition never gets its manifest; the INDEX
+        // retries when it flushes all of its state on shutdown.
+        VAST_ERROR_ANON(__func__, "failed to persist", col->filename(), ":",
+                        render(std::move(err)));
+        return;
+      }
+      guard.unlock();
+      caf::anon_send(index_actor, atom::done_v, id);
+    });
+    ++result;
+  }
+  return result;
+}
+
 caf::actor& partition::indexer_at(size_t position) {
   VAST_ASSERT(position < indexers_.size());
   auto& [fqf, ip] = as_vector(indexers_)[position];
@@ -128,6 +190,21 @@ void partition::add(table_slice_ptr slice) {
         // Spawn a new indexer.
         auto k = indexers_.emplace(fqf, wrapped_indexer{});
         auto& ip = k.first->second;
+        if (state_->indexing_threads > 0) {
+          // Index the column in place.
+          auto col = make_column_index(state_->self->system(),
+                                       column_file(fqf), fqf.type,
+                                       state_->value_index_options());
+          if (!col)
+            VAST_ERROR(state_->self, "failed to create column index for",
+                       fqf.fqn(), ":",
+                       state_->self->system().render(col.error()));
+          else {
+            ip.column = std::move(*col);
+            ip.column_mutex = std::make_unique<std::mutex>();
+          }
+          continue;
+        }
         ip.indexer
           = state().make_indexer(column_file(fqf), fqf.type, id(), fqf.fqn());
         state_->active_partition_indexers++;
@@ -146,6 +223,66 @@ void partition::add(table_slice_ptr slice) {
   inbound_.push_back(std::move(slice));
 }
 
+void partition::index_inbound() {
+  VAST_ASSERT(state_->indexing_threads > 0);
+  if (inbound_.empty())
+    return;
+  // Gather the target column index for every column of every slice.
+  std::vector<std::pair<column_index*, table_slice_column>> columns;
+  for (auto& slice : inbound_) {
+    auto& layout = slice->layout();
+    for (size_t i = 0; i < layout.fields.size(); ++i) {
+      auto fqf = qualified_record_field{layout.name(), layout.fields[i]};
+      auto destination = indexers_.find(fqf);
+      if (destination == indexers_.end() || !destination->second.column)
+        continue;
+      columns.emplace_back(destination->second.column.get(),
+                           table_slice_column{slice, i});
+    }
+  }
+  // Group by column index so that each one ends up in a single shard, while
+  // retaining the order of slices within each column.
+  std::stable_sort(columns.begin(), columns.end(),
+                   [](auto& x, auto& y) { return x.first < y.first; });
+  auto index_range = [](auto first, auto last) {
+    for (auto i = first; i != last; ++i)
+      i->first->add(i->second);
+  };
+  auto t = timer::start(state_->indexing_measurement);
+  auto& pool = state_->indexing_pool;
+  if (pool == nullptr || columns.size() < 2) {
+    index_range(columns.begin(), columns.end());
+  } else {
+    // Split into roughly equally sized shards and move their boundaries
+    // forward until they fall between two different column indexes.
+    auto num_shards = std::min(pool->size() + 1, columns.size());
+    auto shard_size = columns.size() / num_shards;
+    std::vector<std::future<void>> futures;
+    auto first = columns.begin();
+    while (first != columns.end()) {
+      auto last = columns.end();
+      if (static_cast<size_t>(last - first) > shard_size) {
+        last = first + shard_size;
+        while (last != columns.end() && last->first == (last - 1)->first)
+          ++last;
+      }
+      if (last == columns.end())
+        index_range(first, last); // The last shard runs on this thread.
+      else
+        futures.push_back(
+          pool->submit([=, &index_range] { index_range(first, last); }));
+      first = last;
+    }
+    for (auto& f : futures)
+      f.get();
+  }
+  auto events = uint64_t{0};
+  for (auto& slice : inbound_)
+    events += slice->rows();
+  t.stop(events);
+  inbound_.clear();
+}
+
 record_type partition::combined_type() const {
   record_type result;
   for (auto& kvp : indexers_) {
@@ -155,8 +292,7 @@ record_type partition::combined_type() const {
 }
 
 caf::actor partition::fetch_indexer(const data_extractor& dx,
-                                    [[maybe_unused]] relational_operator op,
-                                    [[maybe_unused]] const data& x) {
+                                    relational_operator op, const data& x) {
   VAST_TRACE(VAST_ARG(dx), VAST_ARG(op), VAST_ARG(x));
   // Sanity check.
   if (dx.offset.empty())
@@ -169,6 +305,23 @@ caf::actor partition::fetch_indexer(const data_extractor& dx,
     VAST_DEBUG(state_->self, "got invalid offset for record type", dx.type);
     return nullptr;
   }
+  VAST_ASSERT(*index < indexers_.size());
+  if (auto& ip = as_vector(indexers_)[*index].second; ip.column) {
+    // The column lives in this partition, so we can answer right away and
+    // lift the result into an actor like for type queries below. Lookups
+    // modify the bitmaps lazily, so they must not overlap with a flush.
+    auto row_ids = [&] {
+      std::lock_guard<std::mutex> guard{*ip.column_mutex};
+      return ip.column->lookup(op, make_view(x));
+    }();
+    return state_->self->spawn([row_ids]() -> caf::behavior {
+      return [=](const curried_predicate&) -> caf::result<ids> {
+        if (!row_ids)
+          return row_ids.error();
+        return *row_ids;
+      };
+    });
+  }
   return indexer_at(*index);
 }
 
@@ -193,6 +346,49 @@ caf::actor partition::fetch_indexer(const attribute_extractor& ex,
   return nullptr;
 }
 
+caf::actor partition::fetch_cached(const data_extractor& dx,
+                                   const curried_predicate& pred,
+                                   caf::actor indexer) {
+  auto& cache = state_->cached_predicates;
+  if (cache.capacity() == 0)
+    return indexer;
+  auto index = caf::get<record_type>(dx.type).flat_index_at(dx.offset);
+  VAST_ASSERT(index && *index < indexers_.size());
+  auto column = as_vector(indexers_)[*index].first.fqn();
+  auto key = predicate_cache::make_key(id_, std::move(column), pred);
+  if (auto hits = cache.lookup(key)) {
+    // Lift the cached result into an actor like for type queries.
+    return state_->self->spawn([row_ids = *hits]() -> caf::behavior {
+      return [=](const curried_predicate&) { return row_ids; };
+    });
+  }
+  // Share a lookup that another query started already.
+  if (auto proxy = caf::actor_cast<caf::actor>(cache.in_flight(key)))
+    return proxy;
+  auto index_actor = caf::actor_cast<caf::actor>(state_->self);
+  // The INDEX either caches the hits or forgets about the failed lookup.
+  auto on_result = [=](const caf::expected<ids>& hits) {
+    if (hits)
+      caf::anon_send(index_actor, atom::store_v, key.partition, key.column,
+                     key.predicate, *hits);
+    else
+      caf::anon_send(index_actor, atom::store_v, key.partition, key.column,
+                     key.predicate, hits.error());
+  };
+  auto proxy = state_->self->spawn(
+    shared_lookup, std::move(indexer), pred,
+    std::function<void(const caf::expected<ids>&)>{on_result});
+  cache.in_flight(key, proxy.address());
+  return proxy;
+}
+
+bool partition::immutable() const {
+  if (state_->active.get() == this)
+    return false;
+  return std::none_of(state_->unpersisted.begin(), state_->unpersisted.end(),
+                      [&](auto& kvp) { return kvp.first.get() == this; });
+}
+
 evaluation_triples partition::eval(const expression& expr) {
   evaluation_triples result;
   // Pretend the partition is a table, and return fitted predicates for the
@@ -210,7 +406,10 @@ evaluation_triples partition::eval(const expression& expr) {
         return get_indexer_handle(ex, x);
       },
       [&](const data_extractor& dx, const data& x) {
-        return get_indexer_handle(dx, x);
+        auto hdl = get_indexer_handle(dx, x);
+        if (hdl && immutable())
+          return fetch_cached(dx, curried(pred), std::move(hdl));
+        return hdl;
       },
       [](const auto&, const auto&) {
         return caf::actor{}; // clang-format fix
@@ -224,16 +423,72 @@ evaluation_triples partition::eval(const expression& expr) {
   return result;
 }
 
+selectivity_estimates
+partition::estimate_selectivity(const expression& expr) const {
+  selectivity_estimates result;
+  // Count the rows per layout; this is all we know about a partition without
+  // asking its INDEXER actors.
+  std::unordered_map<std::string_view, double> layout_rows;
+  double total_rows = 0;
+  for (auto& [name, row_ids] : meta_data_.type_ids) {
+    auto n = static_cast<double>(rank(row_ids));
+    layout_rows.emplace(name, n);
+    total_rows += n;
+  }
+  if (total_rows == 0)
+    return result;
+  auto fraction = [&](double rows) { return rows / total_rows; };
+  auto& fields = as_vector(indexers_);
+  using estimate = caf::optional<double>;
+  for (auto& kvp : resolve(expr, combined_type())) {
+    auto& pred = kvp.second;
+    auto v = detail::overload(
+      [&](const attribute_extractor& ex, const data& x) -> estimate {
+        if (ex.attr != atom::type_v)
+          return caf::none;
+        double rows = 0;
+        for (auto& [name, n] : layout_rows)
+          if (evaluate(std::string{name}, pred.op, x))
+            rows += n;
+        return fraction(rows);
+      },
+      [&](const data_extractor& dx, const data&) -> estimate {
+        auto index = caf::get<record_type>(dx.type).flat_index_at(dx.offset);
+        if (!index || *index >= fields.size())
+          return caf::none;
+        auto i = layout_rows.find(fields[*index].first.layout_name);
+        if (i == layout_rows.end())
+          return caf::none;
+        return fraction(i->second) * default_selectivity(pred.op);
+      },
+      [](const auto&, const auto&) -> estimate { return caf::none; });
+    if (auto x = caf::visit(v, pred.lhs, pred.rhs))
+      result.emplace(kvp.first, *x);
+  }
+  return result;
+}
+
 path partition::base_dir() const {
   return state_->dir / to_string(id_);
 }
 
 path partition::meta_file() const {
-  return base_dir() / "meta";
+  return partition_meta_file(base_dir());
 }
 
 path partition::column_file(const qualified_record_field& field) const {
-  return base_dir() / (field.fqn() + "-" + to_digest(field.type));
+  return partition_column_file(base_dir(), field);
+}
+
+// -- free functions -----------------------------------------------------------
+
+path partition_meta_file(const path& base_dir) {
+  return base_dir / "meta";
+}
+
+path partition_column_file(const path& base_dir,
+                           const qualified_record_field& field) {
+  return base_dir / (field.fqn() + "-" + to_digest(field.type));
 }
 
 } // namespace vast::system
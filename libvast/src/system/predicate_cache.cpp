@@ -0,0 +1,137 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/system/predicate_cache.hpp"
+
+#include "vast/bitmap.hpp"
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/data.hpp"
+#include "vast/detail/assert.hpp"
+#include "vast/detail/overload.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace vast::system {
+
+bool operator==(const predicate_cache::key& x, const predicate_cache::key& y) {
+  return x.partition == y.partition && x.column == y.column
+         && x.predicate.op == y.predicate.op
+         && x.predicate.rhs == y.predicate.rhs;
+}
+
+size_t predicate_cache::key_hash::operator()(const key& x) const {
+  auto combine = [](size_t seed, size_t h) {
+    return seed ^ (h + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+  };
+  auto result = std::hash<uuid>{}(x.partition);
+  result = combine(result, std::hash<std::string>{}(x.column));
+  result = combine(result, static_cast<size_t>(x.predicate.op));
+  return combine(result, std::hash<data>{}(x.predicate.rhs));
+}
+
+predicate_cache::predicate_cache(size_t capacity) : capacity_{capacity} {
+  // nop
+}
+
+predicate_cache::key
+predicate_cache::make_key(const uuid& partition, std::string column,
+                          const curried_predicate& pred) {
+  auto result = key{partition, std::move(column), pred};
+  // The order of values does not matter for membership tests.
+  if (pred.op == in || pred.op == not_in)
+    if (auto xs = caf::get_if<list>(&result.predicate.rhs)) {
+      std::sort(xs->begin(), xs->end());
+      xs->erase(std::unique(xs->begin(), xs->end()), xs->end());
+    }
+  return result;
+}
+
+size_t predicate_cache::weigh(const ids& x) {
+  auto f = detail::overload(
+    [](const roaring_bitmap& bm) {
+      size_t result = 0;
+      for (auto& c : bm.containers())
+        result += sizeof(c) + c.values.size() * sizeof(uint16_t)
+                  + c.blocks.size() * sizeof(ids::block_type);
+      return result;
+    },
+    [](const auto& bm) {
+      return bm.blocks().size() * sizeof(ids::block_type);
+    });
+  return sizeof(ids) + caf::visit(f, x.get_data());
+}
+
+const ids* predicate_cache::lookup(const key& k) {
+  auto i = index_.find(k);
+  if (i == index_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  // Move the entry to the back of the list to mark it as most recently used.
+  entries_.splice(entries_.end(), entries_, i->second);
+  return &i->second->result;
+}
+
+void predicate_cache::add(key k, ids result) {
+  in_flight_.erase(k);
+  auto w = weigh(result);
+  if (w > capacity_)
+    return;
+  if (auto i = index_.find(k); i != index_.end())
+    erase(i->second);
+  while (weight_ + w > capacity_) {
+    VAST_ASSERT(!entries_.empty());
+    erase(entries_.begin());
+    ++stats_.evictions;
+  }
+  auto i = entries_.insert(entries_.end(), entry{k, std::move(result), w});
+  index_.emplace(std::move(k), i);
+  weight_ += w;
+}
+
+void predicate_cache::invalidate(const ids& xs) {
+  for (auto i = entries_.begin(); i != entries_.end();) {
+    auto overlap = i->result;
+    overlap &= xs;
+    if (any<1>(overlap)) {
+      auto victim = i++;
+      erase(victim);
+      ++stats_.invalidations;
+    } else {
+      ++i;
+    }
+  }
+}
+
+caf::actor_addr predicate_cache::in_flight(const key& k) const {
+  auto i = in_flight_.find(k);
+  return i != in_flight_.end() ? i->second : caf::actor_addr{};
+}
+
+void predicate_cache::in_flight(const key& k, caf::actor_addr addr) {
+  in_flight_.insert_or_assign(k, std::move(addr));
+}
+
+void predicate_cache::abort(const key& k) {
+  in_flight_.erase(k);
+}
+
+void predicate_cache::erase(entry_list::iterator i) {
+  weight_ -= i->weight;
+  index_.erase(i->k);
+  entries_.erase(i);
+}
+
+} // namespace vast::system
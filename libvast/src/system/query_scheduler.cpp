@@ -0,0 +1,128 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/system/query_scheduler.hpp"
+
+#include "vast/detail/assert.hpp"
+
+#include <algorithm>
+
+namespace vast::system {
+
+const char* to_string(query_priority x) {
+  switch (x) {
+    case query_priority::interactive:
+      return "interactive";
+    case query_priority::background:
+      return "background";
+  }
+  return "unknown";
+}
+
+query_scheduler::job_id
+query_scheduler::add(const uuid& query_id, query_priority priority,
+                     expression expr, caf::actor client, query_map qm) {
+  VAST_ASSERT(!qm.empty());
+  auto id = next_id_++;
+  auto& x = jobs_[id];
+  x.query_id = query_id;
+  x.priority = priority;
+  x.expr = std::move(expr);
+  x.client = std::move(client);
+  time now = std::chrono::system_clock::now();
+  for (auto& [partition, evaluators] : qm)
+    x.queued.push_back({partition, std::move(evaluators), now});
+  ready_[static_cast<size_t>(priority)].push_back(id);
+  return id;
+}
+
+void query_scheduler::cancel(const uuid& query_id) {
+  if (query_id == uuid::nil())
+    return;
+  for (auto i = jobs_.begin(); i != jobs_.end();) {
+    auto& x = i->second;
+    if (x.query_id != query_id) {
+      ++i;
+      continue;
+    }
+    x.queued.clear();
+    x.cancelled = true;
+    // The ready rings skip jobs without queued tasks, and release() erases
+    // jobs with running tasks once they complete.
+    if (x.running == 0)
+      i = jobs_.erase(i);
+    else
+      ++i;
+  }
+}
+
+caf::actor query_scheduler::release(caf::actor worker) {
+  caf::actor result;
+  auto pred = [&](const assignment& x) { return x.worker == worker; };
+  auto i = std::find_if(running_.begin(), running_.end(), pred);
+  if (i != running_.end()) {
+    ++stats_.completed;
+    stats_.run_time += std::chrono::system_clock::now() - i->started;
+    auto j = jobs_.find(i->job);
+    VAST_ASSERT(j != jobs_.end());
+    auto& x = j->second;
+    VAST_ASSERT(x.running > 0);
+    if (--x.running == 0 && x.queued.empty()) {
+      if (!x.cancelled)
+        result = std::move(x.client);
+      jobs_.erase(j);
+    }
+    running_.erase(i);
+  }
+  idle_.push_back(std::move(worker));
+  return result;
+}
+
+size_t query_scheduler::queue_depth(query_priority priority) const {
+  size_t result = 0;
+  for (auto& kvp : jobs_)
+    if (kvp.second.priority == priority)
+      result += kvp.second.queued.size();
+  return result;
+}
+
+size_t query_scheduler::queue_depth() const {
+  return queue_depth(query_priority::interactive)
+         + queue_depth(query_priority::background);
+}
+
+bool query_scheduler::uses(const uuid& partition) const {
+  auto running = [&](const assignment& x) { return x.partition == partition; };
+  if (std::any_of(running_.begin(), running_.end(), running))
+    return true;
+  auto queued = [&](const task& x) { return x.partition == partition; };
+  for (auto& kvp : jobs_)
+    if (std::any_of(kvp.second.queued.begin(), kvp.second.queued.end(),
+                    queued))
+      return true;
+  return false;
+}
+
+query_scheduler::job_map::iterator query_scheduler::next_job() {
+  for (auto& ring : ready_) {
+    while (!ring.empty()) {
+      auto i = jobs_.find(ring.front());
+      ring.pop_front();
+      if (i != jobs_.end() && !i->second.queued.empty())
+        return i;
+    }
+  }
+  return jobs_.end();
+}
+
+} // namespace vast::system
@@ -66,10 +66,10 @@ query_supervisor(caf::stateful_actor<query_supervisor_state>* self,
               VAST_DEBUG(self, "collected all results for partition", id);
               self->state.open_requests.erase(id);
               // Ask master for more work after receiving the last sub
-              // result.
+              // result. The master tells the client when all partitions of
+              // its query are done.
               if (self->state.open_requests.empty()) {
                 VAST_DEBUG(self, "collected all results for all partitions");
-                self->send(client, atom::done_v);
                 self->send(master, atom::worker_v, self);
               }
             }
@@ -0,0 +1,57 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/system/shared_lookup.hpp"
+
+#include "vast/logger.hpp"
+
+#include <caf/behavior.hpp>
+#include <caf/event_based_actor.hpp>
+#include <caf/stateful_actor.hpp>
+
+namespace vast::system {
+
+caf::behavior
+shared_lookup(caf::stateful_actor<shared_lookup_state>* self,
+              caf::actor indexer, curried_predicate pred,
+              std::function<void(const caf::expected<ids>&)> on_result) {
+  VAST_TRACE(VAST_ARG(indexer), VAST_ARG(pred));
+  return {[=](const curried_predicate&) -> caf::result<ids> {
+    auto& st = self->state;
+    if (st.result)
+      return *st.result;
+    auto rp = self->make_response_promise<ids>();
+    st.waiting.push_back(rp);
+    if (st.waiting.size() > 1)
+      return rp;
+    auto finish = [=](caf::expected<ids> x) {
+      for (auto& waiting : self->state.waiting) {
+        if (x)
+          waiting.deliver(*x);
+        else
+          waiting.deliver(x.error());
+      }
+      self->state.waiting.clear();
+      if (on_result)
+        on_result(x);
+      if (x)
+        self->state.result = std::move(*x);
+    };
+    self->request(indexer, caf::infinite, pred)
+      .then([=](ids& hits) { finish(std::move(hits)); },
+            [=](caf::error& err) { finish(std::move(err)); });
+    return rp;
+  }};
+}
+
+} // namespace vast::system
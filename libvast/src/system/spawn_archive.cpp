@@ -14,7 +14,9 @@
 #include "vast/system/spawn_archive.hpp"
 
 #include "vast/defaults.hpp"
+#include "vast/error.hpp"
 #include "vast/path.hpp"
+#include "vast/segment_builder.hpp"
 #include "vast/si_literals.hpp"
 #include "vast/system/archive.hpp"
 #include "vast/system/node.hpp"
@@ -31,6 +33,36 @@ using namespace vast::binary_byte_literals;
 
 namespace vast::system {
 
+namespace {
+
+caf::expected<segment_compression>
+get_compression(const caf::settings& options) {
+  namespace sd = vast::defaults::system;
+  segment_compression result;
+  auto method = get_or(options, "compression", sd::compression);
+  if (method == caf::atom("null")) {
+    result.method = compression::null;
+  } else if (method == caf::atom("lz4")) {
+    result.method = compression::lz4;
+  } else if (method == caf::atom("zstd")) {
+#if VAST_HAVE_ZSTD
+    result.method = compression::zstd;
+#else
+    return make_error(ec::invalid_configuration,
+                      "zstd compression requires building with libzstd");
+#endif
+  } else {
+    return make_error(ec::invalid_configuration, "invalid compression",
+                      method);
+  }
+  result.level = get_or(options, "compression-level", sd::compression_level);
+  result.dictionaries = get_or(options, "compression-dictionaries",
+                               sd::compression_dictionaries);
+  return result;
+}
+
+} // namespace
+
 maybe_actor spawn_archive(node_actor* self, spawn_arguments& args) {
   namespace sd = vast::defaults::system;
   if (!args.empty())
@@ -39,7 +71,27 @@ maybe_actor spawn_archive(node_actor* self, spawn_arguments& args) {
   auto mss
     = 1_MiB
       * get_or(args.inv.options, "max-segment-size", sd::max_segment_size);
-  auto actor = self->spawn(archive, args.dir / args.label, segments, mss);
+  auto segment_cache_size
+    = 1_MiB
+      * get_or(args.inv.options, "segment-cache-size", sd::segment_cache_size);
+  auto slice_cache_size
+    = 1_MiB
+      * get_or(args.inv.options, "slice-cache-size", sd::slice_cache_size);
+  auto compression = get_compression(args.inv.options);
+  if (!compression)
+    return compression.error();
+  auto threads = get_or(args.inv.options, "extraction-threads",
+                        sd::extraction_threads);
+  auto sessions = get_or(args.inv.options, "max-extraction-sessions",
+                         sd::max_extraction_sessions);
+  auto batch_size = get_or(args.inv.options, "extraction-batch-size",
+                           sd::extraction_batch_size);
+  if (sessions == 0 || batch_size == 0)
+    return make_error(ec::invalid_configuration,
+                      "extraction sessions and batch size must be positive");
+  auto actor = self->spawn(archive, args.dir / args.label, segments, mss,
+                           segment_cache_size, slice_cache_size, *compression,
+                           threads, sessions, batch_size);
   if (auto accountant = self->state.registry.find_by_label("accountant"))
     self->send(actor, caf::actor_cast<accountant_type>(accountant));
   return caf::actor_cast<caf::actor>(actor);
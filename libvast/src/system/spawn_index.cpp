@@ -17,7 +17,10 @@
 #include <caf/expected.hpp>
 #include <caf/settings.hpp>
 
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/time.hpp"
 #include "vast/defaults.hpp"
+#include "vast/error.hpp"
 #include "vast/system/index.hpp"
 #include "vast/system/node.hpp"
 #include "vast/system/spawn_arguments.hpp"
@@ -31,12 +34,46 @@ maybe_actor spawn_index(node_actor* self, spawn_arguments& args) {
     return get_or(args.inv.options, key, default_value);
   };
   namespace sd = vast::defaults::system;
-  auto idx = self->spawn(
-    index, args.dir / args.label,
-    opt("system.max-partition-size", sd::max_partition_size),
-    opt("system.max-resident-partitions", sd::max_in_mem_partitions),
-    opt("system.max-taste-partitions", sd::taste_partitions),
-    opt("system.max-queries", sd::num_query_supervisors));
+  index_options opts;
+  opts.max_partition_size
+    = opt("system.max-partition-size", sd::max_partition_size);
+  opts.in_mem_partitions
+    = opt("system.max-resident-partitions", sd::max_in_mem_partitions);
+  opts.max_resident_bytes = opt("system.max-resident-partition-bytes",
+                                sd::max_resident_partition_bytes);
+  opts.taste_partitions
+    = opt("system.max-taste-partitions", sd::taste_partitions);
+  opts.prefetch_partitions
+    = opt("system.prefetch-partitions", sd::prefetch_partitions);
+  opts.num_workers = opt("system.max-queries", sd::num_query_supervisors);
+  opts.meta_index_threads
+    = opt("system.meta-index-threads", sd::meta_index_threads);
+  opts.indexing_threads = opt("system.indexing-threads", sd::indexing_threads);
+  if (auto str = caf::get_if<std::string>(&args.inv.options,
+                                          "system.query-batch-window")) {
+    auto parsed = to<duration>(*str);
+    if (!parsed)
+      return parsed.error();
+    opts.query_batch_window = *parsed;
+  }
+  opts.max_predicate_cache_bytes
+    = opt("system.max-predicate-cache-bytes", sd::max_predicate_cache_bytes);
+  if (auto str = caf::get_if<std::string>(&args.inv.options,
+                                          "system.compaction-interval")) {
+    auto parsed = to<duration>(*str);
+    if (!parsed)
+      return parsed.error();
+    opts.compaction_interval = *parsed;
+  }
+  opts.compaction_rate = opt("system.compaction-rate", sd::compaction_rate);
+  opts.flush_threads = opt("system.flush-threads", sd::flush_threads);
+  opts.bitmap = opt("system.index-bitmap", sd::index_bitmap);
+  if (opts.bitmap != caf::atom("ewah") && opts.bitmap != caf::atom("roaring"))
+    return make_error(ec::invalid_configuration, "invalid index bitmap",
+                      opts.bitmap);
+  opts.max_synopsis_size
+    = opt("system.max-synopsis-size", sd::max_synopsis_size);
+  auto idx = self->spawn(index, args.dir / args.label, opts);
   if (auto accountant = self->state.registry.find_by_label("accountant"))
     self->send(idx, caf::actor_cast<accountant_type>(accountant));
   return idx;
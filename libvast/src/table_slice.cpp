@@ -23,8 +23,10 @@
 #include "vast/error.hpp"
 #include "vast/event.hpp"
 #include "vast/factory.hpp"
+#include "vast/fbs/utils.hpp"
 #include "vast/format/test.hpp"
 #include "vast/logger.hpp"
+#include "vast/synopsis.hpp"
 #include "vast/table_slice_builder.hpp"
 #include "vast/table_slice_factory.hpp"
 #include "vast/value.hpp"
@@ -55,6 +57,21 @@ auto cap (size_type pos, size_type num, size_type last) {
   return num == table_slice::npos ? last : std::min(last, pos + num);
 }
 
+template <class T>
+void append_column_batch(const table_slice& slice, size_type col,
+                         synopsis& syn) {
+  std::vector<view<T>> xs;
+  xs.reserve(slice.rows());
+  for (size_type row = 0; row < slice.rows(); ++row) {
+    auto x = slice.at(row, col);
+    if (auto y = caf::get_if<view<T>>(&x))
+      xs.push_back(*y);
+    else
+      VAST_ASSERT(caf::holds_alternative<caf::none_t>(x));
+  }
+  syn.add_batch(span<const view<T>>{xs});
+}
+
 } // namespace <anonymous>
 
 table_slice::column_view::column_view(const table_slice& slice, size_t column)
@@ -121,8 +138,7 @@ table_slice::column(std::string_view name) const {
 // TODO: this function will boil down to accessing the chunk inside the table
 // slice and then calling GetTableSlice(buf). But until we touch the table
 // slice internals, we use this helper.
-caf::expected<flatbuffers::Offset<fbs::TableSliceBuffer>>
-pack(flatbuffers::FlatBufferBuilder& builder, table_slice_ptr x) {
+caf::expected<chunk_ptr> pack(table_slice_ptr x) {
   // This local builder instance will vanish once we can access the underlying
   // chunk of a table slice.
   flatbuffers::FlatBufferBuilder local_builder;
@@ -158,21 +174,44 @@ pack(flatbuffers::FlatBufferBuilder& builder, table_slice_ptr x) {
   table_slice_builder.add_data(data);
   auto flat_slice = table_slice_builder.Finish();
   local_builder.Finish(flat_slice);
-  auto buffer = span<const uint8_t>{local_builder.GetBufferPointer(),
-                                    local_builder.GetSize()};
-  // This is the only code that will remain. All the stuff above will move into
-  // the respective table slice builders.
-  auto bytes = builder.CreateVector(buffer.data(), buffer.size());
+  return fbs::release(local_builder);
+}
+
+caf::expected<flatbuffers::Offset<fbs::TableSliceBuffer>>
+pack(flatbuffers::FlatBufferBuilder& builder, table_slice_ptr x) {
+  auto flat_slice = pack(std::move(x));
+  if (!flat_slice)
+    return flat_slice.error();
+  auto buffer = as_bytes(*flat_slice);
+  auto bytes = builder.CreateVector(
+    reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
   fbs::TableSliceBufferBuilder table_slice_buffer_builder{builder};
   table_slice_buffer_builder.add_data(bytes);
   return table_slice_buffer_builder.Finish();
 }
 
 // TODO: The dual to the note above applies here.
-caf::error unpack(const fbs::TableSlice& x, table_slice_ptr& y) {
+caf::error unpack(const fbs::TableSlice& x, table_slice_ptr& y,
+                  chunk_ptr chunk) {
   auto ptr = reinterpret_cast<const char*>(x.data()->Data());
-  caf::binary_deserializer source{nullptr, ptr, x.data()->size()};
-  return source(y);
+  if (!chunk) {
+    caf::binary_deserializer source{nullptr, ptr, x.data()->size()};
+    return source(y);
+  }
+  VAST_ASSERT(ptr >= chunk->data());
+  VAST_ASSERT(ptr + x.data()->size() <= chunk->data() + chunk->size());
+  auto offset = static_cast<size_t>(ptr - chunk->data());
+  // The data has the same layout as a serialized table slice chunk, so the
+  // factory lets the table slice implementation reference it in place.
+  auto data = chunk->slice(offset, x.data()->size());
+  y = factory_traits<table_slice>::make(std::move(data));
+  if (!y)
+    return make_error(ec::format_error, "failed to load table slice");
+  return caf::none;
+}
+
+caf::error unpack(const fbs::TableSlice& x, table_slice_ptr& y) {
+  return unpack(x, y, nullptr);
 }
 
 caf::error table_slice::load(chunk_ptr chunk) {
@@ -188,6 +227,27 @@ void table_slice::append_column_to_index(size_type col,
     idx.append(at(row, col), offset() + row);
 }
 
+void table_slice::append_column_to_synopsis(size_type col,
+                                            synopsis& syn) const {
+  auto f = detail::overload(
+    [&](const integer_type&) { append_column_batch<integer>(*this, col, syn); },
+    [&](const count_type&) { append_column_batch<count>(*this, col, syn); },
+    [&](const real_type&) { append_column_batch<real>(*this, col, syn); },
+    [&](const time_type&) { append_column_batch<time>(*this, col, syn); },
+    [&](const address_type&) { append_column_batch<address>(*this, col, syn); },
+    [&](const string_type&) {
+      append_column_batch<std::string>(*this, col, syn);
+    },
+    [&](const auto&) {
+      for (size_type row = 0; row < rows(); ++row) {
+        auto x = at(row, col);
+        if (!caf::holds_alternative<caf::none_t>(x))
+          syn.add(std::move(x));
+      }
+    });
+  caf::visit(f, layout().fields[col].type);
+}
+
 caf::expected<std::vector<table_slice_ptr>>
 make_random_table_slices(size_t num_slices, size_t slice_size,
                          record_type layout, id offset, size_t seed) {
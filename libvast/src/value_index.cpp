@@ -19,6 +19,7 @@
 #include <caf/settings.hpp>
 
 #include <cmath>
+#include <typeinfo>
 
 namespace vast {
 
@@ -88,6 +89,25 @@ value_index::lookup(relational_operator op, data_view x) const {
   return std::move(*result);
 }
 
+caf::error value_index::merge(const value_index& other) {
+  if (typeid(*this) != typeid(other))
+    return make_error(ec::type_clash, "cannot merge value index for", type_,
+                      "with value index for", other.type_);
+  if (!merge_impl(other))
+    return make_error(ec::unspecified, "merge_impl");
+  // The positions of both indexes are disjoint, so we can combine them after
+  // filling up the shorter bitmap.
+  auto overlay = [](ewah_bitmap& x, ewah_bitmap y) {
+    auto n = std::max(x.size(), y.size());
+    x.append_bits(false, n - x.size());
+    y.append_bits(false, n - y.size());
+    x |= y;
+  };
+  overlay(mask_, other.mask_);
+  overlay(none_, other.none_);
+  return caf::no_error;
+}
+
 value_index::size_type value_index::offset() const {
   return std::max(none_.size(), mask_.size());
 }
@@ -116,6 +136,12 @@ const ewah_bitmap& value_index::none() const {
   return none_;
 }
 
+ids value_index::make_bitmap() const {
+  if (caf::get_or(opts_, "bitmap", "ewah") == "roaring")
+    return roaring_bitmap{};
+  return {};
+}
+
 caf::error inspect(caf::serializer& sink, const value_index& x) {
   return x.serialize(sink);
 }
@@ -156,7 +182,7 @@ string_index::string_index(vast::type t, caf::settings opts)
   max_length_
     = caf::get_or(options(), "max-size", defaults::index::max_string_size);
   auto b = base::uniform(10, std::log10(max_length_) + !!(max_length_ % 10));
-  length_ = length_bitmap_index{std::move(b)};
+  length_ = length_bitmap_index{std::move(b), make_bitmap()};
 }
 
 caf::error string_index::serialize(caf::serializer& sink) const {
@@ -256,6 +282,19 @@ string_index::lookup_impl(relational_operator op, data_view x) const {
     x);
 }
 
+bool string_index::merge_impl(const value_index& other) {
+  auto& rhs = static_cast<const string_index&>(other);
+  // Both indexes must truncate long strings at the same length.
+  if (max_length_ != rhs.max_length_)
+    return false;
+  if (rhs.chars_.size() > chars_.size())
+    chars_.resize(rhs.chars_.size(), char_bitmap_index{8});
+  for (auto i = 0u; i < rhs.chars_.size(); ++i)
+    chars_[i].merge(rhs.chars_[i]);
+  length_.merge(rhs.length_);
+  return true;
+}
+
 // -- enumeration_index --------------------------------------------------------
 
 enumeration_index::enumeration_index(vast::type t, caf::settings opts)
@@ -299,6 +338,11 @@ enumeration_index::lookup_impl(relational_operator op, data_view d) const {
     d);
 }
 
+bool enumeration_index::merge_impl(const value_index& other) {
+  index_.merge(static_cast<const enumeration_index&>(other).index_);
+  return true;
+}
+
 // -- address_index ------------------------------------------------------------
 
 address_index::address_index(vast::type t, caf::settings opts)
@@ -381,6 +425,14 @@ address_index::lookup_impl(relational_operator op, data_view d) const {
     d);
 }
 
+bool address_index::merge_impl(const value_index& other) {
+  auto& rhs = static_cast<const address_index&>(other);
+  for (auto i = 0u; i < 16; ++i)
+    bytes_[i].merge(rhs.bytes_[i]);
+  v4_.merge(rhs.v4_);
+  return true;
+}
+
 // -- subnet_index -------------------------------------------------------------
 
 subnet_index::subnet_index(vast::type x, caf::settings opts)
@@ -486,6 +538,14 @@ subnet_index::lookup_impl(relational_operator op, data_view d) const {
     d);
 }
 
+bool subnet_index::merge_impl(const value_index& other) {
+  auto& rhs = static_cast<const subnet_index&>(other);
+  if (network_.merge(rhs.network_))
+    return false;
+  length_.merge(rhs.length_);
+  return true;
+}
+
 // -- port_index ---------------------------------------------------------------
 
 port_index::port_index(vast::type t, caf::settings opts)
@@ -542,6 +602,13 @@ port_index::lookup_impl(relational_operator op, data_view d) const {
     d);
 }
 
+bool port_index::merge_impl(const value_index& other) {
+  auto& rhs = static_cast<const port_index&>(other);
+  num_.merge(rhs.num_);
+  proto_.merge(rhs.proto_);
+  return true;
+}
+
 // -- list_index -----------------------------------------------------------
 
 list_index::list_index(vast::type t, caf::settings opts)
@@ -616,4 +683,24 @@ list_index::lookup_impl(relational_operator op, data_view x) const {
   return result;
 }
 
+bool list_index::merge_impl(const value_index& other) {
+  auto& rhs = static_cast<const list_index&>(other);
+  // Both indexes must truncate long lists at the same size.
+  if (max_size_ != rhs.max_size_)
+    return false;
+  if (rhs.elements_.size() > elements_.size()) {
+    auto old = elements_.size();
+    elements_.resize(rhs.elements_.size());
+    for (auto i = old; i < elements_.size(); ++i) {
+      elements_[i] = factory<value_index>::make(value_type_, options());
+      VAST_ASSERT(elements_[i]);
+    }
+  }
+  for (auto i = 0u; i < rhs.elements_.size(); ++i)
+    if (elements_[i]->merge(*rhs.elements_[i]))
+      return false;
+  size_.merge(rhs.size_);
+  return true;
+}
+
 } // namespace vast
@@ -55,6 +55,17 @@ value_index_ptr make(type x, caf::settings opts) {
       return nullptr;
     }
   }
+  // The bitmap representation has a per-type attribute that takes precedence
+  // over the option.
+  if (auto a = find_attribute(x, "bitmap"); a && a->value)
+    opts["bitmap"] = *a->value;
+  if (auto i = opts.find("bitmap"); i != opts.end()) {
+    auto str = caf::get_if<caf::config_value::string>(&i->second);
+    if (!str || (*str != "ewah" && *str != "roaring")) {
+      VAST_ERROR_ANON(__func__, "invalid bitmap type (ewah or roaring needed)");
+      return nullptr;
+    }
+  }
   if (auto a = find_attribute(x, "index")) {
     if (auto value = a->value)
       if (*value == "hash"sv) {
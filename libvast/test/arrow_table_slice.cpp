@@ -6,10 +6,14 @@
 #include "vast/test/test.hpp"
 
 #include "vast/arrow_table_slice_builder.hpp"
+#include "vast/chunk.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/address.hpp"
 #include "vast/concept/parseable/vast/port.hpp"
 #include "vast/concept/parseable/vast/subnet.hpp"
+#include "vast/min_max_synopsis.hpp"
+#include "vast/table_slice_factory.hpp"
+#include "vast/time_synopsis.hpp"
 #include "vast/type.hpp"
 
 #include <caf/make_copy_on_write.hpp>
@@ -356,6 +360,43 @@ TEST(single column - serialization) {
   CHECK_VARIANT_EQUAL(*slice1, *slice2);
 }
 
+TEST(single column - load from misaligned chunk) {
+  using vast::factory;
+  factory<table_slice>::add<arrow_table_slice>();
+  factory<table_slice_builder>::add<arrow_table_slice_builder>(
+    arrow_table_slice::class_id);
+  auto slice1 = make_single_column_slice<count_type>(0_c, 1_c, 2_c, 3_c);
+  std::vector<char> buf;
+  caf::binary_serializer sink{nullptr, buf};
+  REQUIRE_EQUAL(sink(slice1), caf::none);
+  for (size_t offset = 0; offset < 8; ++offset) {
+    MESSAGE("load a table slice at offset " << offset);
+    std::vector<char> xs(offset);
+    xs.insert(xs.end(), buf.begin(), buf.end());
+    auto chk = chunk::make(std::move(xs));
+    auto slice2 = factory_traits<table_slice>::make(chk->slice(offset));
+    REQUIRE(slice2 != nullptr);
+    CHECK_VARIANT_EQUAL(*slice1, *slice2);
+  }
+}
+
+TEST(append column to synopsis) {
+  using ts = vast::time;
+  auto epoch = ts{duration{0}};
+  auto times = make_single_column_slice<time_type>(epoch + 12h, caf::none,
+                                                   epoch + 48h, epoch);
+  time_synopsis x{time_type{}};
+  times->append_column_to_synopsis(0, x);
+  CHECK_EQUAL(x.min(), epoch);
+  CHECK_EQUAL(x.max(), epoch + 48h);
+  auto counts = make_single_column_slice<count_type>(3_c, 1_c, caf::none);
+  min_max_synopsis<count> y{count_type{}, std::numeric_limits<count>::max(),
+                            std::numeric_limits<count>::lowest()};
+  counts->append_column_to_synopsis(0, y);
+  CHECK_EQUAL(y.min(), 1_c);
+  CHECK_EQUAL(y.max(), 3_c);
+}
+
 FIXTURE_SCOPE(arrow_table_slice_tests, fixtures::table_slices)
 
 TEST_TABLE_SLICE(arrow_table_slice)
@@ -12,12 +12,20 @@
  ******************************************************************************/
 
 #include "vast/bitmap.hpp"
+#include "vast/chunk.hpp"
 #include "vast/ewah_bitmap.hpp"
 #include "vast/ids.hpp"
 #include "vast/null_bitmap.hpp"
+#include "vast/roaring_bitmap.hpp"
 #include "vast/concept/printable/to_string.hpp"
 #include "vast/concept/printable/vast/bitmap.hpp"
 
+#include <caf/stream_deserializer.hpp>
+#include <caf/stream_serializer.hpp>
+#include <caf/streambuf.hpp>
+
+#include <cstring>
+
 #define SUITE bitmap
 #include "vast/test/test.hpp"
 
@@ -476,6 +484,14 @@ TEST(wah_bitmap) {
 
 FIXTURE_SCOPE_END()
 
+FIXTURE_SCOPE(roaring_bitmap_tests, bitmap_test_harness<roaring_bitmap>)
+
+TEST(roaring_bitmap) {
+  execute();
+}
+
+FIXTURE_SCOPE_END()
+
 FIXTURE_SCOPE(bitmap_tests, bitmap_test_harness<bitmap>)
 
 TEST(bitmap) {
@@ -861,6 +877,79 @@ TEST(EWAH bitwise NAND) {
   CHECK(to_block_string(bm2 - bm3), str);
 }
 
+TEST(EWAH bitwise operations with uncompressed bitmaps) {
+  auto bm2 = make_ewah2();
+  auto bm3 = make_ewah3();
+  null_bitmap nb3;
+  nb3.append(bm3);
+  CHECK_EQUAL(binary_and(bm2, nb3), bm2 & bm3);
+  CHECK_EQUAL(binary_and(nb3, bm2), bm2 & bm3);
+  CHECK_EQUAL(binary_or(bm2, nb3), bm2 | bm3);
+  CHECK_EQUAL(binary_or(nb3, bm2), bm2 | bm3);
+}
+
+TEST(EWAH nary operations) {
+  auto bm1 = make_ewah1();
+  auto bm2 = make_ewah2();
+  auto bm3 = make_ewah3();
+  auto bitmaps = std::vector<ewah_bitmap>{bm1, bm2, bm3};
+  auto begin = bitmaps.begin();
+  auto end = bitmaps.end();
+  CHECK_EQUAL(nary_and(begin, end), bm1 & bm2 & bm3);
+  CHECK_EQUAL(nary_or(begin, end), bm1 | bm2 | bm3);
+  CHECK_EQUAL(nary_or(begin, end).size(), bm1.size());
+  CHECK_EQUAL(nary_or(begin + 1, end), bm2 | bm3);
+}
+
+TEST(EWAH frozen blocks) {
+  struct writer : caf::stream_serializer<caf::vectorbuf&>, ewah_block_writer {
+    explicit writer(caf::vectorbuf& buf)
+      : caf::stream_serializer<caf::vectorbuf&>{nullptr, buf} {
+    }
+  };
+  struct reader : caf::stream_deserializer<caf::arraybuf<char>&>,
+                  ewah_block_reader {
+    reader(caf::arraybuf<char>& buf, span<const uint64_t> blocks,
+           chunk_ptr owner)
+      : caf::stream_deserializer<caf::arraybuf<char>&>{nullptr, buf},
+        ewah_block_reader{blocks, std::move(owner)} {
+    }
+  };
+  auto bm1 = make_ewah1();
+  auto bm2 = make_ewah2();
+  MESSAGE("write the blocks out of line");
+  std::vector<char> state;
+  caf::vectorbuf out{state};
+  writer sink{out};
+  REQUIRE_EQUAL(sink(bm1, bm2), caf::none);
+  CHECK_EQUAL(sink.blocks().size(),
+              bm1.blocks().size() + bm2.blocks().size());
+  auto bytes = std::vector<char>(sink.blocks().size() * sizeof(uint64_t));
+  std::memcpy(bytes.data(), sink.blocks().data(), bytes.size());
+  auto chk = chunk::make(std::move(bytes));
+  auto blocks = span<const uint64_t>{
+    reinterpret_cast<const uint64_t*>(chk->data()), sink.blocks().size()};
+  MESSAGE("reference the blocks in place");
+  caf::arraybuf<char> in{state.data(), state.size()};
+  reader source{in, blocks, chk};
+  ewah_bitmap x;
+  ewah_bitmap y;
+  REQUIRE_EQUAL(source(x, y), caf::none);
+  CHECK(x.frozen());
+  CHECK(y.frozen());
+  CHECK_EQUAL(x.blocks().data(), blocks.data());
+  CHECK_EQUAL(x, bm1);
+  CHECK_EQUAL(y, bm2);
+  CHECK_EQUAL(x & y, bm1 & bm2);
+  CHECK_EQUAL(~x, ~bm1);
+  MESSAGE("copy the blocks when modifying");
+  x.append_bits(true, 100);
+  bm1.append_bits(true, 100);
+  CHECK(!x.frozen());
+  CHECK_EQUAL(x, bm1);
+  CHECK_EQUAL(y, bm2);
+}
+
 TEST(EWAH block append) {
   ewah_bitmap bm;
   bm.append_bits(true, 10);
@@ -912,3 +1001,89 @@ TEST(EWAH RLE print 2) {
   //CHECK_EQUAL(str, "1F1T421F2T");
   CHECK_EQUAL(str, "1F1T62F320F39F2T");
 }
+
+TEST(roaring containers) {
+  using kind = roaring_bitmap::container::kind;
+  roaring_bitmap bm;
+  MESSAGE("sparse chunk");
+  for (auto i = 0; i < 100; ++i) {
+    bm.append_bits(false, 99);
+    bm.append_bit(true);
+  }
+  MESSAGE("dense chunk");
+  bm.append_bits(false, roaring_bitmap::container_bits - bm.size());
+  for (auto i = 0u; i < roaring_bitmap::container_bits / 64; ++i)
+    bm.append_block(0xaaaaaaaaaaaaaaaa);
+  MESSAGE("clustered chunk");
+  bm.append_bits(false, 1000);
+  bm.append_bits(true, 50000);
+  bm.optimize();
+  auto& xs = bm.containers();
+  REQUIRE_EQUAL(xs.size(), 3u);
+  CHECK(xs[0].type == kind::array);
+  CHECK_EQUAL(xs[0].cardinality(), 100u);
+  CHECK(xs[1].type == kind::bitset);
+  CHECK_EQUAL(xs[1].cardinality(), roaring_bitmap::container_bits / 2);
+  CHECK(xs[2].type == kind::run);
+  CHECK_EQUAL(xs[2].cardinality(), 50000u);
+  CHECK(bm[99]);
+  CHECK(!bm[100]);
+  CHECK(bm[roaring_bitmap::container_bits + 1]);
+  CHECK(!bm[roaring_bitmap::container_bits + 2]);
+  CHECK_EQUAL(rank(bm), 100u + roaring_bitmap::container_bits / 2 + 50000u);
+}
+
+TEST(roaring long runs) {
+  roaring_bitmap bm;
+  bm.append_bits(false, 3'000'000'000);
+  bm.append_bit(true);
+  bm.append_bits(true, 1'000'000'000);
+  bm.append_bits(false, 42);
+  MESSAGE("gaps take no space");
+  CHECK_EQUAL(bm.containers().front().key, 3'000'000'000u >> 16);
+  MESSAGE("runs span containers without decompression");
+  std::vector<bits<uint64_t>> seqs;
+  for (auto bits : bit_range(bm))
+    seqs.push_back(bits);
+  REQUIRE_EQUAL(seqs.size(), 3u);
+  CHECK_EQUAL(seqs[0].size(), 3'000'000'000u);
+  CHECK_EQUAL(seqs[1].size(), 1'000'000'001u);
+  CHECK_EQUAL(seqs[1].data(), word<uint64_t>::all);
+  CHECK_EQUAL(seqs[2].size(), 42u);
+  CHECK_EQUAL(rank(bm), 1'000'000'001u);
+  CHECK_EQUAL(select(bm, 1), 3'000'000'000u);
+}
+
+TEST(roaring bitwise operations) {
+  roaring_bitmap x;
+  x.append_bits(false, 100'000);
+  x.append_bits(true, 200'000);
+  x.append_block(0xf0f0f0f0f0f0f0f0);
+  roaring_bitmap y;
+  for (auto i = 0; i < 5000; ++i) {
+    y.append_bits(true, 7);
+    y.append_bits(false, 93);
+  }
+  MESSAGE("AND");
+  auto z = x;
+  z &= y;
+  CHECK_EQUAL(z, x & y);
+  ewah_bitmap ex;
+  ex.append(x);
+  ewah_bitmap ey;
+  ey.append(y);
+  CHECK_EQUAL(to_string(z), to_string(ex & ey));
+  MESSAGE("OR");
+  z = x;
+  z |= y;
+  CHECK_EQUAL(z, x | y);
+  MESSAGE("NOT");
+  z = ~x;
+  CHECK_EQUAL(rank(z), x.size() - rank(x));
+  CHECK_EQUAL(~z, x);
+  MESSAGE("type-erased");
+  bitmap bx{x};
+  bx &= bitmap{y};
+  CHECK(caf::holds_alternative<roaring_bitmap>(bx));
+  CHECK_EQUAL(bx, bitmap{x & y});
+}
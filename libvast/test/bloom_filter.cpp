@@ -215,3 +215,48 @@ TEST(bloom filter - simple hasher and partitioning) {
   REQUIRE_EQUAL(err, caf::none);
   CHECK(x == y);
 }
+
+TEST(frozen bloom filter) {
+  bloom_filter_parameters xs;
+  xs.n = 100;
+  xs.p = 0.01;
+  auto x = unbox(make_bloom_filter<xxhash64>(xs));
+  REQUIRE_NOT_EQUAL(x.size() % 64, 0u);
+  x.add(42);
+  x.add("foo");
+  frozen_bloom_filter<xxhash64> y{x.hasher(), x.size(), x.data().blocks()};
+  CHECK_EQUAL(y.size(), x.size());
+  CHECK(y.lookup(42));
+  CHECK(y.lookup("foo"));
+  for (auto i = 0; i < 100; ++i)
+    CHECK_EQUAL(y.lookup(i), x.lookup(i));
+  CHECK(y.thaw() == x);
+}
+
+TEST(bloom filter - folding) {
+  bloom_filter_parameters xs;
+  xs.m = 1024;
+  xs.k = 3;
+  xs.n = 10;
+  auto x = unbox(make_bloom_filter<xxhash64>(xs));
+  xs.m = 256;
+  auto y = unbox(make_bloom_filter<xxhash64>(xs));
+  for (auto i = 0; i < 10; ++i) {
+    x.add(i);
+    y.add(i);
+  }
+  MESSAGE("folding equals adding to a smaller Bloom filter");
+  REQUIRE(x.fold(256));
+  CHECK_EQUAL(x.size(), 256u);
+  CHECK(x == y);
+  CHECK(!x.fold(100));
+  MESSAGE("merging repeats the bits of the smaller Bloom filter");
+  xs.m = 1024;
+  auto z = unbox(make_bloom_filter<xxhash64>(xs));
+  z.add(42);
+  REQUIRE(z.merge(x));
+  CHECK_EQUAL(z.size(), 1024u);
+  for (auto i = 0; i < 10; ++i)
+    CHECK(z.lookup(i));
+  CHECK(z.lookup(42));
+}
@@ -87,6 +87,30 @@ TEST(integer values) {
   CHECK_EQUAL(lookup(col, is4), make_ids({}, slice_size));
 }
 
+TEST(appending after reload) {
+  integer_type column_type;
+  record_type layout{{"value", column_type}};
+  auto col
+    = unbox(make_column_index(sys, directory, column_type, caf::settings{}));
+  auto slice = caf_table_slice::make(layout, make_rows(1, 2, 3));
+  col->add(table_slice_column{slice, 0});
+  col->flush_to_disk();
+  col.reset();
+  MESSAGE("add to the index after reloading it from disk");
+  col = unbox(make_column_index(sys, directory, column_type, caf::settings{}));
+  CHECK(!col->dirty());
+  slice = caf_table_slice::make(layout, make_rows(3, 2, 1));
+  slice.unshared().offset(3);
+  col->add(table_slice_column{slice, 0});
+  auto is1 = curried(unbox(to<predicate>(":int == +1")));
+  CHECK_EQUAL(lookup(col, is1), make_ids({0, 5}, 6));
+  col->flush_to_disk();
+  col.reset();
+  MESSAGE("verify column index again");
+  col = unbox(make_column_index(sys, directory, column_type, caf::settings{}));
+  CHECK_EQUAL(lookup(col, is1), make_ids({0, 5}, 6));
+}
+
 TEST(zeek conn log) {
   MESSAGE("ingest originators from zeek conn log");
   auto row_type = zeek_conn_log_layout();
@@ -0,0 +1,104 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE compiled_expression
+
+#include "vast/compiled_expression.hpp"
+
+#include "vast/test/fixtures/events.hpp"
+#include "vast/test/test.hpp"
+
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/expression.hpp"
+#include "vast/expression.hpp"
+#include "vast/expression_visitors.hpp"
+#include "vast/ids.hpp"
+#include "vast/table_slice.hpp"
+
+#include <string_view>
+#include <vector>
+
+using namespace vast;
+
+namespace {
+
+using opcode = compiled_expression::instruction::opcode;
+
+struct fixture : fixtures::events {
+  fixture() : slice{zeek_conn_log_slices[0]}, layout{slice->layout()} {
+    // nop
+  }
+
+  compiled_expression compile(std::string_view str) {
+    auto expr = unbox(tailor(unbox(to<expression>(str)), layout));
+    return unbox(compiled_expression::make(expr, layout));
+  }
+
+  ids row_wise(std::string_view str) {
+    auto expr = unbox(tailor(unbox(to<expression>(str)), layout));
+    ids result;
+    result.append(false, slice->offset());
+    for (size_t row = 0; row < slice->rows(); ++row)
+      result.append_bit(evaluate_at(*slice, row, expr));
+    return result;
+  }
+
+  table_slice_ptr slice;
+  record_type layout;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(compiled_expression_tests, fixture)
+
+TEST(agreement with row evaluator) {
+  auto queries = std::vector<std::string_view>{
+    "#timestamp < 2009-11-18+12:00:00",
+    "orig_h == 192.168.1.102",
+    ":addr in 192.168.1.0/24 && orig_bytes > 300",
+    "!(resp_h in 192.168.1.0/24) || duration > 1s",
+    "uid ~ /C.*/ && proto == \"udp\"",
+    "service !~ /dns/",
+    "#type == \"zeek.conn\" && history == \"Dd\"",
+  };
+  for (auto query : queries) {
+    MESSAGE(query);
+    CHECK_EQUAL(evaluate(*slice, compile(query)), row_wise(query));
+  }
+}
+
+TEST(constant folding) {
+  MESSAGE("a false conjunct decides the conjunction");
+  auto x = compile("#type == \"foo\" && orig_h == 192.168.1.102");
+  REQUIRE_EQUAL(x.program().size(), 1u);
+  CHECK(x.program()[0].code == opcode::constant);
+  CHECK(!x.program()[0].value);
+  CHECK_EQUAL(rank(x(*slice)), 0u);
+  MESSAGE("a false disjunct is the neutral element");
+  x = compile("#type == \"foo\" || orig_h == 192.168.1.102");
+  REQUIRE_EQUAL(x.program().size(), 2u);
+  CHECK(x.program()[0].code == opcode::disjunction);
+  CHECK(x.program()[1].code == opcode::scan);
+  MESSAGE("negations of constants fold as well");
+  x = compile("! #type == \"foo\"");
+  REQUIRE_EQUAL(x.program().size(), 1u);
+  CHECK(x.program()[0].value);
+  CHECK_EQUAL(rank(x(*slice)), slice->rows());
+}
+
+TEST(unresolved extractors) {
+  auto expr = unbox(to<expression>("orig_h == 192.168.1.102"));
+  CHECK(!compiled_expression::make(expr, layout));
+}
+
+FIXTURE_SCOPE_END()
@@ -60,6 +60,9 @@ TEST(compressedbuf - two blocks) {
 
 TEST(compressedbuf - iostream interface) {
   std::vector<compression> methods = {compression::null, compression::lz4};
+#if VAST_HAVE_ZSTD
+  methods.push_back(compression::zstd);
+#endif
   std::vector<size_t> block_sizes = {1, 2, 64, 256, 1_KiB, 16_KiB};
   auto data = "Im Kampf zwischen dir und der Welt sekundiere der Welt."s;
   auto inflation = 1000;
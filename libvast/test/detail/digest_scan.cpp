@@ -0,0 +1,72 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE digest_scan
+
+#include "vast/detail/digest_scan.hpp"
+
+#include "vast/test/test.hpp"
+
+#include <vector>
+
+using namespace vast;
+using namespace vast::detail;
+
+namespace {
+
+// Creates 3-byte digests whose values cycle through 0..6.
+std::vector<byte> make_digests(size_t n) {
+  std::vector<byte> result;
+  for (size_t i = 0; i < n; ++i) {
+    result.push_back(byte(i % 7));
+    result.push_back(byte{0});
+    result.push_back(byte{0});
+  }
+  return result;
+}
+
+std::vector<uint64_t> scan(const std::vector<byte>& digests,
+                           const std::vector<uint64_t>& keys) {
+  std::vector<uint64_t> result((digests.size() / 3 + 63) / 64);
+  scan_digests<3>(digests, keys, result);
+  return result;
+}
+
+bool bit(const std::vector<uint64_t>& xs, size_t i) {
+  return (xs[i / 64] >> (i % 64)) & 1;
+}
+
+} // namespace
+
+TEST(single key) {
+  auto digests = make_digests(130);
+  auto result = scan(digests, {3});
+  REQUIRE_EQUAL(result.size(), 3u);
+  for (size_t i = 0; i < 130; ++i)
+    CHECK_EQUAL(bit(result, i), i % 7 == 3);
+  MESSAGE("bits beyond the last digest remain 0");
+  CHECK_EQUAL(result.back() >> 2, 0u);
+}
+
+TEST(many keys) {
+  auto digests = make_digests(100);
+  auto keys = std::vector<uint64_t>{6, 1, 42, 43, 44, 45, 46, 47, 48, 49};
+  auto result = scan(digests, keys);
+  for (size_t i = 0; i < 100; ++i)
+    CHECK_EQUAL(bit(result, i), i % 7 == 1 || i % 7 == 6);
+}
+
+TEST(no digests) {
+  auto result = scan({}, {1});
+  CHECK(result.empty());
+}
@@ -0,0 +1,174 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE flat_2q_cache
+#include "vast/test/test.hpp"
+
+#include "vast/detail/flat_2q_cache.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace vast;
+
+namespace {
+
+struct make_value {
+  std::string operator()(const std::string& key) const {
+    return key + key;
+  }
+};
+
+/// Weighs a value by its length, so that a key of N characters weighs 2N.
+struct weigh_value {
+  size_t operator()(const std::string& value) const {
+    return value.size();
+  }
+};
+
+using cache_type
+  = detail::flat_2q_cache<std::string, std::string, make_value, weigh_value>;
+
+template <class Vector>
+std::vector<std::string> keys(const Vector& xs) {
+  std::vector<std::string> result;
+  for (auto& x : xs)
+    result.push_back(x.key);
+  return result;
+}
+
+struct fixture {
+  fixture() : cache(10, 100) {
+    // nop
+  }
+
+  cache_type cache;
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(flat_2q_cache_tests, fixture)
+
+TEST(filling) {
+  for (auto key : {"a", "b", "c", "d", "e"})
+    CHECK_EQUAL(cache.get_or_add(key), std::string{key} + key);
+  CHECK_EQUAL(cache.size(), 5u);
+  CHECK_EQUAL(cache.weight(), 10u);
+  CHECK_EQUAL(cache.stats().misses, 5u);
+  CHECK_EQUAL(cache.stats().evictions, 0u);
+  cache.get_or_add("f");
+  CHECK_EQUAL(keys(cache.recent()),
+              (std::vector<std::string>{"b", "c", "d", "e", "f"}));
+  CHECK(!cache.contains("a"));
+  CHECK_EQUAL(cache.stats().evictions, 1u);
+}
+
+TEST(weight budget) {
+  cache.get_or_add("a");
+  cache.get_or_add("b");
+  cache.get_or_add("cccc");
+  CHECK_EQUAL(keys(cache.recent()), (std::vector<std::string>{"b", "cccc"}));
+  CHECK_EQUAL(cache.weight(), 10u);
+  MESSAGE("an element that exceeds the budget on its own stays");
+  cache.get_or_add("xxxxxx");
+  CHECK_EQUAL(keys(cache.recent()), (std::vector<std::string>{"xxxxxx"}));
+  CHECK_EQUAL(cache.weight(), 12u);
+}
+
+TEST(scan resistance) {
+  cache.get_or_add("a");
+  cache.get_or_add("b");
+  CHECK_EQUAL(cache.get_or_add("a"), "aa");
+  CHECK_EQUAL(cache.get_or_add("b"), "bb");
+  CHECK_EQUAL(cache.stats().hits, 2u);
+  CHECK_EQUAL(keys(cache.frequent()), (std::vector<std::string>{"a", "b"}));
+  MESSAGE("a scan over many keys only replaces elements accessed once");
+  for (auto key : {"c", "d", "e", "f", "g", "h", "i", "j"})
+    cache.get_or_add(key);
+  CHECK_EQUAL(keys(cache.frequent()), (std::vector<std::string>{"a", "b"}));
+  CHECK_EQUAL(keys(cache.recent()), (std::vector<std::string>{"h", "i", "j"}));
+  CHECK_EQUAL(cache.stats().evictions, 5u);
+}
+
+TEST(ghost hits) {
+  for (auto key : {"a", "b", "c", "d", "e", "f"})
+    cache.get_or_add(key);
+  CHECK(!cache.contains("a"));
+  MESSAGE("reloading a recently evicted element promotes it");
+  cache.get_or_add("a");
+  CHECK_EQUAL(keys(cache.frequent()), (std::vector<std::string>{"a"}));
+  CHECK_EQUAL(cache.stats().misses, 7u);
+}
+
+TEST(adding) {
+  CHECK_EQUAL(cache.add("a", "prefetched"), "prefetched");
+  CHECK(cache.contains("a"));
+  CHECK_EQUAL(cache.get_or_add("a"), "prefetched");
+  CHECK_EQUAL(cache.stats().misses, 1u);
+  CHECK_EQUAL(cache.stats().hits, 1u);
+}
+
+TEST(finding) {
+  CHECK(cache.find("a") == nullptr);
+  CHECK_EQUAL(cache.size(), 0u);
+  cache.add("a", "loaded");
+  auto x = cache.find("a");
+  REQUIRE(x != nullptr);
+  CHECK_EQUAL(*x, "loaded");
+  CHECK_EQUAL(keys(cache.frequent()), (std::vector<std::string>{"a"}));
+  CHECK_EQUAL(cache.stats().misses, 1u);
+  CHECK_EQUAL(cache.stats().hits, 1u);
+}
+
+TEST(clearing) {
+  for (auto key : {"a", "b", "c", "d", "e", "f"})
+    cache.get_or_add(key);
+  cache.clear();
+  CHECK_EQUAL(cache.size(), 0u);
+  CHECK_EQUAL(cache.weight(), 0u);
+  MESSAGE("the cache forgets about evicted elements");
+  cache.get_or_add("a");
+  CHECK_EQUAL(keys(cache.recent()), (std::vector<std::string>{"a"}));
+}
+
+TEST(shrinking) {
+  for (auto key : {"a", "b", "c", "d", "e"})
+    cache.get_or_add(key);
+  cache.get_or_add("a");
+  cache.max_size(2);
+  CHECK_EQUAL(keys(cache.recent()), (std::vector<std::string>{"e"}));
+  CHECK_EQUAL(keys(cache.frequent()), (std::vector<std::string>{"a"}));
+  cache.capacity(2);
+  CHECK_EQUAL(cache.size(), 1u);
+  CHECK_EQUAL(keys(cache.frequent()), (std::vector<std::string>{"a"}));
+}
+
+TEST(erasing) {
+  for (auto key : {"a", "b", "c", "d", "e", "f"})
+    cache.get_or_add(key);
+  cache.get_or_add("b");
+  CHECK(cache.erase("b"));
+  CHECK(cache.erase("c"));
+  CHECK(!cache.erase("c"));
+  CHECK_EQUAL(cache.size(), 3u);
+  CHECK_EQUAL(cache.weight(), 6u);
+  CHECK_EQUAL(cache.stats().evictions, 1u);
+  MESSAGE("erasing forgets evicted elements");
+  CHECK(!cache.erase("a"));
+  cache.get_or_add("a");
+  CHECK(cache.frequent().empty());
+  CHECK_EQUAL(keys(cache.recent()),
+              (std::vector<std::string>{"d", "e", "f", "a"}));
+}
+
+FIXTURE_SCOPE_END()
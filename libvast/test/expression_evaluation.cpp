@@ -196,4 +196,39 @@ TEST(evaluation - table slice) {
               make_ids({0, 2, 4}, 8));
 }
 
+TEST(evaluation - table slice columns) {
+  auto& slice = zeek_conn_log_slices[0];
+  auto layout = slice->layout();
+  auto tailored = [&](std::string_view expr) {
+    auto ast = unbox(to<expression>(expr));
+    return unbox(caf::visit(type_resolver{layout}, ast));
+  };
+  // The column-at-a-time evaluation must agree with the row-wise evaluation.
+  auto row_wise = [&](const expression& expr) {
+    ids result;
+    result.append(false, slice->offset());
+    for (size_t row = 0; row < slice->rows(); ++row)
+      result.append_bit(evaluate_at(*slice, row, expr));
+    return result;
+  };
+  auto queries = std::vector<std::string_view>{
+    "#timestamp < 2009-11-18+12:00:00",
+    "#type == \"zeek.conn\"",
+    "orig_h == 192.168.1.102",
+    "orig_h != 192.168.1.102 && orig_bytes > 300",
+    ":addr in 192.168.1.0/24",
+    "!(resp_h in 192.168.1.0/24)",
+    "orig_bytes >= 100 || resp_bytes < 10",
+    "duration > 1s",
+    "uid ~ /C.*/ && proto == \"udp\"",
+    "service !~ /dns/",
+    "history == \"Dd\"",
+  };
+  for (auto query : queries) {
+    MESSAGE(query);
+    auto expr = tailored(query);
+    CHECK_EQUAL(evaluate(*slice, expr), row_wise(expr));
+  }
+}
+
 FIXTURE_SCOPE_END()
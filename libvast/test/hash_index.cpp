@@ -64,6 +64,44 @@ TEST(serialization) {
   CHECK(!y.append(make_data_view("foo")));
 }
 
+TEST(merge with different seeds) {
+  using index_type = hash_index<1>;
+  auto digest = [](const std::string& x, size_t seed) {
+    return index_type::hash(make_data_view(x), seed);
+  };
+  // "foo" and "bar" collide with seed 0, so "bar" receives seed 1 in x.
+  REQUIRE(digest("bar", 1) != digest("foo", 0));
+  index_type x{string_type{}};
+  REQUIRE(x.append(make_data_view("foo"), 3));
+  REQUIRE(x.append(make_data_view("bar"), 4));
+  MESSAGE("block seed 1 for \"bar\" in y");
+  std::string blocker;
+  for (auto i = 0; blocker.empty(); ++i)
+    if (auto str = "x" + std::to_string(i); digest(str, 0) == digest("bar", 1))
+      blocker = str;
+  index_type y{string_type{}};
+  REQUIRE(y.append(make_data_view("foo"), 0));
+  REQUIRE(y.append(make_data_view(blocker), 1));
+  REQUIRE(y.append(make_data_view("bar"), 2));
+  MESSAGE("merge the persisted indexes");
+  auto roundtrip = [](const index_type& idx) {
+    std::vector<char> buf;
+    REQUIRE(save(nullptr, buf, idx) == caf::none);
+    index_type result{string_type{}};
+    REQUIRE(load(nullptr, buf, result) == caf::none);
+    return result;
+  };
+  index_type z{string_type{}};
+  REQUIRE_EQUAL(z.merge(roundtrip(y)), caf::none);
+  REQUIRE_EQUAL(z.merge(roundtrip(x)), caf::none);
+  auto lookup = [&](const std::string& str) {
+    return to_string(unbox(z.lookup(equal, make_data_view(str))));
+  };
+  CHECK_EQUAL(lookup("foo"), "10010");
+  CHECK_EQUAL(lookup("bar"), "00101");
+  CHECK_EQUAL(lookup(blocker), "01000");
+}
+
 // The attribute #index=hash selects the hash_index implementation.
 TEST(factory construction and parameterization) {
   factory<value_index>::initialize();
@@ -118,3 +156,40 @@ TEST(hash index for list) {
   REQUIRE(!result);
   CHECK(result.error() == ec::unsupported_operator);
 }
+
+TEST(scan across words and gaps) {
+  hash_index<2> idx{count_type{}};
+  auto value = [](size_t i) { return count{i % 17}; };
+  auto has_value = [](size_t i) { return i < 100 || i >= 150; };
+  for (size_t i = 0; i < 350; ++i)
+    if (has_value(i))
+      REQUIRE(idx.append(make_data_view(value(i)), i));
+  auto expected = [&](auto pred) {
+    std::string result;
+    for (size_t i = 0; i < 350; ++i)
+      result += has_value(i) && pred(value(i)) ? '1' : '0';
+    return result;
+  };
+  MESSAGE("equality");
+  auto result = idx.lookup(equal, make_data_view(count{5}));
+  CHECK_EQUAL(to_string(unbox(result)),
+              expected([](count x) { return x == 5; }));
+  result = idx.lookup(not_equal, make_data_view(count{5}));
+  CHECK_EQUAL(to_string(unbox(result)),
+              expected([](count x) { return x != 5; }));
+  MESSAGE("membership with few keys");
+  auto few = list{count{1}, count{16}};
+  result = idx.lookup(in, make_data_view(few));
+  CHECK_EQUAL(to_string(unbox(result)),
+              expected([](count x) { return x == 1 || x == 16; }));
+  MESSAGE("membership with many keys");
+  list many;
+  for (count x = 0; x < 20; x += 2)
+    many.emplace_back(x);
+  result = idx.lookup(in, make_data_view(many));
+  CHECK_EQUAL(to_string(unbox(result)),
+              expected([](count x) { return x % 2 == 0; }));
+  result = idx.lookup(not_in, make_data_view(many));
+  CHECK_EQUAL(to_string(unbox(result)),
+              expected([](count x) { return x % 2 != 0; }));
+}
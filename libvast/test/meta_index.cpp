@@ -19,9 +19,11 @@
 #include "vast/test/test.hpp"
 
 #include "vast/caf_table_slice_builder.hpp"
+#include "vast/chunk.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/expression.hpp"
 #include "vast/detail/overload.hpp"
+#include "vast/fbs/utils.hpp"
 #include "vast/synopsis.hpp"
 #include "vast/synopsis_factory.hpp"
 #include "vast/table_slice.hpp"
@@ -29,6 +31,9 @@
 #include "vast/uuid.hpp"
 #include "vast/view.hpp"
 
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+
 using namespace vast;
 
 using std::literals::operator""s;
@@ -95,6 +100,8 @@ struct fixture {
   fixture() {
     MESSAGE("register synopsis factory");
     factory<synopsis>::initialize();
+    put(meta_idx.factory_options(), "max-partition-size",
+        num_events_per_parttion);
     MESSAGE("generate " << num_partitions << " UUIDs for the partitions");
     for (size_t i = 0; i < num_partitions; ++i)
       ids.emplace_back(uuid::random());
@@ -208,8 +215,175 @@ TEST(attribute extractor - type) {
   CHECK_EQUAL(lookup("#type !~ /x/"), ids);
 }
 
+TEST(string synopsis) {
+  CHECK_EQUAL(lookup("content == \"foo\""), ids);
+  CHECK_EQUAL(lookup("content == \"bar\""), empty());
+  CHECK_EQUAL(lookup("content in [\"bar\", \"baz\"]"), empty());
+  CHECK_EQUAL(lookup("content in [\"bar\", \"foo\"]"), ids);
+  CHECK_EQUAL(lookup("content == \"bar\" || #type == \"foo\""),
+              lookup("#type == \"foo\""));
+}
+
+TEST(serialization) {
+  std::vector<char> buf;
+  caf::binary_serializer sink{nullptr, buf};
+  REQUIRE_EQUAL(sink(meta_idx), caf::none);
+  meta_index copy;
+  caf::binary_deserializer source{nullptr, buf};
+  REQUIRE_EQUAL(source(copy), caf::none);
+  auto copy_lookup = [&](std::string_view expr) {
+    auto result = copy.lookup(unbox(to<expression>(expr)));
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  for (auto expr : {"#type == \"foo\"", "#type ~ /f.*/",
+                    "#timestamp >= 1970-01-01+00:00:30.0",
+                    "content == \"foo\"", "content == \"bar\""})
+    CHECK_EQUAL(copy_lookup(expr), lookup(expr));
+}
+
+TEST(flatbuffer) {
+  auto exprs = {"#type == \"foo\"", "#type ~ /f.*/",
+                "#timestamp >= 1970-01-01+00:00:30.0", "content == \"foo\"",
+                "content == \"bar\"", "content in [\"bar\", \"foo\"]"};
+  auto lookup_in = [](const meta_index& x, std::string_view expr) {
+    auto result = x.lookup(unbox(to<expression>(expr)));
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  auto chunk = unbox(fbs::wrap(meta_idx, fbs::file_identifier));
+  auto flatbuf = fbs::as_flatbuffer<fbs::MetaIndex>(as_bytes(chunk));
+  REQUIRE(flatbuf);
+  MESSAGE("unpack with lookups on the packed Bloom filters");
+  meta_index frozen;
+  REQUIRE_EQUAL(unpack(*flatbuf, frozen, chunk), caf::none);
+  CHECK_EQUAL(frozen.num_partitions(), num_partitions);
+  for (auto expr : exprs)
+    CHECK_EQUAL(lookup_in(frozen, expr), lookup(expr));
+  MESSAGE("unpack into a self-contained meta index");
+  meta_index thawed;
+  REQUIRE_EQUAL(unpack(*flatbuf, thawed), caf::none);
+  for (auto expr : exprs)
+    CHECK_EQUAL(lookup_in(thawed, expr), lookup(expr));
+  MESSAGE("repack a meta index with packed Bloom filters");
+  auto repacked = unbox(fbs::wrap(frozen, fbs::file_identifier));
+  auto repacked_flatbuf
+    = fbs::as_flatbuffer<fbs::MetaIndex>(as_bytes(repacked));
+  REQUIRE(repacked_flatbuf);
+  meta_index refrozen;
+  REQUIRE_EQUAL(unpack(*repacked_flatbuf, refrozen, repacked), caf::none);
+  for (auto expr : exprs)
+    CHECK_EQUAL(lookup_in(refrozen, expr), lookup(expr));
+  MESSAGE("serialize a meta index with packed Bloom filters");
+  std::vector<char> buf;
+  caf::binary_serializer sink{nullptr, buf};
+  REQUIRE_EQUAL(sink(frozen), caf::none);
+  meta_index copy;
+  caf::binary_deserializer source{nullptr, buf};
+  REQUIRE_EQUAL(source(copy), caf::none);
+  for (auto expr : exprs)
+    CHECK_EQUAL(lookup_in(copy, expr), lookup(expr));
+}
+
+TEST(flatbuffer delta) {
+  MESSAGE("pack the partitions after the first two");
+  flatbuffers::FlatBufferBuilder builder;
+  auto root = unbox(pack(builder, meta_idx, 2));
+  builder.Finish(root, fbs::file_identifier);
+  auto chunk = fbs::release(builder);
+  auto flatbuf = fbs::as_flatbuffer<fbs::MetaIndex>(as_bytes(chunk));
+  REQUIRE(flatbuf);
+  meta_index delta;
+  REQUIRE_EQUAL(unpack(*flatbuf, delta, chunk), caf::none);
+  CHECK_EQUAL(delta.num_partitions(), 2u);
+  auto delta_lookup = [&](std::string_view expr) {
+    auto result = delta.lookup(unbox(to<expression>(expr)));
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  CHECK_EQUAL(delta_lookup("#type ~ /f.*/"), slice(2, 4));
+  CHECK_EQUAL(delta_lookup("content == \"foo\""), slice(2, 4));
+  CHECK_EQUAL(delta_lookup("#timestamp <= 1970-01-01+00:00:30.0"), empty());
+  MESSAGE("add all partitions on top");
+  auto full = unbox(fbs::wrap(meta_idx, fbs::file_identifier));
+  auto full_flatbuf = fbs::as_flatbuffer<fbs::MetaIndex>(as_bytes(full));
+  REQUIRE(full_flatbuf);
+  REQUIRE_EQUAL(unpack(*full_flatbuf, delta, full), caf::none);
+  CHECK_EQUAL(delta.num_partitions(), num_partitions);
+  for (auto expr : {"#type == \"foo\"", "#timestamp <= 1970-01-01+00:00:30.0",
+                    "content == \"foo\""})
+    CHECK_EQUAL(delta_lookup(expr), lookup(expr));
+}
+
+TEST(replace) {
+  auto target = uuid::random();
+  MESSAGE("unknown partitions leave the meta index unchanged");
+  CHECK_NOT_EQUAL(meta_idx.replace({ids[0], uuid::random()}, target),
+                  caf::none);
+  CHECK_EQUAL(meta_idx.partitions(), ids);
+  MESSAGE("merge the first two partitions");
+  REQUIRE_EQUAL(meta_idx.replace({ids[0], ids[1]}, target), caf::none);
+  CHECK_EQUAL(meta_idx.partitions(),
+              (std::vector<uuid>{target, ids[2], ids[3]}));
+  auto with_target = [&](std::vector<uuid> xs) {
+    xs.push_back(target);
+    std::sort(xs.begin(), xs.end());
+    return xs;
+  };
+  CHECK_EQUAL(attr_time_query("00:00:10"), std::vector<uuid>{target});
+  CHECK_EQUAL(attr_time_query("00:00:30"), std::vector<uuid>{target});
+  CHECK_EQUAL(attr_time_query("00:00:50"), slice(2));
+  CHECK_EQUAL(lookup("#type == \"foo\""), with_target({ids[2]}));
+  CHECK_EQUAL(lookup("#type == \"foobar\""), with_target({ids[3]}));
+  CHECK_EQUAL(lookup("content == \"foo\""), with_target(slice(2, 4)));
+}
+
+TEST(erase) {
+  meta_idx.erase({ids[1], uuid::random()});
+  CHECK_EQUAL(meta_idx.partitions(),
+              (std::vector<uuid>{ids[0], ids[2], ids[3]}));
+  CHECK_EQUAL(attr_time_query("00:00:30"), empty());
+  CHECK_EQUAL(attr_time_query("00:00:50"), slice(2));
+  CHECK_EQUAL(lookup("#type == \"foobar\""), std::vector<uuid>{ids[3]});
+}
+
 FIXTURE_SCOPE_END()
 
+TEST(parallel lookup) {
+  factory<synopsis>::initialize();
+  MESSAGE("add enough partitions to split lookups into several shards");
+  meta_index meta_idx;
+  put(meta_idx.factory_options(), "max-partition-size",
+      num_events_per_parttion);
+  for (size_t i = 0; i < 300; ++i) {
+    auto name = i % 3 == 0 ? "foo"s : "bar"s;
+    mock_partition part{std::move(name), uuid::random(), i};
+    meta_idx.add(part.id, *part.slice);
+  }
+  auto queries = {
+    "#type == \"foo\"",
+    "#type != \"foo\"",
+    "#timestamp >= 1970-01-01+01:00:00.0",
+    "#timestamp >= 1970-01-01+00:30:00.0 && "
+    "#timestamp < 1970-01-01+01:30:00.0",
+    "#timestamp < 1970-01-01+00:10:00.0 || #type == \"foo\"",
+    "content == \"foo\"",
+    "content == \"bar\"",
+    "! (content == \"bar\")",
+  };
+  std::vector<std::vector<uuid>> expected;
+  for (auto query : queries)
+    expected.push_back(meta_idx.lookup(unbox(to<expression>(query))));
+  MESSAGE("compare sharded lookups against single-threaded ones");
+  meta_idx.parallelism(4);
+  size_t i = 0;
+  for (auto query : queries) {
+    auto result = meta_idx.lookup(unbox(to<expression>(query)));
+    CHECK(std::is_sorted(result.begin(), result.end()));
+    CHECK_EQUAL(result, expected[i++]);
+  }
+}
+
 TEST(meta index with bool synopsis) {
   MESSAGE("generate slice data and add it to the meta index");
   meta_index meta_idx;
@@ -255,6 +429,46 @@ TEST(meta index with bool synopsis) {
   CHECK_EQUAL(lookup("y != T"), all);
 }
 
+TEST(partitions without synopses) {
+  factory<synopsis>::initialize();
+  MESSAGE("load a meta index where one partition lacks a synopsis");
+  auto field = qualified_record_field{"test", record_field{"x", count_type{}}};
+  auto syn = factory<synopsis>::make(count_type{}, caf::settings{});
+  REQUIRE(syn != nullptr);
+  syn->add(make_data_view(count{42}));
+  auto id1 = uuid::random();
+  auto id2 = uuid::random();
+  std::unordered_map<uuid, std::unordered_map<qualified_record_field,
+                                              synopsis_ptr>>
+    synopses;
+  synopses[id1].emplace(field, syn);
+  synopses[id2].emplace(field, nullptr);
+  std::vector<char> buf;
+  caf::binary_serializer sink{nullptr, buf};
+  REQUIRE_EQUAL(sink(caf::settings{}, synopses), caf::none);
+  meta_index meta_idx;
+  caf::binary_deserializer source{nullptr, buf};
+  REQUIRE_EQUAL(source(meta_idx), caf::none);
+  auto lookup = [](const meta_index& x, std::string_view expr) {
+    auto result = x.lookup(unbox(to<expression>(expr)));
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  auto both = std::vector<uuid>{id1, id2};
+  std::sort(both.begin(), both.end());
+  MESSAGE("partitions without a synopsis remain candidates");
+  CHECK_EQUAL(lookup(meta_idx, "x == 42"), both);
+  CHECK_EQUAL(lookup(meta_idx, "x == 7"), std::vector<uuid>{id2});
+  MESSAGE("reloading the meta index keeps the candidates");
+  auto chunk = unbox(fbs::wrap(meta_idx, fbs::file_identifier));
+  auto flatbuf = fbs::as_flatbuffer<fbs::MetaIndex>(as_bytes(chunk));
+  REQUIRE(flatbuf);
+  meta_index thawed;
+  REQUIRE_EQUAL(unpack(*flatbuf, thawed), caf::none);
+  CHECK_EQUAL(lookup(thawed, "x == 42"), both);
+  CHECK_EQUAL(lookup(thawed, "x == 7"), std::vector<uuid>{id2});
+}
+
 TEST(option setting and retrieval) {
   meta_index meta_idx;
   auto& opts = meta_idx.factory_options();
@@ -22,11 +22,20 @@
 #include <caf/binary_deserializer.hpp>
 #include <caf/binary_serializer.hpp>
 
+#include "vast/concept/printable/stream.hpp"
+#include "vast/concept/printable/vast/compression.hpp"
+#include "vast/expression.hpp"
+#include "vast/expression_visitors.hpp"
+#include "vast/fbs/segment.hpp"
 #include "vast/ids.hpp"
 #include "vast/load.hpp"
+#include "vast/synopsis_factory.hpp"
 #include "vast/table_slice.hpp"
 #include "vast/save.hpp"
 
+#include <algorithm>
+#include <limits>
+
 using namespace vast;
 
 FIXTURE_SCOPE(segment_tests, fixtures::events)
@@ -37,6 +46,13 @@ TEST(construction and querying) {
     REQUIRE(!builder.add(slice));
   auto x = builder.finish();
   CHECK_EQUAL(x.num_slices(), zeek_conn_log_slices.size());
+  MESSAGE("every table slice buffer records its ID range");
+  auto buffers = fbs::GetSegment(x.chunk()->data())->slices();
+  REQUIRE_EQUAL(buffers->size(), zeek_conn_log_slices.size());
+  for (size_t i = 0; i < buffers->size(); ++i) {
+    CHECK_EQUAL(buffers->Get(i)->offset(), zeek_conn_log_slices[i]->offset());
+    CHECK_EQUAL(buffers->Get(i)->rows(), zeek_conn_log_slices[i]->rows());
+  }
   MESSAGE("lookup IDs for some segments");
   auto xs = x.lookup(make_ids({0, 6, 19, 21}));
   REQUIRE(xs);
@@ -46,6 +62,201 @@ TEST(construction and querying) {
   CHECK_EQUAL(*slices[1], *zeek_conn_log_slices[2]);
 }
 
+TEST(lookup without copying) {
+  segment_builder builder;
+  for (auto& slice : zeek_conn_log_slices)
+    REQUIRE(!builder.add(slice));
+  auto chk = builder.finish().chunk();
+  auto refs = chk->get_reference_count();
+  std::vector<table_slice_ptr> slices;
+  {
+    auto x = segment::make(chk);
+    REQUIRE(x);
+    auto xs = x->lookup(make_ids({0, 6, 19, 21}));
+    REQUIRE(xs);
+    slices = std::move(*xs);
+  }
+  REQUIRE_EQUAL(slices.size(), 2u);
+  MESSAGE("the table slices reference the segment chunk");
+  CHECK_GREATER(chk->get_reference_count(), refs);
+  CHECK_EQUAL(*slices[0], *zeek_conn_log_slices[0]);
+  CHECK_EQUAL(*slices[1], *zeek_conn_log_slices[2]);
+  slices.clear();
+  CHECK_EQUAL(chk->get_reference_count(), refs);
+}
+
+TEST(version) {
+  auto version = [](const segment& x) {
+    return fbs::GetSegment(x.chunk()->data())->version();
+  };
+  segment_builder builder{segment_compression{compression::lz4}};
+  for (auto& slice : zeek_conn_log_slices)
+    REQUIRE(!builder.add(slice));
+  auto x = builder.finish();
+  MESSAGE("compressed table slices require version 1");
+  CHECK(version(x) == fbs::Version::v1);
+  auto y = segment::make(x.chunk());
+  REQUIRE(y);
+  CHECK_EQUAL(y->ids(), x.ids());
+}
+
+TEST(compressed lookup) {
+  auto make_segment = [&](segment_compression config) {
+    segment_builder builder{config};
+    for (auto& slice : zeek_conn_log_slices)
+      REQUIRE(!builder.add(slice));
+    return builder.finish();
+  };
+  auto uncompressed = make_segment({});
+  std::vector<segment_compression> configs = {{compression::lz4}};
+#if VAST_HAVE_ZSTD
+  configs.push_back({compression::zstd, 1});
+  configs.push_back({compression::zstd, 19});
+#endif
+  for (auto& config : configs) {
+    MESSAGE("compress with " << config.method);
+    auto x = make_segment(config);
+    CHECK_LESS(x.chunk()->size(), uncompressed.chunk()->size());
+    CHECK_EQUAL(x.ids(), uncompressed.ids());
+    auto xs = x.lookup(make_ids({0, 6, 19, 21}));
+    REQUIRE(xs);
+    auto& slices = *xs;
+    REQUIRE_EQUAL(slices.size(), 2u);
+    CHECK_EQUAL(*slices[0], *zeek_conn_log_slices[0]);
+    CHECK_EQUAL(*slices[1], *zeek_conn_log_slices[2]);
+  }
+}
+
+TEST(compressed lookup beyond the maximum size) {
+  segment_builder builder{segment_compression{compression::lz4}};
+  for (auto& slice : zeek_conn_log_slices)
+    REQUIRE(!builder.add(slice));
+  auto chk = builder.finish().chunk();
+  auto x = segment::make(chk, 16);
+  REQUIRE(x);
+  CHECK(!x->lookup(x->ids()));
+  auto y = segment::make(chk);
+  REQUIRE(y);
+  CHECK(y->lookup(y->ids()));
+}
+
+#if VAST_HAVE_ZSTD
+
+TEST(compression with dictionaries) {
+  segment_builder builder{segment_compression{compression::zstd, 3, true}};
+  for (auto& slice : zeek_full_conn_log_slices)
+    REQUIRE(!builder.add(slice));
+  auto x = builder.finish();
+  auto dictionaries = fbs::GetSegment(x.chunk()->data())->dictionaries();
+  REQUIRE(dictionaries);
+  CHECK_EQUAL(dictionaries->size(), 1u);
+  auto xs = x.lookup(x.ids());
+  REQUIRE(xs);
+  REQUIRE_EQUAL(xs->size(), zeek_full_conn_log_slices.size());
+  for (size_t i = 0; i < xs->size(); ++i)
+    CHECK_EQUAL(*(*xs)[i], *zeek_full_conn_log_slices[i]);
+}
+
+#endif // VAST_HAVE_ZSTD
+
+TEST(lookup with statistics) {
+  factory<synopsis>::initialize();
+  // The first column of the conn log holds the connection timestamps.
+  REQUIRE_EQUAL(zeek_conn_log_slices[0]->layout().fields[0].name, "ts");
+  auto latest = [](const table_slice& slice) {
+    auto result = vast::time{};
+    for (size_t row = 0; row < slice.rows(); ++row)
+      result = std::max(result, caf::get<view<vast::time>>(slice.at(row, 0)));
+    return result;
+  };
+  auto threshold = latest(*zeek_conn_log_slices[0]);
+  auto expr = expression{
+    predicate{field_extractor{"ts"}, greater, data{threshold}}};
+  std::vector<table_slice_ptr> expected;
+  for (auto& slice : zeek_conn_log_slices)
+    if (latest(*slice) > threshold)
+      expected.push_back(slice);
+  REQUIRE_LESS(expected.size(), zeek_conn_log_slices.size());
+  std::vector<segment_compression> configs = {{}, {compression::lz4}};
+  for (auto& config : configs) {
+    MESSAGE("skip table slices compressed with " << config.method);
+    segment_builder builder{config};
+    for (auto& slice : zeek_conn_log_slices)
+      REQUIRE(!builder.add(slice));
+    auto x = builder.finish();
+    auto xs = x.lookup(x.ids(), expr);
+    REQUIRE(xs);
+    REQUIRE_EQUAL(xs->size(), expected.size());
+    for (size_t i = 0; i < xs->size(); ++i)
+      CHECK_EQUAL(*(*xs)[i], *expected[i]);
+    MESSAGE("skip table slices of other types");
+    auto other_type = expression{predicate{attribute_extractor{atom::type_v},
+                                           equal, data{"zeek.dns"}}};
+    xs = x.lookup(x.ids(), other_type);
+    REQUIRE(xs);
+    CHECK(xs->empty());
+    MESSAGE("skip nothing without a query");
+    xs = x.lookup(x.ids(), expression{});
+    REQUIRE(xs);
+    CHECK_EQUAL(xs->size(), zeek_conn_log_slices.size());
+  }
+}
+
+TEST(lookup with statistics - membership and mixed types) {
+  factory<synopsis>::initialize();
+  auto layout = zeek_conn_log_slices[0]->layout();
+  auto& fields = layout.fields;
+  auto field = std::find_if(fields.begin(), fields.end(), [](auto& x) {
+    return x.name == "orig_bytes";
+  });
+  REQUIRE(field != fields.end());
+  REQUIRE(caf::holds_alternative<count_type>(field->type));
+  auto column = static_cast<size_t>(std::distance(fields.begin(), field));
+  auto value = caf::optional<count>{};
+  for (size_t row = 0; row < zeek_conn_log_slices[0]->rows() && !value;
+       ++row) {
+    auto x = zeek_conn_log_slices[0]->at(row, column);
+    if (auto y = caf::get_if<view<count>>(&x))
+      value = *y;
+  }
+  REQUIRE(value);
+  auto huge = std::numeric_limits<count>::max();
+  segment_builder builder;
+  for (auto& slice : zeek_conn_log_slices)
+    REQUIRE(!builder.add(slice));
+  auto x = builder.finish();
+  // Statistics may keep slices without hits, but must never drop a slice
+  // that contains a matching row.
+  auto lookup = [&](relational_operator op, data rhs) {
+    auto expr = expression{predicate{field_extractor{"orig_bytes"}, op, rhs}};
+    auto tailored = unbox(tailor(expr, layout));
+    auto xs = unbox(x.lookup(x.ids(), expr));
+    for (auto& slice : zeek_conn_log_slices) {
+      auto hit = false;
+      for (size_t row = 0; row < slice->rows() && !hit; ++row)
+        hit = evaluate_at(*slice, row, tailored);
+      auto kept = std::any_of(xs.begin(), xs.end(),
+                              [&](auto& y) { return *y == *slice; });
+      if (hit)
+        CHECK(kept);
+    }
+    return xs;
+  };
+  MESSAGE("membership in a list of counts");
+  CHECK(!lookup(in, data{list{*value, huge}}).empty());
+  CHECK(lookup(in, data{list{huge}}).empty());
+  CHECK_EQUAL(lookup(not_in, data{list{huge}}).size(),
+              zeek_conn_log_slices.size());
+  MESSAGE("integers cannot rule out count columns");
+  auto all = zeek_conn_log_slices.size();
+  CHECK_EQUAL(lookup(in, data{list{integer{-1}, huge}}).size(), all);
+  CHECK_EQUAL(lookup(equal, data{integer{-1}}).size(), all);
+  CHECK_EQUAL(lookup(less, data{integer{-1}}).size(), all);
+  CHECK_EQUAL(lookup(greater, data{integer{-1}}).size(), all);
+  MESSAGE("nil cells satisfy negated comparisons");
+  CHECK_EQUAL(lookup(not_equal, data{*value}).size(), all);
+}
+
 TEST(serialization) {
   segment_builder builder;
   auto slice = zeek_conn_log_slices[0];
@@ -34,7 +34,8 @@ namespace {
 
 struct fixture : fixtures::deterministic_actor_system_and_events {
   fixture() {
-    store = segment_store::make(directory / "segments", 512_KiB, 2);
+    store = segment_store::make(directory / "segments", 512_KiB, 2, 1_MiB,
+                                1_MiB);
     if (store == nullptr)
       FAIL("segment_store::make failed to allocate a segment store");
     segment_path = store->segment_path();
@@ -181,6 +182,26 @@ TEST(querying filled segment store) {
   CHECK_EQUAL(val(slices[1]), val(zeek_conn_log_slices[2]));
 }
 
+TEST(cache tiers) {
+  MESSAGE("freshly written segments enter both tiers");
+  put_hot(zeek_conn_log_slices);
+  CHECK(deep_compare(zeek_conn_log_slices, get(everything)));
+  CHECK_EQUAL(store->slice_cache_stats().hits, 1u);
+  CHECK_EQUAL(store->segment_cache_stats().hits, 0u);
+  MESSAGE("a segment enters the slice tier only on its second access");
+  store->clear_cache();
+  CHECK(deep_compare(zeek_conn_log_slices, get(everything)));
+  CHECK_EQUAL(store->segment_cache_stats().misses, 1u);
+  CHECK(deep_compare(zeek_conn_log_slices, get(everything)));
+  CHECK_EQUAL(store->segment_cache_stats().hits, 1u);
+  auto slices = get(make_ids({0, 6, 19, 21}));
+  REQUIRE_EQUAL(slices.size(), 2u);
+  CHECK_EQUAL(val(slices[0]), val(zeek_conn_log_slices[0]));
+  CHECK_EQUAL(val(slices[1]), val(zeek_conn_log_slices[2]));
+  CHECK_EQUAL(store->slice_cache_stats().hits, 2u);
+  CHECK_EQUAL(store->segment_cache_stats().hits, 1u);
+}
+
 TEST(sessionized extraction on empty segment store) {
   auto session = store->extract(make_ids({0, 6, 19, 21}));
   std::vector<table_slice_ptr> slices;
@@ -200,6 +221,35 @@ TEST(sessionized extraction on filled segment store) {
   CHECK_EQUAL(val(slices[1]).offset(), 16u);
 }
 
+#if VAST_HAVE_ZSTD
+
+TEST(finishing segments on a thread pool) {
+  detail::thread_pool pool{1};
+  store = segment_store::make(directory / "pooled", 1, 2, 1_MiB, 1_MiB,
+                              segment_compression{compression::zstd, 3, true},
+                              &pool);
+  REQUIRE(store != nullptr);
+  segment_path = store->segment_path();
+  MESSAGE("every table slice fills a segment of its own");
+  put(zeek_conn_log_slices);
+  CHECK(deep_compare(zeek_conn_log_slices, get(everything)));
+  auto session = store->extract(make_ids({0, 6, 19, 21}));
+  std::vector<table_slice_ptr> slices;
+  for (auto x = session->next(); x.engaged(); x = session->next())
+    slices.emplace_back(unbox(x));
+  REQUIRE_EQUAL(slices.size(), 2u);
+  CHECK_EQUAL(val(slices[0]), val(zeek_conn_log_slices[0]));
+  CHECK_EQUAL(val(slices[1]), val(zeek_conn_log_slices[2]));
+  MESSAGE("flushing waits for the pool");
+  REQUIRE_EQUAL(store->flush(), caf::none);
+  CHECK(!store->dirty());
+  CHECK_EQUAL(segment_files().size(), 3u);
+  CHECK(deep_compare(zeek_conn_log_slices, get(everything)));
+  store.reset();
+}
+
+#endif // VAST_HAVE_ZSTD
+
 TEST(erase on empty segment store) {
   erase(make_ids({0, 6, 19, 21}));
   auto slices = get(everything);
@@ -0,0 +1,141 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE string_synopsis
+
+#include "vast/string_synopsis.hpp"
+
+#include <vast/concept/hashable/xxhash.hpp>
+#include <vast/si_literals.hpp>
+#include <vast/synopsis.hpp>
+#include <vast/synopsis_factory.hpp>
+#include <vast/test/fixtures/actor_system.hpp>
+#include <vast/test/synopsis.hpp>
+#include <vast/test/test.hpp>
+#include <vast/type.hpp>
+
+using namespace std::string_literals;
+using namespace vast;
+using namespace vast::test;
+using namespace vast::si_literals;
+
+TEST(failed construction) {
+  // If there's neither a type attribute with Bloom filter parameters nor a
+  // partition size, construction fails.
+  auto x = make_string_synopsis<xxhash64>(string_type{}, caf::settings{});
+  CHECK_EQUAL(x, nullptr);
+}
+
+namespace {
+
+struct fixture : fixtures::deterministic_actor_system {
+  fixture() {
+    factory<synopsis>::add(string_type{}, make_string_synopsis<xxhash64>);
+  }
+  caf::settings opts;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(string_synopsis_tests, fixture)
+
+TEST(construction via custom factory) {
+  using namespace nft;
+  auto t = string_type{}.attributes({{"synopsis", "bloomfilter(1000,0.1)"}});
+  auto x = factory<synopsis>::make(t, opts);
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(make_data_view("foo"));
+  x->add(make_data_view("bar"));
+  auto verify = verifier{x};
+  verify(make_data_view("foo"), {N, N, N, N, N, N, T, N, N, N, N, N});
+  verify(make_data_view("bar"), {N, N, N, N, N, N, T, N, N, N, N, N});
+  verify(make_data_view("baz"), {N, N, N, N, N, N, F, N, N, N, N, N});
+  MESSAGE("membership");
+  auto xs = data{list{"baz"s, "qux"s}};
+  verify(make_view(xs), {N, N, F, N, N, N, N, N, N, N, N, N});
+  auto ys = data{list{"baz"s, "foo"s}};
+  verify(make_view(ys), {N, N, T, N, N, N, N, N, N, N, N, N});
+  MESSAGE("type mismatch");
+  verify(count{42}, {N, N, N, N, N, N, N, N, N, N, N, N});
+}
+
+TEST(serialization with custom attribute type) {
+  auto t = string_type{}.attributes({{"synopsis", "bloomfilter(1000,0.1)"}});
+  CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(t, opts));
+}
+
+TEST(construction based on partition size) {
+  opts["max-partition-size"] = 1_Mi;
+  auto ptr = factory<synopsis>::make(string_type{}, opts);
+  REQUIRE_NOT_EQUAL(ptr, nullptr);
+  CHECK_ROUNDTRIP_DEREF(ptr);
+}
+
+TEST(batch) {
+  opts["max-partition-size"] = 100;
+  auto x = factory<synopsis>::make(string_type{}, opts);
+  auto y = factory<synopsis>::make(string_type{}, opts);
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  REQUIRE_NOT_EQUAL(y, nullptr);
+  auto xs = std::vector<std::string_view>{"foo", "bar", "baz"};
+  for (auto s : xs)
+    x->add(s);
+  y->add_batch(span<const std::string_view>{xs});
+  CHECK(*x == *y);
+  CHECK_EQUAL(y->lookup(equal, std::string_view{"bar"}),
+              caf::optional<bool>{true});
+}
+
+TEST(construction within memory budget) {
+  opts["max-partition-size"] = 100'000;
+  opts["max-synopsis-size"] = 64_Ki;
+  auto ptr = factory<synopsis>::make(string_type{}, opts);
+  REQUIRE_NOT_EQUAL(ptr, nullptr);
+  auto params = unbox(evaluate(unbox(parse_parameters(ptr->type()))));
+  CHECK_GREATER(*params.p, 0.01);
+  CHECK_LESS_EQUAL(*params.m, 8 * 64_Ki + 64);
+  CHECK_ROUNDTRIP_DEREF(ptr);
+}
+
+TEST(shrinking) {
+  using synopsis_type = string_synopsis<xxhash64>;
+  opts["max-partition-size"] = 1_Mi;
+  auto x = factory<synopsis>::make(string_type{}, opts);
+  auto y = factory<synopsis>::make(string_type{}, opts);
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  REQUIRE_NOT_EQUAL(y, nullptr);
+  auto size = static_cast<synopsis_type&>(*x).filter().size();
+  x->add(make_data_view("foo"));
+  x->add(make_data_view("bar"));
+  x->shrink(2);
+  auto shrunk_size = static_cast<synopsis_type&>(*x).filter().size();
+  CHECK_LESS(shrunk_size, 8192u);
+  CHECK_EQUAL(size % shrunk_size, 0u);
+  CHECK_EQUAL(x->lookup(equal, std::string_view{"foo"}),
+              caf::optional<bool>{true});
+  CHECK_EQUAL(x->lookup(equal, std::string_view{"bar"}),
+              caf::optional<bool>{true});
+  CHECK_ROUNDTRIP_DEREF(x);
+  MESSAGE("a full synopsis does not shrink");
+  y->add(make_data_view("baz"));
+  y->shrink(1_Mi);
+  CHECK_EQUAL(static_cast<synopsis_type&>(*y).filter().size(), size);
+  MESSAGE("synopses of different sizes merge");
+  REQUIRE(y->merge(*x));
+  CHECK_EQUAL(static_cast<synopsis_type&>(*y).filter().size(), size);
+  for (auto s : {"foo", "bar", "baz"})
+    CHECK_EQUAL(y->lookup(equal, std::string_view{s}),
+                caf::optional<bool>{true});
+}
+
+FIXTURE_SCOPE_END()
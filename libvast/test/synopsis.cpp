@@ -23,6 +23,7 @@
 #include <caf/binary_serializer.hpp>
 
 #include "vast/bool_synopsis.hpp"
+#include "vast/port_synopsis.hpp"
 #include "vast/synopsis_factory.hpp"
 #include "vast/time_synopsis.hpp"
 
@@ -50,24 +51,24 @@ TEST(min-max synopsis) {
   verify(zero, {N, N, N, N, N, N, F, T, F, F, T, T});
   MESSAGE("[4,7] op 4");
   time four = epoch + 4s;
-  verify(four, {N, N, N, N, N, N, T, F, F, T, T, T});
+  verify(four, {N, N, N, N, N, N, T, T, F, T, T, T});
   MESSAGE("[4,7] op 6");
   time six = epoch + 6s;
-  verify(six, {N, N, N, N, N, N, T, F, T, T, T, T});
+  verify(six, {N, N, N, N, N, N, T, T, T, T, T, T});
   MESSAGE("[4,7] op 7");
   time seven = epoch + 7s;
-  verify(seven, {N, N, N, N, N, N, T, F, T, T, F, T});
+  verify(seven, {N, N, N, N, N, N, T, T, T, T, F, T});
   MESSAGE("[4,7] op 9");
   time nine = epoch + 9s;
   verify(nine, {N, N, N, N, N, N, F, T, T, T, F, F});
   MESSAGE("[4,7] op [0, 4]");
   auto zero_four = data{list{zero, four}};
   auto zero_four_view = make_view(zero_four);
-  verify(zero_four_view, {N, N, T, F, N, N, N, N, N, N, N, N});
+  verify(zero_four_view, {N, N, T, T, N, N, N, N, N, N, N, N});
   MESSAGE("[4,7] op [7, 9]");
   auto seven_nine = data{list{seven, nine}};
   auto seven_nine_view = make_view(seven_nine);
-  verify(seven_nine_view, {N, N, T, F, N, N, N, N, N, N, N, N});
+  verify(seven_nine_view, {N, N, T, T, N, N, N, N, N, N, N, N});
   MESSAGE("[4,7] op [0, 9]");
   auto zero_nine = data{list{zero, nine}};
   auto zero_nine_view = make_view(zero_nine);
@@ -79,7 +80,88 @@ TEST(min-max synopsis) {
   MESSAGE("[4,7] op [count{5}, 7]");
   auto heterogeneous = data{list{c, seven}};
   auto heterogeneous_view = make_view(heterogeneous);
-  verify(heterogeneous_view, {N, N, T, F, N, N, N, N, N, N, N, N});
+  verify(heterogeneous_view, {N, N, N, N, N, N, N, N, N, N, N, N});
+}
+
+TEST(min-max synopsis - arithmetic types) {
+  using namespace nft;
+  factory<synopsis>::initialize();
+  MESSAGE("integer");
+  auto x = factory<synopsis>::make(integer_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(integer{-4});
+  x->add(integer{7});
+  auto verify = verifier{x};
+  verify(integer{-5}, {N, N, N, N, N, N, F, T, F, F, T, T});
+  verify(integer{0}, {N, N, N, N, N, N, T, T, T, T, T, T});
+  verify(integer{8}, {N, N, N, N, N, N, F, T, T, T, F, F});
+  MESSAGE("int_field in [1, 2] with count literals");
+  auto counts = data{list{count{1}, count{2}}};
+  verify(make_view(counts), {N, N, N, N, N, N, N, N, N, N, N, N});
+  auto mixed = data{list{integer{8}, count{1}}};
+  verify(make_view(mixed), {N, N, N, N, N, N, N, N, N, N, N, N});
+  MESSAGE("count");
+  auto y = factory<synopsis>::make(count_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(y, nullptr);
+  y->add(count{4});
+  verify = verifier{y};
+  verify(count{4}, {N, N, N, N, N, N, T, F, F, T, F, T});
+  verify(count{5}, {N, N, N, N, N, N, F, T, T, T, F, F});
+  auto four = data{list{count{4}}};
+  verify(make_view(four), {N, N, T, F, N, N, N, N, N, N, N, N});
+  MESSAGE("real");
+  auto z = factory<synopsis>::make(real_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(z, nullptr);
+  verify = verifier{z};
+  MESSAGE("an empty synopsis matches nothing");
+  verify(real{0.0}, {N, N, N, N, N, N, F, T, F, F, F, F});
+  z->add(real{0.5});
+  verify(real{0.5}, {N, N, N, N, N, N, T, F, F, T, F, T});
+}
+
+TEST(min-max synopsis - batch) {
+  using vast::time;
+  factory<synopsis>::initialize();
+  auto xs = std::vector<integer>{3, -4, 7, 0};
+  auto x = factory<synopsis>::make(integer_type{}, caf::settings{});
+  auto y = factory<synopsis>::make(integer_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  REQUIRE_NOT_EQUAL(y, nullptr);
+  for (auto i : xs)
+    x->add(i);
+  y->add_batch(span<const integer>{xs});
+  CHECK(*x == *y);
+  MESSAGE("time");
+  auto ts = std::vector<time>{epoch + 7s, epoch + 4s, epoch + 5s};
+  auto t = factory<synopsis>::make(time_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(t, nullptr);
+  t->add_batch(span<const time>{ts});
+  auto& minmax = static_cast<const time_synopsis&>(*t);
+  CHECK_EQUAL(minmax.min(), epoch + 4s);
+  CHECK_EQUAL(minmax.max(), epoch + 7s);
+  MESSAGE("an empty batch leaves the synopsis untouched");
+  t->add_batch(span<const time>{});
+  CHECK_EQUAL(minmax.min(), epoch + 4s);
+}
+
+TEST(port synopsis) {
+  using namespace nft;
+  factory<synopsis>::initialize();
+  auto x = factory<synopsis>::make(port_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(port{53, port::udp});
+  x->add(port{80, port::tcp});
+  auto verify = verifier{x};
+  MESSAGE("the port type does not matter");
+  verify(port{53, port::tcp}, {N, N, N, N, N, N, T, N, F, T, T, T});
+  verify(port{80}, {N, N, N, N, N, N, T, N, T, T, F, T});
+  verify(port{443, port::tcp}, {N, N, N, N, N, N, F, N, T, T, F, F});
+  auto xs = data{list{port{22}, port{443}}};
+  verify(make_view(xs), {N, N, F, N, N, N, N, N, N, N, N, N});
+  MESSAGE("only ports compare with ports");
+  verify(count{53}, {N, N, N, N, N, N, N, N, N, N, N, N});
+  auto ys = data{list{port{443}, count{53}}};
+  verify(make_view(ys), {N, N, N, N, N, N, N, N, N, N, N, N});
 }
 
 FIXTURE_SCOPE(synopsis_tests, fixtures::deterministic_actor_system)
@@ -89,6 +171,11 @@ TEST(serialization) {
   CHECK_ROUNDTRIP(synopsis_ptr{});
   CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(bool_type{}, caf::settings{}));
   CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(time_type{}, caf::settings{}));
+  CHECK_ROUNDTRIP_DEREF(
+    factory<synopsis>::make(integer_type{}, caf::settings{}));
+  CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(count_type{}, caf::settings{}));
+  CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(real_type{}, caf::settings{}));
+  CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(port_type{}, caf::settings{}));
 }
 
 FIXTURE_SCOPE_END()
@@ -13,7 +13,9 @@
 
 #include "vast/concept/printable/stream.hpp"
 #include "vast/concept/printable/vast/event.hpp"
+#include "vast/defaults.hpp"
 #include "vast/ids.hpp"
+#include "vast/si_literals.hpp"
 #include "vast/system/archive.hpp"
 #include "vast/table_slice.hpp"
 #include "vast/to_events.hpp"
@@ -26,6 +28,7 @@
 
 using namespace caf;
 using namespace vast;
+using namespace vast::binary_byte_literals;
 
 namespace {
 
@@ -33,7 +36,11 @@ struct fixture : fixtures::deterministic_actor_system_and_events {
   system::archive_type a;
 
   fixture() {
-    a = self->spawn(system::archive, directory, 10, 1024 * 1024);
+    // The deterministic scheduler cannot receive messages from other threads.
+    a = self->spawn(system::archive, directory, 10, 1024 * 1024, 64_MiB,
+                    16_MiB, segment_compression{compression::lz4}, 0,
+                    defaults::system::max_extraction_sessions,
+                    defaults::system::extraction_batch_size);
     self->send(a, atom::exporter_v, self);
   }
 
@@ -44,11 +51,15 @@ struct fixture : fixtures::deterministic_actor_system_and_events {
   }
 
   std::vector<event> query(const ids& ids) {
-    bool done = false;
-    std::vector<event> result;
     self->send(a, ids);
     run();
-    self
+    return receive(self, ids);
+  }
+
+  std::vector<event> receive(caf::scoped_actor& requester, const ids& ids) {
+    bool done = false;
+    std::vector<event> result;
+    requester
       ->do_receive(
         [&](vast::atom::done, const caf::error& err) {
           REQUIRE(!err);
@@ -99,4 +110,21 @@ TEST(archiving and querying) {
   self->send_exit(a, exit_reason::user_shutdown);
 }
 
+TEST(concurrent queries) {
+  push_to_archive(zeek_conn_log_slices);
+  caf::scoped_actor other{sys};
+  other->send(a, atom::exporter_v, other);
+  auto xs = make_ids({{0, 20}});
+  auto ys = make_ids({{5, 15}, {50, 60}});
+  self->send(a, xs);
+  other->send(a, ys);
+  run();
+  auto& st = deref<system::archive_type::stateful_base<system::archive_state>>(a)
+               .state;
+  CHECK(st.sessions.empty());
+  CHECK(st.requesters.empty());
+  CHECK_EQUAL(receive(self, xs).size(), 20u);
+  CHECK_EQUAL(receive(other, ys).size(), 20u);
+}
+
 FIXTURE_SCOPE_END()
@@ -0,0 +1,101 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE compactor
+
+#include "vast/system/compactor.hpp"
+
+#include "vast/test/test.hpp"
+
+#include "vast/uuid.hpp"
+
+using namespace vast;
+using namespace vast::system;
+
+namespace {
+
+constexpr size_t max_partition_size = 100;
+
+struct fixture {
+  /// Creates one candidate per entry in `sizes` with ascending IDs.
+  void make_candidates(std::vector<size_t> sizes) {
+    vast::id first = 0;
+    for (auto size : sizes) {
+      candidates.push_back({uuid::random(), first, size});
+      first += size;
+    }
+  }
+
+  std::vector<uuid> ids(std::vector<size_t> indexes) const {
+    std::vector<uuid> result;
+    for (auto i : indexes)
+      result.push_back(candidates[i].id);
+    return result;
+  }
+
+  std::vector<uuid> plan() const {
+    return plan_compaction(candidates, max_partition_size, failed);
+  }
+
+  std::vector<compaction_candidate> candidates;
+  std::set<std::vector<uuid>> failed;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(compactor_tests, fixture)
+
+TEST(no candidates) {
+  CHECK(plan().empty());
+  make_candidates({10});
+  CHECK(plan().empty());
+}
+
+TEST(full partitions) {
+  make_candidates({100, 60, 100, 51});
+  CHECK(plan().empty());
+}
+
+TEST(adjacent small partitions) {
+  make_candidates({100, 10, 20, 30, 100});
+  CHECK_EQUAL(plan(), ids({1, 2, 3}));
+}
+
+TEST(capacity limit) {
+  make_candidates({50, 50, 40, 10});
+  CHECK_EQUAL(plan(), ids({0, 1}));
+}
+
+TEST(interrupted runs) {
+  make_candidates({10, 100, 20, 60, 30, 40});
+  CHECK_EQUAL(plan(), ids({4, 5}));
+}
+
+TEST(run starting at an overflowing partition) {
+  make_candidates({50, 40, 30, 20});
+  CHECK_EQUAL(plan(), ids({0, 1}));
+  candidates.erase(candidates.begin());
+  CHECK_EQUAL(plan(), ids({0, 1, 2}));
+}
+
+TEST(failed runs) {
+  make_candidates({10, 20, 30, 100, 40, 50});
+  failed.insert(ids({0, 1, 2}));
+  CHECK_EQUAL(plan(), ids({1, 2}));
+  failed.insert(ids({1, 2}));
+  CHECK_EQUAL(plan(), ids({4, 5}));
+  failed.insert(ids({4, 5}));
+  CHECK(plan().empty());
+}
+
+FIXTURE_SCOPE_END()
@@ -25,6 +25,7 @@
 #include "vast/detail/spawn_container_source.hpp"
 #include "vast/fwd.hpp"
 #include "vast/ids.hpp"
+#include "vast/si_literals.hpp"
 #include "vast/system/archive.hpp"
 #include "vast/system/index.hpp"
 #include "vast/table_slice.hpp"
@@ -35,6 +36,7 @@
 #include <caf/stateful_actor.hpp>
 
 using namespace vast;
+using namespace vast::binary_byte_literals;
 using namespace system;
 
 using vast::expression;
@@ -64,11 +66,21 @@ struct fixture : fixtures::deterministic_actor_system_and_events {
   fixture() {
     // Spawn INDEX and ARCHIVE, and a mock client.
     MESSAGE("spawn INDEX ingest 4 slices with 100 rows (= 1 partition) each");
-    index = self->spawn(system::index, directory / "index",
-                        defaults::import::table_slice_size, 100, 3, 1);
+    system::index_options opts;
+    opts.max_partition_size = defaults::import::table_slice_size;
+    opts.in_mem_partitions = 100;
+    opts.taste_partitions = 3;
+    opts.num_workers = 1;
+    opts.meta_index_threads = 1;
+    index = self->spawn(system::index, directory / "index", opts);
     archive = self->spawn(system::archive, directory / "archive",
                           defaults::system::segments,
-                          defaults::system::max_segment_size);
+                          defaults::system::max_segment_size,
+                          defaults::system::segment_cache_size * 1_MiB,
+                          defaults::system::slice_cache_size * 1_MiB,
+                          segment_compression{}, 0,
+                          defaults::system::max_extraction_sessions,
+                          defaults::system::extraction_batch_size);
     client = sys.spawn(mock_client);
     // Fill the INDEX with 400 rows from the Zeek conn log.
     detail::spawn_container_source(sys, take(zeek_full_conn_log_slices, 4),
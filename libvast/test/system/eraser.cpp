@@ -56,7 +56,7 @@ struct mock_index_state {
 
 caf::behavior mock_index(caf::stateful_actor<mock_index_state>* self) {
   return {
-    [=](expression&) {
+    [=](atom::background, expression&) {
       auto& deltas = self->state.deltas;
       deltas = std::vector<ids>{
         make_ids({1, 3, 5}),    make_ids({7, 9, 11}),  make_ids({13, 15, 17}),
@@ -76,6 +76,9 @@ caf::behavior mock_index(caf::stateful_actor<mock_index_state>* self) {
         self->send(hdl, take_one(self->state.deltas));
       self->send(hdl, atom::done_v);
     },
+    [=](atom::erase, const ids&) {
+      // nop
+    },
   };
 }
 
@@ -124,7 +127,7 @@ TEST(eraser on mock INDEX) {
   spawn_aut();
   sched.trigger_timeouts();
   expect((atom::run), from(aut).to(aut));
-  expect((expression), from(aut).to(index));
+  expect((atom::background, expression), from(aut).to(index));
   expect((uuid, uint32_t, uint32_t),
          from(index).to(aut).with(query_id, 7u, 3u));
   expect((ids), from(index).to(aut));
@@ -139,6 +142,7 @@ TEST(eraser on mock INDEX) {
   expect((uuid, uint32_t), from(aut).to(index).with(query_id, 1u));
   expect((ids), from(index).to(aut));
   expect((atom::done), from(index).to(aut));
+  expect((atom::erase, ids), from(aut).to(index).with(_, make_ids({{1, 22}})));
   expect((atom::erase, ids),
          from(aut).to(archive).with(_, make_ids({{1, 22}})));
 }
@@ -146,8 +150,13 @@ TEST(eraser on mock INDEX) {
 TEST(eraser on actual INDEX with Zeek conn logs) {
   auto slices = take(zeek_full_conn_log_slices, 4);
   MESSAGE("spawn INDEX ingest 4 slices with 100 rows (= 1 partition) each");
-  index = self->spawn(system::index, directory / "index",
-                      defaults::import::table_slice_size, 100, taste_count, 1);
+  system::index_options opts;
+  opts.max_partition_size = defaults::import::table_slice_size;
+  opts.in_mem_partitions = 100;
+  opts.taste_partitions = taste_count;
+  opts.num_workers = 1;
+  opts.meta_index_threads = 1;
+  index = self->spawn(system::index, directory / "index", opts);
   detail::spawn_container_source(sys, std::move(slices), index);
   run();
   // Predicate for running all actors *except* aut.
@@ -156,7 +165,7 @@ TEST(eraser on actual INDEX with Zeek conn logs) {
   spawn_aut(":addr == 192.168.1.104");
   sched.trigger_timeouts();
   expect((atom::run), from(aut).to(aut));
-  expect((expression), from(aut).to(index));
+  expect((atom::background, expression), from(aut).to(index));
   expect((uuid, uint32_t, uint32_t), from(index).to(aut).with(_, 4u, 3u));
   sched.run_jobs_filtered(not_aut);
   while (allow((ids), from(_).to(aut)))
@@ -167,6 +176,7 @@ TEST(eraser on actual INDEX with Zeek conn logs) {
   while (allow((ids), from(_).to(aut)))
     ; // repeat
   expect((atom::done), from(_).to(aut));
+  expect((atom::erase, ids), from(aut).to(index));
   expect((atom::erase, ids), from(aut).to(archive));
   REQUIRE(!sched.has_job());
   // The magic number 133 was computed via:
@@ -61,10 +61,13 @@ ids select(const counts& xs, curried_predicate pred) {
   }
 }
 
-// Dummy actor representing an INDEXER for field `x`.
-caf::behavior dummy_indexer(counts xs) {
-  return {
-    [xs = std::move(xs)](curried_predicate pred) { return select(xs, pred); }};
+// Dummy actor representing an INDEXER for field `x`. Counts the received
+// lookups in `lookups`.
+caf::behavior dummy_indexer(counts xs, size_t* lookups) {
+  return {[xs = std::move(xs), lookups](curried_predicate pred) {
+    ++*lookups;
+    return select(xs, pred);
+  }};
 }
 
 struct fixture : fixtures::deterministic_actor_system_and_events {
@@ -85,12 +88,15 @@ struct fixture : fixtures::deterministic_actor_system_and_events {
   std::map<std::string, std::vector<caf::actor>> indexers;
 
   void add_indexer(std::vector<caf::actor>& container, counts data) {
-    container.emplace_back(sys.spawn(dummy_indexer, std::move(data)));
+    container.emplace_back(sys.spawn(dummy_indexer, std::move(data), &lookups));
   }
 
   record_type layout;
 
-  ids query(std::string_view expr_str) {
+  /// Counts the lookups received by all dummy INDEXER actors.
+  size_t lookups = 0;
+
+  ids query(std::string_view expr_str, selectivity_estimates estimates = {}) {
     auto expr = unbox(to<expression>(expr_str));
     evaluation_triples triples;
     auto resolved = resolve(expr, layout);
@@ -103,7 +109,8 @@ struct fixture : fixtures::deterministic_actor_system_and_events {
       for (auto& x : xs)
         triples.emplace_back(expr_position, curried(pred), x);
     }
-    auto eval = sys.spawn(system::evaluator, expr, std::move(triples));
+    auto eval = sys.spawn(system::evaluator, expr, std::move(triples),
+                          std::move(estimates));
     self->send(eval, self);
     run();
     ids result;
@@ -171,4 +178,32 @@ TEST(disjunctions) {
   CHECK_QUERY("x == 75 || y == 77", ({3, 5}));
 }
 
+TEST(predicate ordering) {
+  MESSAGE("equality tests go first by default");
+  CHECK_QUERY("y != 10 && x == 98", ({}));
+  CHECK_EQUAL(lookups, 2u);
+  lookups = 0;
+  CHECK_QUERY("x == 42 && y != 10", ({1, 3, 4}));
+  CHECK_EQUAL(lookups, 4u);
+  MESSAGE("estimates override the default order");
+  lookups = 0;
+  selectivity_estimates estimates{{offset{0, 0}, 0.9}, {offset{0, 1}, 0.1}};
+  CHECK_EQUAL(pad_result(query("x == 98 && y != 10", estimates)),
+              pad_result(make_ids({})));
+  CHECK_EQUAL(lookups, 4u);
+  lookups = 0;
+  estimates = {{offset{0, 0}, 0.1}, {offset{0, 1}, 0.9}};
+  CHECK_EQUAL(pad_result(query("x == 98 && y != 10", estimates)),
+              pad_result(make_ids({})));
+  CHECK_EQUAL(lookups, 2u);
+  MESSAGE("disjunctions never skip lookups");
+  lookups = 0;
+  CHECK_QUERY("x == 98 || y != 10", ({1, 3, 4, 8}));
+  CHECK_EQUAL(lookups, 4u);
+  MESSAGE("nested conjunctions short-circuit independently");
+  lookups = 0;
+  CHECK_QUERY("(x == 98 && y == 42) || y == 77", ({3}));
+  CHECK_EQUAL(lookups, 4u);
+}
+
 FIXTURE_SCOPE_END()
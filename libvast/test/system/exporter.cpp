@@ -21,8 +21,10 @@
 
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/expression.hpp"
+#include "vast/defaults.hpp"
 #include "vast/detail/spawn_container_source.hpp"
 #include "vast/query_options.hpp"
+#include "vast/si_literals.hpp"
 #include "vast/system/archive.hpp"
 #include "vast/system/importer.hpp"
 #include "vast/system/index.hpp"
@@ -31,6 +33,7 @@
 
 using namespace caf;
 using namespace vast;
+using namespace vast::binary_byte_literals;
 
 using std::string;
 using std::chrono_literals::operator""ms;
@@ -58,11 +61,21 @@ struct fixture : fixture_base {
   }
 
   void spawn_index() {
-    index = self->spawn(system::index, directory / "index", 10000, 5, 5, 1);
+    system::index_options opts;
+    opts.max_partition_size = 10000;
+    opts.in_mem_partitions = 5;
+    opts.taste_partitions = 5;
+    opts.num_workers = 1;
+    opts.meta_index_threads = 1;
+    index = self->spawn(system::index, directory / "index", opts);
   }
 
   void spawn_archive() {
-    archive = self->spawn(system::archive, directory / "archive", 1, 1024);
+    // The deterministic scheduler cannot receive messages from other threads.
+    archive = self->spawn(system::archive, directory / "archive", 1, 1024,
+                          1_MiB, 1_MiB, segment_compression{}, 0,
+                          defaults::system::max_extraction_sessions,
+                          defaults::system::extraction_batch_size);
   }
 
   void spawn_importer() {
@@ -24,6 +24,8 @@
 #include "vast/concept/printable/std/chrono.hpp"
 #include "vast/concept/printable/to_string.hpp"
 #include "vast/concept/printable/vast/event.hpp"
+#include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/defaults.hpp"
 #include "vast/detail/spawn_container_source.hpp"
 #include "vast/detail/spawn_generator_source.hpp"
 #include "vast/event.hpp"
@@ -50,8 +52,17 @@ static constexpr size_t num_query_supervisors = 1;
 struct fixture : fixtures::deterministic_actor_system_and_events {
   fixture() {
     directory /= "index";
-    index = self->spawn(system::index, directory / "index", slice_size,
-                        in_mem_partitions, taste_count, num_query_supervisors);
+    index = self->spawn(system::index, directory / "index", make_options());
+  }
+
+  system::index_options make_options() const {
+    system::index_options result;
+    result.max_partition_size = slice_size;
+    result.in_mem_partitions = in_mem_partitions;
+    result.taste_partitions = taste_count;
+    result.num_workers = num_query_supervisors;
+    result.meta_index_threads = 1;
+    return result;
   }
 
   ~fixture() {
@@ -221,4 +232,94 @@ TEST(iterable zeek conn log query result) {
   }
 }
 
+TEST(partition-wide indexing engine) {
+  MESSAGE("respawn INDEX with in-place column indexes");
+  anon_send_exit(index, caf::exit_reason::user_shutdown);
+  run();
+  auto opts = make_options();
+  opts.indexing_threads = 2;
+  opts.flush_threads = 0;
+  index = self->spawn(system::index, directory / "partition-engine", opts);
+  MESSAGE("ingest conn.log slices");
+  detail::spawn_container_source(sys, zeek_conn_log_slices, index);
+  run();
+  CHECK_EQUAL(state().active_partition_indexers, 0u);
+  CHECK(state().unpersisted.empty());
+  MESSAGE("query partitions from disk and the active partition");
+  auto expected_result = make_ids({5, 6, 9, 11});
+  auto [query_id, hits, scheduled] = query("id.orig_h == 192.168.1.104");
+  auto result = receive_result(query_id, hits, scheduled);
+  if (result.size() < expected_result.size())
+    result.append_bits(false, expected_result.size() - result.size());
+  else
+    expected_result.append_bits(false, result.size() - expected_result.size());
+  CHECK_EQUAL(result, expected_result);
+}
+
+TEST(partitions without manifest) {
+  MESSAGE("ingest conn.log slices and shut down");
+  detail::spawn_container_source(sys, zeek_conn_log_slices, index);
+  run();
+  auto num_partitions = state().meta_idx.num_partitions();
+  REQUIRE_GREATER(num_partitions, 1u);
+  auto partition_dir = directory / "index"
+                       / to_string(state().meta_idx.partitions().front());
+  anon_send_exit(index, caf::exit_reason::user_shutdown);
+  run();
+  MESSAGE("simulate a crash before writing the meta file of a partition");
+  REQUIRE(exists(partition_dir / "meta"));
+  REQUIRE(rm(partition_dir / "meta"));
+  MESSAGE("restart the INDEX");
+  index = self->spawn(system::index, directory / "index", make_options());
+  run();
+  CHECK_EQUAL(state().meta_idx.num_partitions(), num_partitions - 1);
+  CHECK(!exists(partition_dir));
+}
+
+TEST(batched queries) {
+  MESSAGE("respawn INDEX with a query batch window and two workers");
+  anon_send_exit(index, caf::exit_reason::user_shutdown);
+  run();
+  auto opts = make_options();
+  opts.num_workers = 2;
+  opts.query_batch_window = caf::timespan{milliseconds{10}};
+  index = self->spawn(system::index, directory / "batched", opts);
+  run();
+  MESSAGE("ingest conn.log slices");
+  detail::spawn_container_source(sys, zeek_conn_log_slices, index);
+  run();
+  MESSAGE("issue the same query twice within the window");
+  auto expr = unbox(to<expression>("id.orig_h == 192.168.1.104"));
+  self->send(index, expr);
+  self->send(index, expr);
+  run();
+  CHECK(self->mailbox().empty());
+  CHECK_EQUAL(state().query_batch.size(), 2u);
+  MESSAGE("evaluate both queries once the window closes");
+  sched.trigger_timeouts();
+  run();
+  CHECK(state().query_batch.empty());
+  CHECK_GREATER(state().shared_lookups, 0u);
+  size_t responses = 0;
+  size_t done = 0;
+  ids result;
+  while (!self->mailbox().empty())
+    self->receive(
+      [&](uuid& query_id, uint32_t hits, uint32_t scheduled) {
+        CHECK_EQUAL(query_id, uuid::nil());
+        CHECK_EQUAL(hits, scheduled);
+        ++responses;
+      },
+      [&](ids& hits) { result |= hits; },
+      [&](atom::done) { ++done; });
+  CHECK_EQUAL(responses, 2u);
+  CHECK_EQUAL(done, 2u);
+  auto expected_result = make_ids({5, 6, 9, 11});
+  if (result.size() < expected_result.size())
+    result.append_bits(false, expected_result.size() - result.size());
+  else
+    expected_result.append_bits(false, result.size() - expected_result.size());
+  CHECK_EQUAL(result, expected_result);
+}
+
 FIXTURE_SCOPE_END()
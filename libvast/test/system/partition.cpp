@@ -119,7 +119,8 @@ struct fixture : fixtures::dummy_index {
   ids query(std::string_view query_str) {
     VAST_ASSERT(put != nullptr);
     auto expr = unbox(to<expression>(query_str));
-    auto eval = sys.spawn(system::evaluator, expr, put->eval(expr));
+    auto eval = sys.spawn(system::evaluator, expr, put->eval(expr),
+                          put->estimate_selectivity(expr));
     self->send(eval, self);
     run();
     ids result;
@@ -0,0 +1,113 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE predicate_cache
+
+#include "vast/system/predicate_cache.hpp"
+
+#include "vast/test/test.hpp"
+
+#include "vast/data.hpp"
+#include "vast/ids.hpp"
+#include "vast/uuid.hpp"
+
+using namespace vast;
+using namespace vast::system;
+
+namespace {
+
+struct fixture {
+  fixture() : partition_id{uuid::random()} {
+    x = make_ids({1, 3, 5}, 20);
+    y = make_ids({2, 4, 6}, 20);
+    z = make_ids({11, 13, 15}, 20);
+  }
+
+  predicate_cache::key make_key(std::string column, count value) {
+    return predicate_cache::make_key(partition_id, std::move(column),
+                                     {equal, data{value}});
+  }
+
+  uuid partition_id;
+  ids x;
+  ids y;
+  ids z;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(predicate_cache_tests, fixture)
+
+TEST(key normalization) {
+  auto pred = [](list xs) { return curried_predicate{in, data{xs}}; };
+  auto k0 = predicate_cache::make_key(partition_id, "zeek.conn.id.orig_p",
+                                      pred({count{3}, count{1}, count{1}}));
+  auto k1 = predicate_cache::make_key(partition_id, "zeek.conn.id.orig_p",
+                                      pred({count{1}, count{3}}));
+  auto k2 = predicate_cache::make_key(partition_id, "zeek.conn.id.resp_p",
+                                      pred({count{1}, count{3}}));
+  CHECK(k0 == k1);
+  CHECK_EQUAL(predicate_cache::key_hash{}(k0), predicate_cache::key_hash{}(k1));
+  CHECK(!(k1 == k2));
+}
+
+TEST(hits and misses) {
+  predicate_cache cache{1'000'000};
+  CHECK_EQUAL(cache.lookup(make_key("x", 42)), nullptr);
+  cache.add(make_key("x", 42), x);
+  auto result = cache.lookup(make_key("x", 42));
+  REQUIRE_NOT_EQUAL(result, nullptr);
+  CHECK_EQUAL(*result, x);
+  CHECK_EQUAL(cache.lookup(make_key("y", 42)), nullptr);
+  CHECK_EQUAL(cache.stats().hits, 1u);
+  CHECK_EQUAL(cache.stats().misses, 2u);
+  CHECK_EQUAL(cache.size(), 1u);
+  CHECK_EQUAL(cache.weight(), predicate_cache::weigh(x));
+}
+
+TEST(eviction by weight) {
+  auto w = predicate_cache::weigh(x);
+  REQUIRE_EQUAL(predicate_cache::weigh(y), w);
+  REQUIRE_EQUAL(predicate_cache::weigh(z), w);
+  predicate_cache cache{2 * w};
+  cache.add(make_key("x", 1), x);
+  cache.add(make_key("x", 2), y);
+  MESSAGE("touch the first result to make the second one least recent");
+  CHECK_NOT_EQUAL(cache.lookup(make_key("x", 1)), nullptr);
+  cache.add(make_key("x", 3), z);
+  CHECK_EQUAL(cache.size(), 2u);
+  CHECK_EQUAL(cache.weight(), 2 * w);
+  CHECK_EQUAL(cache.stats().evictions, 1u);
+  CHECK_NOT_EQUAL(cache.lookup(make_key("x", 1)), nullptr);
+  CHECK_EQUAL(cache.lookup(make_key("x", 2)), nullptr);
+  CHECK_NOT_EQUAL(cache.lookup(make_key("x", 3)), nullptr);
+  MESSAGE("results larger than the capacity never enter the cache");
+  predicate_cache tiny{w - 1};
+  tiny.add(make_key("x", 1), x);
+  CHECK_EQUAL(tiny.size(), 0u);
+}
+
+TEST(invalidation) {
+  predicate_cache cache{1'000'000};
+  cache.add(make_key("x", 1), x);
+  cache.add(make_key("x", 2), y);
+  cache.add(make_key("x", 3), z);
+  cache.invalidate(make_ids({4, 13}));
+  CHECK_EQUAL(cache.size(), 1u);
+  CHECK_EQUAL(cache.weight(), predicate_cache::weigh(x));
+  CHECK_EQUAL(cache.stats().invalidations, 2u);
+  CHECK_NOT_EQUAL(cache.lookup(make_key("x", 1)), nullptr);
+  CHECK_EQUAL(cache.lookup(make_key("x", 2)), nullptr);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,171 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE query_scheduler
+
+#include "vast/system/query_scheduler.hpp"
+
+#include "vast/test/fixtures/actor_system.hpp"
+#include "vast/test/test.hpp"
+
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/expression.hpp"
+#include "vast/uuid.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace vast;
+using namespace vast::system;
+
+namespace {
+
+caf::behavior dummy(caf::event_based_actor*) {
+  return {[](atom::done) {}};
+}
+
+struct fixture : fixtures::deterministic_actor_system {
+  fixture() {
+    for (auto i = 0; i < 2; ++i)
+      workers.push_back(sys.spawn(dummy));
+    for (auto i = 0; i < 2; ++i)
+      clients.push_back(sys.spawn(dummy));
+  }
+
+  /// Creates a query map with `n` partitions.
+  query_map make_query_map(size_t n) {
+    query_map result;
+    for (size_t i = 0; i < n; ++i)
+      result.emplace(uuid::random(), std::vector{sys.spawn(dummy)});
+    return result;
+  }
+
+  /// Assigns queued tasks to idle workers and records which client each
+  /// dispatched task belongs to.
+  void dispatch() {
+    scheduler.dispatch([&](const caf::actor& worker, const expression&,
+                           query_map qm, const caf::actor& client) {
+      CHECK_EQUAL(qm.size(), 1u);
+      assigned.emplace_back(worker, client);
+    });
+  }
+
+  /// Completes the oldest dispatched task.
+  caf::actor complete() {
+    REQUIRE(!assigned.empty());
+    auto worker = assigned.front().first;
+    assigned.erase(assigned.begin());
+    return scheduler.release(worker);
+  }
+
+  expression expr = unbox(to<expression>("x == 42"));
+  query_scheduler scheduler;
+  std::vector<caf::actor> workers;
+  std::vector<caf::actor> clients;
+  std::vector<std::pair<caf::actor, caf::actor>> assigned;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(query_scheduler_tests, fixture)
+
+TEST(fair share) {
+  scheduler.release(workers[0]);
+  scheduler.add(uuid::nil(), query_priority::interactive, expr, clients[0],
+                make_query_map(3));
+  scheduler.add(uuid::nil(), query_priority::interactive, expr, clients[1],
+                make_query_map(1));
+  CHECK_EQUAL(scheduler.queue_depth(), 4u);
+  MESSAGE("a single worker alternates between both queries");
+  std::vector<caf::actor> order;
+  for (dispatch(); !assigned.empty(); dispatch()) {
+    order.push_back(assigned.front().second);
+    auto client = complete();
+    if (order.size() == 2)
+      CHECK_EQUAL(client, clients[1]);
+    else if (order.size() == 4)
+      CHECK_EQUAL(client, clients[0]);
+    else
+      CHECK(!client);
+  }
+  std::vector<caf::actor> expected{clients[0], clients[1], clients[0],
+                                   clients[0]};
+  CHECK_EQUAL(order, expected);
+  CHECK_EQUAL(scheduler.jobs(), 0u);
+  CHECK_EQUAL(scheduler.stats().completed, 4u);
+}
+
+TEST(priorities) {
+  scheduler.add(uuid::nil(), query_priority::background, expr, clients[0],
+                make_query_map(2));
+  scheduler.add(uuid::nil(), query_priority::interactive, expr, clients[1],
+                make_query_map(2));
+  CHECK_EQUAL(scheduler.queue_depth(query_priority::background), 2u);
+  CHECK_EQUAL(scheduler.queue_depth(query_priority::interactive), 2u);
+  MESSAGE("idle workers pick interactive tasks first");
+  scheduler.release(workers[0]);
+  scheduler.release(workers[1]);
+  dispatch();
+  REQUIRE_EQUAL(assigned.size(), 2u);
+  CHECK_EQUAL(assigned[0].second, clients[1]);
+  CHECK_EQUAL(assigned[1].second, clients[1]);
+  CHECK_EQUAL(scheduler.busy_workers(), 2u);
+  CHECK_EQUAL(scheduler.idle_workers(), 0u);
+  CHECK(!complete());
+  CHECK_EQUAL(complete(), clients[1]);
+  dispatch();
+  REQUIRE_EQUAL(assigned.size(), 2u);
+  CHECK_EQUAL(assigned[0].second, clients[0]);
+  CHECK_EQUAL(assigned[1].second, clients[0]);
+}
+
+TEST(cancellation) {
+  auto query_id = uuid::random();
+  scheduler.release(workers[0]);
+  scheduler.add(query_id, query_priority::interactive, expr, clients[0],
+                make_query_map(3));
+  dispatch();
+  REQUIRE_EQUAL(assigned.size(), 1u);
+  scheduler.cancel(query_id);
+  CHECK_EQUAL(scheduler.queue_depth(), 0u);
+  MESSAGE("the running task completes without notifying the client");
+  CHECK(!complete());
+  CHECK_EQUAL(scheduler.jobs(), 0u);
+  CHECK_EQUAL(scheduler.idle_workers(), 1u);
+}
+
+TEST(partition references) {
+  auto qm = make_query_map(2);
+  std::vector<uuid> partitions;
+  for (auto& kvp : qm)
+    partitions.push_back(kvp.first);
+  scheduler.add(uuid::nil(), query_priority::interactive, expr, clients[0],
+                std::move(qm));
+  CHECK(scheduler.uses(partitions[0]));
+  CHECK(scheduler.uses(partitions[1]));
+  CHECK(!scheduler.uses(uuid::random()));
+  MESSAGE("running tasks keep referencing their partition");
+  scheduler.release(workers[0]);
+  dispatch();
+  REQUIRE_EQUAL(assigned.size(), 1u);
+  CHECK(scheduler.uses(partitions[0]));
+  CHECK(scheduler.uses(partitions[1]));
+  complete();
+  dispatch();
+  CHECK_EQUAL(scheduler.uses(partitions[0]), scheduler.uses(partitions[1]));
+  complete();
+  CHECK(!scheduler.uses(partitions[0]));
+  CHECK(!scheduler.uses(partitions[1]));
+}
+
+FIXTURE_SCOPE_END()
@@ -61,11 +61,14 @@ TEST(lookup) {
   ids result;
   while (!done)
     self->receive([&](const ids& x) { result |= x; },
-                  [&](atom::done) { done = true; });
+                  [&](atom::worker, const caf::actor& worker) {
+                    MESSAGE("after completion, the supervisor should "
+                            "register itself again");
+                    CHECK_EQUAL(worker, sv);
+                    done = true;
+                  });
   CHECK_EQUAL(result, make_ids({{0, 9}}));
-  MESSAGE("after completion, the supervisor should register itself again");
-  expect((caf::atom_value, caf::actor),
-         from(sv).to(self).with(atom::worker_v, sv));
+  CHECK(self->mailbox().empty());
 }
 
 FIXTURE_SCOPE_END()
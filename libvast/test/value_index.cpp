@@ -108,6 +108,39 @@ TEST(integer) {
   CHECK(to_string(unbox(less_than_leet)) == "1111011");
 }
 
+TEST(integer with roaring bitmaps) {
+  caf::settings opts;
+  opts["bitmap"] = "roaring";
+  auto idx = factory<value_index>::make(integer_type{}, std::move(opts));
+  REQUIRE_NOT_EQUAL(idx, nullptr);
+  MESSAGE("append");
+  REQUIRE(idx->append(make_data_view(-7)));
+  REQUIRE(idx->append(make_data_view(42)));
+  REQUIRE(idx->append(make_data_view(10000)));
+  REQUIRE(idx->append(make_data_view(4711)));
+  REQUIRE(idx->append(make_data_view(31337)));
+  REQUIRE(idx->append(make_data_view(42)));
+  REQUIRE(idx->append(make_data_view(42)));
+  MESSAGE("lookup");
+  auto less_than_leet = idx->lookup(less, make_data_view(31337));
+  CHECK_EQUAL(to_string(unbox(less_than_leet)), "1111011");
+  auto xs = list{42, 10, 4711};
+  auto multi = unbox(idx->lookup(in, make_data_view(xs)));
+  CHECK_EQUAL(to_string(multi), "0101011");
+  MESSAGE("serialization");
+  std::vector<char> buf;
+  CHECK_EQUAL(save(nullptr, buf, idx), caf::none);
+  value_index_ptr idx2;
+  REQUIRE_EQUAL(load(nullptr, buf, idx2), caf::none);
+  less_than_leet = idx2->lookup(less, make_data_view(31337));
+  CHECK_EQUAL(to_string(unbox(less_than_leet)), "1111011");
+  MESSAGE("invalid bitmap type");
+  caf::settings invalid;
+  invalid["bitmap"] = "foo";
+  CHECK_EQUAL(factory<value_index>::make(integer_type{}, std::move(invalid)),
+              nullptr);
+}
+
 TEST(floating-point with custom binner) {
   using index_type = arithmetic_index<real, precision_binner<6, 2>>;
   caf::settings opts;
@@ -520,6 +553,45 @@ TEST(none values - arithmetic) {
   CHECK_EQUAL(to_string(unbox(bm)), "00100");
 }
 
+TEST(merge) {
+  auto make = [](auto type) {
+    auto result = factory<value_index>::make(type, caf::settings{});
+    REQUIRE_NOT_EQUAL(result, nullptr);
+    return result;
+  };
+  MESSAGE("arithmetic");
+  auto x = make(count_type{});
+  REQUIRE(x->append(make_data_view(42)));
+  REQUIRE(x->append(make_data_view(caf::none)));
+  REQUIRE(x->append(make_data_view(7)));
+  auto y = make(count_type{});
+  REQUIRE(y->append(make_data_view(7), 4));
+  REQUIRE(y->append(make_data_view(caf::none)));
+  REQUIRE(y->append(make_data_view(42)));
+  REQUIRE_EQUAL(x->merge(*y), caf::none);
+  CHECK_EQUAL(x->offset(), 7u);
+  auto bm = x->lookup(equal, make_data_view(42));
+  CHECK_EQUAL(to_string(unbox(bm)), "1000001");
+  bm = x->lookup(less, make_data_view(10));
+  CHECK_EQUAL(to_string(unbox(bm)), "0010100");
+  bm = x->lookup(equal, make_data_view(caf::none));
+  CHECK_EQUAL(to_string(unbox(bm)), "0100010");
+  MESSAGE("string");
+  x = make(string_type{});
+  REQUIRE(x->append(make_data_view("foo")));
+  REQUIRE(x->append(make_data_view("ba")));
+  y = make(string_type{});
+  REQUIRE(y->append(make_data_view("bar"), 3));
+  REQUIRE(y->append(make_data_view("foo")));
+  REQUIRE_EQUAL(x->merge(*y), caf::none);
+  bm = x->lookup(equal, make_data_view("foo"));
+  CHECK_EQUAL(to_string(unbox(bm)), "10001");
+  bm = x->lookup(ni, make_data_view("ba"));
+  CHECK_EQUAL(to_string(unbox(bm)), "01010");
+  MESSAGE("different types");
+  CHECK_NOT_EQUAL(x->merge(*make(count_type{})), caf::none);
+}
+
 // This test uncovered a regression that ocurred when computing the rank of a
 // bitmap representing conn.log events. The culprit was the EWAH bitmap
 // encoding, because swapping out ewah_bitmap for null_bitmap in address_index
@@ -16,7 +16,6 @@
 #include "vast/bloom_filter_parameters.hpp"
 #include "vast/bloom_filter_synopsis.hpp"
 
-#include <caf/config_value.hpp>
 #include <caf/settings.hpp>
 
 #include <vast/address.hpp>
@@ -79,34 +78,16 @@ make_address_synopsis(vast::type type, bloom_filter_parameters params,
 template <class HashFunction>
 synopsis_ptr make_address_synopsis(vast::type type, const caf::settings& opts) {
   VAST_ASSERT(caf::holds_alternative<address_type>(type));
-  auto make = [](auto x, auto xs) {
-    return make_address_synopsis<HashFunction>(std::move(x), std::move(xs));
-  };
-  if (auto xs = parse_parameters(type))
-    return make(std::move(type), std::move(*xs));
-  // If no explicit Bloom filter parameters were attached to the type, we try
-  // to use the maximum partition size of the index as upper bound for the
-  // expected number of events.
-  using int_type = caf::config_value::integer;
-  if (auto max_part_size = caf::get_if<int_type>(&opts, "max-partition-size")) {
-    bloom_filter_parameters xs;
-    xs.n = *max_part_size;
-    xs.p = 0.01;
-    // Because VAST deserializes a synopsis with empty options and
-    // construction of an address synopsis fails without any sizing
-    // information, we augment the type with the synopsis options.
-    using namespace std::string_literals;
-    auto v = "bloomfilter("s + std::to_string(*xs.n) + ','
-             + std::to_string(*xs.p) + ')';
-    auto t = type.attributes({{"synopsis", std::move(v)}});
-    auto result = make(std::move(t), std::move(xs));
-    if (!result)
-      VAST_ERROR_ANON(
-        __func__, "failed to evaluate Bloom filter parameters:", xs.n, xs.p);
-    return result;
+  auto xs = make_parameters(type, opts);
+  if (!xs) {
+    VAST_ERROR_ANON(__func__, "could not determine Bloom filter parameters");
+    return nullptr;
   }
-  VAST_ERROR_ANON(__func__, "could not determine Bloom filter parameters");
-  return nullptr;
+  auto result = make_address_synopsis<HashFunction>(std::move(type), *xs);
+  if (!result)
+    VAST_ERROR_ANON(__func__, "failed to evaluate Bloom filter parameters:",
+                    xs->n, xs->p);
+  return result;
 }
 
 } // namespace vast
@@ -67,8 +67,13 @@ public:
 
   caf::error deserialize(caf::deserializer& source) override;
 
+  caf::error load(vast::chunk_ptr chunk) override;
+
   void append_column_to_index(size_type col, value_index& idx) const override;
 
+  void
+  append_column_to_synopsis(size_type col, synopsis& syn) const override;
+
   caf::atom_value implementation_id() const noexcept override;
 
   vast::data_view at(size_type row, size_type col) const override;
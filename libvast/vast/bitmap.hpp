@@ -19,6 +19,7 @@
 #include "vast/bitmap_base.hpp"
 #include "vast/ewah_bitmap.hpp"
 #include "vast/null_bitmap.hpp"
+#include "vast/roaring_bitmap.hpp"
 #include "vast/wah_bitmap.hpp"
 
 #include "vast/detail/operators.hpp"
@@ -37,7 +38,8 @@ public:
   using types = caf::detail::type_list<
     ewah_bitmap,
     null_bitmap,
-    wah_bitmap
+    wah_bitmap,
+    roaring_bitmap
   >;
 
   using variant = caf::detail::tl_apply_t<types, caf::variant>;
@@ -80,6 +82,18 @@ public:
 
   void flip();
 
+  // -- bitwise operations ---------------------------------------------------
+
+  /// Computes the bitwise AND in place. If both sides hold a roaring bitmap,
+  /// the operation runs container by container.
+  /// @see binary_and
+  bitmap& operator&=(const bitmap& other);
+
+  /// Computes the bitwise OR in place. If both sides hold a roaring bitmap,
+  /// the operation runs container by container.
+  /// @see binary_or
+  bitmap& operator|=(const bitmap& other);
+
   // -- concepts -------------------------------------------------------------
 
   variant& get_data();
@@ -109,7 +123,8 @@ private:
   using range_variant = caf::variant<
     ewah_bitmap_range,
     null_bitmap_range,
-    wah_bitmap_range
+    wah_bitmap_range,
+    roaring_bitmap_range
   >;
 
   range_variant range_;
@@ -117,6 +132,18 @@ private:
 
 bitmap_bit_range bit_range(const bitmap& bm);
 
+/// @relates bitmap
+/// Computes the bitwise AND of two type-erased bitmaps. If both sides hold an
+/// EWAH or both hold a roaring bitmap, the operation uses the specialized
+/// algorithm of the concrete type. Otherwise it falls back to the generic
+/// algorithm over bit ranges.
+bitmap binary_and(const bitmap& lhs, const bitmap& rhs);
+
+/// @relates bitmap
+/// Computes the bitwise OR of two type-erased bitmaps.
+/// @see binary_and
+bitmap binary_or(const bitmap& lhs, const bitmap& rhs);
+
 } // namespace vast
 
 namespace caf {
@@ -15,8 +15,10 @@
 
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <queue>
 #include <type_traits>
+#include <vector>
 
 #include <caf/error.hpp>
 
@@ -180,6 +182,123 @@ auto nary_eval(Iterator begin, Iterator end, Operation op) {
   return bitmap_type{};
 }
 
+/// Evaluates an associative and commutative bitwise operation over multiple
+/// bitmaps in a single pass. Unlike ::nary_eval, this algorithm does not
+/// create intermediate results but advances all bitmaps in lockstep. A
+/// min-heap orders the bitmaps by the end of their current sequence, so that
+/// each step only touches the bitmaps whose sequence ends. A run of the
+/// absorbing bit of the operation (1 for OR, 0 for AND) determines the result
+/// by itself, which allows for skipping the sequences of all other bitmaps.
+/// @tparam Absorbing The bit value *x* for which `op(x, y) = x` for all *y*.
+/// @param begin The beginning of the bitmap range.
+/// @param end The end of the bitmap range.
+/// @param op The bitwise operation as block-wise lambda.
+/// @returns The application of *op* over the bitmaps *[begin,end)*, where the
+///          bits beyond the end of shorter bitmaps count as 0.
+template <bool Absorbing, class Iterator, class Operation>
+auto nary_merge(Iterator begin, Iterator end, Operation op) {
+  using bitmap_type = std::decay_t<decltype(*begin)>;
+  using range_type = std::decay_t<decltype(bit_range(*begin))>;
+  using block_type = typename bitmap_type::block_type;
+  using size_type = typename bitmap_type::size_type;
+  using word_type = word<block_type>;
+  // The current sequence of a bitmap, which begins at position *first*.
+  struct cursor {
+    size_type last() const {
+      return first + range.get().size();
+    }
+    range_type range;
+    size_type first;
+  };
+  if (begin == end)
+    return bitmap_type{};
+  if (std::next(begin) == end)
+    return bitmap_type{*begin};
+  std::vector<cursor> cursors;
+  auto max_size = size_type{0};
+  auto min_size = std::numeric_limits<size_type>::max();
+  for (; begin != end; ++begin) {
+    max_size = std::max(max_size, begin->size());
+    min_size = std::min(min_size, begin->size());
+    if (!begin->empty())
+      cursors.push_back({bit_range(*begin), 0});
+  }
+  // The bits past the end of a bitmap are 0, which terminates an AND.
+  auto limit = Absorbing ? max_size : min_size;
+  // The end of the longest run of absorbing bits seen so far.
+  auto absorbing_end = size_type{0};
+  // The cursors whose current sequence contains both 0s and 1s.
+  std::vector<size_t> mixed;
+  auto classify = [&](size_t i) {
+    auto& xs = cursors[i].range.get();
+    if (xs.is_run() || xs.homogeneous()) {
+      if (((xs.data() & 1) != 0) == Absorbing)
+        absorbing_end = std::max(absorbing_end, cursors[i].last());
+    } else {
+      mixed.push_back(i);
+    }
+  };
+  auto cmp = [&](size_t i, size_t j) {
+    return cursors[i].last() > cursors[j].last();
+  };
+  std::vector<size_t> heap;
+  for (size_t i = 0; i < cursors.size(); ++i) {
+    classify(i);
+    heap.push_back(i);
+  }
+  std::make_heap(heap.begin(), heap.end(), cmp);
+  // Iterate.
+  bitmap_type result;
+  auto position = size_type{0};
+  while (!heap.empty() && position < limit) {
+    size_type next;
+    if (absorbing_end > position) {
+      next = std::min(absorbing_end, limit);
+      result.append_bits(Absorbing, next - position);
+    } else if (mixed.empty()) {
+      next = std::min(cursors[heap.front()].last(), limit);
+      result.append_bits(!Absorbing, next - position);
+    } else {
+      next = std::min({cursors[heap.front()].last(), limit,
+                       position + word_type::width});
+      auto n = next - position;
+      auto block = Absorbing ? word_type::none : word_type::all;
+      for (auto i : mixed) {
+        auto& x = cursors[i];
+        block = op(block, x.range.get().data() >> (position - x.first));
+      }
+      result.append_block(block & word_type::lsb_fill(n), n);
+    }
+    position = next;
+    // Advance all cursors whose current sequence ends before the new
+    // position.
+    while (!heap.empty() && cursors[heap.front()].last() <= position) {
+      std::pop_heap(heap.begin(), heap.end(), cmp);
+      auto i = heap.back();
+      heap.pop_back();
+      auto m = std::find(mixed.begin(), mixed.end(), i);
+      if (m != mixed.end()) {
+        *m = mixed.back();
+        mixed.pop_back();
+      }
+      auto& x = cursors[i];
+      do {
+        x.first = x.last();
+        x.range.next();
+      } while (!x.range.done() && x.last() <= position);
+      if (!x.range.done()) {
+        classify(i);
+        heap.push_back(i);
+        std::push_heap(heap.begin(), heap.end(), cmp);
+      }
+    }
+  }
+  VAST_ASSERT(result.size() <= max_size);
+  if (result.size() < max_size)
+    result.append_bits(false, max_size - result.size());
+  return result;
+}
+
 template <class LHS, class RHS>
 auto binary_and(const LHS& lhs, const RHS& rhs) {
   auto op = [](auto x, auto y) { return x & y; };
@@ -213,13 +332,13 @@ auto binary_nor(const LHS& lhs, const RHS& rhs) {
 template <class Iterator>
 auto nary_and(Iterator begin, Iterator end) {
   auto op = [](auto x, auto y) { return x & y; };
-  return nary_eval(begin, end, op);
+  return nary_merge<false>(begin, end, op);
 }
 
 template <class Iterator>
 auto nary_or(Iterator begin, Iterator end) {
   auto op = [](auto x, auto y) { return x | y; };
-  return nary_eval(begin, end, op);
+  return nary_merge<true>(begin, end, op);
 }
 
 template <class Iterator>
@@ -74,6 +74,14 @@ public:
     coder_.append(other.coder_);
   }
 
+  /// Merges another bitmap index whose values occupy positions that this
+  /// bitmap index skipped, e.g., to combine the indexes of two adjacent ID
+  /// ranges.
+  /// @param other The other bitmap index.
+  void merge(const bitmap_index& other) {
+    coder_.merge(other.coder_);
+  }
+
   /// Instructs the coder to add undefined values for the sake of increasing
   /// the number of elements.
   /// @param n The number of elements to skip.
@@ -187,6 +187,16 @@ public:
   template <class InputIterator>
   void append_blocks(InputIterator first, InputIterator last);
 
+  /// Computes the bitwise AND with another bit vector block by block.
+  /// @param other The other bit vector.
+  /// @pre `size() == other.size()`
+  bitvector& operator&=(const bitvector& other);
+
+  /// Computes the bitwise OR with another bit vector block by block.
+  /// @param other The other bit vector.
+  /// @pre `size() == other.size()`
+  bitvector& operator|=(const bitvector& other);
+
   // -- concepts --------------------------------------------------------------
 
   template <class Inspector>
@@ -699,6 +709,24 @@ void bitvector<Block, Allocator>::append_blocks(InputIterator first,
   }
 }
 
+template <class Block, class Allocator>
+bitvector<Block, Allocator>&
+bitvector<Block, Allocator>::operator&=(const bitvector& other) {
+  VAST_ASSERT(size_ == other.size_);
+  for (size_type i = 0; i < blocks_.size(); ++i)
+    blocks_[i] &= other.blocks_[i];
+  return *this;
+}
+
+template <class Block, class Allocator>
+bitvector<Block, Allocator>&
+bitvector<Block, Allocator>::operator|=(const bitvector& other) {
+  VAST_ASSERT(size_ == other.size_);
+  for (size_type i = 0; i < blocks_.size(); ++i)
+    blocks_[i] |= other.blocks_[i];
+  return *this;
+}
+
 template <bool Bit = true, class Block, class Allocator>
 typename bitvector<Block, Allocator>::size_type
 rank(const bitvector<Block, Allocator>& bv) {
@@ -25,7 +25,9 @@
 #include <vector>
 
 #include <vast/bitvector.hpp>
+#include <vast/detail/assert.hpp>
 #include <vast/detail/operators.hpp>
+#include <vast/span.hpp>
 
 namespace vast::policy {
 
@@ -43,6 +45,27 @@ struct no_partitioning;
 
 namespace vast {
 
+namespace detail {
+
+/// Maps the *i*-th digest of an element to a bit position in a Bloom filter.
+/// @param i The index of the digest.
+/// @param x The digest.
+/// @param size The number of bits in the Bloom filter.
+/// @param k The number of hash functions.
+/// @relates bloom_filter frozen_bloom_filter
+template <class PartitioningPolicy, class Digest>
+size_t bloom_filter_position([[maybe_unused]] size_t i, Digest x, size_t size,
+                             [[maybe_unused]] size_t k) {
+  if constexpr (std::is_same_v<PartitioningPolicy, policy::no_partitioning>)
+    return x % size;
+  if constexpr (std::is_same_v<PartitioningPolicy, policy::partitioning>) {
+    auto num_partition_cells = size / k;
+    return i * num_partition_cells + (x % num_partition_cells);
+  }
+}
+
+} // namespace detail
+
 /// A data structure for probabilistic set membership.
 /// @tparam HashFunction The hash function to use in the hasher.
 /// @tparam Hasher The hasher type to generate digests.
@@ -64,6 +87,14 @@ public:
     // nop
   }
 
+  /// Constructs a Bloom filter from a hasher and existing bits.
+  /// @param hasher The hasher type to generate digests.
+  /// @param bits The bits of the Bloom filter.
+  bloom_filter(hasher_type hasher, bitvector<uint64_t> bits)
+    : hasher_{std::move(hasher)}, bits_{std::move(bits)} {
+    // nop
+  }
+
   /// Adds an element to the Bloom filter.
   /// @param x The element to add.
   template <class T>
@@ -86,6 +117,70 @@ public:
     return true;
   }
 
+  /// Adds all elements of another Bloom filter with the same hasher. Bloom
+  /// filters of different sizes merge if they [fold](@ref fold) into each
+  /// other, in which case the result has the larger size.
+  /// @param other The Bloom filter to merge.
+  /// @returns `false` if *other* has an incompatible size or hasher.
+  bool merge(const bloom_filter& other) {
+    if (!(hasher_ == other.hasher_))
+      return false;
+    if (bits_.size() == other.bits_.size()) {
+      bits_ |= other.bits_;
+      return true;
+    }
+    if constexpr (std::is_same_v<partitioning_policy,
+                                 policy::no_partitioning>) {
+      // Repeating the bits of the smaller Bloom filter yields a Bloom filter
+      // of the larger size that still contains all of its elements.
+      auto& larger = bits_.size() > other.bits_.size() ? bits_ : other.bits_;
+      auto& smaller = bits_.size() > other.bits_.size() ? other.bits_ : bits_;
+      if (!can_fold(larger.size(), smaller.size()))
+        return false;
+      auto& large_blocks = larger.blocks();
+      auto& small_blocks = smaller.blocks();
+      std::vector<uint64_t> blocks(large_blocks.size());
+      for (size_t i = 0; i < blocks.size(); ++i)
+        blocks[i] = large_blocks[i] | small_blocks[i % small_blocks.size()];
+      bitvector<uint64_t> bits;
+      bits.append_blocks(blocks.begin(), blocks.end());
+      bits_ = std::move(bits);
+      return true;
+    }
+    return false;
+  }
+
+  /// Folds the Bloom filter into a smaller one by OR-ing equal-sized parts of
+  /// its bits. Because the position of a digest is its remainder modulo the
+  /// number of cells, the result equals a Bloom filter of the smaller size
+  /// with the same elements.
+  /// @param size The new number of cells.
+  /// @returns `false` if the Bloom filter cannot fold into *size* cells.
+  bool fold(size_t size) {
+    if constexpr (std::is_same_v<partitioning_policy,
+                                 policy::no_partitioning>) {
+      if (!can_fold(bits_.size(), size))
+        return false;
+      auto& blocks = bits_.blocks();
+      std::vector<uint64_t> folded(size / 64);
+      for (size_t i = 0; i < blocks.size(); ++i)
+        folded[i % folded.size()] |= blocks[i];
+      bitvector<uint64_t> bits;
+      bits.append_blocks(folded.begin(), folded.end());
+      bits_ = std::move(bits);
+      return true;
+    }
+    return false;
+  }
+
+  /// Checks whether a Bloom filter can fold from one size into another. We
+  /// fold whole blocks only.
+  /// @param from The number of cells before folding.
+  /// @param to The number of cells after folding.
+  static bool can_fold(size_t from, size_t to) {
+    return to > 0 && from % 64 == 0 && to % 64 == 0 && from % to == 0;
+  }
+
   /// @returns The number of cells in the underlying bit vector.
   size_t size() const {
     return bits_.size();
@@ -96,6 +191,16 @@ public:
     return hasher_.size();
   }
 
+  /// @returns The hasher.
+  const hasher_type& hasher() const {
+    return hasher_;
+  }
+
+  /// @returns The underlying bit vector.
+  const bitvector<uint64_t>& data() const {
+    return bits_;
+  }
+
   // -- concepts --------------------------------------------------------------
 
   friend bool operator==(const bloom_filter& x, const bloom_filter& y) {
@@ -109,19 +214,94 @@ public:
 
 private:
   template <class Digest>
-  size_t position([[maybe_unused]] size_t i, Digest x) const {
-    if constexpr (std::is_same_v<partitioning_policy, policy::no_partitioning>)
-      return x % bits_.size();
-    if constexpr (std::is_same_v<partitioning_policy, policy::partitioning>) {
-      auto num_partition_cells = bits_.size() / hasher_.size();
-      return i * num_partition_cells + (x % num_partition_cells);
-    }
+  size_t position(size_t i, Digest x) const {
+    return detail::bloom_filter_position<partitioning_policy>(
+      i, x, bits_.size(), hasher_.size());
   }
 
   hasher_type hasher_;
   bitvector<uint64_t> bits_;
 };
 
+/// A read-only Bloom filter over bits that live elsewhere, e.g., in a
+/// memory-mapped file. The bits must outlive the filter.
+/// @tparam HashFunction The hash function to use in the hasher.
+/// @tparam Hasher The hasher type to generate digests.
+/// @tparam PartitioningPolicy The partitioning policy.
+/// @relates bloom_filter
+template <class HashFunction, template <class> class Hasher = double_hasher,
+          class PartitioningPolicy = policy::no_partitioning>
+class frozen_bloom_filter {
+public:
+  using hash_function = HashFunction;
+  using hasher_type = Hasher<hash_function>;
+  using partitioning_policy = PartitioningPolicy;
+  using bloom_filter_type
+    = bloom_filter<HashFunction, Hasher, PartitioningPolicy>;
+
+  /// Constructs a frozen Bloom filter.
+  /// @param hasher The hasher that generated the digests for the bits.
+  /// @param size The number of bits.
+  /// @param blocks The bits in blocks of 64, as laid out by `bitvector`.
+  /// @pre `blocks.size() * 64 >= size`
+  frozen_bloom_filter(hasher_type hasher, size_t size,
+                      span<const uint64_t> blocks)
+    : hasher_{std::move(hasher)}, size_{size}, blocks_{blocks} {
+    VAST_ASSERT(blocks_.size() * 64 >= size_);
+  }
+
+  /// Test whether an element exists in the Bloom filter.
+  /// @param x The element to test.
+  /// @returns `false` if the *x* is not in the set and `true` if *x* may exist
+  ///          according to the false-positive probability of the filter.
+  template <class T>
+  bool lookup(T&& x) const {
+    auto& digests = hasher_(std::forward<T>(x));
+    for (size_t i = 0; i < digests.size(); ++i) {
+      auto bit = detail::bloom_filter_position<partitioning_policy>(
+        i, digests[i], size_, hasher_.size());
+      if (((blocks_[bit / 64] >> (bit % 64)) & 1) == 0)
+        return false;
+    }
+    return true;
+  }
+
+  /// @returns The number of cells.
+  size_t size() const {
+    return size_;
+  }
+
+  /// @returns The number of hash functions in the hasher.
+  size_t num_hash_functions() const {
+    return hasher_.size();
+  }
+
+  /// @returns The hasher.
+  const hasher_type& hasher() const {
+    return hasher_;
+  }
+
+  /// @returns The bits in blocks of 64.
+  span<const uint64_t> blocks() const {
+    return blocks_;
+  }
+
+  /// Copies the bits into a mutable Bloom filter.
+  bloom_filter_type thaw() const {
+    bitvector<uint64_t> bits;
+    auto full_blocks = size_ / 64;
+    bits.append_blocks(blocks_.begin(), blocks_.begin() + full_blocks);
+    if (auto rest = size_ % 64)
+      bits.append_block(blocks_[full_blocks], rest);
+    return bloom_filter_type{hasher_, std::move(bits)};
+  }
+
+private:
+  hasher_type hasher_;
+  size_t size_;
+  span<const uint64_t> blocks_;
+};
+
 /// Constructs a Bloom filter for a given set of parameters.
 /// @tparam HashFunction The hash function to use in the hasher.
 /// @tparam Hasher The hasher type to generate digests.
@@ -18,12 +18,46 @@
 #include <caf/deserializer.hpp>
 #include <caf/optional.hpp>
 #include <caf/serializer.hpp>
+#include <caf/settings.hpp>
 
 #include <vast/synopsis.hpp>
 #include <vast/type.hpp>
 
 namespace vast {
 
+/// Evaluates a predicate against a Bloom filter of elements of type `T`.
+/// @param filter The Bloom filter, either mutable or frozen.
+/// @param op The relational operator of the predicate.
+/// @param rhs The data of the predicate.
+/// @returns The result of the lookup, or `none` if the Bloom filter cannot
+///          answer the predicate.
+/// @relates bloom_filter_synopsis
+template <class T, class BloomFilter>
+caf::optional<bool> bloom_filter_lookup(const BloomFilter& filter,
+                                        relational_operator op,
+                                        data_view rhs) {
+  switch (op) {
+    default:
+      return caf::none;
+    case equal:
+      if (auto x = caf::get_if<view<T>>(&rhs))
+        return filter.lookup(*x);
+      return caf::none;
+    case in: {
+      if (auto xs = caf::get_if<view<list>>(&rhs)) {
+        for (auto x : **xs) {
+          auto y = caf::get_if<view<T>>(&x);
+          // We cannot rule out elements of a different type.
+          if (!y || filter.lookup(*y))
+            return true;
+        }
+        return false;
+      }
+      return caf::none;
+    }
+  }
+}
+
 /// A Bloom filter synopsis.
 template <class T, class HashFunction>
 class bloom_filter_synopsis : public synopsis {
@@ -40,23 +74,33 @@ public:
     bloom_filter_.add(caf::get<view<T>>(x));
   }
 
+  using synopsis::add_batch;
+
+  void add_batch(span<const view<T>> xs) override {
+    for (auto x : xs)
+      bloom_filter_.add(x);
+  }
+
   caf::optional<bool>
   lookup(relational_operator op, data_view rhs) const override {
-    switch (op) {
-      default:
-        return caf::none;
-      case equal:
-        return bloom_filter_.lookup(caf::get<view<T>>(rhs));
-      case in: {
-        if (auto xs = caf::get_if<view<list>>(&rhs)) {
-          for (auto x : **xs)
-            if (bloom_filter_.lookup(caf::get<view<T>>(x)))
-              return true;
-          return false;
-        }
-        return caf::none;
-      }
-    }
+    return bloom_filter_lookup<T>(bloom_filter_, op, rhs);
+  }
+
+  bool merge(const synopsis& other) override {
+    if (typeid(other) != typeid(*this) || this->type() != other.type())
+      return false;
+    auto& rhs = static_cast<const bloom_filter_synopsis&>(other);
+    return bloom_filter_.merge(rhs.bloom_filter_);
+  }
+
+  void shrink(size_t n) override {
+    auto params = parse_parameters(this->type());
+    if (!params || !params->p)
+      return;
+    auto size = shrunk_size(bloom_filter_.size(),
+                            bloom_filter_.num_hash_functions(), n, *params->p);
+    if (size < bloom_filter_.size())
+      bloom_filter_.fold(size);
   }
 
   bool equals(const synopsis& other) const noexcept override {
@@ -74,10 +118,26 @@ public:
     return source(bloom_filter_);
   }
 
+  /// @returns The underlying Bloom filter.
+  const bloom_filter_type& filter() const {
+    return bloom_filter_;
+  }
+
 protected:
   bloom_filter<HashFunction> bloom_filter_;
 };
 
+/// Determines the smallest size that a Bloom filter can [fold](@ref
+/// bloom_filter::fold) into without exceeding a false-positive probability.
+/// @param m The number of cells of the Bloom filter.
+/// @param k The number of hash functions of the Bloom filter.
+/// @param n The number of elements in the Bloom filter.
+/// @param p The maximum false-positive probability.
+/// @returns The number of cells after folding, which is *m* if the Bloom
+///          filter should not fold.
+/// @relates bloom_filter_synopsis
+size_t shrunk_size(size_t m, size_t k, size_t n, double p);
+
 /// Parses Bloom filter parameters from type attributes of the form
 /// `#synopsis=bloom_filter(n,p)`.
 /// @param x The type whose attributes to parse.
@@ -85,4 +145,21 @@ protected:
 /// @relates bloom_filter_synopsis
 caf::optional<bloom_filter_parameters> parse_parameters(const type& x);
 
+/// Determines the Bloom filter parameters for a synopsis. Explicit parameters
+/// in a type attribute take precedence. Otherwise, the Bloom filter holds
+/// `max-partition-size` elements from the synopsis options at a
+/// false-positive probability of 1%, unless that exceeds `max-synopsis-size`
+/// bytes, in which case we trade a higher false-positive probability for
+/// staying within the budget. Because VAST deserializes a synopsis with empty
+/// options, we then attach the parameters to the type. The number of cells
+/// allows for folding the Bloom filter to a fraction of its size, such that
+/// the synopsis of a partition with fewer events can
+/// [shrink](@ref synopsis::shrink).
+/// @param x The type of the synopsis, which may receive a type attribute.
+/// @param opts The synopsis options.
+/// @returns The Bloom filter parameters.
+/// @relates bloom_filter_synopsis
+caf::optional<bloom_filter_parameters>
+make_parameters(type& x, const caf::settings& opts);
+
 } // namespace vast
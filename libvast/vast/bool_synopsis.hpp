@@ -27,6 +27,8 @@ public:
   caf::optional<bool> lookup(relational_operator op,
                              data_view rhs) const override;
 
+  bool merge(const synopsis& other) override;
+
   bool equals(const synopsis& other) const noexcept override;
 
   caf::error serialize(caf::serializer& sink) const override;
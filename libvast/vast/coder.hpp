@@ -77,6 +77,12 @@ struct coder {
   /// @pre `size() + other.size() < Bitmap::max_size`
   void append(const coder& other);
 
+  /// Overlays another coder whose entries occupy positions that this coder
+  /// skipped, and vice versa. The result has the size of the larger coder.
+  /// @param other The coder to merge.
+  /// @pre The entries of `*this` and *other* are disjoint.
+  void merge(const coder& other);
+
   /// Retrieves the number entries in the coder, i.e., the number of rows.
   /// @returns The size of the coder measured in number of entries.
   size_type size() const;
@@ -129,6 +135,14 @@ public:
     bitmap_.append(other.bitmap_);
   }
 
+  void merge(const singleton_coder& other) {
+    auto rhs = other.bitmap_;
+    auto n = std::max(bitmap_.size(), rhs.size());
+    bitmap_.append_bits(false, n - bitmap_.size());
+    rhs.append_bits(false, n - rhs.size());
+    bitmap_ |= rhs;
+  }
+
   size_type size() const {
     return bitmap_.size();
   }
@@ -161,7 +175,12 @@ public:
     // nop
   }
 
-  vector_coder(size_t n) : size_{0}, bitmaps_(n) {
+  /// Constructs a coder with *n* bitmaps.
+  /// @param n The number of bitmaps.
+  /// @param prototype The bitmap that all *n* bitmaps start out as, which
+  ///        determines their representation for type-erased bitmaps.
+  vector_coder(size_t n, const Bitmap& prototype = Bitmap{})
+    : size_{0}, bitmaps_(n, prototype) {
     // nop
   }
 
@@ -196,6 +215,23 @@ protected:
     size_ += other.size_;
   }
 
+  /// Overlays the bitmaps of another coder, where *bit* denotes the value
+  /// that skipped entries have in both coders.
+  void merge(const vector_coder& other, bool bit) {
+    VAST_ASSERT(bitmaps_.size() == other.bitmaps_.size());
+    auto n = std::max(size_, other.size_);
+    for (auto i = 0u; i < bitmaps_.size(); ++i) {
+      auto rhs = other.bitmaps_[i];
+      bitmaps_[i].append_bits(bit, n - bitmaps_[i].size());
+      rhs.append_bits(bit, n - rhs.size());
+      if (bit)
+        bitmaps_[i] &= rhs;
+      else
+        bitmaps_[i] |= rhs;
+    }
+    size_ = n;
+  }
+
   size_type size_;
   mutable std::vector<Bitmap> bitmaps_;
 };
@@ -285,6 +321,10 @@ public:
   void append(const equality_coder& other) {
     super::append(other, false);
   }
+
+  void merge(const equality_coder& other) {
+    super::merge(other, false);
+  }
 };
 
 /// Encodes a value according to an inequalty. Given a value *x* and an index
@@ -370,6 +410,10 @@ public:
   void append(const range_coder& other) {
     super::append(other, true);
   }
+
+  void merge(const range_coder& other) {
+    super::merge(other, true);
+  }
 };
 
 /// Maintains one bitmap per *bit* of the value to encode.
@@ -469,6 +513,10 @@ public:
   void append(const bitslice_coder& other) {
     super::append(other, false);
   }
+
+  void merge(const bitslice_coder& other) {
+    super::merge(other, false);
+  }
 };
 
 template <class T>
@@ -511,7 +559,9 @@ public:
 
   /// Constructs a multi-level coder from a given base.
   /// @param b The base to initialize this coder with.
-  explicit multi_level_coder(base b) : base_{std::move(b)} {
+  /// @param prototype The initial bitmap of all coders.
+  explicit multi_level_coder(base b, bitmap_type prototype = {})
+    : base_{std::move(b)}, prototype_{std::move(prototype)} {
     init();
   }
 
@@ -538,6 +588,18 @@ public:
       coders_[i].append(other.coders_[i]);
   }
 
+  void merge(const multi_level_coder& other) {
+    if (coders_.empty()) {
+      *this = other;
+      return;
+    }
+    if (other.coders_.empty())
+      return;
+    VAST_ASSERT(coders_.size() == other.coders_.size());
+    for (auto i = 0u; i < coders_.size(); ++i)
+      coders_[i].merge(other.coders_[i]);
+  }
+
   size_type size() const {
     return coders_.empty() ? 0 : coders_[0].size();
   }
@@ -579,14 +641,14 @@ private:
     // For range coders it suffices to use b-1 bitmaps because the last
     // bitmap always consists of all 1s and is hence superfluous.
     for (auto i = 0u; i < base_.size(); ++i)
-      coders[i] = range_coder<bitmap_type>{base_[i] - 1};
+      coders[i] = range_coder<bitmap_type>{base_[i] - 1, prototype_};
   }
 
   template <class C>
   void init_coders(std::vector<C>& coders) {
     // All other multi-bitmap coders use one bitmap per unique value.
     for (auto i = 0u; i < base_.size(); ++i)
-      coders[i] = C{base_[i]};
+      coders[i] = C{base_[i], prototype_};
   }
 
   // Range-Eval-Opt
@@ -664,6 +726,7 @@ private:
   base base_;
   mutable std::vector<value_type> xs_;
   std::vector<coder_type> coders_;
+  bitmap_type prototype_;
 };
 
 template <class T>
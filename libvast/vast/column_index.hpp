@@ -71,6 +71,13 @@ public:
   /// @pre `init()` was called previously.
   caf::expected<bitmap> lookup(relational_operator op, data_view rhs);
 
+  /// Merges the value index of another column index for the same column.
+  /// @param other The column index to merge.
+  /// @returns An error if the value indexes have a different structure.
+  /// @pre `init()` was called on both column indexes previously, and all IDs
+  ///      in *other* are greater than the IDs in this index.
+  caf::error merge(const column_index& other);
+
   /// @returns the file name for loading and storing the index.
   const path& filename() const {
     return filename_;
@@ -103,6 +110,10 @@ public:
   bool dirty() const noexcept;
 
 protected:
+  /// Loads the state from `filename()`. The EWAH bitmaps of the value index
+  /// reference the mapped file in place rather than copies on the heap.
+  caf::error load_from_disk();
+
   // -- member variables -------------------------------------------------------
 
   value_index_ptr idx_;
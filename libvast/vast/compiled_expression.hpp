@@ -0,0 +1,114 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/data.hpp"
+#include "vast/expression.hpp"
+#include "vast/fwd.hpp"
+#include "vast/null_bitmap.hpp"
+#include "vast/operator.hpp"
+#include "vast/type.hpp"
+
+#include <caf/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vast {
+
+/// Evaluates a single predicate over one column of a table slice.
+/// @returns a selection bitmap over the rows of the slice.
+using column_scanner = std::function<null_bitmap(const table_slice&)>;
+
+/// Creates a scanner for a predicate over one column of a layout. The scanner
+/// resolves the operator and converts the RHS into a typed constant up front,
+/// such that an invocation only touches the cells of the column. Predicates
+/// on count, integer, real, time, address, and string columns take typed fast
+/// paths; all other columns fall back to evaluating data views.
+/// @param t The type of the column.
+/// @param column The offset of the column in the layout.
+/// @param op The relational operator of the predicate.
+/// @param rhs The RHS of the predicate.
+column_scanner
+make_column_scanner(type t, size_t column, relational_operator op, data rhs);
+
+/// An expression compiled against a specific layout. Compilation resolves all
+/// extractors to column offsets, evaluates layout-dependent predicates such as
+/// `#type` ahead of time, and flattens the expression tree into a program of
+/// column scanners. A compiled expression can be reused for all table slices
+/// with the layout it was compiled for.
+class compiled_expression {
+public:
+  /// A node of the expression tree. The program stores the nodes in
+  /// depth-first pre-order, such that the children of a connective follow
+  /// their parent directly.
+  struct instruction {
+    /// The operation of an instruction.
+    enum class opcode : uint8_t {
+      constant,
+      scan,
+      conjunction,
+      disjunction,
+      negation,
+    };
+
+    /// The operation to perform.
+    opcode code = opcode::constant;
+
+    /// The number of instructions in the subtree rooted at this instruction,
+    /// including the instruction itself.
+    size_t extent = 1;
+
+    /// The result of a constant instruction for all rows.
+    bool value = false;
+
+    /// The column scanner of a scan instruction.
+    column_scanner scan;
+  };
+
+  /// Compiles an expression for a given layout.
+  /// @param expr The [tailored](@ref tailor) expression to compile.
+  /// @param layout The layout of the table slices to evaluate.
+  /// @returns The compiled expression or an error if *expr* contains
+  ///          unresolved extractors.
+  static caf::expected<compiled_expression>
+  make(const expression& expr, const record_type& layout);
+
+  /// Evaluates the compiled expression over all rows of a table slice.
+  /// @param slice The table slice to evaluate.
+  /// @returns a selection bitmap over the rows of *slice*.
+  /// @pre `slice.layout()` equals the layout of the compilation.
+  null_bitmap operator()(const table_slice& slice) const;
+
+  /// @returns the instructions of the program.
+  const std::vector<instruction>& program() const noexcept {
+    return program_;
+  }
+
+private:
+  null_bitmap run(size_t pc, const table_slice& slice) const;
+
+  std::vector<instruction> program_;
+};
+
+/// Evaluates an entire table slice over a compiled expression.
+/// @param slice The table slice for evaluation.
+/// @param expr The expression compiled for the layout of *slice*.
+/// @returns a bitmap containing all IDs of matching rows.
+/// @relates compiled_expression
+ids evaluate(const table_slice& slice, const compiled_expression& expr);
+
+} // namespace vast
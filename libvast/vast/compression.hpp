@@ -15,6 +15,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <vector>
 
 #include "vast/config.hpp"
 
@@ -24,6 +25,7 @@ namespace vast {
 enum class compression : int8_t {
   null      = 0,
   lz4       = 1,
+  zstd      = 2,
 };
 
 /// The LZ4 compression algorithm.
@@ -40,5 +42,44 @@ size_t compress(const char* in, size_t in_size, char* out, size_t out_size);
 size_t uncompress(const char* in, size_t in_size, char* out, size_t out_size);
 
 } // namespace lz4
+
+#if VAST_HAVE_ZSTD
+
+/// The Zstandard compression algorithm.
+namespace zstd {
+
+/// The compression level that zstd uses by default.
+constexpr int default_level = 3;
+
+/// @returns an upper bound for the compressed output.
+/// @param size The size of the uncompressed input.
+size_t compress_bound(size_t size);
+
+/// Compresses a contiguous byte sequence.
+/// @param dict The dictionary to compress with, or `nullptr` for none.
+/// @returns The size of the compressed output, or 0 on failure.
+size_t compress(const char* in, size_t in_size, char* out, size_t out_size,
+                int level = default_level, const char* dict = nullptr,
+                size_t dict_size = 0);
+
+/// Uncompresses a contiguous byte sequence.
+/// @param dict The dictionary that *in* was compressed with, if any.
+/// @returns The size of the uncompressed output, or 0 on failure.
+size_t uncompress(const char* in, size_t in_size, char* out, size_t out_size,
+                  const char* dict = nullptr, size_t dict_size = 0);
+
+/// Trains a dictionary from samples of similar data.
+/// @param samples The concatenated samples.
+/// @param sizes The size of each sample in *samples*.
+/// @param max_size The maximum size of the dictionary.
+/// @returns The dictionary, or an empty vector if there are too few samples.
+std::vector<char> train_dictionary(const std::vector<char>& samples,
+                                   const std::vector<size_t>& sizes,
+                                   size_t max_size);
+
+} // namespace zstd
+
+#endif // VAST_HAVE_ZSTD
+
 } // namespace vast
 
@@ -30,6 +30,8 @@ struct compression_printer : printer<compression_printer> {
         return str.print(out, "null");
       case compression::lz4:
         return str.print(out, "lz4");
+      case compression::zstd:
+        return str.print(out, "zstd");
     }
     return false;
   }
@@ -335,18 +335,87 @@ constexpr size_t max_partition_size = 1'048'576; // 1_Mi
 /// Maximum number of in-memory INDEX partitions.
 constexpr size_t max_in_mem_partitions = 10;
 
+/// Maximum number of bytes that INDEX partitions loaded from disk may occupy.
+constexpr size_t max_resident_partition_bytes = 1'073'741'824; // 1_GiB
+
 /// Number of immediately scheduled INDEX partitions.
 constexpr size_t taste_partitions = 5;
 
-/// Maximum number of concurrent INDEX queries.
+/// Number of upcoming INDEX partitions to load in the background while a
+/// query evaluates, where 0 disables prefetching.
+constexpr size_t prefetch_partitions = 5;
+
+/// Time to collect concurrent INDEX queries before evaluating them together,
+/// where 0 evaluates each query on arrival.
+constexpr caf::timespan query_batch_window = caf::timespan::zero();
+
+/// Time between two attempts to merge small INDEX partitions, where 0
+/// disables compaction.
+constexpr caf::timespan compaction_interval = caf::timespan::zero();
+
+/// Maximum number of bytes per second that compacting INDEX partitions reads
+/// from disk.
+constexpr size_t compaction_rate = 16'777'216; // 16_MiB
+
+/// Maximum number of bytes that cached results of INDEXER lookups may occupy.
+constexpr size_t max_predicate_cache_bytes = 67'108'864; // 64_MiB
+
+/// Number of workers that evaluate the partitions of all INDEX queries.
 constexpr size_t num_query_supervisors = 10;
 
+/// Number of threads that evaluate a meta index lookup, where 0 means one per
+/// hardware thread.
+constexpr size_t meta_index_threads = 0;
+
+/// Number of threads that index the active partition in place, where 0 means
+/// one INDEXER actor per column.
+constexpr size_t indexing_threads = 0;
+
+/// Number of threads that write the in-place column indexes of a full
+/// partition to disk, where 0 means that the INDEX writes them itself.
+constexpr size_t flush_threads = 4;
+
+/// Bitmap representation of new INDEX value indexes, which is either ewah or
+/// roaring. The `#bitmap` attribute of a type takes precedence.
+constexpr caf::atom_value index_bitmap = caf::atom("ewah");
+
+/// Maximum size of a single Bloom filter synopsis in the meta index in bytes.
+constexpr size_t max_synopsis_size = 1'048'576; // 1_MiB
+
 /// Number of cached ARCHIVE segments.
 constexpr size_t segments = 10;
 
 /// Maximum size of ARCHIVE segments in MB.
 constexpr size_t max_segment_size = 128;
 
+/// Maximum size of all cached ARCHIVE segments in MB.
+constexpr size_t segment_cache_size = 1024;
+
+/// Maximum size of all ARCHIVE segments with cached table slices in MB.
+constexpr size_t slice_cache_size = 256;
+
+/// Algorithm that compresses the table slices of new ARCHIVE segments, which
+/// is one of null, lz4, or zstd.
+constexpr caf::atom_value compression = caf::atom("null");
+
+/// Level of zstd compression for ARCHIVE segments.
+constexpr int compression_level = 3;
+
+/// Whether zstd compression of ARCHIVE segments uses a dictionary per layout
+/// that is trained on the table slices of each segment.
+constexpr bool compression_dictionaries = false;
+
+/// Number of threads that decode ARCHIVE segments for exports, where 0 means
+/// that the ARCHIVE decodes them itself.
+constexpr size_t extraction_threads = 4;
+
+/// Maximum number of exports that the ARCHIVE serves at the same time.
+constexpr size_t max_extraction_sessions = 8;
+
+/// Maximum number of table slices that the ARCHIVE extracts in one turn of an
+/// export.
+constexpr size_t extraction_batch_size = 16;
+
 /// Number of initial IDs to request in the IMPORTER.
 constexpr size_t initially_requested_ids = 128;
 
@@ -0,0 +1,92 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/byte.hpp"
+#include "vast/detail/assert.hpp"
+#include "vast/span.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace vast::detail {
+
+/// Loads a digest into the low-order bytes of a 64-bit word.
+/// @tparam Bytes The width of the digest.
+/// @param ptr The first byte of the digest.
+/// @returns The digest as 64-bit word.
+template <size_t Bytes>
+uint64_t load_digest(const byte* ptr) {
+  static_assert(Bytes > 0 && Bytes <= 8);
+  auto result = uint64_t{0};
+  std::memcpy(&result, ptr, Bytes);
+  return result;
+}
+
+/// Scans a packed array of fixed-width digests for digests that equal one of
+/// a set of keys, and writes one bit per digest into a sequence of words.
+/// The scan processes blocks of 64 digests: it first compares all digests of
+/// a block with branch-free loops that compilers turn into vector
+/// instructions, and then packs the comparison results into a word.
+/// @tparam Bytes The width of a digest.
+/// @param digests The concatenated digests.
+/// @param keys The keys in the representation of `load_digest`.
+/// @param result The words receiving the match bits. Bit *i % 64* of word
+///        *i / 64* is 1 iff digest *i* equals one of the keys. Bits beyond the
+///        last digest are 0.
+/// @pre `digests.size() % Bytes == 0`
+/// @pre `result.size() == (digests.size() / Bytes + 63) / 64`
+template <size_t Bytes>
+void scan_digests(span<const byte> digests, span<const uint64_t> keys,
+                  span<uint64_t> result) {
+  // Comparing every digest with every key only pays off for a few keys. For
+  // larger sets we switch to a binary search.
+  constexpr size_t max_linear_keys = 8;
+  constexpr size_t block_size = 64;
+  VAST_ASSERT(digests.size() % Bytes == 0);
+  auto n = digests.size() / Bytes;
+  VAST_ASSERT(static_cast<size_t>(result.size())
+              == (n + block_size - 1) / block_size);
+  std::vector<uint64_t> sorted_keys;
+  if (keys.size() > max_linear_keys) {
+    sorted_keys.assign(keys.begin(), keys.end());
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+  }
+  uint64_t values[block_size];
+  uint8_t matches[block_size];
+  for (size_t first = 0; first < n; first += block_size) {
+    auto size = std::min(block_size, n - first);
+    auto ptr = digests.data() + first * Bytes;
+    for (size_t i = 0; i < size; ++i)
+      values[i] = load_digest<Bytes>(ptr + i * Bytes);
+    if (sorted_keys.empty()) {
+      std::fill_n(matches, size, uint8_t{0});
+      for (auto key : keys)
+        for (size_t i = 0; i < size; ++i)
+          matches[i] |= static_cast<uint8_t>(values[i] == key);
+    } else {
+      for (size_t i = 0; i < size; ++i)
+        matches[i] = std::binary_search(sorted_keys.begin(),
+                                        sorted_keys.end(), values[i]);
+    }
+    auto word = uint64_t{0};
+    for (size_t i = 0; i < size; ++i)
+      word |= uint64_t{matches[i]} << i;
+    result[first / block_size] = word;
+  }
+}
+
+} // namespace vast::detail
@@ -0,0 +1,305 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vast::detail {
+
+/// A flat cache with a weight budget and a scan-resistant eviction policy in
+/// the spirit of 2Q. The cache splits its elements into two LRU segments:
+/// elements enter the *recent* segment on a miss, and move into the
+/// *frequent* segment when accessed again. Eviction drains the recent segment
+/// first, so that a sequence of one-off accesses (e.g., a query that touches
+/// every partition once) cannot displace the frequently accessed elements.
+/// The cache also remembers the keys of recently evicted elements, such that
+/// an element that gets reloaded shortly after its eviction enters the
+/// frequent segment directly.
+/// @tparam Key The key type to look up elements.
+/// @tparam T The element type.
+/// @tparam Factory Creates a new element from a key.
+/// @tparam Weigher Computes the weight of an element, e.g., its size in bytes.
+template <class Key, class T, class Factory, class Weigher>
+class flat_2q_cache {
+public:
+  // -- member types -----------------------------------------------------------
+
+  /// A cached element together with its key and weight.
+  struct entry {
+    Key key;
+    T value;
+    size_t weight;
+  };
+
+  using vector_type = std::vector<entry>;
+
+  /// Counters about the effectiveness of the cache.
+  struct statistics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  // -- constructors, destructors, and assignment operators -------------------
+
+  /// @param capacity The maximum total weight of all elements.
+  /// @param max_size The maximum number of elements.
+  flat_2q_cache(size_t capacity, size_t max_size, Factory fac = Factory{},
+                Weigher weigh = Weigher{})
+    : capacity_(capacity),
+      max_size_(max_size),
+      make_(std::move(fac)),
+      weigh_(std::move(weigh)) {
+    // nop
+  }
+
+  flat_2q_cache(flat_2q_cache&&) = default;
+
+  flat_2q_cache& operator=(flat_2q_cache&&) = default;
+
+  // -- properties -------------------------------------------------------------
+
+  /// Queries whether `key` is present in the cache. Does not count as an
+  /// access.
+  bool contains(const Key& key) const {
+    return find(recent_, key) != recent_.end()
+           || find(frequent_, key) != frequent_.end();
+  }
+
+  /// Gets the element for `key` or creates a new one. The returned reference
+  /// remains valid until the next modification of the cache. The cache never
+  /// evicts the requested element itself, even if it exceeds the capacity on
+  /// its own.
+  T& get_or_add(const Key& key) {
+    if (auto x = find(key))
+      return *x;
+    ++stats_.misses;
+    return insert(key, make_(key));
+  }
+
+  /// Gets the element for `key` without creating it on a miss, e.g., because
+  /// creating it may fail. A hit counts as an access. Callers that obtain the
+  /// missing element themselves should hand it to add() afterwards.
+  /// @returns a pointer to the element that remains valid until the next
+  ///          modification of the cache, or `nullptr` on a miss.
+  T* find(const Key& key) {
+    if (auto i = find(frequent_, key); i != frequent_.end()) {
+      ++stats_.hits;
+      std::rotate(i, i + 1, frequent_.end());
+      return &frequent_.back().value;
+    }
+    if (auto i = find(recent_, key); i != recent_.end()) {
+      // The second access promotes the element.
+      ++stats_.hits;
+      auto x = std::move(*i);
+      recent_.erase(i);
+      recent_weight_ -= x.weight;
+      return &promote(std::move(x));
+    }
+    return nullptr;
+  }
+
+  /// Adds an element that was created outside of the cache, e.g., loaded in
+  /// the background. Counts as a miss, because the cache had to obtain the
+  /// element.
+  /// @pre `!contains(key)`
+  T& add(const Key& key, T value) {
+    ++stats_.misses;
+    return insert(key, std::move(value));
+  }
+
+  /// Removes the element for `key` and forgets that the cache ever held it,
+  /// e.g., because the element ceased to exist. Does not count as an
+  /// eviction.
+  /// @returns whether the cache contained the element.
+  bool erase(const Key& key) {
+    ghosts_.erase(std::remove(ghosts_.begin(), ghosts_.end(), key),
+                  ghosts_.end());
+    if (auto i = find(recent_, key); i != recent_.end()) {
+      recent_weight_ -= i->weight;
+      recent_.erase(i);
+      return true;
+    }
+    if (auto i = find(frequent_, key); i != frequent_.end()) {
+      frequent_weight_ -= i->weight;
+      frequent_.erase(i);
+      return true;
+    }
+    return false;
+  }
+
+  /// Removes all elements and forgets about evicted ones. Does not count as
+  /// evictions.
+  void clear() {
+    recent_.clear();
+    frequent_.clear();
+    ghosts_.clear();
+    recent_weight_ = 0;
+    frequent_weight_ = 0;
+  }
+
+  /// @returns the elements that were accessed once, oldest first.
+  const vector_type& recent() const {
+    return recent_;
+  }
+
+  /// @returns the elements that were accessed repeatedly, oldest first.
+  const vector_type& frequent() const {
+    return frequent_;
+  }
+
+  /// @returns the number of elements in the cache.
+  size_t size() const noexcept {
+    return recent_.size() + frequent_.size();
+  }
+
+  /// @returns the total weight of all elements.
+  size_t weight() const noexcept {
+    return recent_weight_ + frequent_weight_;
+  }
+
+  /// @returns the maximum total weight of all elements.
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  /// Adjusts the maximum total weight and evicts elements as necessary.
+  void capacity(size_t new_capacity) {
+    capacity_ = new_capacity;
+    shrink(false);
+  }
+
+  /// @returns the maximum number of elements.
+  size_t max_size() const noexcept {
+    return max_size_;
+  }
+
+  /// Adjusts the maximum number of elements and evicts elements as necessary.
+  void max_size(size_t new_max_size) {
+    max_size_ = new_max_size;
+    shrink(false);
+  }
+
+  /// @returns the counters about cache accesses.
+  const statistics& stats() const noexcept {
+    return stats_;
+  }
+
+private:
+  static auto find(const vector_type& xs, const Key& key) {
+    return std::find_if(xs.begin(), xs.end(),
+                        [&](const entry& x) { return x.key == key; });
+  }
+
+  static auto find(vector_type& xs, const Key& key) {
+    return std::find_if(xs.begin(), xs.end(),
+                        [&](const entry& x) { return x.key == key; });
+  }
+
+  /// Inserts a new element into the segment that matches its history.
+  T& insert(const Key& key, T value) {
+    auto weight = std::max(weigh_(value), size_t{1});
+    auto x = entry{key, std::move(value), weight};
+    if (auto i = std::find(ghosts_.begin(), ghosts_.end(), key);
+        i != ghosts_.end()) {
+      ghosts_.erase(i);
+      promote(std::move(x));
+      shrink(false);
+      return frequent_.back().value;
+    }
+    recent_weight_ += weight;
+    recent_.push_back(std::move(x));
+    shrink(true);
+    return recent_.back().value;
+  }
+
+  /// Appends an element to the frequent segment and demotes the least
+  /// recently used elements of the frequent segment when it exceeds its share
+  /// of the capacity.
+  T& promote(entry x) {
+    frequent_weight_ += x.weight;
+    frequent_.push_back(std::move(x));
+    auto share = capacity_ / 4 * 3;
+    while (frequent_weight_ > share && frequent_.size() > 1) {
+      auto& y = frequent_.front();
+      frequent_weight_ -= y.weight;
+      recent_weight_ += y.weight;
+      recent_.push_back(std::move(y));
+      frequent_.erase(frequent_.begin());
+    }
+    return frequent_.back().value;
+  }
+
+  /// Evicts elements until the cache fits into its budget. Never evicts the
+  /// most recently added element, which sits at the back of its segment.
+  /// @param keep_recent Whether the most recently added element is in the
+  ///                    recent segment.
+  void shrink(bool keep_recent) {
+    while ((weight() > capacity_ || size() > max_size_) && size() > 1) {
+      ++stats_.evictions;
+      if (recent_.size() > (keep_recent ? 1u : 0u)) {
+        auto& x = recent_.front();
+        recent_weight_ -= x.weight;
+        ghosts_.push_back(std::move(x.key));
+        recent_.erase(recent_.begin());
+      } else {
+        frequent_weight_ -= frequent_.front().weight;
+        frequent_.erase(frequent_.begin());
+      }
+    }
+    // Remember as many evicted keys as the cache holds elements.
+    auto max_ghosts = std::max(size(), size_t{1});
+    if (ghosts_.size() > max_ghosts)
+      ghosts_.erase(ghosts_.begin(),
+                    ghosts_.begin() + (ghosts_.size() - max_ghosts));
+  }
+
+  // -- member variables -------------------------------------------------------
+
+  /// Elements that were accessed once. New elements are at the back, old
+  /// elements are evicted from the front.
+  vector_type recent_;
+
+  /// Elements that were accessed more than once, ordered by recency.
+  vector_type frequent_;
+
+  /// Keys of elements recently evicted from the recent segment.
+  std::vector<Key> ghosts_;
+
+  /// The total weight of the recent segment.
+  size_t recent_weight_ = 0;
+
+  /// The total weight of the frequent segment.
+  size_t frequent_weight_ = 0;
+
+  /// Maximum total weight of all elements.
+  size_t capacity_;
+
+  /// Maximum number of elements.
+  size_t max_size_;
+
+  /// Creates new instances of `T`.
+  Factory make_;
+
+  /// Computes the weight of an instance of `T`.
+  Weigher weigh_;
+
+  /// Counts hits, misses, and evictions.
+  statistics stats_;
+};
+
+} // namespace vast::detail
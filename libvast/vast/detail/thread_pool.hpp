@@ -0,0 +1,73 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vast::detail {
+
+/// A fixed-size pool of threads that execute jobs in FIFO order. Use this for
+/// CPU-bound work that must run outside of the actor system's scheduler, e.g.,
+/// when an actor wants to split a synchronous computation into shards.
+class thread_pool {
+public:
+  /// Starts a pool with a given number of threads.
+  /// @param size The number of worker threads.
+  /// @pre `size > 0`
+  explicit thread_pool(size_t size);
+
+  /// Waits for all pending jobs to finish and then joins the worker threads.
+  ~thread_pool();
+
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  /// @returns the number of worker threads.
+  size_t size() const;
+
+  /// Schedules a function for execution on one of the worker threads.
+  /// @param f The function to execute.
+  /// @returns a future for the result of *f*.
+  template <class F>
+  auto submit(F f) -> std::future<std::invoke_result_t<F>> {
+    using result_type = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<result_type()>>(
+      std::move(f));
+    auto result = task->get_future();
+    enqueue([task = std::move(task)] { (*task)(); });
+    return result;
+  }
+
+private:
+  void enqueue(std::function<void()> job);
+
+  void run();
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::function<void()>> jobs_;
+  bool done_ = false;
+  std::vector<std::thread> workers_;
+};
+
+} // namespace vast::detail
@@ -15,10 +15,15 @@
 
 #include "vast/bitmap_base.hpp"
 #include "vast/bitvector.hpp"
+#include "vast/chunk.hpp"
+#include "vast/span.hpp"
 #include "vast/word.hpp"
 
 #include "vast/detail/operators.hpp"
 
+#include <caf/error.hpp>
+#include <caf/fwd.hpp>
+
 namespace vast {
 
 template <class Block>
@@ -86,6 +91,8 @@ struct ewah_word : word<Block> {
 /// 1. The first block is a marker.
 /// 2. The last block is always dirty.
 ///
+/// A bitmap may also reference its blocks in place, e.g., from a memory-mapped
+/// file. Such a *frozen* bitmap copies its blocks upon the first modification.
 class ewah_bitmap : public bitmap_base<ewah_bitmap>,
                     detail::equality_comparable<ewah_bitmap> {
 public:
@@ -96,13 +103,24 @@ public:
 
   explicit ewah_bitmap(size_type n, bool bit = false);
 
+  /// Constructs a frozen bitmap from blocks that another EWAH bitmap produced.
+  /// @param blocks The blocks to reference.
+  /// @param last_marker The position of the last marker in *blocks*.
+  /// @param num_bits The number of bits.
+  /// @param owner The chunk that owns *blocks*.
+  ewah_bitmap(span<const block_type> blocks, size_type last_marker,
+              size_type num_bits, chunk_ptr owner);
+
   // -- inspectors -----------------------------------------------------------
 
   bool empty() const;
 
   size_type size() const;
 
-  const block_vector& blocks() const;
+  span<const block_type> blocks() const;
+
+  /// @returns whether the bitmap references its blocks in place.
+  bool frozen() const;
 
   // -- modifiers ------------------------------------------------------------
 
@@ -112,6 +130,13 @@ public:
 
   void append_block(block_type bits, size_type n = word_type::width);
 
+  /// Appends a sequence of complete blocks. Runs of non-homogeneous blocks
+  /// bypass the per-block marker bookkeeping of `append_block` when the
+  /// bitmap ends at a block boundary.
+  /// @param first The first block to append.
+  /// @param last One past the last block to append.
+  void append_blocks(const block_type* first, const block_type* last);
+
   void flip();
 
   // -- concepts -------------------------------------------------------------
@@ -120,10 +145,32 @@ public:
 
   template <class Inspector>
   friend auto inspect(Inspector&f, ewah_bitmap& bm) {
-    return f(bm.blocks_, bm.last_marker_, bm.num_bits_);
+    return inspect_inline(f, bm);
   }
 
+  friend caf::error inspect(caf::serializer& sink, ewah_bitmap& bm);
+
+  friend caf::error inspect(caf::deserializer& source, ewah_bitmap& bm);
+
 private:
+  /// Inspects the blocks as part of the bitmap itself.
+  template <class Inspector>
+  static auto inspect_inline(Inspector& f, ewah_bitmap& bm) {
+    if constexpr (Inspector::reads_state) {
+      if (bm.frozen()) {
+        auto blocks = block_vector(bm.frozen_.begin(), bm.frozen_.end());
+        return f(blocks, bm.last_marker_, bm.num_bits_);
+      }
+    } else {
+      bm.thaw();
+    }
+    return f(bm.blocks_, bm.last_marker_, bm.num_bits_);
+  }
+
+  /// Copies the referenced blocks of a frozen bitmap, such that it can be
+  /// modified.
+  void thaw();
+
   /// Incorporates the most recent (complete) dirty block.
   /// @pre `num_bits_ % word_type::width == 0`
   void integrate_last_block();
@@ -134,10 +181,47 @@ private:
   void bump_dirty_count();
 
   block_vector blocks_;
+  span<const block_type> frozen_;
+  chunk_ptr owner_;
   size_type last_marker_ = 0;
   size_type num_bits_ = 0;
 };
 
+/// A mixin for serializers that write the blocks of all EWAH bitmaps into a
+/// separate array instead of inline. Each bitmap then only refers to a range
+/// of this array, which allows for referencing the blocks in place when
+/// reading them back via an ::ewah_block_reader.
+class ewah_block_writer {
+public:
+  virtual ~ewah_block_writer();
+
+  /// @returns the blocks of all bitmaps written so far.
+  const ewah_bitmap::block_vector& blocks() const;
+
+private:
+  friend caf::error inspect(caf::serializer& sink, ewah_bitmap& bm);
+
+  ewah_bitmap::block_vector blocks_;
+};
+
+/// A mixin for deserializers that read state written by an
+/// ::ewah_block_writer. All deserialized EWAH bitmaps are frozen.
+class ewah_block_reader {
+public:
+  /// @param blocks The blocks that the ::ewah_block_writer produced.
+  /// @param owner The chunk that owns *blocks*.
+  ewah_block_reader(span<const ewah_bitmap::block_type> blocks,
+                    chunk_ptr owner);
+
+  virtual ~ewah_block_reader();
+
+private:
+  friend caf::error inspect(caf::deserializer& source, ewah_bitmap& bm);
+
+  span<const ewah_bitmap::block_type> blocks_;
+  chunk_ptr owner_;
+};
+
 class ewah_bitmap_range
   : public bit_range_base<ewah_bitmap_range, ewah_bitmap::block_type> {
 public:
@@ -160,4 +244,40 @@ private:
 
 ewah_bitmap_range bit_range(const ewah_bitmap& bm);
 
+class null_bitmap;
+
+/// @relates ewah_bitmap
+/// Computes the bitwise AND of two EWAH bitmaps by merging their clean runs
+/// and dirty words directly, without going through bit ranges. A run of 0s in
+/// one operand skips over the corresponding dirty words of the other.
+/// @param lhs The LHS of the operation.
+/// @param rhs The RHS of the operation.
+/// @returns The bitwise AND of *lhs* and *rhs*, padded with 0s to the size of
+///          the longer operand.
+ewah_bitmap binary_and(const ewah_bitmap& lhs, const ewah_bitmap& rhs);
+
+/// @relates ewah_bitmap
+/// Computes the bitwise OR of two EWAH bitmaps by merging their clean runs
+/// and dirty words directly, without going through bit ranges. A run of 1s in
+/// one operand skips over the corresponding dirty words of the other.
+/// @param lhs The LHS of the operation.
+/// @param rhs The RHS of the operation.
+/// @returns The bitwise OR of *lhs* and *rhs*.
+ewah_bitmap binary_or(const ewah_bitmap& lhs, const ewah_bitmap& rhs);
+
+/// @relates ewah_bitmap
+/// Computes the bitwise AND of an EWAH bitmap and an uncompressed bitmap,
+/// e.g., the result of evaluating a predicate over a table slice.
+ewah_bitmap binary_and(const ewah_bitmap& lhs, const null_bitmap& rhs);
+
+/// @relates ewah_bitmap
+ewah_bitmap binary_and(const null_bitmap& lhs, const ewah_bitmap& rhs);
+
+/// @relates ewah_bitmap
+/// Computes the bitwise OR of an EWAH bitmap and an uncompressed bitmap.
+ewah_bitmap binary_or(const ewah_bitmap& lhs, const null_bitmap& rhs);
+
+/// @relates ewah_bitmap
+ewah_bitmap binary_or(const null_bitmap& lhs, const ewah_bitmap& rhs);
+
 } // namespace vast
@@ -16,6 +16,8 @@
 #include "vast/detail/assert.hpp"
 #include "vast/error.hpp"
 #include "vast/expression.hpp"
+#include "vast/fwd.hpp"
+#include "vast/null_bitmap.hpp"
 #include "vast/offset.hpp"
 #include "vast/operator.hpp"
 #include "vast/time.hpp"
@@ -236,13 +238,94 @@ struct table_slice_row_evaluator {
 /// @pre `row < slice.rows()`
 bool evaluate_at(const table_slice& slice, size_t row, const expression& expr);
 
+/// Evaluates all rows of a table slice over a [resolved](@ref type_extractor)
+/// expression, one column at a time. Every predicate yields a selection bitmap
+/// over the rows of the slice, and the connectives combine these bitmaps
+/// block-wise. Predicates on count, integer, real, time, address, and string
+/// columns take typed fast paths that resolve the operator and the RHS once
+/// per column instead of once per row.
+struct table_slice_column_evaluator {
+  explicit table_slice_column_evaluator(const table_slice& slice);
+
+  null_bitmap operator()(caf::none_t);
+  null_bitmap operator()(const conjunction& c);
+  null_bitmap operator()(const disjunction& d);
+  null_bitmap operator()(const negation& n);
+  null_bitmap operator()(const predicate& p);
+  null_bitmap operator()(const attribute_extractor& e, const data& d);
+  null_bitmap operator()(const field_extractor&, const data&);
+  null_bitmap operator()(const type_extractor&, const data&);
+  null_bitmap operator()(const data_extractor& e, const data& d);
+
+  template <class T>
+  null_bitmap operator()(const data& d, const T& x) {
+    return (*this)(x, d);
+  }
+
+  template <class T, class U>
+  null_bitmap operator()(const T&, const U&) {
+    return null_bitmap(slice_.rows());
+  }
+
+  /// Evaluates a predicate over a single column of the slice.
+  /// @param column The column offset.
+  /// @param d The RHS of the predicate.
+  /// @returns a selection bitmap over the rows of the slice.
+  null_bitmap scan(size_t column, const data& d) const;
+
+  const table_slice& slice_;
+  relational_operator op_;
+};
+
 /// Evaluates an entire table slice over a [resolved](@ref type_extractor)
 /// expression.
 /// @param slice The table slice for evaluation.
 /// @param expr A resolved expression for evaluating all rows in `slice`.
 /// @returns a bitmap containing all IDs of matching rows.
+/// @relates table_slice_column_evaluator
 ids evaluate(const table_slice& slice, const expression& expr);
 
+/// Checks whether any row of a table slice may match a [resolved](@ref
+/// type_extractor) expression, based on per-column statistics of the slice
+/// alone. A `false` result is exact, i.e., no row can match, whereas `true`
+/// only means that the statistics cannot rule out a match.
+struct statistics_evaluator {
+  /// Constructs a statistics evaluator.
+  /// @param layout The layout of the table slice.
+  /// @param statistics One synopsis per column of *layout*, or `nullptr` for
+  ///        columns without statistics.
+  statistics_evaluator(const record_type& layout,
+                       const std::vector<synopsis_ptr>& statistics);
+
+  bool operator()(caf::none_t);
+  bool operator()(const conjunction& c);
+  bool operator()(const disjunction& d);
+  bool operator()(const negation& n);
+  bool operator()(const predicate& p);
+  bool operator()(const attribute_extractor& e, const data& d);
+  bool operator()(const field_extractor&, const data&);
+  bool operator()(const type_extractor&, const data&);
+  bool operator()(const data_extractor& e, const data& d);
+
+  template <class T>
+  bool operator()(const data& d, const T& x) {
+    return (*this)(x, d);
+  }
+
+  template <class T, class U>
+  bool operator()(const T&, const U&) {
+    return true;
+  }
+
+  /// Checks whether the statistics of a column may match the current
+  /// predicate.
+  bool lookup(size_t column, const data& d) const;
+
+  const record_type& layout_;
+  const std::vector<synopsis_ptr>& statistics_;
+  relational_operator op_;
+};
+
 /// Checks whether a [resolved](@ref type_extractor) expression matches a given
 /// type. That is, this visitor tests whether an expression consists of a
 /// viable set of predicates for a type. For conjunctions, all operands must
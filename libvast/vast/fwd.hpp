@@ -204,7 +204,9 @@ CAF_BEGIN_TYPE_ID_BLOCK(vast, caf::first_custom_type_id)
 
   VAST_ADD_ATOM(accept, "accept")
   VAST_ADD_ATOM(announce, "announce")
+  VAST_ADD_ATOM(background, "background")
   VAST_ADD_ATOM(batch, "batch")
+  VAST_ADD_ATOM(compact, "compact")
   VAST_ADD_ATOM(config, "config")
   VAST_ADD_ATOM(continuous, "continuous")
   VAST_ADD_ATOM(cpu, "cpu")
@@ -322,6 +324,7 @@ CAF_BEGIN_TYPE_ID_BLOCK(vast, caf::first_custom_type_id)
   VAST_ADD_TYPE_ID((std::vector<vast::event>) )
   VAST_ADD_TYPE_ID((std::vector<uint32_t>) )
   VAST_ADD_TYPE_ID((std::vector<vast::table_slice_ptr>) )
+  VAST_ADD_TYPE_ID((std::vector<vast::uuid>) )
 
   VAST_ADD_TYPE_ID((caf::stream<vast::table_slice_ptr>) )
 
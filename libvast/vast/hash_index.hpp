@@ -17,8 +17,10 @@
 #include "vast/concept/hashable/xxhash.hpp"
 #include "vast/data.hpp"
 #include "vast/detail/assert.hpp"
+#include "vast/detail/digest_scan.hpp"
 #include "vast/detail/stable_map.hpp"
 #include "vast/detail/type_traits.hpp"
+#include "vast/ewah_bitmap.hpp"
 #include "vast/value_index.hpp"
 #include "vast/view.hpp"
 
@@ -69,6 +71,9 @@ public:
   using hasher_type = xxhash64;
   using digest_type = std::array<byte, Bytes>;
 
+  // The scan treats the digests as one contiguous array of bytes.
+  static_assert(sizeof(digest_type) == Bytes, "digests must be packed");
+
   static_assert(sizeof(hasher_type::result_type) >= Bytes,
                 "number of chosen bytes exceeds underlying digest size");
 
@@ -183,34 +188,73 @@ private:
     return true;
   }
 
+  /// Maps match bits of the digests onto IDs. The *i*-th digest belongs to
+  /// the ID of the *i*-th 1-bit in the mask.
+  /// @param matches One bit per digest, as produced by `scan_digests`.
+  ids deposit(const std::vector<uint64_t>& matches) const {
+    ewah_bitmap result;
+    size_t digest = 0;
+    // Extracts up to 64 match bits beginning at a given digest.
+    auto extract = [&](size_t first) {
+      auto i = first / 64;
+      auto shift = first % 64;
+      auto word = matches[i] >> shift;
+      if (shift > 0 && i + 1 < matches.size())
+        word |= matches[i + 1] << (64 - shift);
+      return word;
+    };
+    for (auto bits : bit_range(this->mask())) {
+      if (bits.homogeneous()) {
+        if (bits.data() == 0) {
+          result.append_bits(false, bits.size());
+          continue;
+        }
+        // The common case: a run of consecutive IDs, which receive the match
+        // bits word by word.
+        for (auto n = bits.size(); n > 0;) {
+          auto k = std::min<size_t>(n, 64);
+          result.append_block(extract(digest), k);
+          digest += k;
+          n -= k;
+        }
+        continue;
+      }
+      // A literal word: scatter the match bits onto its 1-bits.
+      auto word = uint64_t{0};
+      for (auto mask = bits.data(); mask != 0; mask &= mask - 1, ++digest)
+        if ((matches[digest / 64] >> (digest % 64)) & 1)
+          word |= mask & (~mask + 1);
+      result.append_block(word, bits.size());
+    }
+    VAST_ASSERT(digest == digests_.size());
+    return result;
+  }
+
   caf::expected<ids>
   lookup_impl(relational_operator op, data_view x) const override {
     VAST_ASSERT(rank(this->mask()) == digests_.size());
-    // Implementation of the one-pass search algorithm that computes the
-    // resulting ID set. The predicate depends on the operator and RHS.
-    auto scan = [&](auto predicate) -> ids {
-      ewah_bitmap result;
-      auto rng = select(this->mask());
-      if (rng.done())
-        return result;
-      for (size_t i = 0, last_match = 0; i < digests_.size(); ++i) {
-        if (predicate(digests_[i])) {
-          auto digests_since_last_match = i - last_match;
-          if (digests_since_last_match > 0)
-            rng.next(digests_since_last_match);
-          result.append_bits(false, rng.get() - result.size());
-          result.append_bit(true);
-          last_match = i;
-        }
+    // Scans the digests for the keys in one pass that yields a bit per digest,
+    // and then maps the bits onto the IDs.
+    auto scan = [&](const std::vector<key>& keys, bool negate) -> ids {
+      std::vector<uint64_t> needles;
+      needles.reserve(keys.size());
+      for (auto& k : keys)
+        needles.push_back(detail::load_digest<Bytes>(k.bytes.data()));
+      std::vector<uint64_t> matches((digests_.size() + 63) / 64);
+      auto bytes = span<const byte>{
+        reinterpret_cast<const byte*>(digests_.data()),
+        digests_.size() * Bytes};
+      detail::scan_digests<Bytes>(bytes, needles, matches);
+      if (negate) {
+        for (auto& word : matches)
+          word = ~word;
+        if (auto partial = digests_.size() % 64)
+          matches.back() &= (uint64_t{1} << partial) - 1;
       }
-      return result;
+      return deposit(matches);
     };
-    if (op == equal || op == not_equal) {
-      auto k = find_digest(x);
-      auto eq = [=](const digest_type& digest) { return k == digest; };
-      auto ne = [=](const digest_type& digest) { return k != digest; };
-      return op == equal ? scan(eq) : scan(ne);
-    }
+    if (op == equal || op == not_equal)
+      return scan({find_digest(x)}, op == not_equal);
     if (op == in || op == not_in) {
       // Ensure that the RHS is a list of strings.
       auto keys = caf::visit(
@@ -230,20 +274,73 @@ private:
         x);
       if (!keys)
         return keys.error();
-      // We're good to go with: create the set predicates an run the scan.
-      auto in_pred = [&](const digest_type& digest) {
-        auto cmp = [=](auto& k) { return k == digest; };
-        return std::any_of(keys->begin(), keys->end(), cmp);
-      };
-      auto not_in_pred = [&](const digest_type& digest) {
-        auto cmp = [=](auto& k) { return k == digest; };
-        return std::none_of(keys->begin(), keys->end(), cmp);
-      };
-      return op == in ? scan(in_pred) : scan(not_in_pred);
+      return scan(*keys, op == not_in);
     }
     return make_error(ec::unsupported_operator, op);
   }
 
+  bool merge_impl(const value_index& other) override {
+    auto& rhs = static_cast<const hash_index&>(other);
+    // Looking up a value uses a single seed, so both indexes must agree on the
+    // seed of every value they have in common. Where they disagree, we
+    // re-hash the digests of the other index with our seed. We only give up
+    // if we cannot tell whether a value occurs in both indexes, or if a
+    // re-hashed digest would collide with the digest of another value.
+    auto contains = [](const std::vector<digest_type>& xs, digest_type x) {
+      return std::find(xs.begin(), xs.end(), x) != xs.end();
+    };
+    auto digests = rhs.digests_;
+    std::vector<std::pair<data, size_t>> adopted;
+    for (auto& [x, seed] : rhs.seeds_) {
+      auto target = seed;
+      if (auto i = seeds_.find(x); i != seeds_.end()) {
+        target = i->second;
+      } else if (contains(digests_, hash(x, 0))) {
+        // The value may occur in our digests with seed 0.
+        if (seed != 0)
+          return false;
+        continue;
+      } else {
+        // The value does not occur in our digests, so we only need a seed
+        // whose digest is unique in both indexes.
+        auto unique = [&](size_t i) {
+          auto digest = hash(x, i);
+          return !contains(digests_, digest)
+                 && (i == seed || !contains(digests, digest));
+        };
+        if (!unique(target)) {
+          target = 0;
+          while (target < max_hash_rounds && !unique(target))
+            ++target;
+          if (target == max_hash_rounds)
+            return false;
+        }
+        if (target > 0)
+          adopted.emplace_back(x, target);
+      }
+      if (target != seed) {
+        auto from = hash(x, seed);
+        auto to = hash(x, target);
+        if (contains(digests, to))
+          return false;
+        std::replace(digests.begin(), digests.end(), from, to);
+      }
+    }
+    // Our values that needed a seed must not occur in the other index with
+    // seed 0, and their digests must not collide with any digest there.
+    for (auto& [x, seed] : seeds_) {
+      if (seed == 0 || rhs.seeds_.find(x) != rhs.seeds_.end())
+        continue;
+      if (contains(digests, hash(x, 0)) || contains(digests, hash(x, seed)))
+        return false;
+    }
+    for (auto& [x, seed] : adopted)
+      seeds_.emplace(std::move(x), seed);
+    digests_.insert(digests_.end(), digests.begin(), digests.end());
+    unique_digests_.clear();
+    return true;
+  }
+
   bool immutable() const {
     return unique_digests_.empty() && !digests_.empty();
   }
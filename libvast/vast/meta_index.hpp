@@ -13,6 +13,7 @@
 
 #pragma once
 
+#include "vast/detail/thread_pool.hpp"
 #include "vast/fbs/meta_index.hpp"
 #include "vast/fwd.hpp"
 #include "vast/qualified_record_field.hpp"
@@ -20,10 +21,13 @@
 #include "vast/type.hpp"
 #include "vast/uuid.hpp"
 
+#include <caf/error.hpp>
 #include <caf/fwd.hpp>
+#include <caf/meta/load_callback.hpp>
 #include <caf/settings.hpp>
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -42,40 +46,183 @@ public:
   /// @param partition The partition ID that *slice* belongs to.
   void add(const uuid& partition, const table_slice& slice);
 
+  /// Shrinks the synopses of a partition that receives no more data, such
+  /// that they fit the number of events in the partition.
+  /// @param partition The partition to shrink the synopses of.
+  /// @param events The number of events in *partition*.
+  void shrink(const uuid& partition, size_t events);
+
+  /// Replaces partitions with a single partition that holds all their data,
+  /// e.g., after compacting them on disk. The new partition takes the place
+  /// of the first replaced partition and receives the merged synopses.
+  /// @param sources The partitions to replace.
+  /// @param target The partition that replaces *sources*.
+  /// @returns An error if a partition is unknown or if the synopses of a
+  ///          field cannot be merged, in which case the meta index remains
+  ///          unchanged.
+  /// @pre `!sources.empty()`
+  caf::error replace(const std::vector<uuid>& sources, const uuid& target);
+
+  /// Removes partitions, e.g., because their state on disk is incomplete.
+  /// Ignores unknown partitions.
+  /// @param partitions The partitions to remove.
+  void erase(const std::vector<uuid>& partitions);
+
   /// Retrieves the list of candidate partition IDs for a given expression.
   /// @param expr The expression to lookup.
   /// @returns A vector of UUIDs representing candidate partitions.
   std::vector<uuid> lookup(const expression& expr) const;
 
+  /// Sets the number of threads that evaluate a lookup. Every thread probes
+  /// the synopses of a disjoint range of partitions, and the calling thread
+  /// merges the results.
+  /// @param num_threads The number of threads including the calling thread.
+  ///        A value of 0 or 1 evaluates all lookups on the calling thread.
+  /// @note A lookup probes every synopsis from at most one thread, but
+  ///       concurrent calls to `lookup` are not supported.
+  void parallelism(size_t num_threads);
+
   /// Gets the options for the synopsis factory.
   /// @returns A reference to the synopsis options.
   caf::settings& factory_options();
 
+  /// @returns The number of partitions.
+  size_t num_partitions() const;
+
+  /// @returns The IDs of all partitions in the order in which the meta index
+  ///          has seen them.
+  const std::vector<uuid>& partitions() const;
+
   // -- concepts ---------------------------------------------------------------
 
-  // Allow debug printing meta_index instances.
+  // Allow debug printing meta_index instances. The persistent representation
+  // maps every partition to its synopses; loading rebuilds the field
+  // dictionary from it.
   template <class Inspector>
   friend auto inspect(Inspector& f, meta_index& x) {
-    return f(x.synopsis_options_, x.synopses_);
+    if constexpr (Inspector::reads_state) {
+      auto synopses = x.partition_synopses();
+      return f(x.synopsis_options_, synopses);
+    } else {
+      static_assert(Inspector::writes_state);
+      std::unordered_map<uuid, partition_synopsis> synopses;
+      auto cb = [&]() -> caf::error {
+        x.clear();
+        for (auto& [part_id, part_syn] : synopses)
+          x.merge(part_id, std::move(part_syn));
+        return caf::none;
+      };
+      return f(x.synopsis_options_, synopses, caf::meta::load_callback(cb));
+    }
   }
 
+  friend caf::expected<flatbuffers::Offset<fbs::MetaIndex>>
+  pack(flatbuffers::FlatBufferBuilder& builder, const meta_index& x,
+       size_t first);
+
+  friend caf::error
+  unpack(const fbs::MetaIndex& x, meta_index& y, chunk_ptr chunk);
+
 private:
   /// Contains one synopsis per partition column.
   using partition_synopsis
     = std::unordered_map<qualified_record_field, synopsis_ptr>;
 
-  /// Maps a partition ID to the synopses for that partition.
-  std::unordered_map<uuid, partition_synopsis> synopses_;
+  /// The synopses of a single field across all partitions that contain it.
+  struct field_synopses {
+    /// Indexes into `partitions_` in ascending order.
+    std::vector<size_t> partitions;
+
+    /// The synopsis per entry in `partitions`, or `nullptr` if the field has
+    /// no synopsis.
+    std::vector<synopsis_ptr> synopses;
+
+    /// Whether any entry in `synopses` is not `nullptr`.
+    bool has_synopsis = false;
+  };
+
+  /// The minimum number of partitions per shard of a parallel lookup.
+  static constexpr size_t min_shard_size = 64;
+
+  /// Retrieves the candidates among the partitions with an index in the range
+  /// [*first*, *last*).
+  std::vector<uuid>
+  lookup(const expression& expr, size_t first, size_t last) const;
+
+  /// Assigns a dense index to a partition.
+  size_t partition_index(const uuid& partition);
+
+  /// Retrieves the dense index of a field, adding it to the dictionary if
+  /// necessary.
+  size_t field_index(qualified_record_field field);
+
+  /// Locates the synopsis of a partition in a field, inserting the result of
+  /// `make()` if the partition has no synopsis for the field yet.
+  template <class MakeSynopsis>
+  synopsis_ptr&
+  slot(field_synopses& column, size_t partition, MakeSynopsis make);
+
+  /// Adds the synopses of a single partition.
+  void merge(const uuid& partition, partition_synopsis synopses);
+
+  /// Reassembles the synopses per partition.
+  std::unordered_map<uuid, partition_synopsis> partition_synopses() const;
+
+  /// Removes all partitions and fields.
+  void clear();
+
+  /// Maps dense partition indexes to partition IDs.
+  std::vector<uuid> partitions_;
+
+  /// Maps partition IDs to dense partition indexes.
+  std::unordered_map<uuid, size_t> partition_indexes_;
+
+  /// The dictionary of all fields across all partitions.
+  std::vector<qualified_record_field> fields_;
+
+  /// Maps fields to their index in `fields_`.
+  std::unordered_map<qualified_record_field, size_t> field_indexes_;
+
+  /// Maps layout names to the indexes of the partitions containing them, in
+  /// ascending order.
+  std::unordered_map<std::string, std::vector<size_t>> layouts_;
+
+  /// The synopses per field; parallel to `fields_`.
+  std::vector<field_synopses> columns_;
 
   /// Settings for the synopsis factory.
   caf::settings synopsis_options_;
+
+  /// Evaluates shards of a lookup next to the calling thread, if set.
+  std::shared_ptr<detail::thread_pool> pool_;
 };
 
 // -- flatbuffer ---------------------------------------------------------------
 
+/// Packs the partitions of a meta index into a flatbuffer.
+/// @param builder The builder to append *x* to.
+/// @param x The meta index to pack.
+/// @param first The index of the first partition to pack in the order in
+///        which *x* has seen the partitions. A value greater than 0 packs only
+///        the partitions added after the first *first* ones, e.g., to append
+///        them to a previously written meta index.
+/// @returns The flatbuffer offset of the packed meta index.
+caf::expected<flatbuffers::Offset<fbs::MetaIndex>>
+pack(flatbuffers::FlatBufferBuilder& builder, const meta_index& x,
+     size_t first);
+
 caf::expected<flatbuffers::Offset<fbs::MetaIndex>>
 pack(flatbuffers::FlatBufferBuilder& builder, const meta_index& x);
 
+/// Adds the partitions of a packed meta index to a meta index.
+/// @param x The packed meta index.
+/// @param y The meta index to add the partitions of *x* to.
+/// @param chunk The chunk that holds *x*. If set, Bloom filter synopses
+///        perform lookups directly on the bits in *chunk* instead of copying
+///        them, and keep *chunk* alive.
+/// @returns An error iff *x* is malformed.
+caf::error unpack(const fbs::MetaIndex& x, meta_index& y, chunk_ptr chunk);
+
 caf::error unpack(const fbs::MetaIndex& x, meta_index& y);
 
 } // namespace vast
@@ -16,10 +16,14 @@
 #include <caf/deserializer.hpp>
 #include <caf/optional.hpp>
 #include <caf/serializer.hpp>
+#include <caf/settings.hpp>
 #include <caf/sum_type.hpp>
 
 #include "vast/synopsis.hpp"
 
+#include <limits>
+#include <typeinfo>
+
 namespace vast {
 
 /// A synopsis structure that keeps track of the minimum and maximum value.
@@ -42,6 +46,21 @@ public:
       max_ = *y;
   }
 
+  using synopsis::add_batch;
+
+  void add_batch(span<const T> xs) override {
+    // Accumulating in locals without branches lets the compiler vectorize
+    // the loop.
+    auto lo = min_;
+    auto hi = max_;
+    for (auto x : xs) {
+      lo = x < lo ? x : lo;
+      hi = x > hi ? x : hi;
+    }
+    min_ = lo;
+    max_ = hi;
+  }
+
   caf::optional<bool> lookup(relational_operator op,
                              data_view rhs) const override {
     auto do_lookup = [this](relational_operator op,
@@ -53,12 +72,16 @@ public:
     };
     auto membership = [&]() -> caf::optional<bool> {
       if (auto xs = caf::get_if<view<list>>(&rhs)) {
+        auto result = false;
         for (auto x : **xs) {
-          auto result = do_lookup(equal, x);
-          if (result && *result)
-            return true;
+          // We cannot rule out elements of a different type, e.g., count
+          // literals for an integer column.
+          auto member = do_lookup(equal, x);
+          if (!member)
+            return caf::none;
+          result = result || *member;
         }
-        return false;
+        return result;
       }
       return caf::none;
     };
@@ -66,8 +89,10 @@ public:
       case in:
         return membership();
       case not_in:
+        // Only a partition with a single distinct value can consist entirely
+        // of members.
         if (auto result = membership())
-          return !*result;
+          return !(*result && min_ == max_);
         else
           return result;
       case equal:
@@ -82,6 +107,24 @@ public:
     }
   }
 
+  bool merge(const synopsis& other) override {
+    if (typeid(other) != typeid(*this))
+      return false;
+    auto& rhs = static_cast<const min_max_synopsis&>(other);
+    if (rhs.min_ < min_)
+      min_ = rhs.min_;
+    if (rhs.max_ > max_)
+      max_ = rhs.max_;
+    return true;
+  }
+
+  bool equals(const synopsis& other) const noexcept override {
+    if (typeid(other) != typeid(*this))
+      return false;
+    auto& rhs = static_cast<const min_max_synopsis&>(other);
+    return this->type() == rhs.type() && min_ == rhs.min_ && max_ == rhs.max_;
+  }
+
   caf::error serialize(caf::serializer& sink) const override {
     return sink(min_, max_);
   }
@@ -127,7 +170,7 @@ private:
       case equal:
         return min_ <= x && x <= max_;
       case not_equal:
-        return !(min_ <= x && x <= max_);
+        return !(min_ == x && x == max_);
       case less:
         return min_ < x;
       case less_equal:
@@ -143,4 +186,16 @@ private:
   T max_;
 };
 
+/// Factory to construct a min-max synopsis for arithmetic types.
+/// @param x The type of the synopsis.
+/// @returns A type-erased pointer to a synopsis that has not seen any values.
+/// @relates min_max_synopsis
+template <class T>
+synopsis_ptr make_min_max_synopsis(vast::type x, const caf::settings&) {
+  static_assert(std::numeric_limits<T>::is_specialized);
+  return caf::make_counted<min_max_synopsis<T>>(
+    std::move(x), std::numeric_limits<T>::max(),
+    std::numeric_limits<T>::lowest());
+}
+
 } // namespace vast
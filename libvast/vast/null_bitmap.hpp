@@ -41,6 +41,8 @@ public:
 
   size_type size() const;
 
+  const bitvector_type::block_vector& blocks() const;
+
   // -- modifiers ------------------------------------------------------------
 
   void append_bit(bool bit);
@@ -51,6 +53,14 @@ public:
 
   void flip();
 
+  // -- bitwise operations ---------------------------------------------------
+
+  /// Computes the bitwise AND with a bitmap of equal size in place.
+  null_bitmap& operator&=(const null_bitmap& other);
+
+  /// Computes the bitwise OR with a bitmap of equal size in place.
+  null_bitmap& operator|=(const null_bitmap& other);
+
   // -- concepts -------------------------------------------------------------
 
   friend bool operator==(const null_bitmap& x, const null_bitmap& y);
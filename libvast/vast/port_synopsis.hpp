@@ -0,0 +1,38 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/min_max_synopsis.hpp"
+#include "vast/synopsis.hpp"
+
+namespace vast {
+
+/// A synopsis for transport-layer ports that keeps track of the minimum and
+/// maximum port number. Because the port type of a query may be unknown, the
+/// synopsis disregards the port type entirely.
+class port_synopsis final : public min_max_synopsis<count> {
+public:
+  using super = min_max_synopsis<count>;
+
+  port_synopsis(vast::type x);
+
+  void add(data_view x) override;
+
+  caf::optional<bool>
+  lookup(relational_operator op, data_view rhs) const override;
+
+  bool equals(const synopsis& other) const noexcept override;
+};
+
+} // namespace vast
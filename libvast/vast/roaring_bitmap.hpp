@@ -0,0 +1,191 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/bitmap_base.hpp"
+#include "vast/detail/operators.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace vast {
+
+class roaring_bitmap_range;
+
+/// A bitmap in the spirit of *Roaring* by Chambi et al. The bitmap partitions
+/// the ID space into chunks of 2^16 bits and stores only chunks that contain
+/// at least one 1-bit. Each chunk lives in a *container* that picks the most
+/// compact of three representations:
+///
+/// 1. *array*: a sorted list of up to 4096 positions for sparse chunks,
+/// 2. *bitset*: an uncompressed 2^16-bit block for dense chunks, and
+/// 3. *run*: a sorted list of `[first, last]` intervals for clustered chunks.
+///
+/// Unlike word-aligned run-length encodings, a run of 0s between two chunks
+/// costs no space at all, and bitwise operations and random access only touch
+/// the containers involved instead of decompressing everything in between.
+class roaring_bitmap : public bitmap_base<roaring_bitmap>,
+                       detail::equality_comparable<roaring_bitmap> {
+  friend roaring_bitmap_range;
+
+public:
+  /// The number of bits that a single container covers.
+  static constexpr size_type container_bits = size_type{1} << 16;
+
+  /// Holds the 1-bits of a single chunk. All positions are relative to the
+  /// beginning of the chunk.
+  struct container : detail::equality_comparable<container> {
+    enum class kind : uint8_t { array, bitset, run };
+
+    /// The maximum number of positions in an array container.
+    static constexpr size_t max_array_size = 4096;
+
+    /// The number of blocks in a bitset container.
+    static constexpr size_t bitset_blocks = container_bits / word_type::width;
+
+    /// @returns the number of 1-bits.
+    size_t cardinality() const;
+
+    /// @returns the value of the bit at position *i*.
+    bool test(uint32_t i) const;
+
+    /// Locates the next bit of a given value.
+    /// @returns the first position *>= i* with value *bit*, or
+    ///          `container_bits` if there is none.
+    uint32_t find(bool bit, uint32_t i) const;
+
+    /// Extracts a sequence of bits.
+    /// @returns the *n* bits starting at position *i* as LSB-aligned block.
+    /// @pre `n <= word_type::width && i + n <= container_bits`
+    block_type extract(uint32_t i, uint32_t n) const;
+
+    /// Sets the bit at position *i*.
+    /// @pre *i* is greater than the last 1-bit.
+    void add(uint32_t i);
+
+    /// Sets all bits in *[first, last)*.
+    /// @pre *first* is greater than the last 1-bit.
+    void add_range(uint32_t first, uint32_t last);
+
+    /// @returns an uncompressed copy of the container.
+    std::vector<block_type> to_bitset() const;
+
+    /// Replaces the contents with an uncompressed bitset, using the
+    /// representation *k*.
+    void assign(std::vector<block_type> xs, kind k);
+
+    /// Switches to the most compact representation.
+    void optimize();
+
+    friend bool operator==(const container& x, const container& y);
+
+    template <class Inspector>
+    friend auto inspect(Inspector& f, container& x) {
+      return f(x.key, x.type, x.values, x.blocks);
+    }
+
+    size_type key = 0;              ///< The index of the chunk.
+    kind type = kind::array;        ///< The active representation.
+    std::vector<uint16_t> values;   ///< Positions or `[first, last]` pairs.
+    std::vector<block_type> blocks; ///< The blocks of a bitset.
+  };
+
+  using container_vector = std::vector<container>;
+
+  roaring_bitmap() = default;
+
+  explicit roaring_bitmap(size_type n, bool bit = false);
+
+  // -- inspectors -----------------------------------------------------------
+
+  bool empty() const;
+
+  size_type size() const;
+
+  const container_vector& containers() const;
+
+  // -- modifiers ------------------------------------------------------------
+
+  void append_bit(bool bit);
+
+  void append_bits(bool bit, size_type n);
+
+  void append_block(block_type bits, size_type n = word_type::width);
+
+  void flip();
+
+  /// Converts all containers into their most compact representation.
+  void optimize();
+
+  // -- element access -------------------------------------------------------
+
+  /// Accesses the *i*-th bit by looking only at the enclosing container.
+  /// @pre `i < size()`
+  bool operator[](size_type i) const;
+
+  // -- bitwise operations ---------------------------------------------------
+
+  /// Computes the bitwise AND container by container in place.
+  roaring_bitmap& operator&=(const roaring_bitmap& other);
+
+  /// Computes the bitwise OR container by container in place.
+  roaring_bitmap& operator|=(const roaring_bitmap& other);
+
+  // -- concepts -------------------------------------------------------------
+
+  friend bool operator==(const roaring_bitmap& x, const roaring_bitmap& y);
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, roaring_bitmap& bm) {
+    return f(bm.containers_, bm.num_bits_);
+  }
+
+  friend roaring_bitmap_range bit_range(const roaring_bitmap& bm);
+
+private:
+  /// Sets *n* bits starting at position *first*.
+  /// @pre *first* is greater than the position of the last 1-bit.
+  void fill(size_type first, size_type n);
+
+  /// Retrieves the container for appending to chunk *key*, creating it if
+  /// necessary. Creating a new container seals the previous one.
+  container& back(size_type key);
+
+  container_vector containers_;
+  size_type num_bits_ = 0;
+};
+
+/// Iterates over a roaring bitmap without materializing runs: gaps between
+/// containers and long intervals inside containers map to a single sequence.
+class roaring_bitmap_range
+  : public bit_range_base<roaring_bitmap_range, roaring_bitmap::block_type> {
+public:
+  using word_type = roaring_bitmap::word_type;
+
+  roaring_bitmap_range() = default;
+
+  explicit roaring_bitmap_range(const roaring_bitmap& bm);
+
+  void next();
+  bool done() const;
+
+private:
+  void scan();
+
+  const roaring_bitmap* bm_ = nullptr;
+  size_t container_ = 0;
+  roaring_bitmap::size_type position_ = 0;
+};
+
+} // namespace vast
@@ -39,6 +39,12 @@ public:
   /// @param chunk The chunk holding the segment data.
   static caf::expected<segment> make(chunk_ptr chunk);
 
+  /// Constructs a segment.
+  /// @param chunk The chunk holding the segment data.
+  /// @param max_size The maximum segment size in bytes, which bounds the size
+  ///        of its table slices after decompression.
+  static caf::expected<segment> make(chunk_ptr chunk, size_t max_size);
+
   /// @returns The unique ID of this segment.
   uuid id() const;
 
@@ -56,10 +62,23 @@ public:
   /// @returns The table slices according to *xs*.
   caf::expected<std::vector<table_slice_ptr>> lookup(const vast::ids& xs) const;
 
+  /// Locates the table slices for a given set of IDs, skipping the ones whose
+  /// statistics rule out a match of a query. The table slices keep their row
+  /// layout, so the lookup decodes all columns of every table slice it keeps.
+  /// @param xs The IDs to lookup.
+  /// @param expr The query that the table slices must possibly match, or an
+  ///        empty expression to skip no table slices.
+  /// @returns The table slices according to *xs* that may match *expr*.
+  caf::expected<std::vector<table_slice_ptr>>
+  lookup(const vast::ids& xs, const expression& expr) const;
+
 private:
   explicit segment(chunk_ptr chk);
 
   chunk_ptr chunk_;
+
+  /// The maximum size of an uncompressed table slice.
+  size_t max_size_;
 };
 
 } // namespace vast
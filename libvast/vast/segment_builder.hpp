@@ -14,9 +14,11 @@
 #pragma once
 
 #include "vast/aliases.hpp"
+#include "vast/compression.hpp"
 #include "vast/fbs/segment.hpp"
 #include "vast/fbs/table_slice.hpp"
 #include "vast/segment.hpp"
+#include "vast/type.hpp"
 #include "vast/uuid.hpp"
 
 #include <caf/expected.hpp>
@@ -27,12 +29,26 @@
 
 namespace vast {
 
+/// Configures how a segment builder compresses table slices.
+/// @relates segment_builder
+struct segment_compression {
+  /// The algorithm that compresses each table slice.
+  compression method = compression::null;
+
+  /// The compression level, which only zstd supports.
+  int level = 3;
+
+  /// Whether to train a zstd dictionary for each layout in a segment.
+  bool dictionaries = false;
+};
+
 /// A builder to create a segment from table slices.
 /// @relates segment
 class segment_builder {
 public:
   /// Constructs a segment builder.
-  segment_builder();
+  /// @param compression Configures the compression of table slices.
+  explicit segment_builder(segment_compression compression = {});
 
   /// Adds a table slice to the segment.
   /// @returns An error if adding the table slice failed.
@@ -56,7 +72,13 @@ public:
   /// @returns The IDs for the contained table slices.
   vast::ids ids() const;
 
-  /// @returns The number of bytes of the current segment.
+  /// @returns Whether ::finish compresses all table slices, because it trains
+  ///          dictionaries on them first. Otherwise, ::add compresses each
+  ///          table slice right away.
+  bool compresses_on_finish() const;
+
+  /// @returns The number of bytes of the current segment, counting table
+  ///          slices that await compression with their uncompressed size.
   size_t table_slice_bytes() const;
 
   /// @returns The currently buffered table slices.
@@ -66,6 +88,35 @@ public:
   void reset();
 
 private:
+  /// A serialized table slice that awaits compression.
+  struct pending_slice {
+    chunk_ptr chunk;
+    int layout;
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> statistics;
+  };
+
+  /// Locates a layout in the segment, and adds it if necessary.
+  /// @returns The index of *layout* in the segment.
+  caf::expected<int> layout_index(const record_type& layout);
+
+  /// Adds a serialized table slice to the segment, compressed if that makes it
+  /// smaller.
+  /// @param x The serialized table slice.
+  /// @param slice The table slice that *x* holds.
+  /// @param layout The index of the layout of *slice* in the segment.
+  /// @param statistics The statistics of *slice*, if any.
+  /// @param dictionary_index The index of *dictionary* in the segment, or -1.
+  /// @param dictionary The zstd dictionary to compress with, if any.
+  void add_buffer(const chunk& x, const table_slice& slice, int layout,
+                  flatbuffers::Offset<flatbuffers::Vector<uint8_t>> statistics,
+                  int dictionary_index, const std::vector<char>* dictionary);
+
+  /// Compresses the pending table slices into the segment.
+  /// @returns The offsets of the trained dictionaries.
+  std::vector<flatbuffers::Offset<fbs::CompressionDictionary>>
+  compress_pending();
+
+  segment_compression compression_;
   uuid id_;
   vast::id min_table_slice_offset_;
   uint64_t num_events_;
@@ -73,6 +124,16 @@ private:
   std::vector<flatbuffers::Offset<fbs::TableSliceBuffer>> flat_slices_;
   std::vector<table_slice_ptr> slices_; // For queries to an unfinished segment.
   std::vector<fbs::Interval> intervals_;
+  /// Serialized table slices that we compress when finishing the segment,
+  /// because training dictionaries requires all of them. Empty unless
+  /// ::compresses_on_finish.
+  std::vector<pending_slice> pending_;
+  size_t pending_bytes_;
+  std::vector<record_type> layouts_;
+  std::vector<flatbuffers::Offset<fbs::SegmentLayout>> flat_layouts_;
+  /// Whether the segment contains compressed table slices or statistics,
+  /// which readers of version 0 segments do not know about.
+  bool requires_v1_;
 };
 
 } // namespace vast
@@ -13,8 +13,9 @@
 
 #pragma once
 
-#include "vast/detail/cache.hpp"
+#include "vast/detail/flat_2q_cache.hpp"
 #include "vast/detail/range_map.hpp"
+#include "vast/detail/thread_pool.hpp"
 #include "vast/fwd.hpp"
 #include "vast/path.hpp"
 #include "vast/segment.hpp"
@@ -24,23 +25,58 @@
 
 #include <caf/fwd.hpp>
 
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
 namespace vast {
 
 /// @relates segment_store
 using segment_store_ptr = std::unique_ptr<segment_store>;
 
-/// A store that keeps its data in terms of segments.
+/// A store that keeps its data in terms of segments. Lookup sessions only
+/// share the caches with the store, so they may run on other threads.
+///
+/// The store caches data in two tiers. The first tier holds segments. The
+/// second tier holds the unpacked table slices of segments, so that lookups
+/// skip unpacking them. A segment qualifies for the second tier when a lookup
+/// finds it in the first tier, or when the store has just written it. Both
+/// tiers evict elements that were accessed only once first, so that a bulk
+/// export cannot displace the working set of interactive queries.
 class segment_store : public store {
 public:
+  // -- member types -----------------------------------------------------------
+
+  /// Counts how often lookups find a segment in a cache tier.
+  struct cache_statistics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
   // -- constructors, destructors, and assignment operators --------------------
 
   /// Constructs a segment store.
   /// @param dir The directory where to store state.
   /// @param max_segment_size The maximum segment size in bytes.
-  /// @param in_memory_segments The number of semgents to cache in memory.
+  /// @param in_memory_segments The number of segments to cache in memory,
+  ///        regardless of their size.
+  /// @param segment_cache_size The maximum number of bytes of cached
+  ///        segments.
+  /// @param slice_cache_size The maximum number of bytes of segments whose
+  ///        unpacked table slices are cached.
+  /// @param compression Configures the compression of table slices in new
+  ///        segments.
+  /// @param pool Finishes segments that train compression dictionaries in
+  ///        the background, or null to finish them in ::put.
   /// @pre `max_segment_size > 0`
-  static segment_store_ptr make(path dir, size_t max_segment_size,
-                                size_t in_memory_segments);
+  static segment_store_ptr
+  make(path dir, size_t max_segment_size, size_t in_memory_segments,
+       size_t segment_cache_size, size_t slice_cache_size,
+       segment_compression compression = {},
+       detail::thread_pool* pool = nullptr);
 
   ~segment_store();
 
@@ -53,7 +89,7 @@ public:
 
   /// @returns whether the store has no unwritten data pending.
   bool dirty() const noexcept {
-    return builder_.table_slice_bytes() != 0;
+    return builder_.table_slice_bytes() != 0 || !sealing_.empty();
   }
 
   /// @returns the ID of the active segment.
@@ -62,15 +98,30 @@ public:
   }
 
   /// @returns whether `x` is currently a cached segment.
-  bool cached(const uuid& x) const noexcept {
-    return cache_.count(x) != 0;
+  bool cached(const uuid& x) const {
+    std::lock_guard<std::mutex> lock{cache_mutex_};
+    return segment_cache_.contains(x) || slice_cache_.contains(x);
+  }
+
+  /// @returns the number of lookups that the segment tier answered.
+  cache_statistics segment_cache_stats() const {
+    std::lock_guard<std::mutex> lock{cache_mutex_};
+    return segment_cache_stats_;
+  }
+
+  /// @returns the number of lookups that the table slice tier answered.
+  cache_statistics slice_cache_stats() const {
+    std::lock_guard<std::mutex> lock{cache_mutex_};
+    return slice_cache_stats_;
   }
 
   // -- cache management -------------------------------------------------------
 
   /// Evicts all segments from the cache.
   void clear_cache() {
-    cache_.clear();
+    std::lock_guard<std::mutex> lock{cache_mutex_};
+    segment_cache_.clear();
+    slice_cache_.clear();
   }
 
   // -- implementation of store ------------------------------------------------
@@ -79,6 +130,9 @@ public:
 
   std::unique_ptr<store::lookup> extract(const ids& xs) const override;
 
+  std::unique_ptr<store::lookup>
+  extract(const ids& xs, const expression& expr) const override;
+
   caf::error erase(const ids& xs) override;
 
   caf::expected<std::vector<table_slice_ptr>> get(const ids& xs) override;
@@ -88,7 +142,49 @@ public:
   void inspect_status(caf::settings& xs, status_verbosity v) override;
 
 private:
-  segment_store(path dir, uint64_t max_segment_size, size_t in_memory_segments);
+  /// The table slices of a segment, unpacked ahead of lookups.
+  struct unpacked_segment {
+    /// The table slices ordered by their offsets.
+    std::vector<table_slice_ptr> slices;
+
+    /// The size of the segment in bytes.
+    size_t size;
+  };
+
+  /// A segment that a thread of the pool finishes in the background.
+  struct sealing_segment {
+    /// The table slices of the segment, which answer lookups meanwhile.
+    std::vector<table_slice_ptr> slices;
+
+    /// Becomes ready once the segment is on disk and in the caches.
+    std::future<caf::error> done;
+  };
+
+  /// Weighs a segment by the size of its chunk.
+  struct segment_weigher {
+    size_t operator()(const segment& x) const;
+  };
+
+  /// Weighs unpacked table slices by the size of their segment.
+  struct unpacked_segment_weigher {
+    size_t operator()(const unpacked_segment& x) const {
+      return x.size;
+    }
+  };
+
+  /// Elements enter the caches via add(), because loading a segment may fail.
+  struct no_factory {};
+
+  using segment_cache_type
+    = detail::flat_2q_cache<uuid, segment, no_factory, segment_weigher>;
+
+  using slice_cache_type
+    = detail::flat_2q_cache<uuid, unpacked_segment, no_factory,
+                            unpacked_segment_weigher>;
+
+  segment_store(path dir, uint64_t max_segment_size, size_t in_memory_segments,
+                size_t segment_cache_size, size_t slice_cache_size,
+                segment_compression compression, detail::thread_pool* pool);
 
   // -- utility functions ------------------------------------------------------
 
@@ -98,6 +194,45 @@ private:
 
   caf::expected<segment> load_segment(uuid id) const;
 
+  /// Finishes the active segment, on the pool if that trains dictionaries.
+  caf::error seal();
+
+  /// Writes a finished segment and adds it to the caches. Safe to call from
+  /// the pool.
+  /// @param seg The finished segment.
+  /// @param slices The table slices of *seg*.
+  caf::error persist(segment seg, std::vector<table_slice_ptr> slices);
+
+  /// Forgets about segments that the pool has finished.
+  /// @param wait Whether to wait for the pool to finish all segments.
+  /// @returns The first error that finishing a segment produced.
+  caf::error reap(bool wait);
+
+  /// Looks up table slices in a persisted segment and updates the caches.
+  /// Safe to call from lookup sessions.
+  /// @param id The segment to look into.
+  /// @param xs The IDs to lookup.
+  /// @param expr The query for skipping table slices, if any.
+  caf::expected<std::vector<table_slice_ptr>>
+  lookup_segment(const uuid& id, const ids& xs, const expression& expr) const;
+
+  /// Registers a new lookup session.
+  /// @returns The erase generation that the session started in.
+  uint64_t begin_session() const;
+
+  /// Unregisters a lookup session and forgets about erased segments that no
+  /// remaining session can reference anymore.
+  /// @param generation The result of ::begin_session for the session.
+  void end_session(uint64_t generation) const;
+
+  /// Forgets about erased segments that no running session can reference.
+  /// Requires a lock on `cache_mutex_`.
+  void prune_erased_segments() const;
+
+  /// Moves cached segments to the front of `candidates`, so that loading the
+  /// others cannot evict them before use.
+  void partition_cached(std::vector<uuid>& candidates) const;
+
   /// Fills `candidates` with all segments that qualify for `selection`.
   caf::error select_segments(const ids& selection,
                              std::vector<uuid>& candidates) const;
@@ -127,7 +262,39 @@ private:
   detail::range_map<id, uuid> segments_;
 
   /// Optimizes access times into segments by keeping some segments in memory.
-  mutable detail::cache<uuid, segment> cache_;
+  mutable segment_cache_type segment_cache_;
+
+  /// Keeps the unpacked table slices of frequently used segments in memory.
+  mutable slice_cache_type slice_cache_;
+
+  mutable cache_statistics segment_cache_stats_;
+
+  mutable cache_statistics slice_cache_stats_;
+
+  /// Protects the caches from concurrent lookup sessions.
+  mutable std::mutex cache_mutex_;
+
+  /// The persisted segments that ::erase evicted from the caches, mapped to
+  /// the erase generation that evicted them. Lookup sessions that started
+  /// before the erasure must not add them again. Protected by `cache_mutex_`.
+  mutable std::unordered_map<uuid, uint64_t> erased_segments_;
+
+  /// Counts the calls to ::erase. Protected by `cache_mutex_`.
+  uint64_t erase_generation_ = 0;
+
+  /// The erase generations that the running lookup sessions started in.
+  /// Protected by `cache_mutex_`.
+  mutable std::multiset<uint64_t> session_generations_;
+
+  /// Configures the compression of table slices in new segments.
+  segment_compression compression_;
+
+  /// Finishes segments that train dictionaries, if not null.
+  detail::thread_pool* pool_;
+
+  /// The segments that the pool finishes, by ID. Only the store accesses
+  /// this map, never its lookup sessions.
+  std::unordered_map<uuid, sealing_segment> sealing_;
 
   /// Serializes table slices into contiguous chunks of memory.
   segment_builder builder_;
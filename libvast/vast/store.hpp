@@ -42,12 +42,24 @@ public:
   /// @returns No error on success.
   virtual caf::error put(table_slice_ptr xs) = 0;
 
-  /// Starts an iterative extraction session.
+  /// Starts an iterative extraction session. The session may run on a
+  /// different thread than the store, but must not outlive it.
   /// @param xs The IDs for the events to retrieve.
   /// @returns A pointer to lookup session.
   /// @relates lookup
   virtual std::unique_ptr<lookup> extract(const ids& xs) const = 0;
 
+  /// Starts an iterative extraction session for a query. The session may
+  /// skip table slices that cannot contain events matching the query, but
+  /// the remaining events still need to be checked against it. The default
+  /// implementation skips nothing.
+  /// @param xs The IDs for the events to retrieve.
+  /// @param expr The query that the retrieved events get checked against.
+  /// @returns A pointer to lookup session.
+  /// @relates lookup
+  virtual std::unique_ptr<lookup>
+  extract(const ids& xs, const expression& expr) const;
+
   /// Erases events from the store.
   /// @param xs The set of IDs to erase.
   /// @returns No error on success.
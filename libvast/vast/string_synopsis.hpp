@@ -0,0 +1,95 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/bloom_filter_parameters.hpp"
+#include "vast/bloom_filter_synopsis.hpp"
+
+#include <caf/settings.hpp>
+
+#include <vast/detail/assert.hpp>
+#include <vast/logger.hpp>
+
+#include <string>
+
+namespace vast {
+
+/// A synopsis for strings.
+template <class HashFunction>
+class string_synopsis final
+  : public bloom_filter_synopsis<std::string, HashFunction> {
+public:
+  using super = bloom_filter_synopsis<std::string, HashFunction>;
+
+  /// Constructs a string synopsis from a `string_type` and a Bloom filter.
+  string_synopsis(type x, typename super::bloom_filter_type bf)
+    : super{std::move(x), std::move(bf)} {
+    VAST_ASSERT(caf::holds_alternative<string_type>(this->type()));
+  }
+
+  bool equals(const synopsis& other) const noexcept override {
+    if (typeid(other) != typeid(string_synopsis))
+      return false;
+    auto& rhs = static_cast<const string_synopsis&>(other);
+    return this->type() == rhs.type()
+           && this->bloom_filter_ == rhs.bloom_filter_;
+  }
+};
+
+/// Factory to construct a string synopsis.
+/// @tparam HashFunction The hash function to use for the Bloom filter.
+/// @param type A type instance carrying a `string_type`.
+/// @param params The Bloom filter parameters.
+/// @param seeds The seeds for the Bloom filter hasher.
+/// @returns A type-erased pointer to a synopsis.
+/// @pre `caf::holds_alternative<string_type>(type)`.
+/// @relates string_synopsis
+template <class HashFunction>
+synopsis_ptr
+make_string_synopsis(vast::type type, bloom_filter_parameters params,
+                     std::vector<size_t> seeds = {}) {
+  VAST_ASSERT(caf::holds_alternative<string_type>(type));
+  auto x = make_bloom_filter<HashFunction>(std::move(params), std::move(seeds));
+  if (!x) {
+    VAST_WARNING_ANON(__func__, "failed to construct Bloom filter");
+    return nullptr;
+  }
+  using synopsis_type = string_synopsis<HashFunction>;
+  return caf::make_counted<synopsis_type>(std::move(type), std::move(*x));
+}
+
+/// Factory to construct a string synopsis. This overload looks for a type
+/// attribute containing the Bloom filter parameters and otherwise sizes the
+/// Bloom filter according to the synopsis options.
+/// @tparam HashFunction The hash function to use for the Bloom filter.
+/// @param type A type instance carrying a `string_type`.
+/// @param opts The synopsis options.
+/// @returns A type-erased pointer to a synopsis.
+/// @relates string_synopsis make_parameters
+template <class HashFunction>
+synopsis_ptr make_string_synopsis(vast::type type, const caf::settings& opts) {
+  VAST_ASSERT(caf::holds_alternative<string_type>(type));
+  auto xs = make_parameters(type, opts);
+  if (!xs) {
+    VAST_ERROR_ANON(__func__, "could not determine Bloom filter parameters");
+    return nullptr;
+  }
+  auto result = make_string_synopsis<HashFunction>(std::move(type), *xs);
+  if (!result)
+    VAST_ERROR_ANON(__func__, "failed to evaluate Bloom filter parameters:",
+                    xs->n, xs->p);
+  return result;
+}
+
+} // namespace vast
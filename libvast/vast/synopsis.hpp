@@ -20,6 +20,7 @@
 #include "vast/aliases.hpp"
 #include "vast/fwd.hpp"
 #include "vast/operator.hpp"
+#include "vast/span.hpp"
 #include "vast/type.hpp"
 #include "vast/view.hpp"
 
@@ -46,6 +47,19 @@ public:
   /// @pre `type_check(type(), x)`
   virtual void add(data_view x) = 0;
 
+  /// Adds an entire column of values. Synopses for the corresponding type
+  /// override these functions to process the column in a tight loop without
+  /// dispatching on every value. The default implementations call `add` for
+  /// each value.
+  /// @param xs The values of a column, excluding nulls.
+  /// @pre `type_check(type(), x)` for all *x* in *xs*.
+  virtual void add_batch(span<const integer> xs);
+  virtual void add_batch(span<const count> xs);
+  virtual void add_batch(span<const real> xs);
+  virtual void add_batch(span<const time> xs);
+  virtual void add_batch(span<const address> xs);
+  virtual void add_batch(span<const std::string_view> xs);
+
   /// Tests whether a predicate matches. The synopsis is implicitly the LHS of
   /// the predicate.
   /// @param op The operator of the predicate.
@@ -54,6 +68,18 @@ public:
   virtual caf::optional<bool> lookup(relational_operator op,
                                      data_view rhs) const = 0;
 
+  /// Adds all data of another synopsis for the same type, such that the
+  /// synopsis summarizes the data of both. The default implementation
+  /// supports no merging.
+  /// @param other The synopsis to merge.
+  /// @returns `false` if the synopses have different kinds or parameters.
+  virtual bool merge(const synopsis& other);
+
+  /// Reduces the size of the synopsis once it receives no more data. The
+  /// default implementation does nothing.
+  /// @param n The maximum number of elements that the synopsis holds.
+  virtual void shrink(size_t n);
+
   /// Tests whether two objects are equal.
   virtual bool equals(const synopsis& other) const noexcept = 0;
 
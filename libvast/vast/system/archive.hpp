@@ -13,8 +13,11 @@
 
 #pragma once
 
+#include "vast/detail/thread_pool.hpp"
+#include "vast/expression.hpp"
 #include "vast/fwd.hpp"
 #include "vast/ids.hpp"
+#include "vast/segment_builder.hpp"
 #include "vast/status.hpp"
 #include "vast/store.hpp"
 #include "vast/system/accountant.hpp"
@@ -27,10 +30,10 @@
 #include <caf/typed_event_based_actor.hpp>
 
 #include <chrono>
+#include <deque>
 #include <memory>
 #include <queue>
 #include <unordered_map>
-#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -48,29 +51,64 @@ using receiver_type = caf::typed_actor<
 using archive_type = caf::typed_actor<
   caf::reacts_to<caf::stream<table_slice_ptr>>,
   caf::reacts_to<atom::exporter, caf::actor>,
+  caf::reacts_to<atom::exporter, caf::actor, expression>,
   caf::reacts_to<accountant_type>,
   caf::reacts_to<ids>,
   caf::reacts_to<ids, receiver_type>,
-  caf::reacts_to<ids, receiver_type, uint64_t>,
+  caf::reacts_to<atom::extract, uint64_t, std::vector<table_slice_ptr>,
+                 caf::error>,
   caf::replies_to<atom::status, status_verbosity>::with<caf::dictionary<caf::config_value>>,
   caf::reacts_to<atom::telemetry>,
   caf::reacts_to<atom::erase, ids>
 >;
 // clang-format on
 
+/// An extraction of table slices for a single requester.
+/// @relates archive
+struct archive_session {
+  receiver_type requester;
+  ids xs;
+  std::shared_ptr<vast::store::lookup> lookup;
+};
+
 /// @relates archive
 struct archive_state {
   void send_report();
+
+  /// Starts sessions for waiting requesters until all session slots are taken.
   void next_session();
+
+  /// Extracts the next batch of table slices of a session, either on the
+  /// extraction pool or inline, and sends it to the ARCHIVE.
+  void extract(uint64_t id);
+
   archive_type::stateful_pointer<archive_state> self;
   std::unique_ptr<vast::store> store;
-  std::unique_ptr<vast::store::lookup> session;
+  std::unordered_map<uint64_t, archive_session> sessions;
   uint64_t session_id = 0;
-  std::queue<receiver_type> requesters;
+
+  /// Requesters with pending IDs in the order of their next turn. A requester
+  /// has at most one running session, and lines up again behind all others
+  /// after it finishes.
+  std::deque<receiver_type> requesters;
+
   std::unordered_map<caf::actor_addr, std::queue<ids>> unhandled_ids;
-  std::unordered_set<caf::actor_addr> active_exporters;
+  /// The registered exporters and their queries, which may be empty.
+  std::unordered_map<caf::actor_addr, expression> active_exporters;
   vast::system::measurement measurement;
   accountant_type accountant;
+
+  /// Decodes segments for running sessions and finishes segments that train
+  /// compression dictionaries; both happen on the actor thread if this is
+  /// null.
+  std::unique_ptr<detail::thread_pool> extraction_pool;
+
+  /// The maximum number of sessions that run at the same time.
+  size_t max_sessions;
+
+  /// The maximum number of table slices to extract in one turn of a session.
+  size_t batch_size;
+
   static inline const char* name = "archive";
 };
 
@@ -79,9 +117,21 @@ struct archive_state {
 /// @param dir The root directory of the archive.
 /// @param capacity The number of segments to cache in memory.
 /// @param max_segment_size The maximum segment size in bytes.
-/// @pre `max_segment_size > 0`
+/// @param segment_cache_size The maximum size of cached segments in bytes.
+/// @param slice_cache_size The maximum size of segments with cached table
+///        slices in bytes.
+/// @param compression Configures the compression of table slices in segments.
+/// @param extraction_threads The number of threads that decode segments for
+///        running sessions, where 0 means that the ARCHIVE decodes them itself.
+/// @param max_sessions The maximum number of sessions that run at the same
+///        time.
+/// @param batch_size The maximum number of table slices to extract in one turn
+///        of a session.
+/// @pre `max_segment_size > 0 && max_sessions > 0 && batch_size > 0`
 archive_type::behavior_type
 archive(archive_type::stateful_pointer<archive_state> self, path dir,
-        size_t capacity, size_t max_segment_size);
+        size_t capacity, size_t max_segment_size, size_t segment_cache_size,
+        size_t slice_cache_size, segment_compression compression,
+        size_t extraction_threads, size_t max_sessions, size_t batch_size);
 
 } // namespace vast::system
@@ -0,0 +1,132 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/aliases.hpp"
+#include "vast/path.hpp"
+#include "vast/qualified_record_field.hpp"
+#include "vast/system/partition.hpp"
+#include "vast/uuid.hpp"
+
+#include <caf/atom.hpp>
+#include <caf/optional.hpp>
+#include <caf/stateful_actor.hpp>
+#include <caf/typed_response_promise.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace vast::system {
+
+/// Summarizes a persisted partition for planning a compaction.
+struct compaction_candidate {
+  /// The ID of the partition.
+  uuid id;
+
+  /// The smallest event ID in the partition.
+  vast::id first;
+
+  /// The number of events in the partition.
+  size_t events;
+};
+
+/// Selects partitions to merge into a single one. A partition qualifies if
+/// it is at most half full. The selection is the first run of at least two
+/// qualifying partitions whose events fit into one partition.
+/// @param candidates The persisted partitions in ascending order of their
+///                   first event ID.
+/// @param max_partition_size The maximum number of events per partition.
+/// @param failed Selections that failed to merge before, which the planner
+///               skips in favor of the next run.
+/// @returns The IDs of the selected partitions in the order of *candidates*,
+///          or an empty vector if no partitions qualify.
+std::vector<uuid>
+plan_compaction(const std::vector<compaction_candidate>& candidates,
+                size_t max_partition_size,
+                const std::set<std::vector<uuid>>& failed = {});
+
+/// The state of the COMPACTOR actor.
+/// @relates compactor
+struct compactor_state {
+  /// A compaction in progress.
+  struct job {
+    /// The partitions to merge, in ascending order of their IDs.
+    std::vector<uuid> sources;
+
+    /// The partition that holds the data of all sources.
+    uuid target;
+
+    /// The merged meta data of all sources.
+    partition::meta_data meta;
+
+    /// All columns of the sources.
+    std::vector<qualified_record_field> columns;
+
+    /// The number of columns that the COMPACTOR merged so far.
+    size_t merged_columns = 0;
+
+    /// Receives the target and the sources once the target is complete.
+    caf::typed_response_promise<uuid, std::vector<uuid>> promise;
+  };
+
+  /// Base directory for all partitions of the INDEX.
+  path dir;
+
+  /// The maximum number of events per partition.
+  size_t max_partition_size;
+
+  /// The maximum number of bytes per second to read from disk, or 0 to read
+  /// without limit.
+  size_t rate;
+
+  /// The bitmap representation of the merged value indexes.
+  caf::atom_value bitmap;
+
+  /// The summaries of the partitions that the INDEX offered for compaction.
+  std::unordered_map<uuid, compaction_candidate> candidates;
+
+  /// The sources of compactions that failed. The COMPACTOR does not plan them
+  /// again as long as all of their partitions exist.
+  std::set<std::vector<uuid>> failed;
+
+  /// The current compaction, if any.
+  caf::optional<job> current;
+
+  /// The number of completed compactions.
+  uint64_t compactions = 0;
+
+  /// The number of bytes of partition state read from disk.
+  uint64_t bytes_read = 0;
+
+  /// The actor name.
+  static inline const char* name = "compactor";
+};
+
+/// Merges small persisted partitions of the INDEX into full ones in the
+/// background. The COMPACTOR only writes the merged partition; the INDEX
+/// replaces the sources with it once no query refers to them anymore.
+/// @param self The actor handle.
+/// @param dir The base directory for all partitions of the INDEX.
+/// @param max_partition_size The maximum number of events per partition.
+/// @param rate The maximum number of bytes per second to read from disk, or 0
+///             to read without limit.
+/// @param bitmap The bitmap representation of the merged value indexes.
+caf::behavior compactor(caf::stateful_actor<compactor_state>* self, path dir,
+                        size_t max_partition_size, size_t rate,
+                        caf::atom_value bitmap);
+
+} // namespace vast::system
@@ -25,6 +25,7 @@
 #include <caf/fwd.hpp>
 #include <caf/typed_response_promise.hpp>
 
+#include <map>
 #include <unordered_map>
 #include <vector>
 
@@ -34,22 +35,36 @@ namespace vast::system {
 struct evaluator_state {
   using predicate_hits_map = std::map<offset, std::pair<size_t, ids>>;
 
+  /// Maps positions in the expression to lookups that we did not send yet.
+  using deferred_lookups_map
+    = std::multimap<offset, std::pair<curried_predicate, caf::actor>>;
+
   evaluator_state(caf::event_based_actor* self);
 
-  void init(caf::actor client, expression expr, caf::response_promise promise);
+  void init(caf::actor client, expression expr,
+            selectivity_estimates estimates, caf::response_promise promise);
 
-  /// Updates `predicate_hits` and may trigger re-evaluation of the expression
-  /// tree.
+  /// Updates `predicate_hits` for a completed lookup.
   void handle_result(const offset& position, const ids& result);
 
-  /// Updates `predicate_hits` and may trigger re-evaluation of the expression
-  /// tree.
+  /// Updates `predicate_hits` for a failed lookup.
   void handle_missing_result(const offset& position, const caf::error& err);
 
+  /// Sends the lookups of the next stage in the plan or, if the plan is
+  /// exhausted, relays the final hits and sends 'done' to the client.
+  void proceed();
+
+  /// Determines the next stage of the plan and sends its lookups.
+  /// @returns the number of sent lookups.
+  size_t schedule();
+
+  /// Drops all deferred lookups for predicates at or below `position`.
+  void skip(const offset& position);
+
   /// Evaluates the predicate-tree and may produces new deltas.
   void evaluate();
 
-  /// Decrements the `pending_responses` and sends 'done' to the client when it
+  /// Decrements the `pending_responses` and proceeds with the plan when it
   /// reaches 0.
   void decrement_pending();
 
@@ -62,6 +77,20 @@ struct evaluator_state {
   /// Stores hits per predicate in the expression.
   predicate_hits_map predicate_hits;
 
+  /// Stores lookups that belong to a later stage of the plan.
+  deferred_lookups_map deferred;
+
+  /// Stores the estimated selectivity per predicate in the expression.
+  selectivity_estimates estimates;
+
+  /// Stores the positions of the predicates looked up in each stage, i.e.,
+  /// the executed plan.
+  std::vector<std::vector<offset>> stages;
+
+  /// Counts the lookups we never sent because an enclosing conjunction was
+  /// already known to be empty.
+  size_t skipped = 0;
+
   /// Stores hits for the expression.
   ids hits;
 
@@ -81,10 +110,19 @@ struct evaluator_state {
   static inline const char* name = "evaluator";
 };
 
-/// Wraps a query expression in an actor. Upon receiving hits from INDEXER
-/// actors, re-evaluates the expression and relays new hits to its sinks.
+/// Wraps a query expression in an actor. Looks up the predicates of the
+/// expression in stages: operands of a conjunction are requested one after
+/// another in order of their estimated selectivity, and the remaining
+/// operands are skipped once the intersection becomes empty. Relays the hits
+/// of the expression to its client after evaluation.
+/// @param expr The expression to evaluate.
+/// @param eval The lookups for the predicates in `expr`.
+/// @param estimates The estimated selectivity of the predicates in `expr`.
+///                  Predicates without estimate fall back to
+///                  ::default_selectivity.
 /// @pre `!eval.empty()`
 caf::behavior evaluator(caf::stateful_actor<evaluator_state>* self,
-                        expression expr, evaluation_triples eval);
+                        expression expr, evaluation_triples eval,
+                        selectivity_estimates estimates);
 
 } // namespace vast::system
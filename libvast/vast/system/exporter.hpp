@@ -14,6 +14,7 @@
 #pragma once
 
 #include "vast/aliases.hpp"
+#include "vast/compiled_expression.hpp"
 #include "vast/expression.hpp"
 #include "vast/ids.hpp"
 #include "vast/query_options.hpp"
@@ -56,8 +57,8 @@ struct exporter_state {
   /// Stores hits from the INDEX.
   ids hits;
 
-  /// Caches tailored candidate checkers.
-  std::unordered_map<type, expression> checkers;
+  /// Caches candidate checkers, compiled once per layout.
+  std::unordered_map<type, compiled_expression> checkers;
 
   /// Caches results for the SINK.
   std::vector<table_slice_ptr> results;
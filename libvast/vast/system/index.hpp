@@ -13,24 +13,35 @@
 
 #pragma once
 
-#include "vast/detail/flat_lru_cache.hpp"
+#include "vast/defaults.hpp"
+#include "vast/detail/flat_2q_cache.hpp"
 #include "vast/detail/stable_map.hpp"
+#include "vast/detail/thread_pool.hpp"
 #include "vast/expression.hpp"
 #include "vast/fwd.hpp"
 #include "vast/meta_index.hpp"
 #include "vast/status.hpp"
 #include "vast/system/accountant.hpp"
+#include "vast/system/filesystem.hpp"
 #include "vast/system/indexer_stage_driver.hpp"
 #include "vast/system/partition.hpp"
+#include "vast/system/predicate_cache.hpp"
+#include "vast/system/query_scheduler.hpp"
 #include "vast/system/query_supervisor.hpp"
 #include "vast/system/spawn_indexer.hpp"
+#include "vast/time.hpp"
 #include "vast/uuid.hpp"
 
 #include <caf/actor.hpp>
 #include <caf/behavior.hpp>
 #include <caf/fwd.hpp>
+#include <caf/optional.hpp>
+#include <caf/response_promise.hpp>
+#include <caf/settings.hpp>
 
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace vast::system {
@@ -46,16 +57,6 @@ struct index_state {
   /// the INDEXER actors of the current partition.
   using stage_ptr = indexer_stage_driver::stage_ptr_type;
 
-  /// Looks up partitions in the LRU cache by UUID.
-  class partition_lookup {
-  public:
-    auto operator()(const uuid& id) const {
-      return [&](const partition_ptr& ptr) {
-        return ptr->id() == id;
-      };
-    }
-  };
-
   /// Loads partitions from disk by UUID.
   class partition_factory {
   public:
@@ -69,10 +70,17 @@ struct index_state {
     index_state* st_;
   };
 
-  /// Stores partitions sorted by access frequency.
-  using partition_cache_type = detail::flat_lru_cache<partition_ptr,
-                                                      partition_lookup,
-                                                      partition_factory>;
+  /// Estimates the memory footprint of a partition by the size of its
+  /// persistent state, i.e., the state of all INDEXER actors once loaded.
+  class partition_weigher {
+  public:
+    size_t operator()(const partition_ptr& part) const;
+  };
+
+  /// Stores partitions loaded from disk within a memory budget.
+  using partition_cache_type
+    = detail::flat_2q_cache<uuid, partition_ptr, partition_factory,
+                            partition_weigher>;
 
   /// Stores context information for unfinished queries.
   struct lookup_state {
@@ -81,10 +89,28 @@ struct index_state {
 
     /// Unscheduled partitions.
     std::vector<uuid> partitions;
+
+    /// The scheduling class of the query.
+    query_priority priority = query_priority::interactive;
+  };
+
+  /// Stores a query that waits for evaluation in the next batch.
+  struct query_request {
+    /// The candidate partitions of the query.
+    lookup_state lookup;
+
+    /// Receives the hits of the query.
+    caf::actor client;
+
+    /// Responds with the query ID and the number of hits.
+    caf::response_promise promise;
   };
 
-  /// Stores evaluation metadata for pending partitions.
-  using pending_query_map = detail::stable_map<uuid, evaluation_triples>;
+  /// Stores evaluation metadata and selectivity estimates for pending
+  /// partitions.
+  using pending_query_map
+    = detail::stable_map<uuid,
+                         std::pair<evaluation_triples, selectivity_estimates>>;
 
   /// Accumulates statistics for a given layout.
   struct layout_statistics {
@@ -105,7 +131,7 @@ struct index_state {
 
   /// Initializes the state.
   caf::error init(const path& dir, size_t max_events, uint32_t max_parts,
-                  uint32_t taste_parts);
+                  size_t max_resident_bytes, uint32_t taste_parts);
 
   // -- persistence ------------------------------------------------------------
 
@@ -129,12 +155,8 @@ struct index_state {
   /// Returns the file name for saving or loading the meta index.
   path meta_index_filename() const;
 
-  /// @returns whether there's an idle worker available.
-  bool worker_available();
-
-  /// Takes the next worker from the idle workers stack and returns it.
-  /// @pre `has_worker()`
-  caf::actor next_worker();
+  /// Returns the file name for appending partitions to the meta index.
+  path meta_index_delta_filename() const;
 
   /// @returns various status metrics.
   caf::dictionary<caf::config_value> status(status_verbosity v) const;
@@ -150,6 +172,9 @@ struct index_state {
   /// @returns a new partition with given ID.
   partition_ptr make_partition(uuid id);
 
+  /// @returns the options for creating the value indexes of a partition.
+  caf::settings value_index_options() const;
+
   /// @returns a new INDEXER actor.
   caf::actor make_indexer(path filename, type column_type, uuid partition_id,
                           std::string fqn);
@@ -161,15 +186,66 @@ struct index_state {
   ///          partition matches.
   partition* find_unpersisted(const uuid& id);
 
+  /// @returns whether the partition matching `id` is available in memory.
+  bool is_resident(const uuid& id) const;
+
+  /// Removes a partition from the prefetched partitions.
+  /// @returns the prefetched partition matching `id` or `nullptr` if no
+  ///          partition matches.
+  partition_ptr take_prefetched(const uuid& id);
+
+  /// Loads the next non-resident partitions of a lookup in the background,
+  /// such that they are available by the time the lookup schedules them.
+  void prefetch(const lookup_state& lookup);
+
   /// Prepares a subset of partitions from the lookup_state for evaluation.
   pending_query_map
   build_query_map(lookup_state& lookup, uint32_t num_partitions);
 
+  /// Prepares a subset of partitions for each lookup of a batch. Evaluates
+  /// all lookups of the batch that have a partition among their candidates
+  /// while the partition is loaded, such that concurrent queries share a
+  /// single load per partition.
+  std::vector<pending_query_map>
+  build_query_maps(const std::vector<lookup_state*>& lookups,
+                   uint32_t num_partitions);
+
+  /// Routes lookups that occur more than once across `pqms` through a single
+  /// actor per INDEXER and predicate, which forwards one request to the
+  /// INDEXER and answers all EVALUATOR actors with its result.
+  void share_lookups(std::vector<pending_query_map>& pqms);
+
+  /// Adds a query to the next batch. Runs the batch immediately if
+  /// `query_batch_window` is zero, or schedules it otherwise.
+  void enqueue_query(query_request request);
+
+  /// Evaluates all queries of the current batch.
+  void run_batch();
+
+  /// Hands queued query tasks to idle workers.
+  void dispatch_tasks();
+
   /// Spawns one evaluator for each partition.
   /// @returns a query map for passing to INDEX workers over the spawned
   ///          EVALUATOR actors.
   query_map launch_evaluators(pending_query_map pqm, expression expr);
 
+  /// Sends the hit rate of the predicate cache and the load of the query
+  /// scheduler to the accountant.
+  void send_report();
+
+  /// @returns whether a pending query, a scheduled task, or a background read
+  ///          refers to the partition matching `id`.
+  bool is_referenced(const uuid& id) const;
+
+  /// Hands all persisted partitions to the COMPACTOR, unless a compaction is
+  /// already in progress.
+  void compact();
+
+  /// Replaces the sources of the last compaction with its target, unless
+  /// queries still refer to one of the sources.
+  void swap_compacted();
+
   /// Adds a new flush listener.
   void add_flush_listener(caf::actor listener);
 
@@ -184,6 +260,12 @@ struct index_state {
   /// Allows to select partitions with timestamps.
   meta_index meta_idx;
 
+  /// The number of partitions in the meta index file.
+  size_t meta_index_compacted = 0;
+
+  /// The number of partitions in the meta index file and its delta file.
+  size_t meta_index_appended = 0;
+
   /// Base directory for all partitions of the index.
   path dir;
 
@@ -193,37 +275,101 @@ struct index_state {
   /// The maximum number of events per partition.
   size_t max_partition_size;
 
+  /// The bitmap representation of new value indexes.
+  caf::atom_value bitmap = defaults::system::index_bitmap;
+
   /// The number of partitions to schedule immediately for each query.
   uint32_t taste_partitions;
 
-  /// Allows the index to multiplex between waiting for ready workers and
-  /// queries.
-  caf::behavior has_worker;
-
   /// Maps query IDs to pending lookup state.
   std::unordered_map<uuid, lookup_state> pending;
 
-  /// Caches idle workers.
-  std::vector<caf::actor> idle_workers;
+  /// The time to wait for more queries before evaluating a batch, where zero
+  /// evaluates each query on arrival.
+  duration query_batch_window = duration::zero();
+
+  /// Queries waiting for evaluation in the next batch.
+  std::vector<query_request> query_batch;
+
+  /// The number of INDEXER lookups answered for more than one EVALUATOR.
+  size_t shared_lookups = 0;
+
+  /// Distributes the partitions of all queries over the workers.
+  query_scheduler scheduler;
+
+  /// The counters of `scheduler` at the time of the last report.
+  query_scheduler::statistics reported_scheduler_stats;
 
   /// Spawns an INDEXER actor. Default-initialized to `spawn_indexer`, but
   /// allows users to redirect to other implementations (primarily for unit
   /// testing).
   indexer_factory factory;
 
+  /// The number of threads for indexing the active partition in place, where
+  /// 0 means that the active partition spawns one INDEXER per column.
+  size_t indexing_threads = 0;
+
+  /// Runs all but one shard of in-place indexing work; the INDEX actor itself
+  /// processes the remaining one. Null unless `indexing_threads > 1`.
+  std::unique_ptr<detail::thread_pool> indexing_pool;
+
+  /// Throughput of the in-place indexing.
+  measurement indexing_measurement;
+
   /// Our current partition.
   partition_ptr active;
 
   /// Active indexer count for the current partition.
   size_t active_partition_indexers = 0;
 
-  /// Recently accessed partitions.
-  partition_cache_type lru_partitions;
+  /// Partitions loaded from disk.
+  partition_cache_type cached_partitions;
+
+  /// Results of INDEXER lookups for persisted partitions.
+  predicate_cache cached_predicates{0};
+
+  /// The counters of `cached_predicates` at the time of the last report.
+  predicate_cache::statistics reported_predicate_stats;
+
+  /// Reads partitions from disk without blocking the INDEX.
+  filesystem_type filesystem;
+
+  /// The number of partitions to load ahead of their evaluation for each
+  /// query.
+  size_t prefetch_partitions = 0;
+
+  /// Partitions currently being read in the background.
+  std::unordered_set<uuid> prefetching;
+
+  /// Partitions read in the background that no query has scheduled yet.
+  std::vector<partition_ptr> prefetched;
 
   /// Stores partitions that are no longer active but have not persisted their
   /// state yet.
   std::vector<std::pair<partition_ptr, size_t>> unpersisted;
 
+  /// Writes the in-place column indexes of full partitions to disk. Declared
+  /// after `unpersisted`, because pending jobs refer to those partitions. Null
+  /// unless `indexing_threads > 0` and the INDEX has flush threads.
+  std::unique_ptr<detail::thread_pool> flush_pool;
+
+  /// Merges small persisted partitions in the background. Null if
+  /// `compaction_interval` is zero.
+  caf::actor compactor;
+
+  /// The time between two attempts to compact partitions.
+  duration compaction_interval = duration::zero();
+
+  /// Whether the COMPACTOR currently merges partitions for us.
+  bool compacting = false;
+
+  /// The target and the sources of a finished compaction that waits for
+  /// queries to release the sources.
+  caf::optional<std::pair<uuid, std::vector<uuid>>> compacted;
+
+  /// The number of partitions replaced by compaction.
+  size_t compacted_partitions = 0;
+
   accountant_type accountant;
 
   /// List of actors that wait for the next flush event.
@@ -251,15 +397,72 @@ auto inspect(Inspector& f, index_state::statistics& x) {
   return f(x.layouts);
 }
 
+/// The tunables of the INDEX. All members default to the values in
+/// `defaults::system`.
+struct index_options {
+  /// The maximum number of events per partition.
+  size_t max_partition_size = defaults::system::max_partition_size;
+
+  /// The maximum number of partitions to hold in memory.
+  size_t in_mem_partitions = defaults::system::max_in_mem_partitions;
+
+  /// The memory budget for partitions loaded from disk.
+  size_t max_resident_bytes = defaults::system::max_resident_partition_bytes;
+
+  /// The number of partitions to schedule immediately for each query.
+  size_t taste_partitions = defaults::system::taste_partitions;
+
+  /// The number of partitions to load in the background while a query
+  /// evaluates its current batch of partitions.
+  size_t prefetch_partitions = defaults::system::prefetch_partitions;
+
+  /// The number of query supervisors that evaluate the partitions of all
+  /// queries.
+  size_t num_workers = defaults::system::num_query_supervisors;
+
+  /// The number of threads for meta index lookups, or 0 to use one per
+  /// hardware thread.
+  size_t meta_index_threads = defaults::system::meta_index_threads;
+
+  /// The number of threads that index all columns of the active partition in
+  /// place, or 0 to spawn one INDEXER actor per column instead.
+  size_t indexing_threads = defaults::system::indexing_threads;
+
+  /// The time to collect concurrent queries before evaluating them together,
+  /// or 0 to evaluate each query on arrival.
+  duration query_batch_window = defaults::system::query_batch_window;
+
+  /// The memory budget for cached lookup results of persisted partitions, or
+  /// 0 to disable the cache.
+  size_t max_predicate_cache_bytes
+    = defaults::system::max_predicate_cache_bytes;
+
+  /// The time between two attempts to merge small persisted partitions, or 0
+  /// to disable compaction.
+  duration compaction_interval = defaults::system::compaction_interval;
+
+  /// The maximum number of bytes per second that the compaction reads from
+  /// disk.
+  size_t compaction_rate = defaults::system::compaction_rate;
+
+  /// The number of threads that write the in-place column indexes of a full
+  /// partition, or 0 to write them on the INDEX. Only relevant if
+  /// `indexing_threads > 0`.
+  size_t flush_threads = defaults::system::flush_threads;
+
+  /// The bitmap representation of new value indexes, which is either `ewah`
+  /// or `roaring`.
+  caf::atom_value bitmap = defaults::system::index_bitmap;
+
+  /// The maximum size of a Bloom filter synopsis in the meta index in bytes.
+  size_t max_synopsis_size = defaults::system::max_synopsis_size;
+};
+
 /// Indexes events in horizontal partitions.
 /// @param dir The directory of the index.
-/// @param max_partition_size The maximum number of events per partition.
-/// @param in_mem_partitions The maximum number of partitions to hold in memory.
-/// @param taste_partitions The number of partitions to schedule immediately
-///                         for each query
-/// @pre `max_partition_size > 0 && in_mem_partitions > 0`
+/// @param opts The tunables of the INDEX.
+/// @pre `opts.max_partition_size > 0 && opts.in_mem_partitions > 0`
 caf::behavior index(caf::stateful_actor<index_state>* self, const path& dir,
-                    size_t max_partition_size, size_t in_mem_partitions,
-                    size_t taste_partitions, size_t num_workers);
+                    index_options opts);
 
 } // namespace vast::system
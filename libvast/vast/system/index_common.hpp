@@ -16,9 +16,11 @@
 #include "vast/expression.hpp"
 #include "vast/fwd.hpp"
 #include "vast/offset.hpp"
+#include "vast/operator.hpp"
 
 #include <caf/actor.hpp>
 
+#include <map>
 #include <tuple>
 #include <vector>
 
@@ -31,4 +33,36 @@ using evaluation_triple = std::tuple<offset, curried_predicate, caf::actor>;
 
 using evaluation_triples = std::vector<evaluation_triple>;
 
+/// Maps offsets into an expression under evaluation to the estimated fraction
+/// of rows in a partition that satisfy the ::predicate at that position. The
+/// EVALUATOR uses these estimates to order the operands of conjunctions.
+using selectivity_estimates = std::map<offset, double>;
+
+/// Estimates the fraction of rows satisfying a predicate with operator `op`
+/// when nothing else is known about the data. Equality tests are assumed to
+/// be most selective and negated tests least selective.
+/// @param op The relational operator of the predicate.
+/// @returns a value in *[0, 1]*.
+inline double default_selectivity(relational_operator op) {
+  switch (op) {
+    case equal:
+    case in:
+    case ni:
+      return 0.01;
+    case less:
+    case less_equal:
+    case greater:
+    case greater_equal:
+      return 0.3;
+    case match:
+      return 0.1;
+    case not_match:
+    case not_in:
+    case not_ni:
+    case not_equal:
+      return 0.9;
+  }
+  return 1.0;
+}
+
 } // namespace vast
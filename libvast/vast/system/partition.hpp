@@ -13,7 +13,9 @@
 
 #pragma once
 
+#include "vast/column_index.hpp"
 #include "vast/detail/stable_map.hpp"
+#include "vast/detail/thread_pool.hpp"
 #include "vast/fwd.hpp"
 #include "vast/ids.hpp"
 #include "vast/qualified_record_field.hpp"
@@ -25,6 +27,8 @@
 #include <caf/event_based_actor.hpp>
 #include <caf/stream_slot.hpp>
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
 namespace vast::system {
@@ -67,6 +71,15 @@ public:
     /// A buffer to avoid overloading the indexer.
     /// Only used during ingestion.
     std::vector<table_slice_column> buf;
+
+    /// Indexes the column in place instead of an INDEXER actor when the INDEX
+    /// runs the partition-wide indexing engine. Only set for the active
+    /// partition.
+    column_index_ptr column;
+
+    /// Guards `column` while the flush pool of the INDEX writes it to disk.
+    /// Only set together with `column`.
+    std::unique_ptr<std::mutex> column_mutex;
   };
 
   // -- constructors, destructors, and assignment operators --------------------
@@ -86,10 +99,25 @@ public:
   /// @returns an error if I/O operations fail.
   caf::error init();
 
-  /// Persists the partition layouts to disk.
+  /// Materializes the partition layouts from the contents of ::meta_file,
+  /// e.g., after reading the file asynchronously.
+  /// @param meta The contents of the meta file.
+  /// @returns an error if deserialization fails.
+  caf::error init(chunk_ptr meta);
+
+  /// Persists all in-place column indexes and then the partition layouts to
+  /// disk. The meta file serves as manifest of the partition: it exists only
+  /// if all columns are complete on disk.
   /// @returns an error if I/O operations fail.
   caf::error flush_to_disk();
 
+  /// Writes all in-place column indexes on *pool*. For every column that it
+  /// writes successfully, the pool sends `atom::done` with the partition ID to
+  /// the INDEX, just like an INDEXER after persisting its state.
+  /// @param pool The threads that write the columns.
+  /// @returns the number of scheduled columns.
+  size_t flush_columns(detail::thread_pool& pool);
+
   // -- properties -------------------------------------------------------------
 
   /// @returns the unique ID of the partition.
@@ -127,6 +155,12 @@ public:
   /// Adds a slice to the partition.
   void add(table_slice_ptr slice);
 
+  /// Indexes all buffered slices with the in-place column indexes. Splits the
+  /// columns into contiguous groups and processes each group on a different
+  /// thread, such that every column index is mutated by a single thread only.
+  /// @pre `state().indexing_threads > 0`
+  void index_inbound();
+
   /// Gets the INDEXER at position in the layout.
   caf::actor& indexer_at(size_t position);
 
@@ -144,10 +178,30 @@ public:
   caf::actor fetch_indexer(const attribute_extractor& ex,
                            relational_operator op, const data& x);
 
+  /// Answers a lookup from the predicate cache of the INDEX if possible.
+  /// Otherwise, wraps `indexer` into an actor that adds the result to the
+  /// cache and that concurrent queries share until the result arrives.
+  /// @param dx The extractor that selects the column.
+  /// @param pred The predicate to look up.
+  /// @param indexer The INDEXER for the column.
+  /// @pre `immutable()`
+  caf::actor fetch_cached(const data_extractor& dx,
+                          const curried_predicate& pred, caf::actor indexer);
+
+  /// @returns whether the partition no longer changes, i.e., it is neither
+  ///          the active partition nor waiting for its INDEXER actors to
+  ///          persist their state.
+  bool immutable() const;
+
   /// @returns all INDEXER actors required for a query, together with tailored
   /// predicates their offsets in the expression. Used by the EVALUATOR.
   evaluation_triples eval(const expression& expr);
 
+  /// Estimates the selectivity of each predicate in `expr` from the number of
+  /// rows per layout in this partition. Type queries are answered exactly.
+  /// @returns the estimates, keyed by the same offsets as ::eval.
+  selectivity_estimates estimate_selectivity(const expression& expr) const;
+
   // -- members ----------------------------------------------------------------
 
   /// State of the INDEX actor that owns this partition.
@@ -178,6 +232,18 @@ using partition_ptr = std::unique_ptr<partition>;
 
 // -- free functions -----------------------------------------------------------
 
+/// @returns the file name for the ::meta_data of a partition.
+/// @param base_dir The directory for persistent state of the partition.
+/// @relates partition
+path partition_meta_file(const path& base_dir);
+
+/// @returns the file name for a column of a partition.
+/// @param base_dir The directory for persistent state of the partition.
+/// @param field The column.
+/// @relates partition
+path partition_column_file(const path& base_dir,
+                           const qualified_record_field& field);
+
 /// @relates partition::meta_data
 template <class Inspector>
 auto inspect(Inspector& f, partition::meta_data& x) {
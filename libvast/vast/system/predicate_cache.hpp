@@ -0,0 +1,159 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/expression.hpp"
+#include "vast/ids.hpp"
+#include "vast/uuid.hpp"
+
+#include <caf/actor_addr.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace vast::system {
+
+/// Caches the results of INDEXER lookups for persisted partitions. Persisted
+/// partitions are immutable, so their results only change when the ERASER
+/// removes events. The cache is bounded by the memory footprint of the cached
+/// results and evicts the least recently used results first.
+class predicate_cache {
+public:
+  // -- member types -----------------------------------------------------------
+
+  /// Identifies a lookup for a single column of a partition.
+  struct key {
+    /// The ID of the partition.
+    uuid partition;
+
+    /// The fully qualified name of the column.
+    std::string column;
+
+    /// The normalized predicate.
+    curried_predicate predicate;
+
+    friend bool operator==(const key& x, const key& y);
+  };
+
+  /// Hashes a ::key.
+  struct key_hash {
+    size_t operator()(const key& x) const;
+  };
+
+  /// Counters about the effectiveness of the cache.
+  struct statistics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;
+  };
+
+  // -- constructors, destructors, and assignment operators --------------------
+
+  /// @param capacity The maximum memory footprint of all results in bytes.
+  explicit predicate_cache(size_t capacity);
+
+  // -- static utility functions -----------------------------------------------
+
+  /// Creates a key for a lookup. Normalizes the predicate such that lookups
+  /// with the same meaning map to the same key, e.g., by sorting the list of
+  /// values for `in` predicates.
+  static key make_key(const uuid& partition, std::string column,
+                      const curried_predicate& pred);
+
+  /// Estimates the memory footprint of a result in bytes.
+  static size_t weigh(const ids& x);
+
+  // -- lookup and modifiers ---------------------------------------------------
+
+  /// Looks up the result for `k` and counts the access as hit or miss.
+  /// @returns the cached result or `nullptr`.
+  const ids* lookup(const key& k);
+
+  /// Adds the result for `k` and evicts the least recently used results until
+  /// the cache fits into its capacity. Ignores results that exceed the
+  /// capacity on their own.
+  void add(key k, ids result);
+
+  /// Drops all results that contain any of the IDs in `xs`.
+  void invalidate(const ids& xs);
+
+  /// @returns the lookup in flight for `k` or an invalid address.
+  caf::actor_addr in_flight(const key& k) const;
+
+  /// Registers an actor that answers the lookup for `k` until the result
+  /// arrives via ::add or the lookup fails via ::abort.
+  void in_flight(const key& k, caf::actor_addr addr);
+
+  /// Forgets the lookup in flight for `k` after it failed, such that the next
+  /// lookup for `k` starts over.
+  void abort(const key& k);
+
+  // -- properties -------------------------------------------------------------
+
+  /// @returns the number of cached results.
+  size_t size() const noexcept {
+    return entries_.size();
+  }
+
+  /// @returns the total memory footprint of all results in bytes.
+  size_t weight() const noexcept {
+    return weight_;
+  }
+
+  /// @returns the maximum memory footprint of all results in bytes.
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  /// @returns the counters about cache accesses.
+  const statistics& stats() const noexcept {
+    return stats_;
+  }
+
+private:
+  struct entry {
+    key k;
+    ids result;
+    size_t weight;
+  };
+
+  using entry_list = std::list<entry>;
+
+  void erase(entry_list::iterator i);
+
+  /// Results in order of access, most recently used at the back.
+  entry_list entries_;
+
+  /// Maps keys to their position in `entries_`.
+  std::unordered_map<key, entry_list::iterator, key_hash> index_;
+
+  /// Weakly references the actors that perform lookups not cached yet.
+  std::unordered_map<key, caf::actor_addr, key_hash> in_flight_;
+
+  /// The total memory footprint of all results.
+  size_t weight_ = 0;
+
+  /// The maximum memory footprint of all results.
+  size_t capacity_;
+
+  /// Counts hits, misses, evictions, and invalidations.
+  statistics stats_;
+};
+
+} // namespace vast::system
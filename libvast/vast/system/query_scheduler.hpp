@@ -0,0 +1,207 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/expression.hpp"
+#include "vast/system/query_supervisor.hpp"
+#include "vast/time.hpp"
+#include "vast/uuid.hpp"
+
+#include <caf/actor.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace vast::system {
+
+/// The scheduling class of a query.
+enum class query_priority : uint8_t {
+  /// Queries whose results someone waits for, e.g., from an EXPORTER.
+  interactive,
+  /// Queries of maintenance tasks, e.g., from the ERASER.
+  background,
+};
+
+/// @relates query_priority
+const char* to_string(query_priority x);
+
+/// Distributes queries over a pool of QUERY SUPERVISOR actors. The scheduler
+/// splits each query into one task per partition and hands out tasks to
+/// workers as they become idle, such that a long-running query cannot occupy
+/// workers beyond its fair share. Idle workers pick the next task round-robin
+/// among all queries of the highest priority with queued tasks.
+class query_scheduler {
+public:
+  // -- member types -----------------------------------------------------------
+
+  /// Identifies a set of tasks that the scheduler reports as done together.
+  using job_id = uint64_t;
+
+  /// Counters about the executed tasks.
+  struct statistics {
+    /// The number of completed tasks.
+    uint64_t completed = 0;
+
+    /// The accumulated time tasks spent in the queue.
+    duration wait_time = duration::zero();
+
+    /// The accumulated time from dispatching to completing tasks.
+    duration run_time = duration::zero();
+  };
+
+  // -- modifiers --------------------------------------------------------------
+
+  /// Adds a job with one task per partition of `qm`.
+  /// @param query_id The ID for cancelling the job, or nil.
+  /// @param priority The scheduling class of the job.
+  /// @param expr The query expression.
+  /// @param client The receiver of all hits.
+  /// @param qm The EVALUATOR actors per partition.
+  /// @returns the ID of the new job.
+  job_id add(const uuid& query_id, query_priority priority, expression expr,
+             caf::actor client, query_map qm);
+
+  /// Drops all queued tasks for `query_id`. Running tasks complete normally,
+  /// but the scheduler no longer reports their job as done.
+  void cancel(const uuid& query_id);
+
+  /// Adds an idle worker to the pool. If the worker ran a task, marks the task
+  /// as completed.
+  /// @returns the client of the job if the worker completed its last task,
+  ///          or an invalid handle otherwise.
+  caf::actor release(caf::actor worker);
+
+  /// Assigns queued tasks to idle workers.
+  /// @param f A function object taking a worker, an expression, a query map
+  ///          with a single partition, and a client.
+  template <class F>
+  void dispatch(F f) {
+    while (!idle_.empty()) {
+      auto i = next_job();
+      if (i == jobs_.end())
+        return;
+      auto& [id, x] = *i;
+      auto worker = std::move(idle_.back());
+      idle_.pop_back();
+      auto t = std::move(x.queued.front());
+      x.queued.pop_front();
+      if (!x.queued.empty())
+        ready_[static_cast<size_t>(x.priority)].push_back(id);
+      ++x.running;
+      time now = std::chrono::system_clock::now();
+      stats_.wait_time += now - t.enqueued;
+      running_.push_back({worker, id, t.partition, now});
+      query_map qm;
+      qm.emplace(t.partition, std::move(t.evaluators));
+      f(worker, x.expr, std::move(qm), x.client);
+    }
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  /// @returns the number of queued tasks for a scheduling class.
+  size_t queue_depth(query_priority priority) const;
+
+  /// @returns the number of queued tasks.
+  size_t queue_depth() const;
+
+  /// @returns the number of workers without task.
+  size_t idle_workers() const noexcept {
+    return idle_.size();
+  }
+
+  /// @returns the number of workers that currently run a task.
+  size_t busy_workers() const noexcept {
+    return running_.size();
+  }
+
+  /// @returns the number of jobs with queued or running tasks.
+  size_t jobs() const noexcept {
+    return jobs_.size();
+  }
+
+  /// @returns whether a queued or running task evaluates `partition`.
+  bool uses(const uuid& partition) const;
+
+  /// @returns the counters about executed tasks.
+  const statistics& stats() const noexcept {
+    return stats_;
+  }
+
+private:
+  // -- member types -----------------------------------------------------------
+
+  /// Evaluates a single partition.
+  struct task {
+    uuid partition;
+    std::vector<caf::actor> evaluators;
+    time enqueued;
+  };
+
+  /// Groups all tasks of a query that the client waits for.
+  struct job {
+    uuid query_id;
+    query_priority priority;
+    expression expr;
+    caf::actor client;
+    std::deque<task> queued;
+    size_t running = 0;
+    bool cancelled = false;
+  };
+
+  /// Remembers which worker runs a task of which job.
+  struct assignment {
+    caf::actor worker;
+    job_id job;
+    uuid partition;
+    time started;
+  };
+
+  using job_map = std::map<job_id, job>;
+
+  // -- utility functions ------------------------------------------------------
+
+  /// Takes the job with the next task off the front of the highest priority
+  /// ring.
+  /// @returns the job or `jobs_.end()` if no task is queued.
+  job_map::iterator next_job();
+
+  // -- member variables -------------------------------------------------------
+
+  /// All jobs with queued or running tasks.
+  job_map jobs_;
+
+  /// Jobs with queued tasks in round-robin order, one ring per priority.
+  std::array<std::deque<job_id>, 2> ready_;
+
+  /// Workers without task.
+  std::vector<caf::actor> idle_;
+
+  /// Workers with task.
+  std::vector<assignment> running_;
+
+  /// The ID of the next job.
+  job_id next_id_ = 0;
+
+  /// Counts executed tasks.
+  statistics stats_;
+};
+
+} // namespace vast::system
@@ -0,0 +1,55 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/expression.hpp"
+#include "vast/ids.hpp"
+
+#include <caf/actor.hpp>
+#include <caf/expected.hpp>
+#include <caf/fwd.hpp>
+#include <caf/optional.hpp>
+#include <caf/typed_response_promise.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace vast::system {
+
+/// @relates shared_lookup
+struct shared_lookup_state {
+  /// Stores the hits of the INDEXER once they arrived.
+  caf::optional<ids> result;
+
+  /// Stores the requests that wait for the response of the INDEXER.
+  std::vector<caf::typed_response_promise<ids>> waiting;
+
+  /// Gives this actor a recognizable name in logging output.
+  static inline const char* name = "shared-lookup";
+};
+
+/// Forwards the first lookup it receives to an INDEXER and answers all
+/// lookups with the response, such that several EVALUATOR actors can share a
+/// single INDEXER lookup. After an error, the next lookup asks the INDEXER
+/// again.
+/// @param indexer The INDEXER that answers `pred`.
+/// @param pred The predicate to look up.
+/// @param on_result Gets called with the response of the INDEXER, i.e., the
+///                  hits or an error. May be empty.
+caf::behavior
+shared_lookup(caf::stateful_actor<shared_lookup_state>* self,
+              caf::actor indexer, curried_predicate pred,
+              std::function<void(const caf::expected<ids>&)> on_result);
+
+} // namespace vast::system
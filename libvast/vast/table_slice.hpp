@@ -134,6 +134,11 @@ public:
   /// Appends all values in column `col` to `idx`.
   virtual void append_column_to_index(size_type col, value_index& idx) const;
 
+  /// Adds all values in column `col` to `syn`. The default implementation
+  /// collects the values of the column and passes them to
+  /// `synopsis::add_batch` if the column has a type with a batch overload.
+  virtual void append_column_to_synopsis(size_type col, synopsis& syn) const;
+
   // -- properties -------------------------------------------------------------
 
   /// @returns the table slice header.
@@ -213,6 +218,11 @@ private:
 
 // -- free functions -----------------------------------------------------------
 
+/// Packs a table slice into a standalone flatbuffer.
+/// @param x The table slice to pack.
+/// @returns The finished TableSlice flatbuffer.
+caf::expected<chunk_ptr> pack(table_slice_ptr x);
+
 /// Packs a table slice into a flatbuffer.
 /// @param builder The builder to pack *x* into.
 /// @param x The table slice to pack.
@@ -220,6 +230,16 @@ private:
 caf::expected<flatbuffers::Offset<fbs::TableSliceBuffer>>
 pack(flatbuffers::FlatBufferBuilder& builder, table_slice_ptr x);
 
+/// Unpacks a table slice from a flatbuffer.
+/// @param x The flatbuffer to unpack.
+/// @param y The target to unpack *x* into.
+/// @param chunk The chunk that contains *x*. If not null, *y* becomes a view
+///              into the memory of *chunk* instead of a deserialized copy
+///              where its encoding supports it, and keeps *chunk* alive.
+/// @returns An error iff the operation fails.
+caf::error unpack(const fbs::TableSlice& x, table_slice_ptr& y,
+                  chunk_ptr chunk);
+
 /// Unpacks a table slice from a flatbuffer.
 /// @param x The flatbuffer to unpack.
 /// @param y The target to unpack *x* into.
@@ -73,10 +73,13 @@ public:
   /// @returns The result of the lookup or an error upon failure.
   caf::expected<ids> lookup(relational_operator op, data_view x) const;
 
-  /// Merges another value index with this one.
+  /// Merges another value index with this one, e.g., to combine the indexes
+  /// of adjacent partitions.
   /// @param other The value index to merge.
-  /// @returns `true` on success.
-  //bool merge(const value_index& other);
+  /// @pre All IDs in *other* are greater than the IDs in this index.
+  /// @returns An error if the indexes have a different structure, in which
+  ///          case this index is in an unspecified state.
+  caf::error merge(const value_index& other);
 
   /// Retrieves the ID of the last append operation.
   /// @returns The largest ID in the index.
@@ -98,12 +101,20 @@ protected:
   const ewah_bitmap& mask() const;
   const ewah_bitmap& none() const;
 
+  /// @returns an empty bitmap in the representation that the `bitmap` option
+  /// selects, which derived indexes use to seed their coders.
+  ids make_bitmap() const;
+
 private:
   virtual bool append_impl(data_view x, id pos) = 0;
 
   virtual caf::expected<ids>
   lookup_impl(relational_operator op, data_view x) const = 0;
 
+  /// Merges the index-specific state of *other*.
+  /// @pre `typeid(*this) == typeid(other)`
+  virtual bool merge_impl(const value_index& other) = 0;
+
   ewah_bitmap mask_;         ///< The position of all values excluding nil.
   ewah_bitmap none_;         ///< The positions of nil values.
   const vast::type type_;    ///< The type of this index.
@@ -226,12 +237,12 @@ public:
       if (i == options().end()) {
         // Some early experiments found that 8 yields the best average
         // performance, presumably because it's a power of 2.
-        bmi_ = bitmap_index_type{base::uniform<64>(8)};
+        bmi_ = bitmap_index_type{base::uniform<64>(8), make_bitmap()};
       } else {
         auto str = caf::get<caf::config_value::string>(i->second);
         auto b = to<base>(str);
         VAST_ASSERT(b); // pre-condition is that this was validated
-        bmi_ = bitmap_index_type{base{std::move(*b)}};
+        bmi_ = bitmap_index_type{base{std::move(*b)}, make_bitmap()};
       }
     }
   }
@@ -287,6 +298,11 @@ private:
     return caf::visit(f, d);
   };
 
+  bool merge_impl(const value_index& other) override {
+    bmi_.merge(static_cast<const arithmetic_index&>(other).bmi_);
+    return true;
+  }
+
   bitmap_index_type bmi_;
 };
 
@@ -315,6 +331,8 @@ private:
   caf::expected<ids>
   lookup_impl(relational_operator op, data_view x) const override;
 
+  bool merge_impl(const value_index& other) override;
+
   size_t max_length_;
   length_bitmap_index length_;
   std::vector<char_bitmap_index> chars_;
@@ -337,6 +355,8 @@ private:
   caf::expected<ids>
   lookup_impl(relational_operator op, data_view x) const override;
 
+  bool merge_impl(const value_index& other) override;
+
   index index_;
 };
 
@@ -358,6 +378,8 @@ private:
   caf::expected<ids>
   lookup_impl(relational_operator op, data_view x) const override;
 
+  bool merge_impl(const value_index& other) override;
+
   std::array<byte_index, 16> bytes_;
   type_index v4_;
 };
@@ -379,6 +401,8 @@ private:
   caf::expected<ids>
   lookup_impl(relational_operator op, data_view x) const override;
 
+  bool merge_impl(const value_index& other) override;
+
   address_index network_;
   prefix_index length_;
 };
@@ -410,6 +434,8 @@ private:
   caf::expected<ids>
   lookup_impl(relational_operator op, data_view x) const override;
 
+  bool merge_impl(const value_index& other) override;
+
   number_index num_;
   protocol_index proto_;
 };
@@ -436,6 +462,8 @@ private:
   caf::expected<ids>
   lookup_impl(relational_operator op, data_view x) const override;
 
+  bool merge_impl(const value_index& other) override;
+
   std::vector<value_index_ptr> elements_;
   size_t max_size_;
   size_bitmap_index size_;